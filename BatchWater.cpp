@@ -0,0 +1,591 @@
+/***********************************************************************
+BatchWater - Vrui application to run the GPU-based water flow
+simulation in a window, decoupled from a live sandbox, on a DEM, from a
+water checkpoint, or on a synthetic scenario for a given amount of
+simulated time as fast as possible, writing water level snapshots and
+reporting simulation throughput, or writing golden water level grids to
+check the CPU reference simulation against.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <Misc/SizedTypes.h>
+#include <Misc/StdError.h>
+#include <IO/File.h>
+#include <IO/OpenFile.h>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+#include <GL/gl.h>
+#include <GL/GLContextData.h>
+#include <Vrui/Vrui.h>
+#include <Vrui/Application.h>
+
+#include "Types.h"
+#include "TextureTracker.h"
+#include "WaterTable2.h"
+#include "WaterCheckpoint.h"
+#include "WaterScenario.h"
+#include "WaterGridFile.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline double getMonotonicTime(void) // Returns the current time of the monotonic clock in seconds
+	{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return double(now.tv_sec)+double(now.tv_nsec)*1.0e-9;
+	}
+
+void printUsage(void)
+	{
+	std::cout<<"Usage: SARndboxBatchWater [option 1] ... [option n]"<<std::endl;
+	std::cout<<"  SARndboxBatchWater is a Vrui application that opens a window to get an"<<std::endl;
+	std::cout<<"  OpenGL context for the GPU-based water flow simulation; it does not run"<<std::endl;
+	std::cout<<"  headless, and accepts Vrui's command line options in addition to these."<<std::endl;
+	std::cout<<"  Options:"<<std::endl;
+	std::cout<<"  -h"<<std::endl;
+	std::cout<<"     Prints this help message"<<std::endl;
+	std::cout<<"  -dem <DEM file name>"<<std::endl;
+	std::cout<<"     Simulates water flowing over the DEM in the given file, in the format"<<std::endl;
+	std::cout<<"     read by the AR Sandbox's DEM tool"<<std::endl;
+	std::cout<<"  -checkpoint <water checkpoint file name>"<<std::endl;
+	std::cout<<"     Starts from the bathymetry, water, snow, and simulation parameters in the"<<std::endl;
+	std::cout<<"     given water checkpoint file instead of a DEM"<<std::endl;
+	std::cout<<"  -scenario <scenario name>"<<std::endl;
+	std::cout<<"     Starts from one of SARndboxSimulateWater's synthetic scenarios (DamBreak,"<<std::endl;
+	std::cout<<"     Basin, or Trench) instead of a DEM"<<std::endl;
+	std::cout<<"  -wts <water grid width> <water grid height>"<<std::endl;
+	std::cout<<"     Resamples the DEM to a water table of the given size, or sets the size of"<<std::endl;
+	std::cout<<"     a synthetic scenario's water table"<<std::endl;
+	std::cout<<"     Default: DEM size plus one, so that bathymetry vertices match DEM postings,"<<std::endl;
+	std::cout<<"     or 320 240 for synthetic scenarios"<<std::endl;
+	std::cout<<"  -cs <cell size>"<<std::endl;
+	std::cout<<"     Sets the width and height of a synthetic scenario's water table cells"<<std::endl;
+	std::cout<<"     Default: 0.25"<<std::endl;
+	std::cout<<"  -waterLevel <initial water level>"<<std::endl;
+	std::cout<<"     Fills the DEM with water up to the given elevation at the start"<<std::endl;
+	std::cout<<"     Default: dry"<<std::endl;
+	std::cout<<"  -rain <rain rate>"<<std::endl;
+	std::cout<<"     Adds water uniformly at the given rate in elevation units per second"<<std::endl;
+	std::cout<<"     Default: 0.0"<<std::endl;
+	std::cout<<"  -time <simulated time>"<<std::endl;
+	std::cout<<"     Runs the simulation for the given number of simulated seconds; the last"<<std::endl;
+	std::cout<<"     step is shortened to end exactly at that time"<<std::endl;
+	std::cout<<"     Default: 60.0"<<std::endl;
+	std::cout<<"  -snapshots <water grid file name> <snapshot interval>"<<std::endl;
+	std::cout<<"     Writes the water level grid every given number of simulated seconds,"<<std::endl;
+	std::cout<<"     starting with the initial state, to a water grid file of the given name;"<<std::endl;
+	std::cout<<"     steps are shortened to end exactly at snapshot times"<<std::endl;
+	std::cout<<"  -golden <water grid file name> <num frames> <grid interval>"<<std::endl;
+	std::cout<<"     Runs the given number of display frames of 1/60 s the same way as"<<std::endl;
+	std::cout<<"     SARndboxSimulateWater, with up to 30 simulation steps per frame that end"<<std::endl;
+	std::cout<<"     exactly on frame boundaries, and writes the water level grid after every"<<std::endl;
+	std::cout<<"     given number of frames to a golden output file that SARndboxSimulateWater's"<<std::endl;
+	std::cout<<"     -check option can read; replaces -time, -snapshots, and -save"<<std::endl;
+	std::cout<<"  -save <water checkpoint file name>"<<std::endl;
+	std::cout<<"     Writes the final simulation state to a water checkpoint file of the given"<<std::endl;
+	std::cout<<"     name"<<std::endl;
+	std::cout<<"  -fused"<<std::endl;
+	std::cout<<"     Runs the second half of each simulation step as a single fused pass"<<std::endl;
+	std::cout<<"  -dts <dry tile size> <dry depth>"<<std::endl;
+	std::cout<<"     Skips simulating square tiles of the given size while they and their"<<std::endl;
+	std::cout<<"     neighbors contain no water deeper than the given depth; tile size 0"<<std::endl;
+	std::cout<<"     simulates the entire grid"<<std::endl;
+	std::cout<<"     Default: 0 0.001"<<std::endl;
+	std::cout<<"  -half"<<std::endl;
+	std::cout<<"     Stores temporal derivatives and water rates in half precision textures"<<std::endl;
+	}
+
+}
+
+class BatchWater:public Vrui::Application
+	{
+	/* Elements: */
+	private:
+	WaterTable2* waterTable; // The offline water table
+	std::vector<GLfloat> bathymetry; // Vertex-centered bathymetry grid resampled from the DEM or created by a synthetic scenario, or empty if starting from a checkpoint
+	GLfloat waterLevel; // Initial water level when starting from a DEM
+	std::vector<GLfloat> initialWater; // Initial cell-centered water level grid created by a synthetic scenario, or empty to use the initial water level
+	WaterCheckpoint* startCheckpoint; // Checkpoint holding the starting state, or null to start from the DEM
+	double simulationTime; // Amount of simulated time to run
+	std::string snapshotFileName; // Name of the water grid file receiving water level snapshots, or empty to not write snapshots
+	double snapshotInterval; // Amount of simulated time between water level snapshots
+	std::string goldenFileName; // Name of the water grid file receiving golden water level grids, or empty to run for a fixed simulated time
+	unsigned int numGoldenFrames; // Number of simulated display frames when writing golden water level grids
+	unsigned int goldenGridInterval; // Number of display frames between golden water level grids
+	std::string saveFileName; // Name of the water checkpoint file receiving the final state, or empty to not save it
+	mutable bool done; // Flag whether the simulation has been run
+	
+	/* Private methods: */
+	void loadDEM(const char* demFileName,const Size& waterTableSize); // Loads a DEM from the given file and creates a water table of the given size, or matching the DEM's size if zero, with a bathymetry grid resampled from the DEM
+	void createScenario(WaterScenario scenario,const Size& waterTableSize,GLfloat cellSize); // Creates a water table of the given size and cell size, with bathymetry and water from the given synthetic scenario
+	void writeGoldenGrids(GLContextData& contextData,TextureTracker& textureTracker) const; // Runs the simulation frame by frame like the CPU reference simulation and writes golden water level grids
+	
+	/* Constructors and destructors: */
+	public:
+	BatchWater(int& argc,char**& argv);
+	virtual ~BatchWater(void);
+	
+	/* Methods from Vrui::Application: */
+	virtual void display(GLContextData& contextData) const;
+	};
+
+/***************************
+Methods of class BatchWater:
+***************************/
+
+void BatchWater::loadDEM(const char* demFileName,const Size& waterTableSize)
+	{
+	/* Read the DEM file: */
+	IO::FilePtr demFile=IO::openFile(demFileName);
+	demFile->setEndianness(Misc::LittleEndian);
+	Size demSize;
+	demFile->read<int,unsigned int>(demSize.getComponents(),2);
+	if(demSize[0]<2||demSize[1]<2)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"DEM file %s has invalid size %u x %u",demFileName,demSize[0],demSize[1]);
+	double demBox[4];
+	demFile->read<float,double>(demBox,4);
+	std::vector<float> dem(size_t(demSize[1])*size_t(demSize[0]));
+	demFile->read(&dem.front(),dem.size());
+	
+	/* Create a water table whose bathymetry grid spans the DEM's postings: */
+	Size size=waterTableSize;
+	if(size[0]==0||size[1]==0)
+		size=Size(demSize[0]+1,demSize[1]+1);
+	if(size[0]<3||size[1]<3)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Invalid water table size %u x %u",size[0],size[1]);
+	GLfloat cellSize[2];
+	for(int i=0;i<2;++i)
+		cellSize[i]=GLfloat((demBox[2+i]-demBox[i])/double(size[i]-2));
+	waterTable=new WaterTable2(size,cellSize);
+	
+	/* Resample the DEM to the bathymetry grid using bilinear interpolation: */
+	Size bSize=waterTable->getBathymetrySize();
+	bathymetry.resize(size_t(bSize[1])*size_t(bSize[0]));
+	std::vector<GLfloat>::iterator bIt=bathymetry.begin();
+	for(unsigned int y=0;y<bSize[1];++y)
+		{
+		double dy=double(y)*double(demSize[1]-1)/double(bSize[1]-1);
+		unsigned int y0=Math::min((unsigned int)(dy),demSize[1]-2);
+		double wy=dy-double(y0);
+		for(unsigned int x=0;x<bSize[0];++x,++bIt)
+			{
+			double dx=double(x)*double(demSize[0]-1)/double(bSize[0]-1);
+			unsigned int x0=Math::min((unsigned int)(dx),demSize[0]-2);
+			double wx=dx-double(x0);
+			const float* d=&dem[size_t(y0)*size_t(demSize[0])+size_t(x0)];
+			double e0=double(d[0])*(1.0-wx)+double(d[1])*wx;
+			double e1=double(d[demSize[0]])*(1.0-wx)+double(d[demSize[0]+1])*wx;
+			*bIt=GLfloat(e0*(1.0-wy)+e1*wy);
+			}
+		}
+	}
+
+void BatchWater::createScenario(WaterScenario scenario,const Size& waterTableSize,GLfloat cellSize)
+	{
+	/* Scenarios with water sources need per-cell source rates, which the GPU simulation only receives from render functions: */
+	if(scenario==Rain)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Scenario %s requires a water source grid, which is not supported",getWaterScenarioName(scenario));
+	
+	/* Create a water table of the given size: */
+	Size size=waterTableSize;
+	if(size[0]==0||size[1]==0)
+		size=Size(320,240);
+	if(size[0]<3||size[1]<3)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Invalid water table size %u x %u",size[0],size[1]);
+	GLfloat cs[2]={cellSize,cellSize};
+	waterTable=new WaterTable2(size,cs);
+	
+	/* Create the scenario's bathymetry and initial water level grids: */
+	Size bSize=waterTable->getBathymetrySize();
+	bathymetry.resize(size_t(bSize[1])*size_t(bSize[0]));
+	createScenarioBathymetry(scenario,size,&bathymetry.front());
+	initialWater.resize(size_t(size[1])*size_t(size[0]));
+	std::vector<GLfloat> waterSource(initialWater.size());
+	createScenarioWater(scenario,size,&initialWater.front(),&waterSource.front());
+	}
+
+void BatchWater::writeGoldenGrids(GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Frame parameters matching SARndboxSimulateWater's defaults: */
+	const double frameTime=1.0/60.0;
+	const unsigned int waterMaxSteps=30;
+	
+	const Size& size=waterTable->getSize();
+	unsigned int numGrids=numGoldenFrames/goldenGridInterval;
+	
+	/* Write the file header: */
+	IO::FilePtr goldenFile=IO::openFile(goldenFileName.c_str(),IO::File::WriteOnly);
+	goldenFile->setEndianness(Misc::LittleEndian);
+	WaterGridFileHeader header;
+	for(int i=0;i<2;++i)
+		header.gridSize[i]=size[i];
+	header.numGrids=numGrids;
+	goldenFile->write(header.magic,sizeof(header.magic));
+	goldenFile->write(&header.version,1);
+	goldenFile->write(header.gridSize,2);
+	goldenFile->write(&header.numGrids,1);
+	
+	/* Run the simulation the same way the CPU reference simulation does in each frame: */
+	std::vector<GLfloat> grid(size_t(size[1])*size_t(size[0]));
+	double time=0.0;
+	unsigned int numSteps=0;
+	unsigned int numDeficitFrames=0;
+	double startTime=getMonotonicTime();
+	for(unsigned int frame=0;frame<numGoldenFrames;++frame)
+		{
+		GLfloat totalTimeStep=GLfloat(frameTime);
+		unsigned int numFrameSteps=0;
+		while(numFrameSteps<waterMaxSteps&&totalTimeStep>1.0e-8f)
+			{
+			/* Limit the step to the rest of the frame, and wait for its size, which is otherwise reported one step late: */
+			waterTable->setMaxStepSize(totalTimeStep);
+			GLfloat timeStep=waterTable->runSimulationStep(false,contextData,textureTracker);
+			timeStep+=waterTable->finishSimulationSteps(contextData);
+			totalTimeStep-=timeStep;
+			time+=double(timeStep);
+			++numFrameSteps;
+			}
+		numSteps+=numFrameSteps;
+		if(totalTimeStep>1.0e-8f)
+			++numDeficitFrames;
+		
+		if((frame+1)%goldenGridInterval==0)
+			{
+			/* Read back and write the current water level grid: */
+			waterTable->readQuantityTexture(contextData,textureTracker,GL_RED,&grid[0]);
+			goldenFile->write<Misc::Float64>(time);
+			goldenFile->write(&grid[0],grid.size());
+			}
+		}
+	double elapsed=getMonotonicTime()-startTime;
+	
+	std::cout<<std::fixed<<std::setprecision(4);
+	std::cout<<"Simulated "<<numGoldenFrames<<" frames ("<<time<<" s) on a "<<size[0]<<'x'<<size[1]<<" grid in "<<numSteps<<" steps and "<<elapsed<<" s";
+	std::cout<<", wrote "<<numGrids<<" golden water level grids to "<<goldenFileName<<std::endl;
+	if(numDeficitFrames!=0)
+		std::cout<<numDeficitFrames<<" frame(s) ran out of simulation steps"<<std::endl;
+	}
+
+BatchWater::BatchWater(int& argc,char**& argv)
+	:Vrui::Application(argc,argv),
+	 waterTable(0),
+	 waterLevel(-Math::Constants<GLfloat>::max),
+	 startCheckpoint(0),
+	 simulationTime(60.0),
+	 snapshotInterval(1.0),
+	 numGoldenFrames(300),goldenGridInterval(60),
+	 done(false)
+	{
+	/* Parse the command line: */
+	const char* demFileName=0;
+	const char* checkpointFileName=0;
+	bool haveScenario=false;
+	WaterScenario scenario=DamBreak;
+	Size waterTableSize(0,0);
+	GLfloat cellSize=0.25f;
+	GLfloat rainRate=0.0f;
+	bool fused=false;
+	unsigned int dryTileSize=0;
+	GLfloat dryDepth=1.0e-3f;
+	bool halfPrecision=false;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"h")==0)
+				{
+				printUsage();
+				Vrui::shutdown();
+				return;
+				}
+			else if(strcasecmp(argv[i]+1,"dem")==0&&i+1<argc)
+				{
+				++i;
+				demFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"checkpoint")==0&&i+1<argc)
+				{
+				++i;
+				checkpointFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"scenario")==0&&i+1<argc)
+				{
+				++i;
+				haveScenario=parseWaterScenario(argv[i],scenario);
+				if(!haveScenario)
+					std::cerr<<"Ignoring unrecognized scenario "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"wts")==0&&i+2<argc)
+				{
+				for(int j=0;j<2;++j)
+					waterTableSize[j]=(unsigned int)(atoi(argv[i+1+j]));
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"cs")==0&&i+1<argc)
+				{
+				++i;
+				cellSize=GLfloat(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"waterLevel")==0&&i+1<argc)
+				{
+				++i;
+				waterLevel=GLfloat(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"rain")==0&&i+1<argc)
+				{
+				++i;
+				rainRate=GLfloat(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"time")==0&&i+1<argc)
+				{
+				++i;
+				simulationTime=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"snapshots")==0&&i+2<argc)
+				{
+				snapshotFileName=argv[i+1];
+				snapshotInterval=atof(argv[i+2]);
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"golden")==0&&i+3<argc)
+				{
+				goldenFileName=argv[i+1];
+				numGoldenFrames=(unsigned int)(atoi(argv[i+2]));
+				goldenGridInterval=(unsigned int)(atoi(argv[i+3]));
+				i+=3;
+				}
+			else if(strcasecmp(argv[i]+1,"save")==0&&i+1<argc)
+				{
+				++i;
+				saveFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"fused")==0)
+				fused=true;
+			else if(strcasecmp(argv[i]+1,"dts")==0&&i+2<argc)
+				{
+				dryTileSize=(unsigned int)(atoi(argv[i+1]));
+				dryDepth=GLfloat(atof(argv[i+2]));
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"half")==0)
+				halfPrecision=true;
+			else
+				std::cerr<<"Ignoring unrecognized command line option "<<argv[i]<<std::endl;
+			}
+		else
+			std::cerr<<"Ignoring unrecognized command line argument "<<argv[i]<<std::endl;
+		}
+	if(!snapshotFileName.empty()&&snapshotInterval<=0.0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Snapshot interval must be positive");
+	if(!goldenFileName.empty()&&goldenGridInterval==0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Golden grid interval must be positive");
+	
+	/* Create the water table from the starting checkpoint or the DEM: */
+	if(checkpointFileName!=0)
+		{
+		startCheckpoint=new WaterCheckpoint(checkpointFileName);
+		waterTable=new WaterTable2(startCheckpoint->size,startCheckpoint->cellSize);
+		waterTable->restoreCheckpointParameters(*startCheckpoint);
+		if(demFileName!=0)
+			std::cerr<<"Ignoring DEM file "<<demFileName<<" in favor of water checkpoint file "<<checkpointFileName<<std::endl;
+		}
+	else if(haveScenario)
+		{
+		createScenario(scenario,waterTableSize,cellSize);
+		if(demFileName!=0)
+			std::cerr<<"Ignoring DEM file "<<demFileName<<" in favor of scenario "<<getWaterScenarioName(scenario)<<std::endl;
+		}
+	else if(demFileName!=0)
+		loadDEM(demFileName,waterTableSize);
+	else
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"No DEM file, water checkpoint file, or scenario provided");
+	
+	/* Configure the water table: */
+	if(rainRate!=0.0f)
+		waterTable->setWaterDeposit(rainRate);
+	waterTable->setFusedIntegration(fused);
+	waterTable->setDryTileSkipping(dryTileSize,dryDepth);
+	waterTable->setHalfPrecision(halfPrecision);
+	}
+
+BatchWater::~BatchWater(void)
+	{
+	delete waterTable;
+	delete startCheckpoint;
+	}
+
+void BatchWater::display(GLContextData& contextData) const
+	{
+	/* Run the simulation only once, in the first OpenGL context: */
+	if(done||waterTable==0)
+		return;
+	done=true;
+	
+	TextureTracker::initExtensions();
+	TextureTracker textureTracker;
+	const Size& size=waterTable->getSize();
+	
+	/* Initialize the simulation state: */
+	if(startCheckpoint!=0)
+		waterTable->restoreCheckpoint(*startCheckpoint,contextData,textureTracker);
+	else
+		{
+		waterTable->updateBathymetry(&bathymetry[0],contextData,textureTracker);
+		if(!initialWater.empty())
+			waterTable->setWaterLevel(&initialWater[0],contextData,textureTracker);
+		else
+			{
+			std::vector<GLfloat> waterGrid(size_t(size[1])*size_t(size[0]),waterLevel);
+			waterTable->setWaterLevel(&waterGrid[0],contextData,textureTracker);
+			}
+		}
+	
+	if(!goldenFileName.empty())
+		{
+		/* Write golden water level grids instead of running for a fixed simulated time: */
+		writeGoldenGrids(contextData,textureTracker);
+		Vrui::shutdown();
+		return;
+		}
+	
+	/* Start the snapshot file: */
+	IO::FilePtr snapshotFile;
+	unsigned int numSnapshots=0;
+	if(!snapshotFileName.empty())
+		{
+		snapshotFile=IO::openFile(snapshotFileName.c_str(),IO::File::WriteOnly);
+		snapshotFile->setEndianness(Misc::LittleEndian);
+		
+		/* Write the file header, with one snapshot at the start and one after each full interval: */
+		numSnapshots=(unsigned int)(Math::floor(simulationTime/snapshotInterval+1.0e-9))+1;
+		WaterGridFileHeader header;
+		for(int i=0;i<2;++i)
+			header.gridSize[i]=size[i];
+		header.numGrids=numSnapshots;
+		snapshotFile->write(header.magic,sizeof(header.magic));
+		snapshotFile->write(&header.version,1);
+		snapshotFile->write(header.gridSize,2);
+		snapshotFile->write(&header.numGrids,1);
+		}
+	std::vector<GLfloat> snapshot(size_t(size[1])*size_t(size[0]));
+	
+	/* Run the simulation; step sizes are reported one step late, so the simulation time lags behind the state by the step in flight: */
+	GLfloat maxStepSize=waterTable->getMaxStepSize();
+	double time=0.0;
+	GLfloat inFlightMaxStepSize=0.0f; // Upper bound on the size of the step in flight, or zero if there is none
+	unsigned int numSteps=0;
+	unsigned int nextSnapshot=0;
+	double snapshotElapsed=0.0;
+	double startTime=getMonotonicTime();
+	while(true)
+		{
+		/* Find the time of the next snapshot or the end of the simulation, whichever comes first: */
+		double nextEventTime=simulationTime;
+		if(nextSnapshot<numSnapshots)
+			nextEventTime=Math::min(nextEventTime,double(nextSnapshot)*snapshotInterval);
+		
+		/* Check if the step in flight and the next step together might reach the next event: */
+		if(time+double(inFlightMaxStepSize)+double(maxStepSize)>=nextEventTime)
+			{
+			/* Account for the step in flight to get the exact time of the current state: */
+			time+=double(waterTable->finishSimulationSteps(contextData));
+			inFlightMaxStepSize=0.0f;
+			
+			/* Check if the simulation reached the next event, up to the rounding of single-precision step sizes: */
+			if(nextEventTime-time<=nextEventTime*1.0e-6)
+				{
+				if(nextSnapshot<numSnapshots&&nextEventTime>=double(nextSnapshot)*snapshotInterval)
+					{
+					double snapshotStartTime=getMonotonicTime();
+					
+					/* Read back and write the current water level grid: */
+					waterTable->readQuantityTexture(contextData,textureTracker,GL_RED,&snapshot[0]);
+					snapshotFile->write<Misc::Float64>(time);
+					snapshotFile->write(&snapshot[0],snapshot.size());
+					++nextSnapshot;
+					
+					snapshotElapsed+=getMonotonicTime()-snapshotStartTime;
+					}
+				
+				if(nextEventTime>=simulationTime)
+					break;
+				
+				continue;
+				}
+			}
+		
+		/* Run the next step, limited to end exactly at the next event if there is no step in flight: */
+		GLfloat stepSizeLimit=maxStepSize;
+		if(inFlightMaxStepSize==0.0f)
+			stepSizeLimit=Math::min(stepSizeLimit,GLfloat(nextEventTime-time));
+		waterTable->setMaxStepSize(stepSizeLimit);
+		time+=double(waterTable->runSimulationStep(false,contextData,textureTracker));
+		inFlightMaxStepSize=stepSizeLimit;
+		++numSteps;
+		}
+	waterTable->setMaxStepSize(maxStepSize);
+	glFinish();
+	double elapsed=getMonotonicTime()-startTime;
+	
+	if(!saveFileName.empty())
+		{
+		/* Read back the final simulation state and write it to a checkpoint file: */
+		waterTable->startCheckpoint(contextData,textureTracker);
+		WaterCheckpoint* checkpoint;
+		while((checkpoint=waterTable->finishCheckpoint(contextData,true))==0)
+			;
+		try
+			{
+			checkpoint->write(saveFileName.c_str());
+			}
+		catch(const std::runtime_error& err)
+			{
+			std::cerr<<"Cannot write water checkpoint file "<<saveFileName<<" due to exception "<<err.what()<<std::endl;
+			}
+		delete checkpoint;
+		}
+	
+	/* Print the results, excluding the time spent reading back and writing snapshots from the throughput: */
+	double simElapsed=elapsed-snapshotElapsed;
+	std::cout<<std::fixed<<std::setprecision(1);
+	std::cout<<"Simulated "<<time<<" s on a "<<size[0]<<'x'<<size[1]<<" grid in "<<numSteps<<" steps and "<<elapsed<<" s";
+	if(nextSnapshot>0)
+		std::cout<<", including "<<snapshotElapsed<<" s for "<<nextSnapshot<<" snapshots";
+	std::cout<<std::endl;
+	std::cout<<std::setw(12)<<double(numSteps)/simElapsed<<" steps/s";
+	std::cout<<std::setw(14)<<double(size[0])*double(size[1])*double(numSteps)/simElapsed<<" cells/s";
+	std::cout<<std::setw(12)<<time/simElapsed<<" simulated s/s"<<std::endl;
+	
+	/* Exit the application: */
+	Vrui::shutdown();
+	}
+
+VRUI_APPLICATION_RUN(BatchWater)
@@ -207,7 +207,7 @@ std::ostream& printFloat8(std::ostream& os,double value)
 
 }
 
-void BathymetrySaverTool::writeDEMFile(void) const
+void BathymetrySaverTool::writeDEMFile(const GLfloat* bathymetry) const
 	{
 	/* Open the output file as a std::ostream: */
 	IO::OStream demFile(IO::openFile(configuration.saveFileName.c_str(),IO::File::WriteOnly));
@@ -257,8 +257,8 @@ void BathymetrySaverTool::writeDEMFile(void) const
 	
 	/* Calculate and write the grid's elevation range: */
 	GLfloat elevMin,elevMax;
-	elevMin=elevMax=bathymetryBuffer[0];
-	const GLfloat* bbPtr=bathymetryBuffer+1;
+	elevMin=elevMax=bathymetry[0];
+	const GLfloat* bbPtr=bathymetry+1;
 	for(GLsizei count=factory->gridSize[1]*factory->gridSize[0]-1;count>0;--count,++bbPtr)
 		{
 		if(elevMin>*bbPtr)
@@ -325,7 +325,7 @@ void BathymetrySaverTool::writeDEMFile(void) const
 		printFloat8(demFile,elevationBase); // Local datum elevation
 		
 		/* Calculate and write the profile's elevation range: */
-		const GLfloat* pPtr=bathymetryBuffer+column;
+		const GLfloat* pPtr=bathymetry+column;
 		GLfloat elevMin,elevMax;
 		elevMin=elevMax=*pPtr;
 		pPtr+=factory->gridSize[0];
@@ -343,7 +343,7 @@ void BathymetrySaverTool::writeDEMFile(void) const
 		fileSize+=6*4+24*5;
 		
 		/* Quantize and write the profile's elevation postings: */
-		pPtr=bathymetryBuffer+column;
+		pPtr=bathymetry+column;
 		for(GLsizei count=factory->gridSize[1];count>0;--count,pPtr+=factory->gridSize[0])
 			{
 			/* Check if there is enough space left in the current 1024-character record: */
@@ -579,14 +579,14 @@ void BathymetrySaverTool::postUpdate(void) const
 	// std::cout<<std::endl;
 	}
 
-void BathymetrySaverTool::readBackCallback(GLfloat* bathymetryBuffer,GLfloat*,GLfloat*,void* userData)
+void BathymetrySaverTool::readBackCallback(const GridReadbackPtr& readback,void* userData)
 	{
 	BathymetrySaverTool* thisPtr=static_cast<BathymetrySaverTool*>(userData);
 	
 	try
 		{
 		/* Export the bathymetry grid: */
-		thisPtr->writeDEMFile();
+		thisPtr->writeDEMFile(readback->getBathymetry());
 		
 		if(thisPtr->configuration.postUpdate)
 			{
@@ -612,14 +612,12 @@ BathymetrySaverToolFactory* BathymetrySaverTool::initClass(WaterTable2* sWaterTa
 
 BathymetrySaverTool::BathymetrySaverTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputAssignment& inputAssignment)
 	:Vrui::Tool(factory,inputAssignment),
-	 configuration(BathymetrySaverTool::factory->configuration),
-	 bathymetryBuffer(new GLfloat[BathymetrySaverTool::factory->gridSize[1]*BathymetrySaverTool::factory->gridSize[0]])
+	 configuration(BathymetrySaverTool::factory->configuration)
 	{
 	}
 
 BathymetrySaverTool::~BathymetrySaverTool(void)
 	{
-	delete[] bathymetryBuffer;
 	}
 
 void BathymetrySaverTool::configure(const Misc::ConfigurationFileSection& configFileSection)
@@ -634,6 +632,12 @@ void BathymetrySaverTool::storeState(Misc::ConfigurationFileSection& configFileS
 	configuration.write(configFileSection);
 	}
 
+void BathymetrySaverTool::deinitialize(void)
+	{
+	/* Cancel any outstanding grid request, so that its callback does not outlive this tool: */
+	application->gridRequest.cancelRequests(this);
+	}
+
 const Vrui::ToolFactory* BathymetrySaverTool::getFactory(void) const
 	{
 	return factory;
@@ -644,6 +648,6 @@ void BathymetrySaverTool::buttonCallback(int buttonSlotIndex,Vrui::InputDevice::
 	if(cbData->newButtonState)
 		{
 		/* Request a bathymetry grid from the water table: */
-		application->gridRequest.requestGrids(bathymetryBuffer,0,0,&BathymetrySaverTool::readBackCallback,this);
+		application->gridRequest.requestGrids(GridReadback::Bathymetry,&BathymetrySaverTool::readBackCallback,this);
 		}
 	}
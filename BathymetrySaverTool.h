@@ -29,6 +29,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <Vrui/Application.h>
 
 #include "Types.h"
+#include "GridReadback.h"
 
 /* Forward declarations: */
 class WaterTable2;
@@ -88,12 +89,11 @@ class BathymetrySaverTool:public Vrui::Tool,public Vrui::Application::Tool<Sandb
 	private:
 	static BathymetrySaverToolFactory* factory; // Pointer to the factory object for this class
 	BathymetrySaverToolFactory::Configuration configuration; // Configuration of this tool
-	GLfloat* bathymetryBuffer; // Bathymetry grid buffer
 	
 	/* Private methods: */
-	void writeDEMFile(void) const; // Writes the bathymetry grid to a file in USGS DEM format
+	void writeDEMFile(const GLfloat* bathymetry) const; // Writes the given bathymetry grid to a file in USGS DEM format
 	void postUpdate(void) const; // Sends an update message to a web server
-	static void readBackCallback(GLfloat* bathymetryBuffer,GLfloat* waterLevelBuffer,GLfloat*,void* userData); // Callback when a grid has been read back from the GPU
+	static void readBackCallback(const GridReadbackPtr& readback,void* userData); // Callback when a grid has been read back from the GPU
 	
 	/* Constructors and destructors: */
 	public:
@@ -104,6 +104,7 @@ class BathymetrySaverTool:public Vrui::Tool,public Vrui::Application::Tool<Sandb
 	/* Methods from class Vrui::Tool: */
 	virtual void configure(const Misc::ConfigurationFileSection& configFileSection);
 	virtual void storeState(Misc::ConfigurationFileSection& configFileSection) const;
+	virtual void deinitialize(void);
 	virtual const Vrui::ToolFactory* getFactory(void) const;
 	virtual void buttonCallback(int buttonSlotIndex,Vrui::InputDevice::ButtonCallbackData* cbData);
 	};
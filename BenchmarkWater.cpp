@@ -0,0 +1,492 @@
+/***********************************************************************
+BenchmarkWater - Utility to measure the throughput of the GPU-based
+water flow simulation at several water table sizes, with and without
+fused integration passes, and in single or half precision, and to
+compare the results of simulation variants against each other.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <Math/Math.h>
+#include <GL/gl.h>
+#include <GL/GLContextData.h>
+#include <Vrui/Vrui.h>
+#include <Vrui/Application.h>
+
+#include "Types.h"
+#include "TextureTracker.h"
+#include "WaterTable2.h"
+#include "WaterCheckpoint.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline double getMonotonicTime(void) // Returns the current time of the monotonic clock in seconds
+	{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return double(now.tv_sec)+double(now.tv_nsec)*1.0e-9;
+	}
+
+void printUsage(void)
+	{
+	std::cout<<"Usage: SARndboxBenchmarkWater [option 1] ... [option n]"<<std::endl;
+	std::cout<<"  Options:"<<std::endl;
+	std::cout<<"  -h"<<std::endl;
+	std::cout<<"     Prints this help message"<<std::endl;
+	std::cout<<"  -wts <water grid width> <water grid height>"<<std::endl;
+	std::cout<<"     Adds a water table size to the benchmark; can be given multiple times"<<std::endl;
+	std::cout<<"     Default: 640 480 and 1280 960"<<std::endl;
+	std::cout<<"  -domain <domain width> <domain height>"<<std::endl;
+	std::cout<<"     Sets the size of the simulated domain in cm, independent of water table"<<std::endl;
+	std::cout<<"     size"<<std::endl;
+	std::cout<<"     Default: 100.0 75.0"<<std::endl;
+	std::cout<<"  -steps <number of warm-up steps> <number of timed steps>"<<std::endl;
+	std::cout<<"     Sets the number of untimed and timed simulation steps per run"<<std::endl;
+	std::cout<<"     Default: 50 500"<<std::endl;
+	std::cout<<"  -fused <fused mode>"<<std::endl;
+	std::cout<<"     Selects which integration variant(s) to run: Separate, Fused, or Both"<<std::endl;
+	std::cout<<"     Default: Both"<<std::endl;
+	std::cout<<"  -dts <dry tile size> <dry depth>"<<std::endl;
+	std::cout<<"     Skips simulating square tiles of the given size while they and their"<<std::endl;
+	std::cout<<"     neighbors contain no water deeper than the given depth; tile size 0"<<std::endl;
+	std::cout<<"     simulates the entire grid"<<std::endl;
+	std::cout<<"     Default: 0 0.001"<<std::endl;
+	std::cout<<"  -half"<<std::endl;
+	std::cout<<"     Stores temporal derivatives and water rates in half precision textures"<<std::endl;
+	std::cout<<"  -checkpoint <water checkpoint file name>"<<std::endl;
+	std::cout<<"     Starts every run from the simulation state and parameters in the given"<<std::endl;
+	std::cout<<"     water checkpoint file instead of the synthetic scenario; replaces all"<<std::endl;
+	std::cout<<"     water table sizes with the checkpoint's size"<<std::endl;
+	std::cout<<"  -compare <comparison>"<<std::endl;
+	std::cout<<"     Instead of measuring throughput, runs two simulation variants from the"<<std::endl;
+	std::cout<<"     same starting state with identical step sizes, and reports the maximum"<<std::endl;
+	std::cout<<"     differences between their conserved quantities and their water volume"<<std::endl;
+	std::cout<<"     drifts; Fused compares the fused integration pass against the separate"<<std::endl;
+	std::cout<<"     passes, DryTiles compares dry tile skipping using the tile size given"<<std::endl;
+	std::cout<<"     by -dts (or 32) against simulating the entire grid, using the"<<std::endl;
+	std::cout<<"     integration variant selected by -fused"<<std::endl;
+	}
+
+}
+
+class BenchmarkWater:public Vrui::Application
+	{
+	/* Embedded classes: */
+	private:
+	enum Comparison // Enumerated type for pairs of simulation variants to compare
+		{
+		NoComparison, // Measure throughput instead
+		CompareFused, // Compare the fused integration pass against the separate passes
+		CompareDryTiles // Compare dry tile skipping against simulating the entire grid
+		};
+	
+	/* Elements: */
+	std::vector<WaterTable2*> waterTables; // Water tables of all benchmarked sizes
+	unsigned int numWarmupSteps; // Number of untimed simulation steps at the beginning of each run
+	unsigned int numSteps; // Number of timed simulation steps in each run
+	bool runVariants[2]; // Flags whether to run the separate and the fused integration variants
+	unsigned int dryTileSize; // Size of dry skipping tiles, or 0 to simulate the entire grid
+	GLfloat dryDepth; // Water column height below which a cell counts as dry for dry tile skipping
+	WaterCheckpoint* startCheckpoint; // Checkpoint holding the starting state of every run, or null to start from the synthetic scenario
+	Comparison comparison; // Pair of simulation variants to compare instead of measuring throughput
+	mutable bool done; // Flag whether the benchmark has been run
+	
+	/* Private methods: */
+	void initSimulation(WaterTable2& waterTable,bool fused,unsigned int tileSize,GLContextData& contextData,TextureTracker& textureTracker) const; // Selects the given integration variant and dry tile size and sets the given water table to the starting state
+	void runBenchmark(WaterTable2& waterTable,bool fused,GLContextData& contextData) const; // Runs one benchmark on the given water table using the given integration variant
+	double calcWaterVolume(WaterTable2& waterTable,GLContextData& contextData,TextureTracker& textureTracker) const; // Returns the total water volume in the given water table's current state
+	void runComparison(WaterTable2& waterTable,GLContextData& contextData) const; // Runs the two simulation variants selected by the comparison on the given water table and prints the differences between their results
+	
+	/* Constructors and destructors: */
+	public:
+	BenchmarkWater(int& argc,char**& argv);
+	virtual ~BenchmarkWater(void);
+	
+	/* Methods from Vrui::Application: */
+	virtual void display(GLContextData& contextData) const;
+	};
+
+/*******************************
+Methods of class BenchmarkWater:
+*******************************/
+
+void BenchmarkWater::initSimulation(WaterTable2& waterTable,bool fused,unsigned int tileSize,GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	const Size& size=waterTable.getSize();
+	
+	/* Initialize the water table: */
+	waterTable.setFusedIntegration(fused);
+	waterTable.setDryTileSkipping(tileSize,dryDepth);
+	if(startCheckpoint!=0)
+		{
+		/* Start from the checkpoint's simulation state: */
+		waterTable.restoreCheckpoint(*startCheckpoint,contextData,textureTracker);
+		}
+	else
+		{
+		/* Create a bowl-shaped bathymetry with a ripple pattern: */
+		Size bSize=waterTable.getBathymetrySize();
+		std::vector<GLfloat> bathymetry(bSize[0]*bSize[1]);
+		std::vector<GLfloat>::iterator bIt=bathymetry.begin();
+		for(unsigned int y=0;y<bSize[1];++y)
+			{
+			float v=(float(y)+1.0f)/float(size[1])-0.5f;
+			for(unsigned int x=0;x<bSize[0];++x,++bIt)
+				{
+				float u=(float(x)+1.0f)/float(size[0])-0.5f;
+				*bIt=20.0f*(u*u+v*v)+Math::sin(u*40.0f)*Math::cos(v*30.0f);
+				}
+			}
+		
+		/* Create a tilted water surface that keeps most of the domain wet: */
+		std::vector<GLfloat> waterLevel(size[0]*size[1]);
+		std::vector<GLfloat>::iterator wIt=waterLevel.begin();
+		for(unsigned int y=0;y<size[1];++y)
+			for(unsigned int x=0;x<size[0];++x,++wIt)
+				*wIt=3.0f+4.0f*((float(x)+0.5f)/float(size[0])-0.5f);
+		
+		waterTable.updateBathymetry(&bathymetry[0],contextData,textureTracker);
+		waterTable.setWaterLevel(&waterLevel[0],contextData,textureTracker);
+		}
+	}
+
+void BenchmarkWater::runBenchmark(WaterTable2& waterTable,bool fused,GLContextData& contextData) const
+	{
+	TextureTracker textureTracker;
+	const Size& size=waterTable.getSize();
+	
+	/* Initialize the water table: */
+	initSimulation(waterTable,fused,dryTileSize,contextData,textureTracker);
+	
+	/* Run the warm-up steps: */
+	for(unsigned int i=0;i<numWarmupSteps;++i)
+		waterTable.runSimulationStep(false,contextData,textureTracker);
+	waterTable.finishSimulationSteps(contextData);
+	glFinish();
+	
+	/* Run the timed steps: */
+	double simulatedTime=0.0;
+	double startTime=getMonotonicTime();
+	for(unsigned int i=0;i<numSteps;++i)
+		simulatedTime+=double(waterTable.runSimulationStep(false,contextData,textureTracker));
+	simulatedTime+=double(waterTable.finishSimulationSteps(contextData));
+	glFinish();
+	double elapsed=getMonotonicTime()-startTime;
+	
+	/* Print the results: */
+	std::cout<<std::setw(5)<<size[0]<<'x'<<std::setw(4)<<std::left<<size[1]<<std::right;
+	std::cout<<(waterTable.getHalfPrecision()?"  half  ":"  single");
+	std::cout<<(fused?"  fused   ":"  separate");
+	std::cout<<std::setw(12)<<double(numSteps)/elapsed<<" steps/s";
+	std::cout<<std::setw(14)<<double(size[0])*double(size[1])*double(numSteps)/elapsed<<" cells/s";
+	std::cout<<std::setw(12)<<simulatedTime/elapsed<<" simulated s/s";
+	if(dryTileSize!=0)
+		std::cout<<std::setw(8)<<waterTable.getActiveTileFraction(contextData)*100.0f<<"% active";
+	std::cout<<std::endl;
+	}
+
+double BenchmarkWater::calcWaterVolume(WaterTable2& waterTable,GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Read back the current bathymetry and water level grids: */
+	const Size& size=waterTable.getSize();
+	Size bSize=waterTable.getBathymetrySize();
+	std::vector<GLfloat> bathymetry(size_t(bSize[1])*size_t(bSize[0]));
+	waterTable.readBathymetryTexture(contextData,textureTracker,&bathymetry[0]);
+	std::vector<GLfloat> waterLevel(size_t(size[1])*size_t(size[0]));
+	waterTable.readQuantityTexture(contextData,textureTracker,GL_RED,&waterLevel[0]);
+	
+	/* Accumulate the water column heights of all cells in double precision, matching the health statistics shader's clamped bathymetry lookups: */
+	double volume=0.0;
+	std::vector<GLfloat>::const_iterator wIt=waterLevel.begin();
+	for(unsigned int y=0;y<size[1];++y)
+		{
+		unsigned int by0=y>0?y-1:0;
+		unsigned int by1=Math::min(y,bSize[1]-1);
+		const GLfloat* b0=&bathymetry[by0*bSize[0]];
+		const GLfloat* b1=&bathymetry[by1*bSize[0]];
+		for(unsigned int x=0;x<size[0];++x,++wIt)
+			{
+			unsigned int bx0=x>0?x-1:0;
+			unsigned int bx1=Math::min(x,bSize[0]-1);
+			volume+=double(*wIt)-double(b0[bx0]+b0[bx1]+b1[bx0]+b1[bx1])*0.25;
+			}
+		}
+	
+	return volume*double(waterTable.getCellSize()[0])*double(waterTable.getCellSize()[1]);
+	}
+
+void BenchmarkWater::runComparison(WaterTable2& waterTable,GLContextData& contextData) const
+	{
+	TextureTracker textureTracker;
+	const Size& size=waterTable.getSize();
+	size_t numCells=size_t(size[1])*size_t(size[0]);
+	GLfloat maxStepSize=waterTable.getMaxStepSize();
+	
+	/* Select the two variants to compare: */
+	const char* variantNames[2];
+	bool fused[2];
+	unsigned int tileSizes[2];
+	if(comparison==CompareDryTiles)
+		{
+		variantNames[0]="full grid";
+		variantNames[1]="dry tiles";
+		fused[0]=fused[1]=!runVariants[0];
+		tileSizes[0]=0;
+		tileSizes[1]=dryTileSize;
+		}
+	else
+		{
+		variantNames[0]="separate";
+		variantNames[1]="fused";
+		fused[0]=false;
+		fused[1]=true;
+		tileSizes[0]=tileSizes[1]=dryTileSize;
+		}
+	
+	/* Run both variants from the same starting state for the same number of steps: */
+	std::vector<GLfloat> stepSizes;
+	std::vector<GLfloat> quantities[2];
+	double simulatedTimes[2];
+	double volumes[2][2]; // Initial and final water volume of each variant
+	for(int variant=0;variant<2;++variant)
+		{
+		initSimulation(waterTable,fused[variant],tileSizes[variant],contextData,textureTracker);
+		volumes[variant][0]=calcWaterVolume(waterTable,contextData,textureTracker);
+		
+		/* Let the first variant choose its step sizes, and force the second variant to take the same steps; wait for each step's size, which is otherwise reported one step late: */
+		simulatedTimes[variant]=0.0;
+		for(unsigned int i=0;i<numWarmupSteps+numSteps;++i)
+			{
+			GLfloat stepSize;
+			if(variant==0)
+				{
+				waterTable.setMaxStepSize(maxStepSize);
+				stepSize=waterTable.runSimulationStep(false,contextData,textureTracker);
+				stepSize+=waterTable.finishSimulationSteps(contextData);
+				stepSizes.push_back(stepSize);
+				}
+			else
+				{
+				waterTable.setMaxStepSize(stepSizes[i]);
+				stepSize=waterTable.runSimulationStep(true,contextData,textureTracker);
+				stepSize+=waterTable.finishSimulationSteps(contextData);
+				}
+			simulatedTimes[variant]+=double(stepSize);
+			}
+		
+		/* Read back the final conserved quantities: */
+		quantities[variant].resize(numCells*3);
+		waterTable.readQuantityTexture(contextData,textureTracker,GL_RGB,&quantities[variant][0]);
+		volumes[variant][1]=calcWaterVolume(waterTable,contextData,textureTracker);
+		}
+	waterTable.setMaxStepSize(maxStepSize);
+	
+	/* Find the maximum differences between the two variants' water levels and fluxes: */
+	GLfloat maxDiffs[3]={0.0f,0.0f,0.0f};
+	size_t numInvalidCells=0;
+	for(size_t cell=0;cell<numCells;++cell)
+		for(int i=0;i<3;++i)
+			{
+			GLfloat diff=Math::abs(quantities[1][cell*3+i]-quantities[0][cell*3+i]);
+			if(diff==diff)
+				maxDiffs[i]=Math::max(maxDiffs[i],diff);
+			else
+				++numInvalidCells; // Catches NaNs
+			}
+	
+	/* Print the results: */
+	std::cout<<std::setw(5)<<size[0]<<'x'<<std::setw(4)<<std::left<<size[1]<<std::right;
+	std::cout<<(waterTable.getHalfPrecision()?"  half  ":"  single");
+	std::cout<<"  "<<variantNames[1]<<" vs. "<<variantNames[0]<<" after "<<numWarmupSteps+numSteps<<" steps ("<<std::setprecision(4)<<simulatedTimes[0]<<" s):";
+	std::cout<<std::scientific<<std::setprecision(3);
+	std::cout<<" max water level diff "<<maxDiffs[0]<<", max flux diffs "<<maxDiffs[1]<<' '<<maxDiffs[2];
+	for(int variant=0;variant<2;++variant)
+		std::cout<<", "<<variantNames[variant]<<" volume drift "<<(volumes[variant][1]-volumes[variant][0])/volumes[variant][0];
+	std::cout<<std::fixed<<std::setprecision(1);
+	if(numInvalidCells!=0)
+		std::cout<<", "<<numInvalidCells<<" NaN values";
+	std::cout<<std::endl;
+	}
+
+BenchmarkWater::BenchmarkWater(int& argc,char**& argv)
+	:Vrui::Application(argc,argv),
+	 numWarmupSteps(50),numSteps(500),
+	 dryTileSize(0),dryDepth(1.0e-3f),
+	 startCheckpoint(0),
+	 comparison(NoComparison),
+	 done(false)
+	{
+	/* Parse the command line: */
+	std::vector<Size> sizes;
+	GLfloat domainSize[2]={100.0f,75.0f};
+	bool halfPrecision=false;
+	runVariants[0]=runVariants[1]=true;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"h")==0)
+				{
+				printUsage();
+				Vrui::shutdown();
+				return;
+				}
+			else if(strcasecmp(argv[i]+1,"wts")==0&&i+2<argc)
+				{
+				Size size;
+				for(int j=0;j<2;++j)
+					size[j]=(unsigned int)(atoi(argv[i+1+j]));
+				sizes.push_back(size);
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"domain")==0&&i+2<argc)
+				{
+				for(int j=0;j<2;++j)
+					domainSize[j]=GLfloat(atof(argv[i+1+j]));
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"steps")==0&&i+2<argc)
+				{
+				numWarmupSteps=(unsigned int)(atoi(argv[i+1]));
+				numSteps=(unsigned int)(atoi(argv[i+2]));
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"fused")==0&&i+1<argc)
+				{
+				++i;
+				runVariants[0]=strcasecmp(argv[i],"Separate")==0||strcasecmp(argv[i],"Both")==0;
+				runVariants[1]=strcasecmp(argv[i],"Fused")==0||strcasecmp(argv[i],"Both")==0;
+				if(!runVariants[0]&&!runVariants[1])
+					{
+					std::cerr<<"Ignoring unrecognized fused mode "<<argv[i]<<std::endl;
+					runVariants[0]=runVariants[1]=true;
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"dts")==0&&i+2<argc)
+				{
+				dryTileSize=(unsigned int)(atoi(argv[i+1]));
+				dryDepth=GLfloat(atof(argv[i+2]));
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"half")==0)
+				halfPrecision=true;
+			else if(strcasecmp(argv[i]+1,"checkpoint")==0&&i+1<argc)
+				{
+				++i;
+				try
+					{
+					delete startCheckpoint;
+					startCheckpoint=0;
+					startCheckpoint=new WaterCheckpoint(argv[i]);
+					}
+				catch(const std::runtime_error& err)
+					{
+					std::cerr<<"Ignoring water checkpoint file "<<argv[i]<<" due to exception "<<err.what()<<std::endl;
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"compare")==0&&i+1<argc)
+				{
+				++i;
+				if(strcasecmp(argv[i],"Fused")==0)
+					comparison=CompareFused;
+				else if(strcasecmp(argv[i],"DryTiles")==0)
+					comparison=CompareDryTiles;
+				else
+					std::cerr<<"Ignoring unrecognized comparison "<<argv[i]<<std::endl;
+				}
+			else
+				std::cerr<<"Ignoring unrecognized command line option "<<argv[i]<<std::endl;
+			}
+		else
+			std::cerr<<"Ignoring unrecognized command line argument "<<argv[i]<<std::endl;
+		}
+	if(comparison==CompareDryTiles&&dryTileSize==0)
+		{
+		/* Dry tile skipping must be enabled to compare it against the entire grid: */
+		dryTileSize=32;
+		}
+	if(startCheckpoint!=0)
+		{
+		/* Create a single offline water table matching the checkpoint: */
+		waterTables.push_back(new WaterTable2(startCheckpoint->size,startCheckpoint->cellSize));
+		waterTables.back()->restoreCheckpointParameters(*startCheckpoint);
+		waterTables.back()->setHalfPrecision(halfPrecision);
+		return;
+		}
+	if(sizes.empty())
+		{
+		sizes.push_back(Size(640,480));
+		sizes.push_back(Size(1280,960));
+		}
+	
+	/* Create offline water tables for all requested sizes, covering the same domain: */
+	for(std::vector<Size>::iterator sIt=sizes.begin();sIt!=sizes.end();++sIt)
+		{
+		GLfloat cellSize[2];
+		for(int j=0;j<2;++j)
+			cellSize[j]=domainSize[j]/GLfloat((*sIt)[j]);
+		waterTables.push_back(new WaterTable2(*sIt,cellSize));
+		waterTables.back()->setHalfPrecision(halfPrecision);
+		}
+	}
+
+BenchmarkWater::~BenchmarkWater(void)
+	{
+	for(std::vector<WaterTable2*>::iterator wtIt=waterTables.begin();wtIt!=waterTables.end();++wtIt)
+		delete *wtIt;
+	delete startCheckpoint;
+	}
+
+void BenchmarkWater::display(GLContextData& contextData) const
+	{
+	/* Run the benchmark only once, in the first OpenGL context: */
+	if(done)
+		return;
+	done=true;
+	
+	/* Run all benchmarks: */
+	TextureTracker::initExtensions();
+	std::cout<<std::fixed<<std::setprecision(1);
+	for(std::vector<WaterTable2*>::const_iterator wtIt=waterTables.begin();wtIt!=waterTables.end();++wtIt)
+		{
+		if(comparison!=NoComparison)
+			runComparison(**wtIt,contextData);
+		else
+			{
+			for(int variant=0;variant<2;++variant)
+				if(runVariants[variant])
+					runBenchmark(**wtIt,variant!=0,contextData);
+			}
+		}
+	
+	/* Exit the application: */
+	Vrui::shutdown();
+	}
+
+VRUI_APPLICATION_RUN(BenchmarkWater)
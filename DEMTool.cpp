@@ -155,14 +155,14 @@ void DEMTool::loadDEMFileCallback(GLMotif::FileSelectionDialog::OKCallbackData*
 	loadDEMFile(cbData->selectedDirectory->getPath(cbData->selectedFileName).c_str());
 	}
 
-void DEMTool::bathymetryReadBackCallback(GLfloat* bathymetryBuffer,GLfloat*,GLfloat*,void* userData)
+void DEMTool::bathymetryReadBackCallback(const GridReadbackPtr& readback,void* userData)
 	{
 	DEMTool* thisPtr=static_cast<DEMTool*>(userData);
 	
 	/* Calculate the sandbox's current average elevation: */
-	const Size& size=thisPtr->bathymetrySize;
+	Size size=readback->getBathymetrySize();
 	GLfloat elevationSum=0.0f;
-	GLfloat* bPtr=bathymetryBuffer;
+	const GLfloat* bPtr=readback->getBathymetry();
 	for(unsigned int i=size[1]*size[0];i>0;--i,++bPtr)
 		elevationSum+=*bPtr;
 	GLfloat averageElevation=elevationSum/GLfloat(size[1]*size[0]);
@@ -172,10 +172,6 @@ void DEMTool::bathymetryReadBackCallback(GLfloat* bathymetryBuffer,GLfloat*,GLfl
 	
 	/* Select this DEM: */
 	thisPtr->application->toggleDEM(thisPtr);
-	
-	/* Release the temporary bathymetry buffer: */
-	delete[] thisPtr->tempBathymetryBuffer;
-	thisPtr->tempBathymetryBuffer=0;
 	}
 
 DEMToolFactory* DEMTool::initClass(Vrui::ToolManager& toolManager)
@@ -191,15 +187,12 @@ DEMToolFactory* DEMTool::initClass(Vrui::ToolManager& toolManager)
 DEMTool::DEMTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputAssignment& inputAssignment)
 	:Vrui::Tool(factory,inputAssignment),
 	 haveDemTransform(false),demTransform(OGTransform::identity),
-	 demVerticalShift(0),demVerticalScale(1),
-	 tempBathymetryBuffer(0)
+	 demVerticalShift(0),demVerticalScale(1)
 	{
 	}
 
 DEMTool::~DEMTool(void)
 	{
-	/* Release allocated resources: */
-	delete[] tempBathymetryBuffer;
 	}
 
 void DEMTool::configure(const Misc::ConfigurationFileSection& configFileSection)
@@ -233,6 +226,12 @@ void DEMTool::initialize(void)
 		}
 	}
 
+void DEMTool::deinitialize(void)
+	{
+	/* Cancel any outstanding bathymetry request, so that its callback does not outlive this tool: */
+	application->gridRequest.cancelRequests(this);
+	}
+
 const Vrui::ToolFactory* DEMTool::getFactory(void) const
 	{
 	return factory;
@@ -246,9 +245,7 @@ void DEMTool::buttonCallback(int buttonSlotIndex,Vrui::InputDevice::ButtonCallba
 		if(application->waterTable!=0)
 			{
 			/* Request to read the sandbox's current bathymetry grid in order to vertically align the DEM: */
-			bathymetrySize=application->waterTable->getBathymetrySize();
-			tempBathymetryBuffer=new GLfloat[bathymetrySize[1]*bathymetrySize[0]];
-			application->gridRequest.requestGrids(tempBathymetryBuffer,0,0,&DEMTool::bathymetryReadBackCallback,this);
+			application->gridRequest.requestGrids(GridReadback::Bathymetry,&DEMTool::bathymetryReadBackCallback,this);
 			}
 		else
 			{
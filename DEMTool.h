@@ -33,6 +33,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "Types.h"
 #include "DEM.h"
+#include "GridReadback.h"
 
 /* Forward declarations: */
 class Sandbox;
@@ -71,14 +72,12 @@ class DEMTool:public DEM,public Vrui::Tool,public Vrui::Application::Tool<Sandbo
 	OGTransform demTransform; // The transformation to apply to the DEM
 	Scalar demVerticalShift; // Extra vertical shift to apply to DEM in sandbox coordinate units
 	Scalar demVerticalScale; // The vertical exaggeration to apply to the DEM
-	Size bathymetrySize; // Width and height of the temporary bathymetry buffer
-	GLfloat* tempBathymetryBuffer; // Temporary buffer to read back the sandbox's current bathymetry to vertically align the loaded DEM
 	
 	/* Private methods: */
 	void alignDEM(float averageSandboxElevation); // Aligns the DEM with the sandbox
 	void loadDEMFile(const char* demFileName); // Loads a DEM from a file
 	void loadDEMFileCallback(GLMotif::FileSelectionDialog::OKCallbackData* cbData); // Called when the user selects a DEM file to load
-	static void bathymetryReadBackCallback(GLfloat* bathymetryBuffer,GLfloat* waterLevelBuffer,GLfloat*,void* userData); // Callback when a bathymetry grid has been read back from the GPU
+	static void bathymetryReadBackCallback(const GridReadbackPtr& readback,void* userData); // Callback when a bathymetry grid has been read back from the GPU
 	
 	/* Constructors and destructors: */
 	public:
@@ -89,6 +88,7 @@ class DEMTool:public DEM,public Vrui::Tool,public Vrui::Application::Tool<Sandbo
 	/* Methods from class Vrui::Tool: */
 	virtual void configure(const Misc::ConfigurationFileSection& configFileSection);
 	virtual void initialize(void);
+	virtual void deinitialize(void);
 	virtual const Vrui::ToolFactory* getFactory(void) const;
 	virtual void buttonCallback(int buttonSlotIndex,Vrui::InputDevice::ButtonCallbackData* cbData);
 	};
@@ -0,0 +1,104 @@
+/***********************************************************************
+DepthFrameFile - Definition of the layout of files holding recorded raw
+depth and color frames, designed to be memory-mapped for replay.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef DEPTHFRAMEFILE_INCLUDED
+#define DEPTHFRAMEFILE_INCLUDED
+
+#include <stddef.h>
+#include <string.h>
+#include <Misc/SizedTypes.h>
+
+/***********************************************************************
+A depth frame file is written in little-endian byte order and consists
+of a fixed-size header, a plane of per-pixel depth correction
+coefficients (scale and offset as two 32-bit floats per depth pixel),
+and a sequence of fixed-size frame records. The correction plane and
+the first frame record start at page boundaries, and each frame record
+holds a 64-bit floating-point time stamp, the raw 16-bit depth frame,
+and optionally the raw 24-bit RGB color frame, with each part padded to
+a multiple of 64 bytes. The number of frames is not stored, but follows
+from the file size, so that a file cut short by a crash stays readable.
+***********************************************************************/
+
+struct DepthFrameFileHeader // Structure for the header at the beginning of a depth frame file
+	{
+	/* Elements: */
+	public:
+	char magic[16]; // File identifier, "SARndboxFrames" padded with NUL characters
+	Misc::UInt32 version; // File format version number
+	Misc::UInt32 depthSize[2]; // Width and height of depth frames
+	Misc::UInt32 colorSize[2]; // Width and height of color frames; zero if the file does not contain color frames
+	Misc::UInt32 reserved; // Padding for the following 64-bit values
+	Misc::Float64 depthProjection[16]; // Row-major matrix of the projective transformation from depth image space to camera space
+	Misc::Float64 basePlane[4]; // Normal vector and offset of the sandbox's base plane in camera space
+	Misc::Float64 elevationRange[2]; // Range of valid elevations above the base plane
+	
+	static const Misc::UInt32 currentVersion=1; // Version number of the current file format
+	
+	/* Constructors and destructors: */
+	DepthFrameFileHeader(void) // Creates a header for the current file format version with all other fields set to zero
+		{
+		memset(this,0,sizeof(DepthFrameFileHeader));
+		strcpy(magic,"SARndboxFrames");
+		version=currentVersion;
+		}
+	
+	/* Methods: */
+	bool isValid(void) const // Returns true if the header identifies a depth frame file of a supported version
+		{
+		return strncmp(magic,"SARndboxFrames",sizeof(magic))==0&&version==currentVersion;
+		}
+	bool hasColor(void) const // Returns true if the file contains color frames
+		{
+		return colorSize[0]!=0&&colorSize[1]!=0;
+		}
+	size_t getCorrectionOffset(void) const // Returns the file offset of the per-pixel depth correction plane
+		{
+		return pageAlign(sizeof(DepthFrameFileHeader));
+		}
+	size_t getFramesOffset(void) const // Returns the file offset of the first frame record
+		{
+		return pageAlign(getCorrectionOffset()+size_t(depthSize[1])*size_t(depthSize[0])*2*sizeof(Misc::Float32));
+		}
+	size_t getDepthOffset(void) const // Returns the offset of the depth frame inside a frame record
+		{
+		return 64;
+		}
+	size_t getColorOffset(void) const // Returns the offset of the color frame inside a frame record
+		{
+		return getDepthOffset()+blockAlign(size_t(depthSize[1])*size_t(depthSize[0])*sizeof(Misc::UInt16));
+		}
+	size_t getFrameRecordSize(void) const // Returns the size of each frame record
+		{
+		return getColorOffset()+blockAlign(size_t(colorSize[1])*size_t(colorSize[0])*3);
+		}
+	static size_t blockAlign(size_t size) // Rounds the given size up to a multiple of 64 bytes
+		{
+		return (size+63)&~size_t(63);
+		}
+	static size_t pageAlign(size_t size) // Rounds the given size up to a multiple of 4096 bytes
+		{
+		return (size+4095)&~size_t(4095);
+		}
+	};
+
+#endif
@@ -0,0 +1,184 @@
+/***********************************************************************
+DepthFrameRecorder - Class to record streams of raw depth and color
+frames arriving from a depth camera into a depth frame file for offline
+replay.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "DepthFrameRecorder.h"
+
+#include <IO/OpenFile.h>
+
+/***********************************
+Methods of class DepthFrameRecorder:
+***********************************/
+
+void DepthFrameRecorder::writePadding(size_t numBytes)
+	{
+	static const char zeros[64]={0};
+	while(numBytes>0)
+		{
+		size_t writeSize=numBytes<sizeof(zeros)?numBytes:sizeof(zeros);
+		file->writeRaw(zeros,writeSize);
+		numBytes-=writeSize;
+		}
+	}
+
+void* DepthFrameRecorder::writerThreadMethod(void)
+	{
+	size_t numDepthPixels=size_t(header.depthSize[1])*size_t(header.depthSize[0]);
+	size_t numColorBytes=size_t(header.colorSize[1])*size_t(header.colorSize[0])*3;
+	while(true)
+		{
+		FrameRecord record;
+		{
+		Threads::MutexCond::Lock queueLock(queueCond);
+		
+		/* Wait until a frame arrives or the recorder shuts down: */
+		while(runWriterThread&&queue.empty())
+			queueCond.wait(queueLock);
+		
+		/* Bail out if the recorder is shutting down and all pending frames have been written: */
+		if(queue.empty())
+			break;
+		
+		/* Take the oldest frame from the queue: */
+		record=queue.front();
+		queue.pop_front();
+		}
+		
+		/* Write the frame record's time stamp: */
+		file->write<Misc::Float64>(record.depthFrame.timeStamp);
+		writePadding(header.getDepthOffset()-sizeof(Misc::Float64));
+		
+		/* Write the raw depth frame: */
+		file->write(record.depthFrame.getData<Misc::UInt16>(),numDepthPixels);
+		writePadding(header.getColorOffset()-header.getDepthOffset()-numDepthPixels*sizeof(Misc::UInt16));
+		
+		if(header.hasColor())
+			{
+			/* Write the most recent color frame, or a black frame if no color frame has arrived yet: */
+			if(record.colorFrame.isValid())
+				file->writeRaw(record.colorFrame.getBuffer(),numColorBytes);
+			else
+				writePadding(numColorBytes);
+			writePadding(header.getFrameRecordSize()-header.getColorOffset()-numColorBytes);
+			}
+		
+		__atomic_add_fetch(&numWrittenFrames,1U,__ATOMIC_RELAXED);
+		}
+	
+	return 0;
+	}
+
+DepthFrameRecorder::DepthFrameRecorder(const char* fileName,const Size& depthFrameSize,const Size& colorFrameSize,const DepthFrameRecorder::PixelDepthCorrection* pixelDepthCorrection,const PTransform& depthProjection,const Plane& basePlane,const Math::Interval<double>& elevationRange)
+	:file(IO::openFile(fileName,IO::File::WriteOnly)),
+	 runWriterThread(true),
+	 numWrittenFrames(0),numDroppedFrames(0)
+	{
+	/* Write all data in little-endian byte order: */
+	file->setEndianness(Misc::LittleEndian);
+	
+	/* Fill in the file header: */
+	for(int i=0;i<2;++i)
+		{
+		header.depthSize[i]=depthFrameSize[i];
+		header.colorSize[i]=colorFrameSize[i];
+		}
+	for(int i=0;i<4;++i)
+		for(int j=0;j<4;++j)
+			header.depthProjection[i*4+j]=depthProjection.getMatrix()(i,j);
+	for(int i=0;i<3;++i)
+		header.basePlane[i]=basePlane.getNormal()[i];
+	header.basePlane[3]=basePlane.getOffset();
+	header.elevationRange[0]=elevationRange.getMin();
+	header.elevationRange[1]=elevationRange.getMax();
+	
+	/* Write the file header: */
+	file->write(header.magic,sizeof(header.magic));
+	file->write(&header.version,1);
+	file->write(header.depthSize,2);
+	file->write(header.colorSize,2);
+	file->write(&header.reserved,1);
+	file->write(header.depthProjection,16);
+	file->write(header.basePlane,4);
+	file->write(header.elevationRange,2);
+	writePadding(header.getCorrectionOffset()-sizeof(DepthFrameFileHeader));
+	
+	/* Write the per-pixel depth correction coefficients: */
+	size_t numDepthPixels=size_t(depthFrameSize[1])*size_t(depthFrameSize[0]);
+	for(size_t i=0;i<numDepthPixels;++i)
+		{
+		file->write<Misc::Float32>(pixelDepthCorrection[i].scale);
+		file->write<Misc::Float32>(pixelDepthCorrection[i].offset);
+		}
+	writePadding(header.getFramesOffset()-header.getCorrectionOffset()-numDepthPixels*2*sizeof(Misc::Float32));
+	
+	/* Start the background writer thread: */
+	writerThread.start(this,&DepthFrameRecorder::writerThreadMethod);
+	}
+
+DepthFrameRecorder::~DepthFrameRecorder(void)
+	{
+	/* Shut down the writer thread after it has written all pending frames: */
+	{
+	Threads::MutexCond::Lock queueLock(queueCond);
+	runWriterThread=false;
+	queueCond.signal();
+	}
+	writerThread.join();
+	}
+
+void DepthFrameRecorder::receiveRawDepthFrame(const Kinect::FrameBuffer& newFrame)
+	{
+	Threads::MutexCond::Lock queueLock(queueCond);
+	
+	/* Drop the frame if the writer thread is falling behind: */
+	if(queue.size()>=maxQueueSize)
+		{
+		__atomic_add_fetch(&numDroppedFrames,1U,__ATOMIC_RELAXED);
+		return;
+		}
+	
+	/* Append the frame and the most recent color frame to the write queue: */
+	queue.push_back(FrameRecord());
+	queue.back().depthFrame=newFrame;
+	queue.back().colorFrame=colorFrame;
+	
+	/* Wake up the writer thread: */
+	queueCond.signal();
+	}
+
+void DepthFrameRecorder::receiveRawColorFrame(const Kinect::FrameBuffer& newFrame)
+	{
+	Threads::MutexCond::Lock queueLock(queueCond);
+	
+	/* Remember the frame for the next depth frame: */
+	colorFrame=newFrame;
+	}
+
+unsigned int DepthFrameRecorder::getNumWrittenFrames(void) const
+	{
+	return __atomic_load_n(&numWrittenFrames,__ATOMIC_RELAXED);
+	}
+
+unsigned int DepthFrameRecorder::getNumDroppedFrames(void) const
+	{
+	return __atomic_load_n(&numDroppedFrames,__ATOMIC_RELAXED);
+	}
@@ -0,0 +1,85 @@
+/***********************************************************************
+DepthFrameRecorder - Class to record streams of raw depth and color
+frames arriving from a depth camera into a depth frame file for offline
+replay.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef DEPTHFRAMERECORDER_INCLUDED
+#define DEPTHFRAMERECORDER_INCLUDED
+
+#include <deque>
+#include <IO/File.h>
+#include <Math/Interval.h>
+#include <Threads/Thread.h>
+#include <Threads/MutexCond.h>
+#include <Kinect/FrameBuffer.h>
+#include <Kinect/FrameSource.h>
+
+#include "Types.h"
+#include "DepthFrameFile.h"
+
+class DepthFrameRecorder
+	{
+	/* Embedded classes: */
+	public:
+	typedef Kinect::FrameSource::DepthCorrection::PixelCorrection PixelDepthCorrection; // Type for per-pixel depth correction factors
+	
+	private:
+	struct FrameRecord // Structure holding a pair of frames waiting to be written
+		{
+		/* Elements: */
+		public:
+		Kinect::FrameBuffer depthFrame; // Raw depth frame
+		Kinect::FrameBuffer colorFrame; // Most recent raw color frame at the time the depth frame arrived; invalid if color frames are not recorded
+		};
+	
+	/* Elements: */
+	static const size_t maxQueueSize=30; // Maximum number of frames waiting to be written before new frames are dropped
+	IO::FilePtr file; // The depth frame file
+	DepthFrameFileHeader header; // The depth frame file's header
+	Threads::MutexCond queueCond; // Condition variable protecting the write queue and the most recent color frame
+	std::deque<FrameRecord> queue; // Queue of frames waiting to be written
+	Kinect::FrameBuffer colorFrame; // Most recent raw color frame
+	volatile bool runWriterThread; // Flag to keep the background writer thread running
+	Threads::Thread writerThread; // The background writer thread
+	unsigned int numWrittenFrames; // Number of frames written to the file so far
+	unsigned int numDroppedFrames; // Number of frames dropped because the write queue was full
+	
+	/* Private methods: */
+	void writePadding(size_t numBytes); // Writes the given number of zero bytes to the file
+	void* writerThreadMethod(void); // Method for the background writer thread
+	
+	/* Constructors and destructors: */
+	public:
+	DepthFrameRecorder(const char* fileName,const Size& depthFrameSize,const Size& colorFrameSize,const PixelDepthCorrection* pixelDepthCorrection,const PTransform& depthProjection,const Plane& basePlane,const Math::Interval<double>& elevationRange); // Creates a recorder writing depth frames of the given size, and color frames of the given size unless it is zero, to the file of the given name
+	private:
+	DepthFrameRecorder(const DepthFrameRecorder& source); // Prohibit copy constructor
+	DepthFrameRecorder& operator=(const DepthFrameRecorder& source); // Prohibit assignment operator
+	public:
+	~DepthFrameRecorder(void); // Writes all pending frames and closes the file
+	
+	/* Methods: */
+	void receiveRawDepthFrame(const Kinect::FrameBuffer& newFrame); // Called to receive a new raw depth frame; never waits for the background writer thread
+	void receiveRawColorFrame(const Kinect::FrameBuffer& newFrame); // Called to receive a new raw color frame, which is written together with the next depth frame
+	unsigned int getNumWrittenFrames(void) const; // Returns the number of frames written to the file so far
+	unsigned int getNumDroppedFrames(void) const; // Returns the number of frames dropped because the file could not be written fast enough
+	};
+
+#endif
@@ -0,0 +1,231 @@
+/***********************************************************************
+DepthFrameReplayer - Class to replay raw depth and color frames from a
+memory-mapped depth frame file, as a stand-in for a live depth camera.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "DepthFrameReplayer.h"
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <Misc/StdError.h>
+#include <Misc/FunctionCalls.h>
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline double getMonotonicTime(void) // Returns the current time of the monotonic clock in seconds
+	{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return double(now.tv_sec)+double(now.tv_nsec)*1.0e-9;
+	}
+
+inline void sleepUntil(double time) // Suspends the calling thread until the monotonic clock reaches the given time in seconds
+	{
+	struct timespec until;
+	until.tv_sec=time_t(time);
+	until.tv_nsec=long((time-double(until.tv_sec))*1.0e9);
+	while(clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&until,0)==EINTR)
+		;
+	}
+
+}
+
+/***********************************
+Methods of class DepthFrameReplayer:
+***********************************/
+
+void* DepthFrameReplayer::streamingThreadMethod(void)
+	{
+	double startTime=getMonotonicTime();
+	double firstTimeStamp=numFrames>0?getTimeStamp(0):0.0;
+	unsigned int frameIndex=0;
+	while(runStreamingThread&&frameIndex<numFrames)
+		{
+		/* Wait until the frame's recorded time if replaying in real time: */
+		if(realTime)
+			sleepUntil(startTime+getTimeStamp(frameIndex)-firstTimeStamp);
+		
+		/* Send the frame to the callbacks: */
+		if(colorStreamingCallback!=0&&header->hasColor())
+			(*colorStreamingCallback)(getColorFrame(frameIndex));
+		if(depthStreamingCallback!=0)
+			(*depthStreamingCallback)(getDepthFrame(frameIndex));
+		
+		/* Go to the next frame: */
+		++frameIndex;
+		if(loop&&frameIndex==numFrames)
+			{
+			/* Start over from the first frame, continuing the replay clock one mean frame interval after the last frame's time stamp: */
+			double recordingLength=getTimeStamp(numFrames-1)-firstTimeStamp;
+			startTime+=recordingLength;
+			if(numFrames>1)
+				startTime+=recordingLength/double(numFrames-1);
+			frameIndex=0;
+			}
+		}
+	
+	/* Signal the end of the stream: */
+	{
+	Threads::MutexCond::Lock streamingLock(streamingCond);
+	streaming=false;
+	streamingCond.broadcast();
+	}
+	
+	return 0;
+	}
+
+DepthFrameReplayer::DepthFrameReplayer(const char* fileName)
+	:fileData(0),fileSize(0),header(0),numFrames(0),
+	 colorStreamingCallback(0),depthStreamingCallback(0),
+	 realTime(true),loop(false),
+	 runStreamingThread(false),streaming(false)
+	{
+	/* Check that the host byte order matches the file's: */
+	Misc::UInt32 byteOrderTest=1U;
+	if(*reinterpret_cast<unsigned char*>(&byteOrderTest)!=1U)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Depth frame files can only be memory-mapped on little-endian hosts");
+	
+	/* Open the depth frame file and query its size: */
+	int fd=open(fileName,O_RDONLY);
+	if(fd<0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to open depth frame file %s due to error %s",fileName,strerror(errno));
+	struct stat fileStats;
+	if(fstat(fd,&fileStats)<0||size_t(fileStats.st_size)<sizeof(DepthFrameFileHeader))
+		{
+		close(fd);
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"File %s is not a depth frame file",fileName);
+		}
+	fileSize=size_t(fileStats.st_size);
+	
+	/* Map the entire file into memory; the mapping stays valid after the file is closed: */
+	void* mapping=mmap(0,fileSize,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if(mapping==MAP_FAILED)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to map depth frame file %s due to error %s",fileName,strerror(errno));
+	fileData=static_cast<const unsigned char*>(mapping);
+	header=reinterpret_cast<const DepthFrameFileHeader*>(fileData);
+	
+	/* Check the file's header and calculate the number of complete frame records: */
+	if(!header->isValid()||fileSize<header->getFramesOffset())
+		{
+		munmap(mapping,fileSize);
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"File %s is not a depth frame file of a supported version",fileName);
+		}
+	numFrames=(fileSize-header->getFramesOffset())/header->getFrameRecordSize();
+	
+	/* Tell the kernel that frames will be read in order: */
+	madvise(mapping,fileSize,MADV_SEQUENTIAL);
+	}
+
+DepthFrameReplayer::~DepthFrameReplayer(void)
+	{
+	/* Stop streaming and release the file mapping: */
+	stopStreaming();
+	munmap(const_cast<unsigned char*>(fileData),fileSize);
+	}
+
+PTransform DepthFrameReplayer::getDepthProjection(void) const
+	{
+	PTransform result;
+	for(int i=0;i<4;++i)
+		for(int j=0;j<4;++j)
+			result.getMatrix()(i,j)=header->depthProjection[i*4+j];
+	return result;
+	}
+
+Plane DepthFrameReplayer::getBasePlane(void) const
+	{
+	return Plane(Plane::Vector(header->basePlane[0],header->basePlane[1],header->basePlane[2]),header->basePlane[3]);
+	}
+
+Math::Interval<double> DepthFrameReplayer::getElevationRange(void) const
+	{
+	return Math::Interval<double>(header->elevationRange[0],header->elevationRange[1]);
+	}
+
+Kinect::FrameBuffer DepthFrameReplayer::getDepthFrame(unsigned int frameIndex) const
+	{
+	/* Copy the depth frame into a new frame buffer: */
+	size_t frameSize=size_t(header->depthSize[1])*size_t(header->depthSize[0])*sizeof(Misc::UInt16);
+	Kinect::FrameBuffer result(getDepthFrameSize(),frameSize);
+	memcpy(result.getBuffer(),getDepthPixels(frameIndex),frameSize);
+	result.timeStamp=getTimeStamp(frameIndex);
+	return result;
+	}
+
+Kinect::FrameBuffer DepthFrameReplayer::getColorFrame(unsigned int frameIndex) const
+	{
+	/* Copy the color frame into a new frame buffer: */
+	size_t frameSize=size_t(header->colorSize[1])*size_t(header->colorSize[0])*3;
+	Kinect::FrameBuffer result(getColorFrameSize(),frameSize);
+	memcpy(result.getBuffer(),getColorPixels(frameIndex),frameSize);
+	result.timeStamp=getTimeStamp(frameIndex);
+	return result;
+	}
+
+void DepthFrameReplayer::startStreaming(DepthFrameReplayer::StreamingCallback* newColorStreamingCallback,DepthFrameReplayer::StreamingCallback* newDepthStreamingCallback,bool newRealTime,bool newLoop)
+	{
+	/* Stop a previous stream: */
+	stopStreaming();
+	
+	/* Install the new callbacks and replay settings: */
+	colorStreamingCallback=newColorStreamingCallback;
+	depthStreamingCallback=newDepthStreamingCallback;
+	realTime=newRealTime;
+	loop=newLoop&&numFrames>0;
+	
+	/* Start the background streaming thread: */
+	streaming=true;
+	runStreamingThread=true;
+	streamingThread.start(this,&DepthFrameReplayer::streamingThreadMethod);
+	}
+
+void DepthFrameReplayer::waitForEndOfStream(void)
+	{
+	Threads::MutexCond::Lock streamingLock(streamingCond);
+	while(streaming)
+		streamingCond.wait(streamingLock);
+	}
+
+void DepthFrameReplayer::stopStreaming(void)
+	{
+	if(runStreamingThread)
+		{
+		/* Shut down the streaming thread: */
+		runStreamingThread=false;
+		streamingThread.join();
+		}
+	
+	/* Release the callbacks: */
+	delete colorStreamingCallback;
+	colorStreamingCallback=0;
+	delete depthStreamingCallback;
+	depthStreamingCallback=0;
+	}
@@ -0,0 +1,120 @@
+/***********************************************************************
+DepthFrameReplayer - Class to replay raw depth and color frames from a
+memory-mapped depth frame file, as a stand-in for a live depth camera.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef DEPTHFRAMEREPLAYER_INCLUDED
+#define DEPTHFRAMEREPLAYER_INCLUDED
+
+#include <stddef.h>
+#include <Misc/SizedTypes.h>
+#include <Math/Interval.h>
+#include <Threads/Thread.h>
+#include <Threads/MutexCond.h>
+#include <Kinect/FrameBuffer.h>
+#include <Kinect/FrameSource.h>
+
+#include "Types.h"
+#include "DepthFrameFile.h"
+
+/* Forward declarations: */
+namespace Misc {
+template <class ParameterParam>
+class FunctionCall;
+}
+
+class DepthFrameReplayer
+	{
+	/* Embedded classes: */
+	public:
+	typedef Kinect::FrameSource::DepthCorrection::PixelCorrection PixelDepthCorrection; // Type for per-pixel depth correction factors
+	typedef Misc::FunctionCall<const Kinect::FrameBuffer&> StreamingCallback; // Type for functions called when a new frame is replayed
+	
+	/* Elements: */
+	private:
+	const unsigned char* fileData; // Pointer to the memory-mapped depth frame file
+	size_t fileSize; // Size of the memory-mapped file in bytes
+	const DepthFrameFileHeader* header; // Pointer to the file's header
+	unsigned int numFrames; // Number of complete frame records in the file
+	StreamingCallback* colorStreamingCallback; // Function called with replayed color frames, or null
+	StreamingCallback* depthStreamingCallback; // Function called with replayed depth frames, or null
+	bool realTime; // Flag whether frames are replayed at their recorded rate, or as fast as possible
+	bool loop; // Flag whether to restart from the first frame after the last frame has been replayed
+	Threads::MutexCond streamingCond; // Condition variable to signal the end of streaming
+	volatile bool runStreamingThread; // Flag to keep the background streaming thread running
+	bool streaming; // Flag whether the background streaming thread is replaying frames, protected by streamingCond
+	Threads::Thread streamingThread; // The background streaming thread
+	
+	/* Private methods: */
+	void* streamingThreadMethod(void); // Method for the background streaming thread
+	
+	/* Constructors and destructors: */
+	public:
+	DepthFrameReplayer(const char* fileName); // Memory-maps the depth frame file of the given name
+	private:
+	DepthFrameReplayer(const DepthFrameReplayer& source); // Prohibit copy constructor
+	DepthFrameReplayer& operator=(const DepthFrameReplayer& source); // Prohibit assignment operator
+	public:
+	~DepthFrameReplayer(void); // Stops streaming and unmaps the depth frame file
+	
+	/* Methods: */
+	Size getDepthFrameSize(void) const // Returns the size of depth frames
+		{
+		return Size(header->depthSize[0],header->depthSize[1]);
+		}
+	bool hasColor(void) const // Returns true if the file contains color frames
+		{
+		return header->hasColor();
+		}
+	Size getColorFrameSize(void) const // Returns the size of color frames; zero if the file does not contain color frames
+		{
+		return Size(header->colorSize[0],header->colorSize[1]);
+		}
+	const PixelDepthCorrection* getPixelDepthCorrection(void) const // Returns the recorded per-pixel depth correction coefficients
+		{
+		return reinterpret_cast<const PixelDepthCorrection*>(fileData+header->getCorrectionOffset());
+		}
+	PTransform getDepthProjection(void) const; // Returns the recorded projective transformation from depth image space to camera space
+	Plane getBasePlane(void) const; // Returns the recorded sandbox base plane in camera space
+	Math::Interval<double> getElevationRange(void) const; // Returns the recorded range of valid elevations above the base plane
+	unsigned int getNumFrames(void) const // Returns the number of recorded frames
+		{
+		return numFrames;
+		}
+	double getTimeStamp(unsigned int frameIndex) const // Returns the time stamp of the given frame
+		{
+		return *reinterpret_cast<const Misc::Float64*>(fileData+header->getFramesOffset()+size_t(frameIndex)*header->getFrameRecordSize());
+		}
+	const Misc::UInt16* getDepthPixels(unsigned int frameIndex) const // Returns the memory-mapped raw depth pixels of the given frame
+		{
+		return reinterpret_cast<const Misc::UInt16*>(fileData+header->getFramesOffset()+size_t(frameIndex)*header->getFrameRecordSize()+header->getDepthOffset());
+		}
+	const unsigned char* getColorPixels(unsigned int frameIndex) const // Returns the memory-mapped raw RGB color pixels of the given frame, or null if the file does not contain color frames
+		{
+		return header->hasColor()?fileData+header->getFramesOffset()+size_t(frameIndex)*header->getFrameRecordSize()+header->getColorOffset():0;
+		}
+	Kinect::FrameBuffer getDepthFrame(unsigned int frameIndex) const; // Returns a new frame buffer holding a copy of the given depth frame
+	Kinect::FrameBuffer getColorFrame(unsigned int frameIndex) const; // Returns a new frame buffer holding a copy of the given color frame; file must contain color frames
+	void startStreaming(StreamingCallback* newColorStreamingCallback,StreamingCallback* newDepthStreamingCallback,bool newRealTime,bool newLoop); // Starts replaying frames to the given callbacks from a background thread; adopts the given functor objects
+	void waitForEndOfStream(void); // Waits until all frames have been replayed; never returns if looping is enabled
+	void stopStreaming(void); // Stops replaying frames
+	};
+
+#endif
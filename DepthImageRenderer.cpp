@@ -2,7 +2,7 @@
 DepthImageRenderer - Class to centralize storage of raw or filtered
 depth images on the GPU, and perform simple repetitive rendering tasks
 such as rendering elevation values into a frame buffer.
-Copyright (c) 2014-2025 Oliver Kreylos
+Copyright (c) 2014-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "DepthImageRenderer.h"
 
+#include <Math/Math.h>
 #include <GL/gl.h>
 #include <GL/GLMiscTemplates.h>
 #include <GL/GLVertexArrayParts.h>
@@ -37,6 +38,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "TextureTracker.h"
 #include "ShaderHelper.h"
+#include "LatencyMonitor.h"
 
 /*********************************************
 Methods of class DepthImageRenderer::DataItem:
@@ -72,8 +74,21 @@ GLint DepthImageRenderer::bindDepthTexture(DepthImageRenderer::DataItem* dataIte
 	/* Check if the texture is outdated: */
 	if(dataItem->depthTextureVersion!=depthImageVersion)
 		{
-		/* Upload the new depth texture: */
-		glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,depthImageSize,GL_LUMINANCE,GL_FLOAT,depthImage.getData<GLfloat>());
+		/* Upload the new depth texture, or only the part that changed since the texture's version if the changes were tracked: */
+		double uploadStartTime=latencyMonitor!=0?LatencyMonitor::getTime():0.0;
+		Rect dirtyRect;
+		Box dirtyBox;
+		if(getDirtyRegion(dataItem->depthTextureVersion,dirtyRect,dirtyBox))
+			{
+			glPixelStorei(GL_UNPACK_ROW_LENGTH,depthImageSize[0]);
+			const GLfloat* dirtyData=depthImage.getData<GLfloat>()+(dirtyRect.offset[1]*depthImageSize[0]+dirtyRect.offset[0]);
+			glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,dirtyRect.offset[0],dirtyRect.offset[1],dirtyRect.size[0],dirtyRect.size[1],GL_LUMINANCE,GL_FLOAT,dirtyData);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH,0);
+			}
+		else
+			glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,depthImageSize,GL_LUMINANCE,GL_FLOAT,depthImage.getData<GLfloat>());
+		if(latencyMonitor!=0)
+			latencyMonitor->frameUploaded(depthImage.timeStamp,uploadStartTime,LatencyMonitor::getTime());
 		
 		/* Mark the depth texture as current: */
 		dataItem->depthTextureVersion=depthImageVersion;
@@ -82,9 +97,38 @@ GLint DepthImageRenderer::bindDepthTexture(DepthImageRenderer::DataItem* dataIte
 	return unit;
 	}
 
+bool DepthImageRenderer::addDirtyVertex(unsigned int x,unsigned int y,const Scalar depthRange[2],int& weightSign,DepthImageRenderer::Box& box) const
+	{
+	/* Calculate the pixel's template vertex position, correcting for lens distortion like the template vertices: */
+	LensDistortion::Point vp(LensDistortion::Scalar(x)+LensDistortion::Scalar(0.5),LensDistortion::Scalar(y)+LensDistortion::Scalar(0.5));
+	if(!lensDistortion.isIdentity())
+		vp=t2i.transform(lensDistortion.undistort(i2t.transform(vp)));
+	
+	/* Unproject the vertex at the minimum and maximum depths: */
+	const PTransform::Matrix& dpm=depthProjection.getMatrix();
+	for(int i=0;i<2;++i)
+		{
+		Scalar p[4];
+		for(int j=0;j<4;++j)
+			p[j]=dpm(j,0)*Scalar(vp[0])+dpm(j,1)*Scalar(vp[1])+dpm(j,2)*depthRange[i]+dpm(j,3);
+		
+		/* Bail out if the depth range crosses the plane at infinity, where the bounding box would not contain the surface: */
+		int sign=p[3]>Scalar(0)?1:p[3]<Scalar(0)?-1:0;
+		if(weightSign==0)
+			weightSign=sign;
+		if(sign==0||sign!=weightSign)
+			return false;
+		
+		box.addPoint(Point(p[0]/p[3],p[1]/p[3],p[2]/p[3]));
+		}
+	
+	return true;
+	}
+
 DepthImageRenderer::DepthImageRenderer(const Size& sDepthImageSize)
 	:depthImageSize(sDepthImageSize),
-	 depthImageVersion(0)
+	 depthImageVersion(0),
+	 latencyMonitor(0)
 	{
 	/* Initialize the depth image: */
 	depthImage=Kinect::FrameBuffer(depthImageSize,depthImageSize[1]*depthImageSize[0]*sizeof(float));
@@ -92,6 +136,10 @@ DepthImageRenderer::DepthImageRenderer(const Size& sDepthImageSize)
 	for(unsigned int i=depthImageSize[1]*depthImageSize[0];i>0;--i,++diPtr)
 		*diPtr=0.0f;
 	++depthImageVersion;
+	
+	/* Mark all depth image versions as untracked: */
+	for(unsigned int i=0;i<numDirtyRegions;++i)
+		dirtyRegions[i].tracked=false;
 	}
 
 void DepthImageRenderer::initContext(GLContextData& contextData) const
@@ -249,6 +297,100 @@ void DepthImageRenderer::setDepthImage(const Kinect::FrameBuffer& newDepthImage)
 	/* Update the depth image: */
 	depthImage=newDepthImage;
 	++depthImageVersion;
+	
+	/* Consider the entire depth image changed: */
+	dirtyRegions[depthImageVersion%numDirtyRegions].tracked=false;
+	}
+
+void DepthImageRenderer::setDepthImage(const Kinect::FrameBuffer& newDepthImage,const Rect& dirtyRect)
+	{
+	/* Keep the current version if no depth pixels changed, but hold on to the new frame for its time stamp: */
+	if(dirtyRect.size[0]==0||dirtyRect.size[1]==0)
+		{
+		depthImage=newDepthImage;
+		return;
+		}
+	
+	/* Find the rectangle of template vertices whose surface patches touch the changed pixels: */
+	unsigned int x0=dirtyRect.offset[0]>0?dirtyRect.offset[0]-1:0;
+	unsigned int x1=Math::min(dirtyRect.offset[0]+dirtyRect.size[0]+1,depthImageSize[0]);
+	unsigned int y0=dirtyRect.offset[1]>0?dirtyRect.offset[1]-1:0;
+	unsigned int y1=Math::min(dirtyRect.offset[1]+dirtyRect.size[1]+1,depthImageSize[1]);
+	
+	/* Find the range of old and new depth values inside the rectangle: */
+	Scalar depthRange[2];
+	const float* oldData=depthImage.getData<float>();
+	const float* newData=newDepthImage.getData<float>();
+	float dMin=oldData[y0*depthImageSize[0]+x0];
+	float dMax=dMin;
+	for(unsigned int y=y0;y<y1;++y)
+		{
+		const float* oPtr=oldData+y*depthImageSize[0];
+		const float* nPtr=newData+y*depthImageSize[0];
+		for(unsigned int x=x0;x<x1;++x)
+			{
+			dMin=Math::min(dMin,Math::min(oPtr[x],nPtr[x]));
+			dMax=Math::max(dMax,Math::max(oPtr[x],nPtr[x]));
+			}
+		}
+	depthRange[0]=Scalar(dMin);
+	depthRange[1]=Scalar(dMax);
+	
+	/* Bound the surface patches before and after the change by unprojecting the rectangle's boundary vertices at the minimum and maximum depths: */
+	DirtyRegion& dr=dirtyRegions[(depthImageVersion+1)%numDirtyRegions];
+	dr.rect=dirtyRect;
+	dr.box=Box::empty;
+	int weightSign=0;
+	dr.tracked=true;
+	for(unsigned int x=x0;x<x1&&dr.tracked;++x)
+		dr.tracked=addDirtyVertex(x,y0,depthRange,weightSign,dr.box)&&addDirtyVertex(x,y1-1,depthRange,weightSign,dr.box);
+	for(unsigned int y=y0+1;y+1<y1&&dr.tracked;++y)
+		dr.tracked=addDirtyVertex(x0,y,depthRange,weightSign,dr.box)&&addDirtyVertex(x1-1,y,depthRange,weightSign,dr.box);
+	
+	/* Update the depth image: */
+	depthImage=newDepthImage;
+	++depthImageVersion;
+	}
+
+bool DepthImageRenderer::getDirtyRegion(unsigned int sinceVersion,Rect& dirtyRect,DepthImageRenderer::Box& dirtyBox) const
+	{
+	/* Bail out if some of the versions after the given one are no longer tracked: */
+	if(depthImageVersion-sinceVersion>numDirtyRegions)
+		return false;
+	
+	/* Combine the changed regions of all versions after the given one: */
+	unsigned int x0=depthImageSize[0],x1=0,y0=depthImageSize[1],y1=0;
+	dirtyBox=Box::empty;
+	for(unsigned int version=sinceVersion+1;version!=depthImageVersion+1;++version)
+		{
+		const DirtyRegion& dr=dirtyRegions[version%numDirtyRegions];
+		if(!dr.tracked)
+			return false;
+		
+		x0=Math::min(x0,(unsigned int)(dr.rect.offset[0]));
+		x1=Math::max(x1,(unsigned int)(dr.rect.offset[0])+dr.rect.size[0]);
+		y0=Math::min(y0,(unsigned int)(dr.rect.offset[1]));
+		y1=Math::max(y1,(unsigned int)(dr.rect.offset[1])+dr.rect.size[1]);
+		dirtyBox.addPoint(dr.box.min);
+		dirtyBox.addPoint(dr.box.max);
+		}
+	
+	/* Return the combined rectangle, which is empty if there were no changes: */
+	dirtyRect=Rect(Size(0,0));
+	if(x0<x1&&y0<y1)
+		{
+		dirtyRect.offset[0]=int(x0);
+		dirtyRect.offset[1]=int(y0);
+		dirtyRect.size[0]=x1-x0;
+		dirtyRect.size[1]=y1-y0;
+		}
+	
+	return true;
+	}
+
+void DepthImageRenderer::setLatencyMonitor(LatencyMonitor* newLatencyMonitor)
+	{
+	latencyMonitor=newLatencyMonitor;
 	}
 
 Scalar DepthImageRenderer::intersectLine(const Point& p0,const Point& p1,Scalar elevationMin,Scalar elevationMax) const
@@ -2,7 +2,7 @@
 DepthImageRenderer - Class to centralize storage of raw or filtered
 depth images on the GPU, and perform simple repetitive rendering tasks
 such as rendering elevation values into a frame buffer.
-Copyright (c) 2014-2025 Oliver Kreylos
+Copyright (c) 2014-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef DEPTHIMAGERENDERER_INCLUDED
 #define DEPTHIMAGERENDERER_INCLUDED
 
+#include <Geometry/Box.h>
 #include <GL/gl.h>
 #include <GL/GLContextData.h>
 #include <GL/GLObject.h>
@@ -36,10 +37,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 /* Forward declarations: */
 class TextureTracker;
+class LatencyMonitor;
 
 class DepthImageRenderer:public GLObject
 	{
 	/* Embedded classes: */
+	public:
+	typedef Geometry::Box<Scalar,3> Box; // Type for bounding boxes in camera space
+	
 	private:
 	typedef Kinect::FrameSource::IntrinsicParameters::LensDistortion LensDistortion; // Type for lens distortion correction formulas
 	typedef Kinect::FrameSource::IntrinsicParameters::ATransform PixelTransform; // Type for transformations between pixel and tangent space
@@ -65,6 +70,15 @@ class DepthImageRenderer:public GLObject
 		virtual ~DataItem(void);
 		};
 	
+	struct DirtyRegion // Structure describing the part of the depth image changed by one depth image version
+		{
+		/* Elements: */
+		public:
+		bool tracked; // Flag whether the change was tracked; if false, the entire depth image has to be considered changed
+		Rect rect; // Rectangle of changed depth pixels
+		Box box; // Bounding box in camera space of the surface patches touched by the changed depth pixels, before and after the change
+		};
+	
 	/* Elements: */
 	Size depthImageSize; // Size of depth image texture
 	LensDistortion lensDistortion; // 2D lens distortion parameters
@@ -78,9 +92,13 @@ class DepthImageRenderer:public GLObject
 	/* Transient state: */
 	Kinect::FrameBuffer depthImage; // The most recent float-pixel depth image
 	unsigned int depthImageVersion; // Version number of the depth image
+	static const unsigned int numDirtyRegions=8; // Number of most recent depth image versions whose changed regions are tracked
+	DirtyRegion dirtyRegions[numDirtyRegions]; // Changed regions of the most recent depth image versions, indexed by version number modulo the number of tracked versions
+	LatencyMonitor* latencyMonitor; // Optional monitor receiving the time taken by depth texture uploads
 	
 	/* Private methods: */
 	GLint bindDepthTexture(DataItem* dataItem,TextureTracker& textureTracker) const; // Binds the up-to-date depth texture image to the next available texture unit in the given texture tracker and returns that unit's index
+	bool addDirtyVertex(unsigned int x,unsigned int y,const Scalar depthRange[2],int& weightSign,Box& box) const; // Adds the camera-space positions of the given pixel's template vertex at the given minimum and maximum depths to the given box; returns false if the positions' homogeneous weights do not all have the given sign, or the first sign if the given sign is zero
 	
 	/* Constructors and destructors: */
 	public:
@@ -110,11 +128,18 @@ class DepthImageRenderer:public GLObject
 	void setIntrinsics(const Kinect::FrameSource::IntrinsicParameters& ips); // Sets a new depth unprojection matrix and, if present, 2D lens distortion parameters
 	void setBasePlane(const Plane& newBasePlane); // Sets a new base plane for elevation rendering
 	void setDepthImage(const Kinect::FrameBuffer& newDepthImage); // Sets a new depth image for subsequent surface rendering
+	void setDepthImage(const Kinect::FrameBuffer& newDepthImage,const Rect& dirtyRect); // Sets a new depth image that only differs from the current one inside the given rectangle of depth pixels; keeps the current version number if the rectangle is empty
 	Scalar intersectLine(const Point& p0,const Point& p1,Scalar elevationMin,Scalar elevationMax) const; // Intersects a line segment with the current depth image in camera space; returns intersection point's parameter along line
 	unsigned int getDepthImageVersion(void) const // Returns the version number of the current depth image
 		{
 		return depthImageVersion;
 		}
+	bool getDirtyRegion(unsigned int sinceVersion,Rect& dirtyRect,Box& dirtyBox) const; // Returns the rectangle of depth pixels and the camera-space bounding box of the surface changed by all depth image versions after the given one; returns false if the changes are not tracked and the entire depth image has to be considered changed
+	double getDepthImageTimeStamp(void) const // Returns the time stamp of the raw depth frame from which the current depth image was filtered
+		{
+		return depthImage.timeStamp;
+		}
+	void setLatencyMonitor(LatencyMonitor* newLatencyMonitor); // Sets a latency monitor to receive depth texture upload times, or null
 	void uploadDepthProjection(Shader& shader) const; // Uploads the depth unprojection matrix into a GLSL 4x4 matrix at the next uniform location in the given shader
 	GLint bindDepthTexture(GLContextData& contextData,TextureTracker& textureTracker) const // Binds the up-to-date depth texture image to the next available texture unit in the given texture tracker and returns that unit's index
 		{
@@ -2,7 +2,7 @@
 FrameFilter - Class to filter streams of depth frames arriving from a
 depth camera, with code to detect unstable values in each pixel, and
 fill holes resulting from invalid samples.
-Copyright (c) 2012-2022 Oliver Kreylos
+Copyright (c) 2012-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -23,178 +23,1149 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "FrameFilter.h"
 
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <Misc/StdError.h>
 #include <Misc/FunctionCalls.h>
+#include <Math/Math.h>
+#include <Math/Constants.h>
 #include <Geometry/HVector.h>
 #include <Geometry/Matrix.h>
+#if FRAMEFILTER_X86SIMD
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+template <class ValueParam>
+inline ValueParam* allocPlane(size_t numValues) // Allocates a plane of values aligned to a cache line boundary
+	{
+	void* result=0;
+	if(posix_memalign(&result,64,numValues*sizeof(ValueParam))!=0)
+		throw std::bad_alloc();
+	return static_cast<ValueParam*>(result);
+	}
+
+inline unsigned int findSortedSample(const FrameFilter::RawDepth* samples,unsigned int numSamples,unsigned int sample) // Returns the index of one instance of the given sample in the given sorted run of samples
+	{
+	/* Binary-search for the first instance of the sample: */
+	unsigned int l=0;
+	unsigned int r=numSamples;
+	while(l<r)
+		{
+		unsigned int m=(l+r)>>1;
+		if(samples[m]<sample)
+			l=m+1;
+		else
+			r=m;
+		}
+	return l;
+	}
+
+inline void removeSortedSample(FrameFilter::RawDepth* samples,unsigned int numSamples,unsigned int sample) // Removes one instance of the given sample from the given sorted run of samples
+	{
+	/* Find the sample and close the gap by shifting all larger samples down: */
+	for(unsigned int i=findSortedSample(samples,numSamples,sample);i+1<numSamples;++i)
+		samples[i]=samples[i+1];
+	}
+
+inline void replaceSortedSample(FrameFilter::RawDepth* samples,unsigned int numSamples,unsigned int oldSample,unsigned int newSample) // Replaces one instance of the given old sample in the given sorted run of samples with the given new sample
+	{
+	/* Find the old sample and move the gap it leaves towards the new sample's position, which only shifts the samples in between: */
+	unsigned int i=findSortedSample(samples,numSamples,oldSample);
+	if(newSample>oldSample)
+		{
+		for(;i+1<numSamples&&samples[i+1]<newSample;++i)
+			samples[i]=samples[i+1];
+		}
+	else
+		{
+		for(;i>0&&samples[i-1]>newSample;--i)
+			samples[i]=samples[i-1];
+		}
+	samples[i]=FrameFilter::RawDepth(newSample);
+	}
+
+inline void insertSortedSample(FrameFilter::RawDepth* samples,unsigned int numSamples,unsigned int sample) // Inserts the given sample into the given sorted run of samples, which must have room for one more sample
+	{
+	/* Shift all larger samples up to open a gap for the new sample: */
+	unsigned int i=numSamples;
+	for(;i>0&&samples[i-1]>sample;--i)
+		samples[i]=samples[i-1];
+	samples[i]=FrameFilter::RawDepth(sample);
+	}
+
+inline void lowPassColumns(const float* prev,const float* cur,const float* next,float* dest,unsigned int width) // Low-pass filters one row of a frame vertically; prev or next are null at the frame's top or bottom edge
+	{
+	if(prev==0)
+		{
+		/* Filter the first row of the frame: */
+		for(unsigned int x=0;x<width;++x)
+			dest[x]=(cur[x]*2.0f+next[x])/3.0f;
+		}
+	else if(next==0)
+		{
+		/* Filter the last row of the frame: */
+		for(unsigned int x=0;x<width;++x)
+			dest[x]=(prev[x]+cur[x]*2.0f)/3.0f;
+		}
+	else
+		{
+		/* Filter an interior row of the frame: */
+		for(unsigned int x=0;x<width;++x)
+			dest[x]=(prev[x]+cur[x]*2.0f+next[x])*0.25f;
+		}
+	}
+
+inline void lowPassRow(const float* source,float* dest,unsigned int xBegin,unsigned int xEnd,unsigned int width) // Low-pass filters the given span of one row of a frame horizontally; source and dest point to the beginning of the row
+	{
+	unsigned int x=xBegin;
+	
+	/* Filter the first pixel in the row: */
+	if(x==0)
+		{
+		dest[0]=(source[0]*2.0f+source[1])/3.0f;
+		++x;
+		}
+	
+	/* Filter the interior pixels in the span: */
+	unsigned int interiorEnd=xEnd<width?xEnd:width-1;
+	for(;x<interiorEnd;++x)
+		dest[x]=(source[x-1]+source[x]*2.0f+source[x+1])*0.25f;
+	
+	/* Filter the last pixel in the row: */
+	if(xEnd==width)
+		dest[width-1]=(source[width-2]+source[width-1]*2.0f)/3.0f;
+	}
+
+inline void getUpsampleBins(unsigned int pixel,unsigned int numBins,unsigned int& bin0,unsigned int& bin1,float& weight1) // Returns the two bins bracketing the center of the given full-resolution pixel row or column, and the weight of the second bin
+	{
+	/* The center of pixel 2k lies a quarter bin before the center of bin k, and the center of pixel 2k+1 lies a quarter bin after it: */
+	int bin=int((pixel+1U)/2U)-1;
+	weight1=(pixel&0x1U)!=0U?0.25f:0.75f;
+	bin0=bin<0?0U:(unsigned int)(bin)<numBins?(unsigned int)(bin):numBins-1U;
+	bin1=(unsigned int)(bin+1)<numBins?(unsigned int)(bin+1):numBins-1U;
+	}
+
+inline void printPlaneSize(std::ostream& os,const char* planeName,size_t numPixels,size_t bytesPerPixel) // Prints the size of a plane of per-pixel values
+	{
+	os<<"  "<<std::setw(28)<<std::left<<planeName<<std::right<<std::setw(10)<<std::fixed<<std::setprecision(2)<<double(numPixels*bytesPerPixel)/(1024.0*1024.0)<<" MB ("<<bytesPerPixel<<" bytes/pixel)"<<std::endl;
+	}
+
+}
 
 /****************************
 Methods of class FrameFilter:
 ****************************/
 
-void* FrameFilter::filterThreadMethod(void)
+template <class SumSquaresParam,bool medianParam,bool adaptiveParam>
+inline void FrameFilter::filterPixels(const FrameFilter::RawDepth* inputData,float* outputData,SumSquaresParam* sumSquaresBuffer,unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	/* Get pointers to the first pixel of the span in all buffers: */
+	unsigned int pixelIndex=y*size[0]+xBegin;
+	const RawDepth* ifPtr=inputData+pixelIndex;
+	const float* dcsPtr=depthCorrectionScales+pixelIndex;
+	const float* dcoPtr=depthCorrectionOffsets+pixelIndex;
+	RawDepth* abPtr=averagingBuffer+averagingSlotIndex*size[1]*size[0]+pixelIndex;
+	Misc::UInt16* cPtr=countBuffer+pixelIndex;
+	Misc::UInt32* sPtr=sumBuffer+pixelIndex;
+	SumSquaresParam* sqPtr=sumSquaresBuffer+pixelIndex;
+	float* ofPtr=validBuffer+pixelIndex;
+	float* nofPtr=outputData+pixelIndex;
+	Misc::UInt8* mPtr=adaptiveParam?motionBuffer+pixelIndex:0;
+	
+	/* Get a pointer to the pixel in the first averaging slot and the distance between slots for the adaptive filter: */
+	RawDepth* ab0Ptr=averagingBuffer+pixelIndex;
+	size_t slotStride=size_t(size[1])*size_t(size[0]);
+	
+	/* Get a pointer to the first pixel's sorted sample window for the median filter: */
+	RawDepth* mwPtr=medianParam?medianWindowBuffer+size_t(pixelIndex)*numAveragingSlots:0;
+	
+	float py=float(y)+0.5f;
+	for(unsigned int x=xBegin;x<xEnd;++x,++ifPtr,++dcsPtr,++dcoPtr,++abPtr,++ab0Ptr,++cPtr,++sPtr,++sqPtr,++ofPtr,++nofPtr)
+		{
+		float px=float(x)+0.5f;
+		
+		unsigned int oldVal=*abPtr;
+		unsigned int newVal=*ifPtr;
+		
+		/* Retrieve the pixel's statistics: */
+		unsigned int count=*cPtr; // Number of valid samples
+		unsigned int sum=*sPtr; // Sum of valid samples
+		SumSquaresParam sumSq=*sqPtr; // Sum of squares of valid samples
+		unsigned int motion=adaptiveParam?mPtr[x-xBegin]:0U; // Window restart flag in the high bit, and number of consecutive deviating samples in the low seven bits
+		unsigned int numDeviating=motion&0x7fU;
+		motion&=0x80U; // Any sample that is not valid and deviating breaks the run of deviating samples
+		
+		/* Depth-correct the new value: */
+		float newCVal=float(newVal)*(*dcsPtr)+(*dcoPtr);
+		
+		/* Plug the depth-corrected new value into the minimum and maximum plane equations to determine its validity: */
+		float minD=minPlane[0]*px+minPlane[1]*py+minPlane[2]*newCVal+minPlane[3];
+		float maxD=maxPlane[0]*px+maxPlane[1]*py+maxPlane[2]*newCVal+maxPlane[3];
+		if(minD>=0.0f&&maxD<=0.0f)
+			{
+			if(adaptiveParam)
+				{
+				/* Extend the run of deviating samples if the new value is farther from the pixel's running mean than the motion threshold: */
+				if(count>0&&Math::abs(float(newVal)*float(count)-float(sum))>motionThreshold*float(count))
+					motion|=numDeviating+1U;
+				}
+			
+			/* Store the new input value: */
+			*abPtr=newVal;
+			
+			if(medianParam)
+				{
+				/* Replace the old value with the new value in the pixel's sorted sample window: */
+				RawDepth* window=mwPtr+size_t(x-xBegin)*numAveragingSlots;
+				if(oldVal!=2048U)
+					replaceSortedSample(window,count,oldVal,newVal);
+				else
+					insertSortedSample(window,count,newVal);
+				}
+			
+			/* Update the pixel's statistics: */
+			++count;
+			sum+=newVal;
+			sumSq+=SumSquaresParam(newVal)*newVal;
+			
+			/* Check if the previous value in the averaging buffer was valid: */
+			if(oldVal!=2048U)
+				{
+				--count;
+				sum-=oldVal;
+				sumSq-=SumSquaresParam(oldVal)*oldVal;
+				}
+			
+			if(adaptiveParam&&(motion&0x7fU)>=motionConfirmSamples)
+				{
+				/* The pixel moved; restart its averaging window from the consecutive deviating samples, which are in the most recently written slots: */
+				unsigned int numKeep=motion&0x7fU;
+				if(numKeep>numAveragingSlots)
+					numKeep=numAveragingSlots;
+				count=0;
+				sum=0;
+				sumSq=0;
+				RawDepth* slotPtr=ab0Ptr;
+				for(unsigned int i=0;i<numAveragingSlots;++i,slotPtr+=slotStride)
+					{
+					if((averagingSlotIndex+numAveragingSlots-i)%numAveragingSlots<numKeep)
+						{
+						++count;
+						sum+=*slotPtr;
+						sumSq+=SumSquaresParam(*slotPtr)*(*slotPtr);
+						}
+					else
+						*slotPtr=2048U;
+					}
+				
+				/* Flag the window as restarted: */
+				motion=0x80U;
+				}
+			}
+		else if(!retainValids)
+			{
+			/* Store an invalid input value: */
+			*abPtr=2048U;
+			
+			/* Check if the previous value in the averaging buffer was valid: */
+			if(oldVal!=2048U)
+				{
+				/* Remove the old value from the pixel's sorted sample window: */
+				if(medianParam)
+					removeSortedSample(mwPtr+size_t(x-xBegin)*numAveragingSlots,count,oldVal);
+				
+				--count;
+				sum-=oldVal;
+				sumSq-=SumSquaresParam(oldVal)*oldVal;
+				}
+			}
+		
+		/* Store the pixel's updated statistics: */
+		*cPtr=Misc::UInt16(count);
+		*sPtr=sum;
+		*sqPtr=sumSq;
+		
+		unsigned int requiredNumSamples=minNumSamples;
+		if(adaptiveParam)
+			{
+			/* Relax the required number of samples after a window restart until the window has filled up again: */
+			if(count>=minNumSamples)
+				motion&=0x7fU;
+			else if((motion&0x80U)!=0U&&motionMinNumSamples<minNumSamples)
+				requiredNumSamples=motionMinNumSamples;
+			mPtr[x-xBegin]=Misc::UInt8(motion);
+			}
+		
+		/* Check if the pixel is considered "stable": */
+		if(count>=requiredNumSamples&&sumSq*count<=SumSquaresParam(maxVariance)*count*count+SumSquaresParam(sum)*sum)
+			{
+			float newMean;
+			if(medianParam)
+				{
+				/* Average the two middle samples of the pixel's sorted sample window, which are the same for odd numbers of samples: */
+				const RawDepth* window=mwPtr+size_t(x-xBegin)*numAveragingSlots;
+				newMean=(float(window[(count-1)/2])+float(window[count/2]))*0.5f;
+				}
+			else
+				newMean=float(sum)/float(count);
+			
+			/* Check if the new depth-corrected running mean is outside the previous value's envelope: */
+			float newFiltered=newMean*(*dcsPtr)+(*dcoPtr);
+			if(Math::abs(newFiltered-*ofPtr)>=hysteresis)
+				{
+				/* Set the output pixel value to the depth-corrected running mean: */
+				*nofPtr=*ofPtr=newFiltered;
+				}
+			else
+				{
+				/* Leave the pixel at its previous value: */
+				*nofPtr=*ofPtr;
+				}
+			}
+		else if(retainValids)
+			{
+			/* Leave the pixel at its previous value: */
+			*nofPtr=*ofPtr;
+			}
+		else
+			{
+			/* Assign default value to instable pixels: */
+			*nofPtr=instableValue;
+			}
+		}
+	}
+
+void FrameFilter::filterRowScalar32(const FrameFilter::RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	filterPixels<Misc::UInt32,false,false>(inputData,outputData,sumSquaresBuffer32,y,xBegin,xEnd);
+	}
+
+void FrameFilter::filterRowScalar64(const FrameFilter::RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	filterPixels<Misc::UInt64,false,false>(inputData,outputData,sumSquaresBuffer64,y,xBegin,xEnd);
+	}
+
+void FrameFilter::filterRowMedian32(const FrameFilter::RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	filterPixels<Misc::UInt32,true,false>(inputData,outputData,sumSquaresBuffer32,y,xBegin,xEnd);
+	}
+
+void FrameFilter::filterRowMedian64(const FrameFilter::RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	filterPixels<Misc::UInt64,true,false>(inputData,outputData,sumSquaresBuffer64,y,xBegin,xEnd);
+	}
+
+void FrameFilter::filterRowAdaptive32(const FrameFilter::RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	filterPixels<Misc::UInt32,false,true>(inputData,outputData,sumSquaresBuffer32,y,xBegin,xEnd);
+	}
+
+void FrameFilter::filterRowAdaptive64(const FrameFilter::RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	filterPixels<Misc::UInt64,false,true>(inputData,outputData,sumSquaresBuffer64,y,xBegin,xEnd);
+	}
+
+void FrameFilter::filterRowEMA(const FrameFilter::RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	/* Get pointers to the first pixel of the span in all buffers: */
+	unsigned int pixelIndex=y*size[0]+xBegin;
+	const RawDepth* ifPtr=inputData+pixelIndex;
+	const float* dcsPtr=depthCorrectionScales+pixelIndex;
+	const float* dcoPtr=depthCorrectionOffsets+pixelIndex;
+	Misc::UInt16* cPtr=countBuffer+pixelIndex;
+	float* ePtr=estimateBuffer+pixelIndex;
+	float* evPtr=estimateVarianceBuffer+pixelIndex;
+	float* ofPtr=validBuffer+pixelIndex;
+	float* nofPtr=outputData+pixelIndex;
+	
+	float py=float(y)+0.5f;
+	for(unsigned int x=xBegin;x<xEnd;++x,++ifPtr,++dcsPtr,++dcoPtr,++cPtr,++ePtr,++evPtr,++ofPtr,++nofPtr)
+		{
+		float px=float(x)+0.5f;
+		
+		unsigned int newVal=*ifPtr;
+		unsigned int count=*cPtr;
+		
+		/* Depth-correct the new value: */
+		float newCVal=float(newVal)*(*dcsPtr)+(*dcoPtr);
+		
+		/* Plug the depth-corrected new value into the minimum and maximum plane equations to determine its validity: */
+		float minD=minPlane[0]*px+minPlane[1]*py+minPlane[2]*newCVal+minPlane[3];
+		float maxD=maxPlane[0]*px+maxPlane[1]*py+maxPlane[2]*newCVal+maxPlane[3];
+		if(minD>=0.0f&&maxD<=0.0f)
+			{
+			float delta=float(newVal)-*ePtr;
+			if(count==0||delta*delta>9.0f*(*evPtr+float(maxVariance)))
+				{
+				/* Restart the average from the new value if there is no previous estimate or the new value is more than three standard deviations away from it: */
+				*ePtr=float(newVal);
+				*evPtr=0.0f;
+				count=1;
+				}
+			else
+				{
+				/* Update the running average and variance: */
+				*ePtr+=emaWeight*delta;
+				*evPtr=(1.0f-emaWeight)*(*evPtr+emaWeight*delta*delta);
+				if(count<65535U)
+					++count;
+				}
+			}
+		else if(!retainValids&&count>0)
+			{
+			/* Count the invalid sample against the pixel's stability: */
+			--count;
+			}
+		*cPtr=Misc::UInt16(count);
+		
+		/* Check if the pixel is considered "stable": */
+		if(count>=minNumSamples&&*evPtr<=float(maxVariance))
+			{
+			/* Check if the new depth-corrected running average is outside the previous value's envelope: */
+			float newFiltered=(*ePtr)*(*dcsPtr)+(*dcoPtr);
+			if(Math::abs(newFiltered-*ofPtr)>=hysteresis)
+				{
+				/* Set the output pixel value to the depth-corrected running average: */
+				*nofPtr=*ofPtr=newFiltered;
+				}
+			else
+				{
+				/* Leave the pixel at its previous value: */
+				*nofPtr=*ofPtr;
+				}
+			}
+		else if(retainValids)
+			{
+			/* Leave the pixel at its previous value: */
+			*nofPtr=*ofPtr;
+			}
+		else
+			{
+			/* Assign default value to instable pixels: */
+			*nofPtr=instableValue;
+			}
+		}
+	}
+
+void FrameFilter::filterRowKalman(const FrameFilter::RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	/* Get pointers to the first pixel of the span in all buffers: */
+	unsigned int pixelIndex=y*size[0]+xBegin;
+	const RawDepth* ifPtr=inputData+pixelIndex;
+	const float* dcsPtr=depthCorrectionScales+pixelIndex;
+	const float* dcoPtr=depthCorrectionOffsets+pixelIndex;
+	Misc::UInt16* cPtr=countBuffer+pixelIndex;
+	float* ePtr=estimateBuffer+pixelIndex;
+	float* evPtr=estimateVarianceBuffer+pixelIndex;
+	float* ofPtr=validBuffer+pixelIndex;
+	float* nofPtr=outputData+pixelIndex;
+	
+	float py=float(y)+0.5f;
+	for(unsigned int x=xBegin;x<xEnd;++x,++ifPtr,++dcsPtr,++dcoPtr,++cPtr,++ePtr,++evPtr,++ofPtr,++nofPtr)
+		{
+		float px=float(x)+0.5f;
+		
+		unsigned int newVal=*ifPtr;
+		unsigned int count=*cPtr;
+		
+		/* Depth-correct the new value: */
+		float newCVal=float(newVal)*(*dcsPtr)+(*dcoPtr);
+		
+		/* Plug the depth-corrected new value into the minimum and maximum plane equations to determine its validity: */
+		float minD=minPlane[0]*px+minPlane[1]*py+minPlane[2]*newCVal+minPlane[3];
+		float maxD=maxPlane[0]*px+maxPlane[1]*py+maxPlane[2]*newCVal+maxPlane[3];
+		if(minD>=0.0f&&maxD<=0.0f)
+			{
+			/* Predict the estimate's variance for the current frame: */
+			float variance=*evPtr+kalmanProcessNoise;
+			float innovation=float(newVal)-*ePtr;
+			float innovationVariance=variance+kalmanMeasurementNoise;
+			if(count==0||innovation*innovation>9.0f*innovationVariance)
+				{
+				/* Restart the filter from the new value if there is no previous estimate or the new value is more than three standard deviations away from it: */
+				*ePtr=float(newVal);
+				*evPtr=kalmanMeasurementNoise;
+				count=1;
+				}
+			else
+				{
+				/* Correct the estimate with the new value: */
+				float gain=variance/innovationVariance;
+				*ePtr+=gain*innovation;
+				*evPtr=(1.0f-gain)*variance;
+				if(count<65535U)
+					++count;
+				}
+			}
+		else if(!retainValids&&count>0)
+			{
+			/* Count the invalid sample against the pixel's stability: */
+			--count;
+			}
+		*cPtr=Misc::UInt16(count);
+		
+		/* Check if the pixel is considered "stable": */
+		if(count>=minNumSamples&&*evPtr<=float(maxVariance))
+			{
+			/* Check if the new depth-corrected estimate is outside the previous value's envelope: */
+			float newFiltered=(*ePtr)*(*dcsPtr)+(*dcoPtr);
+			if(Math::abs(newFiltered-*ofPtr)>=hysteresis)
+				{
+				/* Set the output pixel value to the depth-corrected estimate: */
+				*nofPtr=*ofPtr=newFiltered;
+				}
+			else
+				{
+				/* Leave the pixel at its previous value: */
+				*nofPtr=*ofPtr;
+				}
+			}
+		else if(retainValids)
+			{
+			/* Leave the pixel at its previous value: */
+			*nofPtr=*ofPtr;
+			}
+		else
+			{
+			/* Assign default value to instable pixels: */
+			*nofPtr=instableValue;
+			}
+		}
+	}
+
+#if FRAMEFILTER_X86SIMD
+
+/*****************************************************************
+The SIMD kernels below perform exactly the same sequence of IEEE
+floating-point operations as filterPixels, and the same modulo-2^32
+integer operations as filterPixels with 32-bit sums of squares, one
+pixel per vector lane. Their results are therefore bit-identical to
+those of the scalar code.
+*****************************************************************/
+
+__attribute__((target("sse4.1")))
+void FrameFilter::filterRowSSE41(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	/* Get pointers to the first pixel of the span in all buffers: */
+	unsigned int pixelIndex=y*size[0]+xBegin;
+	const RawDepth* ifPtr=inputData+pixelIndex;
+	const float* dcsPtr=depthCorrectionScales+pixelIndex;
+	const float* dcoPtr=depthCorrectionOffsets+pixelIndex;
+	RawDepth* abPtr=averagingBuffer+averagingSlotIndex*size[1]*size[0]+pixelIndex;
+	Misc::UInt16* cPtr=countBuffer+pixelIndex;
+	Misc::UInt32* sPtr=sumBuffer+pixelIndex;
+	Misc::UInt32* sqPtr=sumSquaresBuffer32+pixelIndex;
+	float* ofPtr=validBuffer+pixelIndex;
+	float* nofPtr=outputData+pixelIndex;
+	
+	/* Set up loop-invariant vectors: */
+	__m128 px=_mm_add_ps(_mm_setr_ps(0.5f,1.5f,2.5f,3.5f),_mm_set1_ps(float(xBegin)));
+	__m128 pxStep=_mm_set1_ps(4.0f);
+	__m128 py=_mm_set1_ps(float(y)+0.5f);
+	__m128 minPlane0=_mm_set1_ps(minPlane[0]);
+	__m128 minPlane1=_mm_set1_ps(minPlane[1]);
+	__m128 minPlane2=_mm_set1_ps(minPlane[2]);
+	__m128 minPlane3=_mm_set1_ps(minPlane[3]);
+	__m128 maxPlane0=_mm_set1_ps(maxPlane[0]);
+	__m128 maxPlane1=_mm_set1_ps(maxPlane[1]);
+	__m128 maxPlane2=_mm_set1_ps(maxPlane[2]);
+	__m128 maxPlane3=_mm_set1_ps(maxPlane[3]);
+	__m128 zero=_mm_setzero_ps();
+	__m128 absMask=_mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 hysteresisV=_mm_set1_ps(hysteresis);
+	__m128 instableValueV=_mm_set1_ps(instableValue);
+	__m128i invalid=_mm_set1_epi32(2048);
+	__m128i one=_mm_set1_epi32(1);
+	__m128i minNumSamplesV=_mm_set1_epi32(int(minNumSamples));
+	__m128i maxVarianceV=_mm_set1_epi32(int(maxVariance));
+	__m128i storeInvalids=retainValids?_mm_setzero_si128():_mm_set1_epi32(-1);
+	__m128 keepValids=retainValids?_mm_castsi128_ps(_mm_set1_epi32(-1)):_mm_setzero_ps();
+	
+	unsigned int x=xBegin;
+	for(;x+4<=xEnd;x+=4,ifPtr+=4,dcsPtr+=4,dcoPtr+=4,abPtr+=4,cPtr+=4,sPtr+=4,sqPtr+=4,ofPtr+=4,nofPtr+=4,px=_mm_add_ps(px,pxStep))
+		{
+		/* Load the old and new raw depth values: */
+		__m128i oldVal=_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(abPtr)));
+		__m128i newVal=_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ifPtr)));
+		
+		/* Depth-correct the new values: */
+		__m128 scale=_mm_loadu_ps(dcsPtr);
+		__m128 offset=_mm_loadu_ps(dcoPtr);
+		__m128 newCVal=_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(newVal),scale),offset);
+		
+		/* Plug the depth-corrected new values into the minimum and maximum plane equations to determine their validity: */
+		__m128 minD=_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(minPlane0,px),_mm_mul_ps(minPlane1,py)),_mm_mul_ps(minPlane2,newCVal)),minPlane3);
+		__m128 maxD=_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(maxPlane0,px),_mm_mul_ps(maxPlane1,py)),_mm_mul_ps(maxPlane2,newCVal)),maxPlane3);
+		__m128i valid=_mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(minD,zero),_mm_cmple_ps(maxD,zero)));
+		
+		/* Determine which averaging slots are overwritten, and which overwritten slots held valid samples: */
+		__m128i store=_mm_or_si128(valid,storeInvalids);
+		__m128i remove=_mm_andnot_si128(_mm_cmpeq_epi32(oldVal,invalid),store);
+		
+		/* Store the new averaging buffer values: */
+		__m128i newAb=_mm_blendv_epi8(oldVal,_mm_blendv_epi8(invalid,newVal,valid),store);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(abPtr),_mm_packus_epi32(newAb,newAb));
+		
+		/* Update the pixels' statistics: */
+		__m128i count=_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cPtr)));
+		__m128i sum=_mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr));
+		__m128i sumSq=_mm_loadu_si128(reinterpret_cast<const __m128i*>(sqPtr));
+		count=_mm_sub_epi32(_mm_add_epi32(count,_mm_and_si128(valid,one)),_mm_and_si128(remove,one));
+		sum=_mm_sub_epi32(_mm_add_epi32(sum,_mm_and_si128(valid,newVal)),_mm_and_si128(remove,oldVal));
+		sumSq=_mm_sub_epi32(_mm_add_epi32(sumSq,_mm_and_si128(valid,_mm_mullo_epi32(newVal,newVal))),_mm_and_si128(remove,_mm_mullo_epi32(oldVal,oldVal)));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(cPtr),_mm_packus_epi32(count,count));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(sPtr),sum);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(sqPtr),sumSq);
+		
+		/* Check which pixels are considered "stable" using unsigned comparisons: */
+		__m128i enoughSamples=_mm_cmpeq_epi32(_mm_max_epu32(count,minNumSamplesV),count);
+		__m128i lhs=_mm_mullo_epi32(sumSq,count);
+		__m128i rhs=_mm_add_epi32(_mm_mullo_epi32(_mm_mullo_epi32(maxVarianceV,count),count),_mm_mullo_epi32(sum,sum));
+		__m128 stable=_mm_castsi128_ps(_mm_and_si128(enoughSamples,_mm_cmpeq_epi32(_mm_max_epu32(lhs,rhs),rhs)));
+		
+		/* Check if the new depth-corrected running means are outside the previous values' envelopes: */
+		__m128 newFiltered=_mm_add_ps(_mm_mul_ps(_mm_div_ps(_mm_cvtepi32_ps(sum),_mm_cvtepi32_ps(count)),scale),offset);
+		__m128 oldFiltered=_mm_loadu_ps(ofPtr);
+		__m128 update=_mm_and_ps(stable,_mm_cmpge_ps(_mm_and_ps(_mm_sub_ps(newFiltered,oldFiltered),absMask),hysteresisV));
+		__m128 filtered=_mm_blendv_ps(oldFiltered,newFiltered,update);
+		_mm_storeu_ps(ofPtr,filtered);
+		
+		/* Assign the stable value or the default value to the output pixels: */
+		_mm_storeu_ps(nofPtr,_mm_blendv_ps(instableValueV,filtered,_mm_or_ps(stable,keepValids)));
+		}
+	
+	/* Filter the remaining pixels in the span: */
+	filterPixels<Misc::UInt32,false,false>(inputData,outputData,sumSquaresBuffer32,y,x,xEnd);
+	}
+
+__attribute__((target("avx2")))
+void FrameFilter::filterRowAVX2(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	/* Get pointers to the first pixel of the span in all buffers: */
+	unsigned int pixelIndex=y*size[0]+xBegin;
+	const RawDepth* ifPtr=inputData+pixelIndex;
+	const float* dcsPtr=depthCorrectionScales+pixelIndex;
+	const float* dcoPtr=depthCorrectionOffsets+pixelIndex;
+	RawDepth* abPtr=averagingBuffer+averagingSlotIndex*size[1]*size[0]+pixelIndex;
+	Misc::UInt16* cPtr=countBuffer+pixelIndex;
+	Misc::UInt32* sPtr=sumBuffer+pixelIndex;
+	Misc::UInt32* sqPtr=sumSquaresBuffer32+pixelIndex;
+	float* ofPtr=validBuffer+pixelIndex;
+	float* nofPtr=outputData+pixelIndex;
+	
+	/* Set up loop-invariant vectors: */
+	__m256 px=_mm256_add_ps(_mm256_setr_ps(0.5f,1.5f,2.5f,3.5f,4.5f,5.5f,6.5f,7.5f),_mm256_set1_ps(float(xBegin)));
+	__m256 pxStep=_mm256_set1_ps(8.0f);
+	__m256 py=_mm256_set1_ps(float(y)+0.5f);
+	__m256 minPlane0=_mm256_set1_ps(minPlane[0]);
+	__m256 minPlane1=_mm256_set1_ps(minPlane[1]);
+	__m256 minPlane2=_mm256_set1_ps(minPlane[2]);
+	__m256 minPlane3=_mm256_set1_ps(minPlane[3]);
+	__m256 maxPlane0=_mm256_set1_ps(maxPlane[0]);
+	__m256 maxPlane1=_mm256_set1_ps(maxPlane[1]);
+	__m256 maxPlane2=_mm256_set1_ps(maxPlane[2]);
+	__m256 maxPlane3=_mm256_set1_ps(maxPlane[3]);
+	__m256 zero=_mm256_setzero_ps();
+	__m256 absMask=_mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256 hysteresisV=_mm256_set1_ps(hysteresis);
+	__m256 instableValueV=_mm256_set1_ps(instableValue);
+	__m256i invalid=_mm256_set1_epi32(2048);
+	__m256i one=_mm256_set1_epi32(1);
+	__m256i minNumSamplesV=_mm256_set1_epi32(int(minNumSamples));
+	__m256i maxVarianceV=_mm256_set1_epi32(int(maxVariance));
+	__m256i storeInvalids=retainValids?_mm256_setzero_si256():_mm256_set1_epi32(-1);
+	__m256 keepValids=retainValids?_mm256_castsi256_ps(_mm256_set1_epi32(-1)):_mm256_setzero_ps();
+	
+	unsigned int x=xBegin;
+	for(;x+8<=xEnd;x+=8,ifPtr+=8,dcsPtr+=8,dcoPtr+=8,abPtr+=8,cPtr+=8,sPtr+=8,sqPtr+=8,ofPtr+=8,nofPtr+=8,px=_mm256_add_ps(px,pxStep))
+		{
+		/* Load the old and new raw depth values: */
+		__m256i oldVal=_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(abPtr)));
+		__m256i newVal=_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ifPtr)));
+		
+		/* Depth-correct the new values: */
+		__m256 scale=_mm256_loadu_ps(dcsPtr);
+		__m256 offset=_mm256_loadu_ps(dcoPtr);
+		__m256 newCVal=_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(newVal),scale),offset);
+		
+		/* Plug the depth-corrected new values into the minimum and maximum plane equations to determine their validity: */
+		__m256 minD=_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(minPlane0,px),_mm256_mul_ps(minPlane1,py)),_mm256_mul_ps(minPlane2,newCVal)),minPlane3);
+		__m256 maxD=_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(maxPlane0,px),_mm256_mul_ps(maxPlane1,py)),_mm256_mul_ps(maxPlane2,newCVal)),maxPlane3);
+		__m256i valid=_mm256_castps_si256(_mm256_and_ps(_mm256_cmp_ps(minD,zero,_CMP_GE_OQ),_mm256_cmp_ps(maxD,zero,_CMP_LE_OQ)));
+		
+		/* Determine which averaging slots are overwritten, and which overwritten slots held valid samples: */
+		__m256i store=_mm256_or_si256(valid,storeInvalids);
+		__m256i remove=_mm256_andnot_si256(_mm256_cmpeq_epi32(oldVal,invalid),store);
+		
+		/* Store the new averaging buffer values: */
+		__m256i newAb=_mm256_blendv_epi8(oldVal,_mm256_blendv_epi8(invalid,newVal,valid),store);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(abPtr),_mm_packus_epi32(_mm256_castsi256_si128(newAb),_mm256_extracti128_si256(newAb,1)));
+		
+		/* Update the pixels' statistics: */
+		__m256i count=_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cPtr)));
+		__m256i sum=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(sPtr));
+		__m256i sumSq=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(sqPtr));
+		count=_mm256_sub_epi32(_mm256_add_epi32(count,_mm256_and_si256(valid,one)),_mm256_and_si256(remove,one));
+		sum=_mm256_sub_epi32(_mm256_add_epi32(sum,_mm256_and_si256(valid,newVal)),_mm256_and_si256(remove,oldVal));
+		sumSq=_mm256_sub_epi32(_mm256_add_epi32(sumSq,_mm256_and_si256(valid,_mm256_mullo_epi32(newVal,newVal))),_mm256_and_si256(remove,_mm256_mullo_epi32(oldVal,oldVal)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(cPtr),_mm_packus_epi32(_mm256_castsi256_si128(count),_mm256_extracti128_si256(count,1)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(sPtr),sum);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(sqPtr),sumSq);
+		
+		/* Check which pixels are considered "stable" using unsigned comparisons: */
+		__m256i enoughSamples=_mm256_cmpeq_epi32(_mm256_max_epu32(count,minNumSamplesV),count);
+		__m256i lhs=_mm256_mullo_epi32(sumSq,count);
+		__m256i rhs=_mm256_add_epi32(_mm256_mullo_epi32(_mm256_mullo_epi32(maxVarianceV,count),count),_mm256_mullo_epi32(sum,sum));
+		__m256 stable=_mm256_castsi256_ps(_mm256_and_si256(enoughSamples,_mm256_cmpeq_epi32(_mm256_max_epu32(lhs,rhs),rhs)));
+		
+		/* Check if the new depth-corrected running means are outside the previous values' envelopes: */
+		__m256 newFiltered=_mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(_mm256_cvtepi32_ps(sum),_mm256_cvtepi32_ps(count)),scale),offset);
+		__m256 oldFiltered=_mm256_loadu_ps(ofPtr);
+		__m256 update=_mm256_and_ps(stable,_mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(newFiltered,oldFiltered),absMask),hysteresisV,_CMP_GE_OQ));
+		__m256 filtered=_mm256_blendv_ps(oldFiltered,newFiltered,update);
+		_mm256_storeu_ps(ofPtr,filtered);
+		
+		/* Assign the stable value or the default value to the output pixels: */
+		_mm256_storeu_ps(nofPtr,_mm256_blendv_ps(instableValueV,filtered,_mm256_or_ps(stable,keepValids)));
+		}
+	
+	/* Filter the remaining pixels in the span: */
+	filterPixels<Misc::UInt32,false,false>(inputData,outputData,sumSquaresBuffer32,y,x,xEnd);
+	}
+
+#endif
+
+void FrameFilter::binRow(unsigned int y,unsigned int xBegin,unsigned int xEnd)
+	{
+	/* Get pointers to the first bin of the span in the two raw rows and the binned row: */
+	const RawDepth* r0Ptr=bandRawData+(2*y)*frameSize[0]+2*xBegin;
+	const RawDepth* r1Ptr=r0Ptr+frameSize[0];
+	RawDepth* bPtr=binnedInputBuffer+y*size[0]+xBegin;
+	for(unsigned int x=xBegin;x<xEnd;++x,r0Ptr+=2,r1Ptr+=2,++bPtr)
+		{
+		/* Average the valid raw depth values in the bin, rounding to the nearest integer: */
+		unsigned int sum=0;
+		unsigned int count=0;
+		const RawDepth* samples[4]={r0Ptr,r0Ptr+1,r1Ptr,r1Ptr+1};
+		for(int i=0;i<4;++i)
+			if(*samples[i]<2047U)
+				{
+				sum+=*samples[i];
+				++count;
+				}
+		*bPtr=count>0?RawDepth((sum+count/2)/count):RawDepth(2047U);
+		}
+	}
+
+void FrameFilter::upsampleFrame(const float* binnedData,float* outputData)
+	{
+	float* oPtr=outputData;
+	for(unsigned int y=0;y<frameSize[1];++y)
+		{
+		if(retainValids)
+			{
+			/* Find the two rows of bins bracketing the output row: */
+			unsigned int by0,by1;
+			float wy1;
+			getUpsampleBins(y,size[1],by0,by1,wy1);
+			const float* row0=binnedData+by0*size[0];
+			const float* row1=binnedData+by1*size[0];
+			float wy0=1.0f-wy1;
+			
+			/* Interpolate each pair of output pixels between the vertically interpolated bin and its left or right neighbor: */
+			float vPrev=row0[0]*wy0+row1[0]*wy1;
+			float vCur=vPrev;
+			for(unsigned int bx=0;bx<size[0];++bx,oPtr+=2)
+				{
+				float vNext=bx+1<size[0]?row0[bx+1]*wy0+row1[bx+1]*wy1:vCur;
+				oPtr[0]=vPrev*0.25f+vCur*0.75f;
+				oPtr[1]=vCur*0.75f+vNext*0.25f;
+				vPrev=vCur;
+				vCur=vNext;
+				}
+			
+			/* Extend the last bin into the last column of frames of odd width: */
+			if(frameSize[0]&0x1U)
+				*(oPtr++)=vCur;
+			}
+		else
+			{
+			/* Replicate each bin's value, as interpolation would blend instable values into stable ones: */
+			unsigned int by=y/2<size[1]?y/2:size[1]-1;
+			const float* row=binnedData+by*size[0];
+			for(unsigned int bx=0;bx<size[0];++bx,oPtr+=2)
+				oPtr[0]=oPtr[1]=row[bx];
+			if(frameSize[0]&0x1U)
+				*(oPtr++)=row[size[0]-1];
+			}
+		}
+	}
+
+void FrameFilter::updateDirtyRect(const float* outputData)
+	{
+	if(!previousOutputValid)
+		{
+		/* Consider the entire first output frame changed: */
+		memcpy(previousOutputBuffer,outputData,size_t(frameSize[1])*size_t(frameSize[0])*sizeof(float));
+		previousOutputValid=true;
+		dirtyRect=Rect(frameSize);
+		return;
+		}
+	
+	/* Find the range of rows and columns that differ from the previous output frame: */
+	unsigned int x0=frameSize[0],x1=0,y0=frameSize[1],y1=0;
+	const float* oRow=outputData;
+	float* pRow=previousOutputBuffer;
+	for(unsigned int y=0;y<frameSize[1];++y,oRow+=frameSize[0],pRow+=frameSize[0])
+		{
+		/* Skip unchanged rows, which hysteresis makes the common case: */
+		if(memcmp(oRow,pRow,frameSize[0]*sizeof(float))==0)
+			continue;
+		
+		/* Find the first and last changed pixels in the row, comparing bit patterns to match the row test: */
+		unsigned int rx0=0;
+		while(memcmp(oRow+rx0,pRow+rx0,sizeof(float))==0)
+			++rx0;
+		unsigned int rx1=frameSize[0];
+		while(memcmp(oRow+(rx1-1),pRow+(rx1-1),sizeof(float))==0)
+			--rx1;
+		
+		/* Grow the changed rectangle: */
+		if(x0>rx0)
+			x0=rx0;
+		if(x1<rx1)
+			x1=rx1;
+		if(y0>y)
+			y0=y;
+		y1=y+1;
+		
+		/* Retain the changed part of the row: */
+		memcpy(pRow+rx0,oRow+rx0,(rx1-rx0)*sizeof(float));
+		}
+	
+	/* Store the changed rectangle, which is empty if no pixel changed: */
+	if(y0<y1)
+		{
+		dirtyRect.offset[0]=int(x0);
+		dirtyRect.offset[1]=int(y0);
+		dirtyRect.size[0]=x1-x0;
+		dirtyRect.size[1]=y1-y0;
+		}
+	else
+		dirtyRect=Rect(Size(0,0));
+	}
+
+void FrameFilter::setROISpans(unsigned int* newSpans)
+	{
+	/* Replace any region of interest that was not yet picked up by the background filtering thread: */
+	Threads::MutexCond::Lock inputLock(inputCond);
+	delete[] newROISpans;
+	newROISpans=newSpans;
+	}
+
+void FrameFilter::updateROI(unsigned int* newSpans)
+	{
+	/* Install the new region of interest: */
+	delete[] roiSpans;
+	roiSpans=newSpans;
+	
+	/* Count the pixels inside the region of interest: */
+	unsigned int newNumROIPixels=0;
+	for(unsigned int y=0;y<size[1];++y)
+		newNumROIPixels+=roiSpans[2*y+1]-roiSpans[2*y];
+	__atomic_store_n(&numROIPixels,newNumROIPixels,__ATOMIC_RELAXED);
+	
+	/* Find the spatial filter tiles overlapping the region of interest: */
+	for(unsigned int ty=0;ty<numTiles[1];++ty)
+		{
+		unsigned int y0=ty*spatialTileSize;
+		unsigned int y1=y0+spatialTileSize<size[1]?y0+spatialTileSize:size[1];
+		for(unsigned int tx=0;tx<numTiles[0];++tx)
+			{
+			unsigned int x0=tx*spatialTileSize;
+			unsigned int x1=x0+spatialTileSize<size[0]?x0+spatialTileSize:size[0];
+			unsigned char inROI=0;
+			for(unsigned int y=y0;y<y1&&inROI==0;++y)
+				if(roiSpans[2*y]<x1&&roiSpans[2*y+1]>x0)
+					inROI=1;
+			tileInROI[ty*numTiles[0]+tx]=inROI;
+			}
+		}
+	
+	/* The spatial filter needs to start from scratch, as pixels might have entered or left the region of interest: */
+	spatialResultValid=false;
+	}
+
+void FrameFilter::spatialFilterRect(const float* source,float* dest,unsigned int xBegin,unsigned int xEnd,unsigned int yBegin,unsigned int yEnd,float* scratch)
+	{
+	unsigned int width=size[0];
+	unsigned int height=size[1];
+	
+	/*********************************************************************
+	Each filter pass reads one neighbor in each direction. The results of
+	the second pass inside the rectangle therefore depend on results of
+	the first pass one pixel outside the rectangle, which in turn depend
+	on source pixels two pixels outside the rectangle. Frame-edge weights
+	are only applied at the actual frame edges, making the results
+	identical to filtering the entire frame.
+	*********************************************************************/
+	
+	/* Calculate the ranges of rows and columns for which results of the first filter pass are needed: */
+	unsigned int haloYBegin=yBegin>0?yBegin-1:0;
+	unsigned int haloYEnd=yEnd<height?yEnd+1:height;
+	unsigned int haloXBegin=xBegin>0?xBegin-1:0;
+	unsigned int haloXEnd=xEnd<width?xEnd+1:width;
+	
+	/* Calculate the range of columns for which results of the first column pass are needed: */
+	unsigned int colXBegin=haloXBegin>0?haloXBegin-1:0;
+	unsigned int colXEnd=haloXEnd<width?haloXEnd+1:width;
+	
+	/* Scratch rows of full frame width for the first filter pass and the column passes: */
+	float* pass1=scratch;
+	float* colRow=scratch+(haloYEnd-haloYBegin)*width;
+	
+	/* Run the first filter pass on the rectangle plus its halo, reading neighboring pixels directly from the source frame: */
+	for(unsigned int y=haloYBegin;y<haloYEnd;++y)
+		{
+		const float* cur=source+y*width;
+		lowPassColumns(y>0?cur-width+colXBegin:0,cur+colXBegin,y<height-1?cur+width+colXBegin:0,colRow+colXBegin,colXEnd-colXBegin);
+		lowPassRow(colRow,pass1+(y-haloYBegin)*width,haloXBegin,haloXEnd,width);
+		}
+	
+	/* Run the second filter pass on the rectangle and write the results into the destination frame: */
+	for(unsigned int y=yBegin;y<yEnd;++y)
+		{
+		const float* cur=pass1+(y-haloYBegin)*width;
+		lowPassColumns(y>0?cur-width+haloXBegin:0,cur+haloXBegin,y<height-1?cur+width+haloXBegin:0,colRow+haloXBegin,haloXEnd-haloXBegin);
+		lowPassRow(colRow,dest+y*width,xBegin,xEnd,width);
+		}
+	}
+
+void FrameFilter::processBand(unsigned int bandIndex)
+	{
+	FilterBand& band=bands[bandIndex];
+	
+	/* Enter the band's pixels inside the region of interest into the averaging buffer and calculate their temporally filtered values: */
+	for(unsigned int y=band.yBegin;y<band.yEnd;++y)
+		{
+		unsigned int xBegin=roiSpans[2*y];
+		unsigned int xEnd=roiSpans[2*y+1];
+		if(xBegin<xEnd)
+			{
+			if(binned)
+				binRow(y,xBegin,xEnd);
+			(this->*filterRow)(bandInputData,bandTemporalData,y,xBegin,xEnd);
+			}
+		
+		/* Pixels outside the region of interest keep their most recent stable values: */
+		float* tdRow=bandTemporalData+y*size[0];
+		const float* vbRow=validBuffer+y*size[0];
+		memcpy(tdRow,vbRow,xBegin*sizeof(float));
+		memcpy(tdRow+xEnd,vbRow+xEnd,(size[0]-xEnd)*sizeof(float));
+		}
+	
+	/* Apply a spatial filter if requested: */
+	if(bandSpatialFilter)
+		{
+		/* Find the tiles in the band whose temporal filter results changed from the previous frame: */
+		const float* prevTemporalData=temporalBuffers[1-temporalBufferIndex];
+		for(unsigned int ty=band.tileRowBegin;ty<band.tileRowEnd;++ty)
+			{
+			unsigned int y0=ty*spatialTileSize;
+			unsigned int y1=y0+spatialTileSize<size[1]?y0+spatialTileSize:size[1];
+			unsigned char* tcPtr=tileChanged+ty*numTiles[0];
+			for(unsigned int tx=0;tx<numTiles[0];++tx,++tcPtr)
+				{
+				if(spatialResultValid&&tileInROI[ty*numTiles[0]+tx]==0)
+					{
+					/* Tiles outside the region of interest never change: */
+					*tcPtr=0;
+					}
+				else if(spatialResultValid)
+					{
+					/* Compare the tile's pixels against the previous frame: */
+					unsigned int x0=tx*spatialTileSize;
+					unsigned int x1=x0+spatialTileSize<size[0]?x0+spatialTileSize:size[0];
+					*tcPtr=0;
+					for(unsigned int y=y0;y<y1&&*tcPtr==0;++y)
+						if(memcmp(bandTemporalData+y*size[0]+x0,prevTemporalData+y*size[0]+x0,(x1-x0)*sizeof(float))!=0)
+							*tcPtr=1;
+					}
+				else
+					*tcPtr=1;
+				}
+			}
+		
+		/* Wait until all bands have been filtered temporally, as the spatial filter reads halo pixels and change flags from neighboring bands: */
+		if(numBands>1)
+			bandBarrier->synchronize();
+		
+		/* Re-filter runs of tiles that are changed or have changed neighbors, as the spatial filter reaches two pixels: */
+		band.numSkippedTiles=0;
+		for(unsigned int ty=band.tileRowBegin;ty<band.tileRowEnd;++ty)
+			{
+			unsigned int ty0=ty>0?ty-1:0;
+			unsigned int ty1=ty+1<numTiles[1]?ty+2:numTiles[1];
+			unsigned int y0=ty*spatialTileSize;
+			unsigned int y1=y0+spatialTileSize<size[1]?y0+spatialTileSize:size[1];
+			unsigned int runBegin=0;
+			bool inRun=false;
+			for(unsigned int tx=0;tx<=numTiles[0];++tx)
+				{
+				/* Check if the tile or any of its neighbors changed: */
+				bool dirty=false;
+				if(tx<numTiles[0])
+					{
+					unsigned int tx0=tx>0?tx-1:0;
+					unsigned int tx1=tx+1<numTiles[0]?tx+2:numTiles[0];
+					for(unsigned int nty=ty0;nty<ty1&&!dirty;++nty)
+						for(unsigned int ntx=tx0;ntx<tx1&&!dirty;++ntx)
+							dirty=tileChanged[nty*numTiles[0]+ntx]!=0;
+					if(!dirty)
+						++band.numSkippedTiles;
+					}
+				
+				if(dirty&&!inRun)
+					{
+					/* Start a new run of dirty tiles: */
+					runBegin=tx;
+					inRun=true;
+					}
+				else if(!dirty&&inRun)
+					{
+					/* Filter the run of dirty tiles: */
+					unsigned int x0=runBegin*spatialTileSize;
+					unsigned int x1=tx*spatialTileSize<size[0]?tx*spatialTileSize:size[0];
+					spatialFilterRect(bandTemporalData,spatialResultBuffer,x0,x1,y0,y1,band.spatialBuffer);
+					inRun=false;
+					}
+				}
+			}
+		
+		/* Copy the band's spatial filter results into the output frame: */
+		memcpy(bandOutputData+band.yBegin*size[0],spatialResultBuffer+band.yBegin*size[0],(band.yEnd-band.yBegin)*size[0]*sizeof(float));
+		}
+	
+	/* Wait until all bands have been processed: */
+	if(numBands>1)
+		bandBarrier->synchronize();
+	}
+
+void* FrameFilter::workerThreadMethod(void)
 	{
-	unsigned int lastInputFrameVersion=0;
+	/* Claim a band: */
+	unsigned int bandIndex;
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	bandIndex=nextWorkerBandIndex;
+	++nextWorkerBandIndex;
+	}
+	
+	while(true)
+		{
+		/* Wait until the background filtering thread starts working on a new frame or shuts down: */
+		bandBarrier->synchronize();
+		
+		/* Bail out if the program is shutting down: */
+		if(!runFilterThread)
+			break;
+		
+		/* Process the band: */
+		processBand(bandIndex);
+		}
 	
+	return 0;
+	}
+
+void* FrameFilter::filterThreadMethod(void)
+	{
+	unsigned int* pickedROISpans=0;
 	while(true)
 		{
-		Kinect::FrameBuffer frame;
 		{
 		Threads::MutexCond::Lock inputLock(inputCond);
 		
 		/* Wait until a new frame arrives or the program shuts down: */
-		while(runFilterThread&&lastInputFrameVersion==inputFrameVersion)
+		while(runFilterThread&&(__atomic_load_n(&inputSharedSlot,__ATOMIC_ACQUIRE)&inputSlotNewFrame)==0U)
 			inputCond.wait(inputLock);
 		
 		/* Bail out if the program is shutting down: */
 		if(!runFilterThread)
 			break;
 		
-		/* Work on the new frame: */
-		frame=inputFrame;
-		lastInputFrameVersion=inputFrameVersion;
+		/* Take ownership of a new region of interest; building its tile masks happens outside the lock: */
+		pickedROISpans=newROISpans;
+		newROISpans=0;
 		}
 		
-		/* Prepare a new output frame: */
-		Kinect::FrameBuffer& newOutputFrame=outputFrames.startNewValue();
-		
-		/* Enter the new frame into the averaging buffer and calculate the output frame's pixel values: */
-		const RawDepth* ifPtr=inputFrame.getData<RawDepth>();
-		RawDepth* abPtr=averagingBuffer+averagingSlotIndex*size[1]*size[0];
-		unsigned int* sPtr=statBuffer;
-		float* ofPtr=validBuffer;
-		float* nofPtr=newOutputFrame.getData<float>();
-		const PixelDepthCorrection* pdcPtr=pixelDepthCorrection;
-		for(unsigned int y=0;y<size[1];++y)
+		/* Install a new region of interest: */
+		if(pickedROISpans!=0)
 			{
-			float py=float(y)+0.5f;
-			for(unsigned int x=0;x<size[0];++x,++ifPtr,++pdcPtr,++abPtr,sPtr+=3,++ofPtr,++nofPtr)
-				{
-				float px=float(x)+0.5f;
-				
-				unsigned int oldVal=*abPtr;
-				unsigned int newVal=*ifPtr;
-				
-				/* Depth-correct the new value: */
-				float newCVal=pdcPtr->correct(newVal);
-				
-				/* Plug the depth-corrected new value into the minimum and maximum plane equations to determine its validity: */
-				float minD=minPlane[0]*px+minPlane[1]*py+minPlane[2]*newCVal+minPlane[3];
-				float maxD=maxPlane[0]*px+maxPlane[1]*py+maxPlane[2]*newCVal+maxPlane[3];
-				if(minD>=0.0f&&maxD<=0.0f)
-					{
-					/* Store the new input value: */
-					*abPtr=newVal;
-					
-					/* Update the pixel's statistics: */
-					++sPtr[0]; // Number of valid samples
-					sPtr[1]+=newVal; // Sum of valid samples
-					sPtr[2]+=newVal*newVal; // Sum of squares of valid samples
-					
-					/* Check if the previous value in the averaging buffer was valid: */
-					if(oldVal!=2048U)
-						{
-						--sPtr[0]; // Number of valid samples
-						sPtr[1]-=oldVal; // Sum of valid samples
-						sPtr[2]-=oldVal*oldVal; // Sum of squares of valid samples
-						}
-					}
-				else if(!retainValids)
-					{
-					/* Store an invalid input value: */
-					*abPtr=2048U;
-					
-					/* Check if the previous value in the averaging buffer was valid: */
-					if(oldVal!=2048U)
-						{
-						--sPtr[0]; // Number of valid samples
-						sPtr[1]-=oldVal; // Sum of valid samples
-						sPtr[2]-=oldVal*oldVal; // Sum of squares of valid samples
-						}
-					}
-				
-				/* Check if the pixel is considered "stable": */
-				if(sPtr[0]>=minNumSamples&&sPtr[2]*sPtr[0]<=maxVariance*sPtr[0]*sPtr[0]+sPtr[1]*sPtr[1])
-					{
-					/* Check if the new depth-corrected running mean is outside the previous value's envelope: */
-					float newFiltered=pdcPtr->correct(float(sPtr[1])/float(sPtr[0]));
-					if(Math::abs(newFiltered-*ofPtr)>=hysteresis)
-						{
-						/* Set the output pixel value to the depth-corrected running mean: */
-						*nofPtr=*ofPtr=newFiltered;
-						}
-					else
-						{
-						/* Leave the pixel at its previous value: */
-						*nofPtr=*ofPtr;
-						}
-					}
-				else if(retainValids)
-					{
-					/* Leave the pixel at its previous value: */
-					*nofPtr=*ofPtr;
-					}
-				else
-					{
-					/* Assign default value to instable pixels: */
-					*nofPtr=instableValue;
-					}
-				}
+			updateROI(pickedROISpans);
+			pickedROISpans=0;
 			}
 		
+		/* Exchange the consumer's empty slot with the slot holding the newest frame; older frames were already dropped by the producer: */
+		inputConsumerSlot=__atomic_exchange_n(&inputSharedSlot,inputConsumerSlot,__ATOMIC_ACQ_REL)&~inputSlotNewFrame;
+		Kinect::FrameBuffer frame=inputRing[inputConsumerSlot];
+		inputRing[inputConsumerSlot]=Kinect::FrameBuffer();
+		
+		/* Prepare a new output frame carrying the raw frame's time stamp, so downstream stages can match it to its source frame: */
+		Kinect::FrameBuffer& newOutputFrame=outputFrames.startNewValue();
+		newOutputFrame.timeStamp=frame.timeStamp;
+		
+		/* Set up the current frame for all bands; the temporal filter writes directly into the output frame if there is no spatial filter and no binning: */
+		bandRawData=frame.getData<RawDepth>();
+		bandInputData=binned?binnedInputBuffer:bandRawData;
+		bandOutputData=binned?binnedOutputBuffer:newOutputFrame.getData<float>();
+		bandSpatialFilter=spatialFilter;
+		bandTemporalData=bandSpatialFilter?temporalBuffers[temporalBufferIndex]:bandOutputData;
+		
+		/* Start the worker threads and process the first band: */
+		if(numBands>1)
+			bandBarrier->synchronize();
+		processBand(0);
+		
+		/* Interpolate the binned results to the output frame's resolution: */
+		if(binned)
+			upsampleFrame(binnedOutputBuffer,newOutputFrame.getData<float>());
+		
+		/* Find the depth pixels changed by the new output frame: */
+		updateDirtyRect(newOutputFrame.getData<float>());
+		
 		/* Go to the next averaging slot: */
 		if(++averagingSlotIndex==numAveragingSlots)
 			averagingSlotIndex=0U;
 		
-		/* Apply a spatial filter if requested: */
-		if(spatialFilter)
+		/* Update the spatial filter's state: */
+		if(bandSpatialFilter)
 			{
-			for(int filterPass=0;filterPass<2;++filterPass)
-				{
-				/* Low-pass filter the entire output frame in-place: */
-				for(unsigned int x=0;x<size[0];++x)
-					{
-					/* Get a pointer to the current column: */
-					float* colPtr=newOutputFrame.getData<float>()+x;
-					
-					/* Filter the first pixel in the column: */
-					float lastVal=*colPtr;
-					*colPtr=(colPtr[0]*2.0f+colPtr[size[0]])/3.0f;
-					colPtr+=size[0];
-					
-					/* Filter the interior pixels in the column: */
-					for(unsigned int y=1;y<size[1]-1;++y,colPtr+=size[0])
-						{
-						/* Filter the pixel: */
-						float nextLastVal=*colPtr;
-						*colPtr=(lastVal+colPtr[0]*2.0f+colPtr[size[0]])*0.25f;
-						lastVal=nextLastVal;
-						}
-					
-					/* Filter the last pixel in the column: */
-					*colPtr=(lastVal+colPtr[0]*2.0f)/3.0f;
-					}
-				float* rowPtr=newOutputFrame.getData<float>();
-				for(unsigned int y=0;y<size[1];++y)
-					{
-					/* Filter the first pixel in the row: */
-					float lastVal=*rowPtr;
-					*rowPtr=(rowPtr[0]*2.0f+rowPtr[1])/3.0f;
-					++rowPtr;
-					
-					/* Filter the interior pixels in the row: */
-					for(unsigned int x=1;x<size[0]-1;++x,++rowPtr)
-						{
-						/* Filter the pixel: */
-						float nextLastVal=*rowPtr;
-						*rowPtr=(lastVal+rowPtr[0]*2.0f+rowPtr[1])*0.25f;
-						lastVal=nextLastVal;
-						}
-					
-					/* Filter the last pixel in the row: */
-					*rowPtr=(lastVal+rowPtr[0]*2.0f)/3.0f;
-					++rowPtr;
-					}
-				}
+			/* Tally the number of skipped tiles: */
+			unsigned int numSkippedTiles=0;
+			for(unsigned int i=0;i<numBands;++i)
+				numSkippedTiles+=bands[i].numSkippedTiles;
+			__atomic_store_n(&lastNumSkippedTiles,numSkippedTiles,__ATOMIC_RELAXED);
+			__atomic_add_fetch(&totalNumTiles,Misc::UInt64(numTiles[1]*numTiles[0]),__ATOMIC_RELAXED);
+			__atomic_add_fetch(&totalNumSkippedTiles,Misc::UInt64(numSkippedTiles),__ATOMIC_RELAXED);
+			
+			/* Compare the next frame's temporal results against this frame's: */
+			temporalBufferIndex=1-temporalBufferIndex;
+			spatialResultValid=true;
+			}
+		else
+			{
+			/* The spatial filter needs to start from scratch once it is re-enabled: */
+			spatialResultValid=false;
 			}
 		
 		/* Finalize the new output frame in the output buffer: */
@@ -205,47 +1176,141 @@ void* FrameFilter::filterThreadMethod(void)
 			(*outputFrameFunction)(newOutputFrame);
 		}
 	
+	/* Release the worker threads so they can shut down: */
+	if(numBands>1)
+		bandBarrier->synchronize();
+	
 	return 0;
 	}
 
-FrameFilter::FrameFilter(const Size& sSize,unsigned int sNumAveragingSlots,const FrameFilter::PixelDepthCorrection* sPixelDepthCorrection,const PTransform& depthProjection,const Plane& basePlane)
-	:size(sSize),
-	 pixelDepthCorrection(sPixelDepthCorrection),
-	 averagingBuffer(0),
-	 statBuffer(0),
+FrameFilter::FrameFilter(const Size& sFrameSize,FrameFilter::TemporalFilterMode sTemporalFilterMode,unsigned int sNumAveragingSlots,unsigned int sNumThreads,const FrameFilter::PixelDepthCorrection* sPixelDepthCorrection,const PTransform& depthProjection,const Plane& basePlane,bool sBinned)
+	:frameSize(sFrameSize),binned(sBinned),
+	 size(sBinned?Size(sFrameSize[0]/2,sFrameSize[1]/2):sFrameSize),
+	 numBands(0),bands(0),workerThreads(0),nextWorkerBandIndex(1),bandBarrier(0),
+	 binnedInputBuffer(0),binnedOutputBuffer(0),roiSpans(0),newROISpans(0),tileInROI(0),
+	 depthCorrectionScales(0),depthCorrectionOffsets(0),
+	 temporalFilterMode(sTemporalFilterMode),averagingBuffer(0),medianWindowBuffer(0),
+	 countBuffer(0),sumBuffer(0),sumSquaresBuffer32(0),sumSquaresBuffer64(0),
+	 estimateBuffer(0),estimateVarianceBuffer(0),motionBuffer(0),
+	 validBuffer(0),temporalBufferIndex(0),tileChanged(0),spatialResultBuffer(0),spatialResultValid(false),
+	 lastNumSkippedTiles(0),totalNumTiles(0),totalNumSkippedTiles(0),
+	 previousOutputBuffer(0),previousOutputValid(false),dirtyRect(sFrameSize),
 	 outputFrameFunction(0)
 	{
-	/* Initialize the input frame slot: */
-	inputFrameVersion=0;
+	/* Check the averaging window length against the size of the sample counters: */
+	if(sNumAveragingSlots==0||sNumAveragingSlots>65535U)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Invalid number of averaging slots %u",sNumAveragingSlots);
+	if(temporalFilterMode==MedianFilter&&sNumAveragingSlots>maxMedianWindowSize)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Number of averaging slots %u exceeds maximum median filter window size %u",sNumAveragingSlots,maxMedianWindowSize);
+	
+	/* Initialize the input frame ring: */
+	inputProducerSlot=0;
+	inputSharedSlot=1;
+	inputConsumerSlot=2;
+	numReceivedFrames=0;
+	numDroppedFrames=0;
 	
 	/* Initialize the valid depth range: */
 	setValidDepthInterval(0U,2046U);
 	
-	/* Initialize the averaging buffer: */
-	numAveragingSlots=sNumAveragingSlots;
-	averagingBuffer=new RawDepth[numAveragingSlots*size[1]*size[0]];
-	RawDepth* abPtr=averagingBuffer;
-	for(unsigned int i=0;i<numAveragingSlots;++i)
+	/* Split the per-pixel depth correction coefficients into separate planes: */
+	size_t numPixels=size_t(size[1])*size_t(size[0]);
+	depthCorrectionScales=allocPlane<float>(numPixels);
+	depthCorrectionOffsets=allocPlane<float>(numPixels);
+	if(binned)
+		{
+		/* Average the depth correction coefficients of the pixels in each bin: */
 		for(unsigned int y=0;y<size[1];++y)
-			for(unsigned int x=0;x<size[0];++x,++abPtr)
-				*abPtr=2048U; // Mark sample as invalid
-	averagingSlotIndex=0U;
+			for(unsigned int x=0;x<size[0];++x)
+				{
+				const PixelDepthCorrection* pdc0=sPixelDepthCorrection+(2*y)*frameSize[0]+2*x;
+				const PixelDepthCorrection* pdc1=pdc0+frameSize[0];
+				depthCorrectionScales[y*size[0]+x]=(pdc0[0].scale+pdc0[1].scale+pdc1[0].scale+pdc1[1].scale)*0.25f;
+				depthCorrectionOffsets[y*size[0]+x]=(pdc0[0].offset+pdc0[1].offset+pdc1[0].offset+pdc1[1].offset)*0.25f;
+				}
+		
+		/* Allocate the planes holding binned frames: */
+		binnedInputBuffer=allocPlane<RawDepth>(numPixels);
+		binnedOutputBuffer=allocPlane<float>(numPixels);
+		}
+	else
+		{
+		for(size_t i=0;i<numPixels;++i)
+			{
+			depthCorrectionScales[i]=sPixelDepthCorrection[i].scale;
+			depthCorrectionOffsets[i]=sPixelDepthCorrection[i].offset;
+			}
+		}
 	
-	/* Initialize the statistics buffer: */
-	statBuffer=new unsigned int[size[1]*size[0]*3];
-	unsigned int* sbPtr=statBuffer;
-	for(unsigned int y=0;y<size[1];++y)
-		for(unsigned int x=0;x<size[0];++x)
-			for(int i=0;i<3;++i,++sbPtr)
-				*sbPtr=0;
+	numAveragingSlots=sNumAveragingSlots;
+	averagingSlotIndex=0U;
+	countBuffer=allocPlane<Misc::UInt16>(numPixels);
+	for(size_t i=0;i<numPixels;++i)
+		countBuffer[i]=0;
+	if(hasSampleWindow(temporalFilterMode))
+		{
+		/* Initialize the averaging buffer: */
+		averagingBuffer=allocPlane<RawDepth>(numAveragingSlots*numPixels);
+		RawDepth* abPtr=averagingBuffer;
+		for(size_t i=numAveragingSlots*numPixels;i>0;--i,++abPtr)
+			*abPtr=2048U; // Mark sample as invalid
+		
+		/* Initialize the statistics planes: */
+		sumBuffer=allocPlane<Misc::UInt32>(numPixels);
+		if(needs64BitSums(numAveragingSlots))
+			sumSquaresBuffer64=allocPlane<Misc::UInt64>(numPixels);
+		else
+			sumSquaresBuffer32=allocPlane<Misc::UInt32>(numPixels);
+		for(size_t i=0;i<numPixels;++i)
+			{
+			sumBuffer[i]=0;
+			if(sumSquaresBuffer64!=0)
+				sumSquaresBuffer64[i]=0;
+			else
+				sumSquaresBuffer32[i]=0;
+			}
+		
+		if(temporalFilterMode==MedianFilter)
+			{
+			/* Allocate the sorted sample windows, which start out empty like the averaging buffer: */
+			medianWindowBuffer=allocPlane<RawDepth>(numAveragingSlots*numPixels);
+			}
+		
+		if(temporalFilterMode==AdaptiveFilter)
+			{
+			/* Initialize the motion state plane: */
+			motionBuffer=allocPlane<Misc::UInt8>(numPixels);
+			memset(motionBuffer,0,numPixels*sizeof(Misc::UInt8));
+			}
+		}
+	else
+		{
+		/* Initialize the filter state planes; pixels with a zero sample count have no estimate: */
+		estimateBuffer=allocPlane<float>(numPixels);
+		estimateVarianceBuffer=allocPlane<float>(numPixels);
+		for(size_t i=0;i<numPixels;++i)
+			{
+			estimateBuffer[i]=0.0f;
+			estimateVarianceBuffer[i]=0.0f;
+			}
+		}
 	
 	/* Initialize the stability criterion: */
-	minNumSamples=(numAveragingSlots+1)/2;
+	minNumSamples=numAveragingSlots>1U?(numAveragingSlots+1)/2:1U;
 	maxVariance=4;
 	hysteresis=0.1f;
 	retainValids=true;
 	instableValue=0.0;
 	
+	/* Initialize the parameters of the filters without sample windows: */
+	emaWeight=0.1f;
+	kalmanProcessNoise=0.01f;
+	kalmanMeasurementNoise=2.0f;
+	
+	/* Initialize the motion detection parameters of the adaptive filter: */
+	motionThreshold=5.0f;
+	motionMinNumSamples=3;
+	
 	/* Enable spatial filtering: */
 	spatialFilter=true;
 	
@@ -255,19 +1320,89 @@ FrameFilter::FrameFilter(const Size& sSize,unsigned int sNumAveragingSlots,const
 	PTransform::HVector basePlaneDic(depthProjection.getMatrix().transposeMultiply(basePlaneCc));
 	basePlaneDic/=Geometry::mag(basePlaneDic.toVector());
 	
-	/* Initialize the valid buffer: */
-	validBuffer=new float[size[1]*size[0]];
+	/* Initialize the valid buffer, using the centers of bins in depth image space if frames are binned: */
+	validBuffer=allocPlane<float>(numPixels);
 	float* vbPtr=validBuffer;
+	double binScale=binned?2.0:1.0;
 	for(unsigned int y=0;y<size[1];++y)
 		for(unsigned int x=0;x<size[0];++x,++vbPtr)
-			*vbPtr=float(-((double(x)+0.5)*basePlaneDic[0]+(double(y)+0.5)*basePlaneDic[1]+basePlaneDic[3])/basePlaneDic[2]);
+			*vbPtr=float(-((double(x)+0.5)*binScale*basePlaneDic[0]+(double(y)+0.5)*binScale*basePlaneDic[1]+basePlaneDic[3])/basePlaneDic[2]);
+	
+	/* Select the temporal filter kernel for the filter algorithm; only the box filter has SIMD kernels: */
+	switch(temporalFilterMode)
+		{
+		case BoxFilter:
+			/* Select the fastest kernel supported by the CPU and the averaging window length: */
+			setFilterKernel(AutoKernel);
+			break;
+		
+		case MedianFilter:
+			filterRow=sumSquaresBuffer64!=0?&FrameFilter::filterRowMedian64:&FrameFilter::filterRowMedian32;
+			break;
+		
+		case EMAFilter:
+			filterRow=&FrameFilter::filterRowEMA;
+			break;
+		
+		case KalmanFilter:
+			filterRow=&FrameFilter::filterRowKalman;
+			break;
+		
+		case AdaptiveFilter:
+			filterRow=sumSquaresBuffer64!=0?&FrameFilter::filterRowAdaptive64:&FrameFilter::filterRowAdaptive32;
+			break;
+		}
+	
+	/* Initialize the spatial filter's buffers: */
+	for(int i=0;i<2;++i)
+		temporalBuffers[i]=allocPlane<float>(numPixels);
+	for(int i=0;i<2;++i)
+		numTiles[i]=(size[i]+spatialTileSize-1)/spatialTileSize;
+	tileChanged=new unsigned char[numTiles[1]*numTiles[0]];
+	spatialResultBuffer=allocPlane<float>(numPixels);
+	
+	/* Filter all pixels until a region of interest is set: */
+	tileInROI=new unsigned char[numTiles[1]*numTiles[0]];
+	resetROI();
+	updateROI(newROISpans);
+	newROISpans=0;
+	
+	/* Split the frame into one horizontal band of rows of tiles per filtering thread: */
+	numBands=sNumThreads;
+	if(numBands<1U)
+		numBands=1U;
+	if(numBands>numTiles[1])
+		numBands=numTiles[1];
+	bands=new FilterBand[numBands];
+	for(unsigned int i=0;i<numBands;++i)
+		{
+		FilterBand& band=bands[i];
+		band.tileRowBegin=(numTiles[1]*i)/numBands;
+		band.tileRowEnd=(numTiles[1]*(i+1))/numBands;
+		band.yBegin=band.tileRowBegin*spatialTileSize;
+		band.yEnd=band.tileRowEnd*spatialTileSize<size[1]?band.tileRowEnd*spatialTileSize:size[1];
+		
+		/* Allocate a spatial filter buffer for one row of tiles and its halo rows, plus one extra row: */
+		band.spatialBuffer=allocPlane<float>(size_t(spatialTileSize+3)*size_t(size[0]));
+		band.numSkippedTiles=0;
+		}
 	
 	/* Initialize the output frame buffer: */
 	for(int i=0;i<3;++i)
-		outputFrames.getBuffer(i)=Kinect::FrameBuffer(size,size[1]*size[0]*sizeof(float));
+		outputFrames.getBuffer(i)=Kinect::FrameBuffer(frameSize,frameSize[1]*frameSize[0]*sizeof(float));
+	previousOutputBuffer=allocPlane<float>(size_t(frameSize[1])*size_t(frameSize[0]));
 	
-	/* Start the filtering thread: */
+	/* Start the worker threads: */
 	runFilterThread=true;
+	if(numBands>1)
+		{
+		bandBarrier=new Threads::Barrier(numBands);
+		workerThreads=new Threads::Thread[numBands-1];
+		for(unsigned int i=0;i<numBands-1;++i)
+			workerThreads[i].start(this,&FrameFilter::workerThreadMethod);
+		}
+	
+	/* Start the filtering thread: */
 	filterThread.start(this,&FrameFilter::filterThreadMethod);
 	}
 
@@ -280,14 +1415,135 @@ FrameFilter::~FrameFilter(void)
 	inputCond.signal();
 	}
 	filterThread.join();
+	for(unsigned int i=0;i+1<numBands;++i)
+		workerThreads[i].join();
+	delete[] workerThreads;
+	delete bandBarrier;
 	
 	/* Release all allocated buffers: */
-	delete[] averagingBuffer;
-	delete[] statBuffer;
-	delete[] validBuffer;
+	free(depthCorrectionScales);
+	free(depthCorrectionOffsets);
+	free(averagingBuffer);
+	free(medianWindowBuffer);
+	free(countBuffer);
+	free(sumBuffer);
+	free(sumSquaresBuffer32);
+	free(sumSquaresBuffer64);
+	free(estimateBuffer);
+	free(estimateVarianceBuffer);
+	free(motionBuffer);
+	free(validBuffer);
+	for(int i=0;i<2;++i)
+		free(temporalBuffers[i]);
+	delete[] tileChanged;
+	free(spatialResultBuffer);
+	free(binnedInputBuffer);
+	free(binnedOutputBuffer);
+	free(previousOutputBuffer);
+	delete[] roiSpans;
+	delete[] newROISpans;
+	delete[] tileInROI;
+	for(unsigned int i=0;i<numBands;++i)
+		free(bands[i].spatialBuffer);
+	delete[] bands;
 	delete outputFrameFunction;
 	}
 
+bool FrameFilter::needs64BitSums(unsigned int numAveragingSlots)
+	{
+	/* Check if the sum of squares of a full window of maximum raw depth values overflows 32 bits: */
+	return Misc::UInt64(numAveragingSlots)*2047U*2047U>Misc::UInt64(0xffffffffU);
+	}
+
+bool FrameFilter::isFilterKernelSupported(FrameFilter::TemporalFilterMode temporalFilterMode,unsigned int numAveragingSlots,FrameFilter::FilterKernel filterKernel)
+	{
+	/* All temporal filter algorithms have a scalar implementation: */
+	if(filterKernel==AutoKernel||filterKernel==ScalarKernel)
+		return true;
+	
+	/* Only the box filter with 32-bit sums of squares has SIMD implementations: */
+	if(temporalFilterMode!=BoxFilter||needs64BitSums(numAveragingSlots))
+		return false;
+	
+	#if FRAMEFILTER_X86SIMD
+	__builtin_cpu_init();
+	if(filterKernel==SSE41Kernel)
+		return __builtin_cpu_supports("sse4.1");
+	else
+		return __builtin_cpu_supports("avx2");
+	#else
+	return false;
+	#endif
+	}
+
+void FrameFilter::printMemoryFootprint(std::ostream& os,const Size& frameSize,FrameFilter::TemporalFilterMode temporalFilterMode,unsigned int numAveragingSlots,bool binned)
+	{
+	/* All sizes are given per filtered pixel, which covers four depth pixels in input and output frames if frames are binned: */
+	size_t numPixels=binned?size_t(frameSize[1]/2)*size_t(frameSize[0]/2):size_t(frameSize[1])*size_t(frameSize[0]);
+	size_t frameScale=binned?4:1;
+	if(binned)
+		os<<"FrameFilter: Filtering "<<frameSize[0]/2<<" x "<<frameSize[1]/2<<" bins of 2x2 depth pixels"<<std::endl;
+	
+	/* Calculate the per-pixel sizes of the temporal filter's state and of the part of it touched by each frame: */
+	size_t stateSize=sizeof(Misc::UInt16);
+	size_t workingStateSize=sizeof(Misc::UInt16);
+	if(hasSampleWindow(temporalFilterMode))
+		{
+		os<<"FrameFilter: Memory footprint for "<<frameSize[0]<<" x "<<frameSize[1]<<" depth frames and "<<numAveragingSlots<<" averaging slots:"<<std::endl;
+		size_t sumSquaresSize=needs64BitSums(numAveragingSlots)?sizeof(Misc::UInt64):sizeof(Misc::UInt32);
+		printPlaneSize(os,"Depth correction",numPixels,2*sizeof(float));
+		printPlaneSize(os,"Averaging buffer",numPixels,numAveragingSlots*sizeof(RawDepth));
+		printPlaneSize(os,"Sample counts",numPixels,sizeof(Misc::UInt16));
+		printPlaneSize(os,"Sample sums",numPixels,sizeof(Misc::UInt32));
+		printPlaneSize(os,"Sample sums of squares",numPixels,sumSquaresSize);
+		stateSize+=numAveragingSlots*sizeof(RawDepth)+sizeof(Misc::UInt32)+sumSquaresSize;
+		
+		/* The box filter only touches one averaging slot per frame: */
+		workingStateSize+=sizeof(RawDepth)+sizeof(Misc::UInt32)+sumSquaresSize;
+		
+		if(temporalFilterMode==MedianFilter)
+			{
+			/* The median filter additionally keeps each pixel's valid samples in sorted order, and touches the entire contiguous sorted window every frame: */
+			printPlaneSize(os,"Sorted sample windows",numPixels,numAveragingSlots*sizeof(RawDepth));
+			stateSize+=numAveragingSlots*sizeof(RawDepth);
+			workingStateSize+=numAveragingSlots*sizeof(RawDepth);
+			}
+		
+		if(temporalFilterMode==AdaptiveFilter)
+			{
+			/* The adaptive filter additionally tracks each pixel's motion state, and only touches all averaging slots of pixels that moved: */
+			printPlaneSize(os,"Motion states",numPixels,sizeof(Misc::UInt8));
+			stateSize+=sizeof(Misc::UInt8);
+			workingStateSize+=sizeof(Misc::UInt8);
+			}
+		}
+	else
+		{
+		os<<"FrameFilter: Memory footprint for "<<frameSize[0]<<" x "<<frameSize[1]<<" depth frames:"<<std::endl;
+		printPlaneSize(os,"Depth correction",numPixels,2*sizeof(float));
+		printPlaneSize(os,"Sample counts",numPixels,sizeof(Misc::UInt16));
+		printPlaneSize(os,"Estimates and variances",numPixels,2*sizeof(float));
+		stateSize+=2*sizeof(float);
+		workingStateSize+=2*sizeof(float);
+		}
+	printPlaneSize(os,"Stable values",numPixels,sizeof(float));
+	printPlaneSize(os,"Temporal filter results",numPixels,2*sizeof(float));
+	printPlaneSize(os,"Spatial filter results",numPixels,sizeof(float));
+	size_t binnedSize=0;
+	if(binned)
+		{
+		binnedSize=sizeof(RawDepth)+sizeof(float);
+		printPlaneSize(os,"Binned frames",numPixels,binnedSize);
+		}
+	printPlaneSize(os,"Output frames",numPixels,4*sizeof(float)*frameScale);
+	size_t totalSize=2*sizeof(float)+stateSize+sizeof(float)+3*sizeof(float)+binnedSize+4*sizeof(float)*frameScale;
+	printPlaneSize(os,"Total",numPixels,totalSize);
+	
+	/* Each frame only touches the working part of the filter state, the stable values, the filter buffers, one input frame, one output frame, and the copy of the previous output frame: */
+	size_t workingSetSize=2*sizeof(float)+workingStateSize+sizeof(float)+3*sizeof(float)+binnedSize+(sizeof(RawDepth)+2*sizeof(float))*frameScale;
+	printPlaneSize(os,"Per-frame working set",numPixels,workingSetSize);
+	}
+
 void FrameFilter::setValidDepthInterval(unsigned int newMinDepth,unsigned int newMaxDepth)
 	{
 	/* Set the equations for the minimum and maximum plane in depth image space: */
@@ -318,11 +1574,22 @@ void FrameFilter::setValidElevationInterval(const PTransform& depthProjection,co
 	double maxPlaneScale=-1.0/Geometry::mag(maxPlaneDic.toVector());
 	for(int i=0;i<4;++i)
 		minPlane[i]=float(maxPlaneDic[i]*maxPlaneScale);
+	
+	if(binned)
+		{
+		/* Transform the plane equations from depth image space to the space of bins, where pixel coordinates are halved: */
+		for(int i=0;i<2;++i)
+			{
+			minPlane[i]*=2.0f;
+			maxPlane[i]*=2.0f;
+			}
+		}
 	}
 
 void FrameFilter::setStableParameters(unsigned int newMinNumSamples,unsigned int newMaxVariance)
 	{
-	minNumSamples=newMinNumSamples;
+	/* Require at least one valid sample, as stable values are calculated from the valid samples: */
+	minNumSamples=newMinNumSamples>1U?newMinNumSamples:1U;
 	maxVariance=newMaxVariance;
 	}
 
@@ -331,6 +1598,23 @@ void FrameFilter::setHysteresis(float newHysteresis)
 	hysteresis=newHysteresis;
 	}
 
+void FrameFilter::setEMAWeight(float newEMAWeight)
+	{
+	emaWeight=newEMAWeight;
+	}
+
+void FrameFilter::setKalmanNoise(float newKalmanProcessNoise,float newKalmanMeasurementNoise)
+	{
+	kalmanProcessNoise=newKalmanProcessNoise;
+	kalmanMeasurementNoise=newKalmanMeasurementNoise;
+	}
+
+void FrameFilter::setMotionParameters(float newMotionThreshold,unsigned int newMotionMinNumSamples)
+	{
+	motionThreshold=newMotionThreshold;
+	motionMinNumSamples=newMotionMinNumSamples>1U?newMotionMinNumSamples:1U;
+	}
+
 void FrameFilter::setRetainValids(bool newRetainValids)
 	{
 	retainValids=newRetainValids;
@@ -346,6 +1630,147 @@ void FrameFilter::setSpatialFilter(bool newSpatialFilter)
 	spatialFilter=newSpatialFilter;
 	}
 
+bool FrameFilter::setFilterKernel(FrameFilter::FilterKernel newFilterKernel)
+	{
+	/* Bail out if the requested kernel is not supported: */
+	if(!isFilterKernelSupported(temporalFilterMode,numAveragingSlots,newFilterKernel))
+		return false;
+	
+	/* Only the box filter has alternative kernels: */
+	if(temporalFilterMode!=BoxFilter)
+		return true;
+	
+	if(sumSquaresBuffer64!=0)
+		filterRow=&FrameFilter::filterRowScalar64;
+	else
+		{
+		filterRow=&FrameFilter::filterRowScalar32;
+		#if FRAMEFILTER_X86SIMD
+		if(newFilterKernel==AVX2Kernel||(newFilterKernel==AutoKernel&&isFilterKernelSupported(temporalFilterMode,numAveragingSlots,AVX2Kernel)))
+			filterRow=&FrameFilter::filterRowAVX2;
+		else if(newFilterKernel==SSE41Kernel||(newFilterKernel==AutoKernel&&isFilterKernelSupported(temporalFilterMode,numAveragingSlots,SSE41Kernel)))
+			filterRow=&FrameFilter::filterRowSSE41;
+		#endif
+		}
+	
+	return true;
+	}
+
+FrameFilter::FilterKernel FrameFilter::getFilterKernel(void) const
+	{
+	#if FRAMEFILTER_X86SIMD
+	if(filterRow==&FrameFilter::filterRowAVX2)
+		return AVX2Kernel;
+	if(filterRow==&FrameFilter::filterRowSSE41)
+		return SSE41Kernel;
+	#endif
+	return ScalarKernel;
+	}
+
+void FrameFilter::setROI(const PTransform& depthProjection,const Plane& basePlane,const Point basePlaneCorners[4],double minElevation,double maxElevation)
+	{
+	/* Find the sign of the homogeneous weight of points in front of the camera: */
+	PTransform cameraToDepth=Geometry::invert(depthProjection);
+	double frontSign=cameraToDepth.transform(PTransform::HVector(basePlaneCorners[0]))[3];
+	
+	/* Project the corners of the sandbox quadrilateral at the minimum and maximum elevations into the space of filtered pixels: */
+	Vector elevationDir=basePlane.getNormal()/basePlane.getNormal().mag();
+	double pixelScale=binned?0.5:1.0;
+	double corners[8][2];
+	for(int i=0;i<8;++i)
+		{
+		PTransform::HVector corner=cameraToDepth.transform(PTransform::HVector(basePlaneCorners[i%4]+elevationDir*(i<4?minElevation:maxElevation)));
+		
+		/* Filter all pixels if the elevation range reaches behind the camera: */
+		if(!(corner[3]*frontSign>0.0))
+			{
+			resetROI();
+			return;
+			}
+		
+		for(int j=0;j<2;++j)
+			corners[i][j]=corner[j]/corner[3]*pixelScale;
+		}
+	
+	/* Find the extent of the projected corners' convex hull along each row's center line, which is the extent of all line segments between pairs of corners: */
+	std::vector<double> rowMin(size[1],Math::Constants<double>::max);
+	std::vector<double> rowMax(size[1],-Math::Constants<double>::max);
+	for(unsigned int y=0;y<size[1];++y)
+		{
+		double py=double(y)+0.5;
+		for(int i=0;i<8;++i)
+			for(int j=i+1;j<8;++j)
+				{
+				double d0=corners[i][1]-py;
+				double d1=corners[j][1]-py;
+				if(d0*d1<=0.0&&d0!=d1)
+					{
+					double x=corners[i][0]+(corners[j][0]-corners[i][0])*d0/(d0-d1);
+					rowMin[y]=Math::min(rowMin[y],x);
+					rowMax[y]=Math::max(rowMax[y],x);
+					}
+				}
+		}
+	
+	/* Grow the hull by the margin in all directions and convert it to spans of pixels: */
+	unsigned int* newSpans=new unsigned int[size[1]*2];
+	for(unsigned int y=0;y<size[1];++y)
+		{
+		double xMin=Math::Constants<double>::max;
+		double xMax=-Math::Constants<double>::max;
+		unsigned int y0=y>=roiMargin?y-roiMargin:0;
+		unsigned int y1=y+roiMargin<size[1]?y+roiMargin+1:size[1];
+		for(unsigned int ny=y0;ny<y1;++ny)
+			{
+			xMin=Math::min(xMin,rowMin[ny]);
+			xMax=Math::max(xMax,rowMax[ny]);
+			}
+		xMin=Math::floor(xMin)-double(roiMargin);
+		xMax=Math::ceil(xMax)+double(roiMargin);
+		if(xMin<double(size[0])&&xMax>0.0&&xMin<xMax)
+			{
+			newSpans[2*y]=xMin>0.0?(unsigned int)(xMin):0U;
+			newSpans[2*y+1]=xMax<double(size[0])?(unsigned int)(xMax):size[0];
+			}
+		else
+			newSpans[2*y]=newSpans[2*y+1]=0U;
+		}
+	
+	setROISpans(newSpans);
+	}
+
+void FrameFilter::setROI(const Rect& newROI)
+	{
+	/* Convert the rectangle to the space of filtered pixels, rounding outwards: */
+	unsigned int pixelShift=binned?1:0;
+	unsigned int x0=Math::min((unsigned int)(Math::max(newROI.offset[0],0))>>pixelShift,size[0]);
+	unsigned int x1=Math::min(((unsigned int)(Math::max(newROI.offset[0],0))+newROI.size[0]+pixelShift)>>pixelShift,size[0]);
+	unsigned int y0=Math::min((unsigned int)(Math::max(newROI.offset[1],0))>>pixelShift,size[1]);
+	unsigned int y1=Math::min(((unsigned int)(Math::max(newROI.offset[1],0))+newROI.size[1]+pixelShift)>>pixelShift,size[1]);
+	
+	unsigned int* newSpans=new unsigned int[size[1]*2];
+	for(unsigned int y=0;y<size[1];++y)
+		{
+		bool inside=y>=y0&&y<y1&&x0<x1;
+		newSpans[2*y]=inside?x0:0U;
+		newSpans[2*y+1]=inside?x1:0U;
+		}
+	
+	setROISpans(newSpans);
+	}
+
+void FrameFilter::resetROI(void)
+	{
+	unsigned int* newSpans=new unsigned int[size[1]*2];
+	for(unsigned int y=0;y<size[1];++y)
+		{
+		newSpans[2*y]=0U;
+		newSpans[2*y+1]=size[0];
+		}
+	
+	setROISpans(newSpans);
+	}
+
 void FrameFilter::setOutputFrameFunction(FrameFilter::OutputFrameFunction* newOutputFrameFunction)
 	{
 	delete outputFrameFunction;
@@ -354,12 +1779,48 @@ void FrameFilter::setOutputFrameFunction(FrameFilter::OutputFrameFunction* newOu
 
 void FrameFilter::receiveRawFrame(const Kinect::FrameBuffer& newFrame)
 	{
-	Threads::MutexCond::Lock inputLock(inputCond);
+	__atomic_add_fetch(&numReceivedFrames,1U,__ATOMIC_RELAXED);
+	
+	/* Store a reference to the new frame in the producer's slot: */
+	inputRing[inputProducerSlot]=newFrame;
 	
-	/* Store the new buffer in the input buffer: */
-	inputFrame=newFrame;
-	++inputFrameVersion;
+	/* Publish the new frame by exchanging the producer's slot with the shared slot: */
+	unsigned int oldSharedSlot=__atomic_exchange_n(&inputSharedSlot,inputProducerSlot|inputSlotNewFrame,__ATOMIC_ACQ_REL);
+	inputProducerSlot=oldSharedSlot&~inputSlotNewFrame;
+	if((oldSharedSlot&inputSlotNewFrame)!=0U)
+		{
+		/* Drop the superseded frame that the consumer did not pick up in time: */
+		inputRing[inputProducerSlot]=Kinect::FrameBuffer();
+		__atomic_add_fetch(&numDroppedFrames,1U,__ATOMIC_RELAXED);
+		}
 	
-	/* Signal the background thread: */
+	/* Wake up the background filtering thread; it only holds the mutex while waiting for new frames and taking over a new region of interest, never while filtering or building the region of interest's tile masks: */
+	Threads::MutexCond::Lock inputLock(inputCond);
 	inputCond.signal();
 	}
+
+unsigned int FrameFilter::getNumReceivedFrames(void) const
+	{
+	return __atomic_load_n(&numReceivedFrames,__ATOMIC_RELAXED);
+	}
+
+unsigned int FrameFilter::getNumDroppedFrames(void) const
+	{
+	return __atomic_load_n(&numDroppedFrames,__ATOMIC_RELAXED);
+	}
+
+unsigned int FrameFilter::getNumFilteredPixels(void) const
+	{
+	return __atomic_load_n(&numROIPixels,__ATOMIC_RELAXED);
+	}
+
+unsigned int FrameFilter::getLastNumSkippedTiles(void) const
+	{
+	return __atomic_load_n(&lastNumSkippedTiles,__ATOMIC_RELAXED);
+	}
+
+void FrameFilter::getSpatialFilterTileCounts(Misc::UInt64& numConsideredTiles,Misc::UInt64& numSkippedTiles) const
+	{
+	numConsideredTiles=__atomic_load_n(&totalNumTiles,__ATOMIC_RELAXED);
+	numSkippedTiles=__atomic_load_n(&totalNumSkippedTiles,__ATOMIC_RELAXED);
+	}
@@ -2,7 +2,7 @@
 FrameFilter - Class to filter streams of depth frames arriving from a
 depth camera, with code to detect unstable values in each pixel, and
 fill holes resulting from invalid samples.
-Copyright (c) 2012-2022 Oliver Kreylos
+Copyright (c) 2012-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -24,14 +24,25 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef FRAMEFILTER_INCLUDED
 #define FRAMEFILTER_INCLUDED
 
+#include <stddef.h>
+#include <iosfwd>
+#include <Misc/SizedTypes.h>
 #include <Threads/Thread.h>
 #include <Threads/MutexCond.h>
+#include <Threads/Barrier.h>
 #include <Threads/TripleBuffer.h>
 #include <Kinect/FrameBuffer.h>
 #include <Kinect/FrameSource.h>
 
 #include "Types.h"
 
+/* Check whether the x86 SIMD filter kernels can be compiled: */
+#if defined(__GNUC__)&&(defined(__x86_64__)||defined(__i386__))
+#define FRAMEFILTER_X86SIMD 1
+#else
+#define FRAMEFILTER_X86SIMD 0
+#endif
+
 /* Forward declarations: */
 namespace Misc {
 template <class ParameterParam>
@@ -47,21 +58,90 @@ class FrameFilter
 	typedef Misc::FunctionCall<const Kinect::FrameBuffer&> OutputFrameFunction; // Type for functions called when a new output frame is ready
 	typedef Kinect::FrameSource::DepthCorrection::PixelCorrection PixelDepthCorrection; // Type for per-pixel depth correction factors
 	
-	/* Elements: */
+	enum TemporalFilterMode // Enumerated type for temporal filter algorithms
+		{
+		BoxFilter=0, // Running average over a fixed window of samples, with a variance-based stability test
+		MedianFilter, // Running median over a fixed window of samples, with a variance-based stability test
+		EMAFilter, // Exponential moving average with a running variance estimate; does not keep a window of samples
+		KalmanFilter, // Per-pixel one-dimensional Kalman filter assuming constant depth; does not keep a window of samples
+		AdaptiveFilter // Running average over a fixed window of samples that restarts from the most recent samples in pixels where motion is detected
+		};
+	
+	enum FilterKernel // Enumerated type for implementations of the box temporal filter
+		{
+		AutoKernel=0, // Fastest implementation supported by the CPU and the averaging window length
+		ScalarKernel, // Scalar implementation
+		SSE41Kernel, // SSE4.1 implementation processing four pixels at once
+		AVX2Kernel // AVX2 implementation processing eight pixels at once
+		};
+	
 	private:
-	Size size; // Width and height of processed frames
-	const PixelDepthCorrection* pixelDepthCorrection; // Buffer of per-pixel depth correction coefficients
-	Threads::MutexCond inputCond; // Condition variable to signal arrival of a new input frame
-	Kinect::FrameBuffer inputFrame; // The most recent input frame
-	unsigned int inputFrameVersion; // Version number of input frame
+	typedef void (FrameFilter::*FilterRowMethod)(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Type for methods running the temporal filter on a span of pixels in one row
+	
+	struct FilterBand // Structure describing a horizontal band of rows processed by one filtering thread
+		{
+		/* Elements: */
+		public:
+		unsigned int tileRowBegin,tileRowEnd; // Range of rows of spatial filter tiles in the band
+		unsigned int yBegin,yEnd; // Range of pixel rows in the band
+		float* spatialBuffer; // Scratch buffer for the spatial filter, holding one row of tiles plus one halo row above and below
+		unsigned int numSkippedTiles; // Number of tiles in the band skipped by the spatial filter in the current frame
+		};
+	
+	/* Elements: */
+	Size frameSize; // Width and height of received and produced frames
+	bool binned; // Flag whether frames are filtered at half resolution in bins of 2x2 pixels
+	Size size; // Width and height of the grid of filtered pixels; half the frame size if frames are binned
+	static const unsigned int inputRingSize=3; // Number of slots in the input frame ring: one owned by the producer, one owned by the consumer, and one handed between them
+	static const unsigned int inputSlotNewFrame=0x4U; // Flag in the shared input slot index marking a frame that has not been picked up by the consumer yet
+	Kinect::FrameBuffer inputRing[inputRingSize]; // Lock-free single-producer/single-consumer ring of references to received input frames
+	unsigned int inputProducerSlot; // Index of the ring slot receiving the next frame; only accessed by the producer
+	unsigned int inputSharedSlot; // Index of the ring slot holding the most recently published frame, combined with the new frame flag; exchanged atomically by the producer and the consumer
+	unsigned int inputConsumerSlot; // Index of the ring slot most recently picked up by the consumer; only accessed by the consumer
+	unsigned int numReceivedFrames; // Number of input frames received so far
+	unsigned int numDroppedFrames; // Number of input frames dropped because they were superseded by newer frames before they could be filtered
+	Threads::MutexCond inputCond; // Condition variable to wake up the background filtering thread when the input ring becomes non-empty
 	volatile bool runFilterThread; // Flag to keep the background filtering thread running
 	Threads::Thread filterThread; // The background filtering thread
+	unsigned int numBands; // Number of horizontal bands into which each frame is split, equal to the number of filtering threads
+	FilterBand* bands; // Array of horizontal bands
+	Threads::Thread* workerThreads; // Array of worker threads processing all bands but the first, which is processed by the background filtering thread
+	unsigned int nextWorkerBandIndex; // Index of the band to be claimed by the next starting worker thread, protected by inputCond
+	Threads::Barrier* bandBarrier; // Barrier to synchronize the background filtering thread and the worker threads if there are multiple bands
+	const RawDepth* bandRawData; // Raw input frame currently processed by all bands
+	const RawDepth* bandInputData; // Raw input frame, or its binned version, entered into the temporal filter
+	float* bandTemporalData; // Buffer receiving the results of the temporal filter for the current frame
+	float* bandOutputData; // Output frame currently produced by all bands
+	bool bandSpatialFilter; // Flag whether the spatial filter is applied to the current frame
+	RawDepth* binnedInputBuffer; // Plane receiving the binned raw depth values of the current frame if frames are binned, or null
+	float* binnedOutputBuffer; // Plane receiving the filtered depth values of the current frame before they are upsampled into the output frame if frames are binned, or null
+	static const unsigned int roiMargin=2; // Number of pixels by which the region of interest is grown to cover the reach of the spatial filter
+	unsigned int* roiSpans; // Per-row ranges of filtered pixels inside the region of interest, as pairs of first and one-past-last pixel indices; empty rows are stored as (0, 0)
+	unsigned int* newROISpans; // Region of interest set by the most recent call to a setROI method that was not yet picked up by the background filtering thread, or null; protected by inputCond
+	unsigned int numROIPixels; // Number of filtered pixels inside the region of interest
+	unsigned char* tileInROI; // Flags whether each spatial filter tile overlaps the region of interest
 	float minPlane[4]; // Plane equation of the lower bound of valid depth values in depth image space
 	float maxPlane[4]; // Plane equation of the upper bound of valid depth values in depth image space
+	float* depthCorrectionScales; // Plane of per-pixel depth correction scale factors
+	float* depthCorrectionOffsets; // Plane of per-pixel depth correction offsets
+	TemporalFilterMode temporalFilterMode; // Temporal filter algorithm
 	unsigned int numAveragingSlots; // Number of slots in each pixel's averaging buffer
-	RawDepth* averagingBuffer; // Buffer to calculate running averages of each pixel's depth value
+	RawDepth* averagingBuffer; // Buffer to calculate running averages of each pixel's depth value, one plane per averaging slot; null for filters without sample windows
+	RawDepth* medianWindowBuffer; // Buffer of per-pixel sorted copies of the valid samples in the averaging buffer, numAveragingSlots entries per pixel, updated incrementally by the median filter; null for other filters
 	unsigned int averagingSlotIndex; // Index of averaging slot in which to store the next frame's depth values
-	unsigned int* statBuffer; // Buffer retaining the running means and variances of each pixel's depth value
+	Misc::UInt16* countBuffer; // Plane of per-pixel numbers of valid samples in the averaging buffer, or numbers of consecutive valid samples entered into the filter state for filters without sample windows
+	Misc::UInt32* sumBuffer; // Plane of per-pixel sums of valid samples in the averaging buffer, or null
+	Misc::UInt32* sumSquaresBuffer32; // Plane of per-pixel sums of squares of valid samples if the averaging window is short enough for 32-bit sums, or null
+	Misc::UInt64* sumSquaresBuffer64; // Plane of per-pixel sums of squares of valid samples if the averaging window needs 64-bit sums, or null
+	float* estimateBuffer; // Plane of per-pixel filtered raw depth values for filters without sample windows, or null
+	float* estimateVarianceBuffer; // Plane of per-pixel variances of the filtered raw depth values for filters without sample windows, or null
+	float emaWeight; // Weight of a new sample in the exponential moving average
+	float kalmanProcessNoise; // Variance added to each pixel's Kalman filter estimate per frame
+	float kalmanMeasurementNoise; // Variance of raw depth samples assumed by the Kalman filter
+	static const unsigned int motionConfirmSamples=2; // Number of consecutive samples deviating from a pixel's running mean that restart the pixel's averaging window
+	Misc::UInt8* motionBuffer; // Plane of per-pixel motion states for the adaptive filter, holding the number of consecutive deviating samples and a flag whether the averaging window was restarted recently; null for other filters
+	float motionThreshold; // Deviation of a sample from its pixel's running mean in raw depth units above which the sample indicates motion
+	unsigned int motionMinNumSamples; // Minimum number of valid samples needed to consider a pixel stable after its averaging window was restarted
 	unsigned int minNumSamples; // Minimum number of valid samples needed to consider a pixel stable
 	unsigned int maxVariance; // Maximum variance to consider a pixel stable
 	float hysteresis; // Amount by which a new filtered value has to differ from the current value to update
@@ -69,27 +149,96 @@ class FrameFilter
 	float instableValue; // Value to assign to instable pixels if retainValids is false
 	bool spatialFilter; // Flag whether to apply a spatial filter to time-averaged depth values
 	float* validBuffer; // Buffer holding the most recent stable depth value for each pixel
+	float* temporalBuffers[2]; // Pair of buffers holding the results of the temporal filter for the current and previous frames when the spatial filter is enabled
+	unsigned int temporalBufferIndex; // Index of the temporal buffer receiving the current frame's results
+	static const unsigned int spatialTileSize=32; // Width and height of the tiles tracked by the incremental spatial filter
+	unsigned int numTiles[2]; // Number of spatial filter tiles in x and y
+	unsigned char* tileChanged; // Flags whether the temporal filter results inside each tile changed from the previous frame
+	float* spatialResultBuffer; // Buffer holding the most recent results of the spatial filter
+	bool spatialResultValid; // Flag whether the spatial result buffer matches the temporal results in the previous temporal buffer
+	unsigned int lastNumSkippedTiles; // Number of tiles skipped by the spatial filter in the most recent frame
+	Misc::UInt64 totalNumTiles; // Total number of tiles considered by the spatial filter so far
+	Misc::UInt64 totalNumSkippedTiles; // Total number of tiles skipped by the spatial filter so far
+	FilterRowMethod filterRow; // Method to run the temporal filter on one row of pixels, selected based on the CPU's capabilities
 	Threads::TripleBuffer<Kinect::FrameBuffer> outputFrames; // Triple buffer of output frames
+	float* previousOutputBuffer; // Copy of the most recent output frame, to find the depth pixels changed by the next output frame
+	bool previousOutputValid; // Flag whether the previous output buffer holds an output frame
+	Rect dirtyRect; // Rectangle of depth pixels that changed between the two most recent output frames
 	OutputFrameFunction* outputFrameFunction; // Function called when a new output frame is ready
 	
 	/* Private methods: */
+	template <class SumSquaresParam,bool medianParam,bool adaptiveParam>
+	void filterPixels(const RawDepth* inputData,float* outputData,SumSquaresParam* sumSquaresBuffer,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Runs the box, median, or adaptive temporal filter on the given span of pixels in one row using scalar arithmetic
+	void filterRowScalar32(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Runs the box temporal filter on a span of pixels in one row using scalar arithmetic and 32-bit sums of squares
+	void filterRowScalar64(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Runs the box temporal filter on a span of pixels in one row using scalar arithmetic and 64-bit sums of squares
+	void filterRowMedian32(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Runs the median temporal filter on a span of pixels in one row using 32-bit sums of squares
+	void filterRowMedian64(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Runs the median temporal filter on a span of pixels in one row using 64-bit sums of squares
+	void filterRowAdaptive32(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Runs the adaptive temporal filter on a span of pixels in one row using 32-bit sums of squares
+	void filterRowAdaptive64(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Runs the adaptive temporal filter on a span of pixels in one row using 64-bit sums of squares
+	void filterRowEMA(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Runs the exponential moving average temporal filter on a span of pixels in one row
+	void filterRowKalman(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Runs the Kalman temporal filter on a span of pixels in one row
+	#if FRAMEFILTER_X86SIMD
+	void filterRowSSE41(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Runs the temporal filter on a span of pixels in one row using SSE4.1 instructions
+	void filterRowAVX2(const RawDepth* inputData,float* outputData,unsigned int y,unsigned int xBegin,unsigned int xEnd); // Runs the temporal filter on a span of pixels in one row using AVX2 instructions
+	#endif
+	void binRow(unsigned int y,unsigned int xBegin,unsigned int xEnd); // Averages the valid raw depth values in each 2x2 bin of the given span of binned pixels in one row of the current frame
+	void upsampleFrame(const float* binnedData,float* outputData); // Interpolates the given binned filtered frame to the full-resolution output frame
+	void updateDirtyRect(const float* outputData); // Compares the given new output frame against the previous output frame, updates the changed rectangle, and retains the new output frame
+	void setROISpans(unsigned int* newSpans); // Hands the given region of interest to the background filtering thread; adopts the given array
+	void updateROI(unsigned int* newSpans); // Installs the given region of interest taken over from newROISpans and rebuilds its tile masks; adopts the given array; must be called by the background filtering thread without holding inputCond
+	void spatialFilterRect(const float* source,float* dest,unsigned int xBegin,unsigned int xEnd,unsigned int yBegin,unsigned int yEnd,float* scratch); // Applies the two-pass spatial filter to the given rectangle of the source frame, using halo pixels from the source frame
+	void processBand(unsigned int bandIndex); // Runs the temporal and spatial filters on the band of the given index
+	void* workerThreadMethod(void); // Method for the worker threads
 	void* filterThreadMethod(void); // Method for the background filtering thread
 	
 	/* Constructors and destructors: */
 	public:
-	FrameFilter(const Size& sSize,unsigned int sNumAveragingSlots,const PixelDepthCorrection* sPixelDepthCorrection,const PTransform& depthProjection,const Plane& basePlane); // Creates a filter for frames of the given size and the given running average length
+	FrameFilter(const Size& sFrameSize,TemporalFilterMode sTemporalFilterMode,unsigned int sNumAveragingSlots,unsigned int sNumThreads,const PixelDepthCorrection* sPixelDepthCorrection,const PTransform& depthProjection,const Plane& basePlane,bool sBinned); // Creates a filter for frames of the given size using the given temporal filter algorithm and running window length, using the given number of filtering threads; filters bins of 2x2 pixels at half resolution if the binned flag is set
 	~FrameFilter(void); // Destroys the frame filter
 	
 	/* Methods: */
+	static const unsigned int maxMedianWindowSize=64; // Maximum running window length for the median temporal filter
+	static bool needs64BitSums(unsigned int numAveragingSlots); // Returns true if the given averaging window length requires 64-bit sums of squares
+	static bool hasSampleWindow(TemporalFilterMode temporalFilterMode) // Returns true if the given temporal filter algorithm keeps a running window of samples
+		{
+		return temporalFilterMode==BoxFilter||temporalFilterMode==MedianFilter||temporalFilterMode==AdaptiveFilter;
+		}
+	static bool isFilterKernelSupported(TemporalFilterMode temporalFilterMode,unsigned int numAveragingSlots,FilterKernel filterKernel); // Returns true if the given temporal filter implementation can be used for the given temporal filter algorithm and running window length on the current CPU
+	static void printMemoryFootprint(std::ostream& os,const Size& frameSize,TemporalFilterMode temporalFilterMode,unsigned int numAveragingSlots,bool binned); // Prints a breakdown of the memory used by a filter for frames of the given size, temporal filter algorithm, running window length, and binning flag
 	void setValidDepthInterval(unsigned int newMinDepth,unsigned int newMaxDepth); // Sets the interval of depth values considered by the depth image filter
 	void setValidElevationInterval(const PTransform& depthProjection,const Plane& basePlane,double newMinElevation,double newMaxElevation); // Sets the interval of elevations relative to the given base plane considered by the depth image filter
-	void setStableParameters(unsigned int newMinNumSamples,unsigned int newMaxVariance); // Sets the statistical properties to consider a pixel stable
+	void setStableParameters(unsigned int newMinNumSamples,unsigned int newMaxVariance); // Sets the statistical properties to consider a pixel stable; the minimum number of samples is at least one
 	void setHysteresis(float newHysteresis); // Sets the stable value hysteresis envelope
+	void setEMAWeight(float newEMAWeight); // Sets the weight of new samples in the exponential moving average temporal filter
+	void setKalmanNoise(float newKalmanProcessNoise,float newKalmanMeasurementNoise); // Sets the per-frame process noise variance and measurement noise variance of the Kalman temporal filter
+	void setMotionParameters(float newMotionThreshold,unsigned int newMotionMinNumSamples); // Sets the motion detection threshold in raw depth units and the minimum number of samples to consider a pixel stable after motion for the adaptive temporal filter; the minimum number of samples is at least one
 	void setRetainValids(bool newRetainValids); // Sets whether the filter retains previous stable values for instable pixels
 	void setInstableValue(float newInstableValue); // Sets the depth value to assign to instable pixels
 	void setSpatialFilter(bool newSpatialFilter); // Sets the spatial filtering flag
+	bool setFilterKernel(FilterKernel newFilterKernel); // Overrides the implementation of the box temporal filter for benchmarking; must be called before the first frame is received; returns false and keeps the current implementation if the given one is not supported
+	FilterKernel getFilterKernel(void) const; // Returns the implementation of the temporal filter used by the box temporal filter, or ScalarKernel for all other temporal filter algorithms
+	void setROI(const PTransform& depthProjection,const Plane& basePlane,const Point basePlaneCorners[4],double minElevation,double maxElevation); // Restricts filtering to the depth pixels showing the given sandbox quadrilateral anywhere between the given elevations above the base plane; pixels outside keep their most recent stable values
+	void setROI(const Rect& newROI); // Restricts filtering to the given rectangle of depth pixels
+	void resetROI(void); // Filters all depth pixels
 	void setOutputFrameFunction(OutputFrameFunction* newOutputFrameFunction); // Sets the output function; adopts given functor object
-	void receiveRawFrame(const Kinect::FrameBuffer& newFrame); // Called to receive a new raw depth frame
+	void receiveRawFrame(const Kinect::FrameBuffer& newFrame); // Called to receive a new raw depth frame; never waits for the background filtering thread
+	unsigned int getNumReceivedFrames(void) const; // Returns the number of raw depth frames received so far
+	unsigned int getNumDroppedFrames(void) const; // Returns the number of raw depth frames that were received but not filtered
+	unsigned int getNumTiles(void) const // Returns the number of tiles tracked by the incremental spatial filter
+		{
+		return numTiles[1]*numTiles[0];
+		}
+	bool isBinned(void) const // Returns true if frames are filtered in bins of 2x2 pixels
+		{
+		return binned;
+		}
+	unsigned int getNumFilteredPixels(void) const; // Returns the number of pixels or bins run through the temporal filter per frame
+	unsigned int getLastNumSkippedTiles(void) const; // Returns the number of tiles skipped by the spatial filter in the most recent frame
+	void getSpatialFilterTileCounts(Misc::UInt64& numConsideredTiles,Misc::UInt64& numSkippedTiles) const; // Returns the total numbers of tiles considered and skipped by the spatial filter so far
+	const Rect& getDirtyRect(void) const // Returns the rectangle of depth pixels that changed between the previous and the new output frame; must only be called from the output frame function
+		{
+		return dirtyRect;
+		}
 	bool lockNewFrame(void) // Locks the most recently produced output frame for reading; returns true if the locked frame is new
 		{
 		return outputFrames.lockNewValue();
@@ -0,0 +1,85 @@
+/***********************************************************************
+GridReadback - Class holding a set of bathymetry, water level, and snow
+height grids read back from the GPU in a single operation, shared by
+all parties that requested them.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef GRIDREADBACK_INCLUDED
+#define GRIDREADBACK_INCLUDED
+
+#include <vector>
+#include <Misc/Autopointer.h>
+#include <Threads/RefCounted.h>
+#include <GL/gl.h>
+
+#include "Types.h"
+
+class GridReadback:public Threads::RefCounted
+	{
+	/* Embedded classes: */
+	public:
+	enum GridMask // Enumerated type for bit masks selecting grids to read back
+		{
+		Bathymetry=0x1U,
+		WaterLevel=0x2U,
+		SnowHeight=0x4U
+		};
+	
+	/* Elements: */
+	Size size; // Width and height of the cell-centered grids; the bathymetry grid is one smaller in each direction
+	unsigned int gridMask; // Bit mask of grids that were read back
+	std::vector<GLfloat> bathymetry; // The vertex-centered bathymetry grid, or empty if it was not read back
+	std::vector<GLfloat> waterLevel; // The cell-centered water level grid, or empty if it was not read back
+	std::vector<GLfloat> snowHeight; // The cell-centered snow height grid, or empty if it was not read back
+	
+	/* Constructors and destructors: */
+	GridReadback(const Size& sSize,unsigned int sGridMask) // Creates uninitialized grids of the given size for the grids selected by the given bit mask
+		:size(sSize),gridMask(sGridMask)
+		{
+		if(gridMask&Bathymetry)
+			bathymetry.resize(size_t(size[1]-1)*size_t(size[0]-1));
+		if(gridMask&WaterLevel)
+			waterLevel.resize(size_t(size[1])*size_t(size[0]));
+		if(gridMask&SnowHeight)
+			snowHeight.resize(size_t(size[1])*size_t(size[0]));
+		}
+	
+	/* Methods: */
+	Size getBathymetrySize(void) const // Returns the width and height of the bathymetry grid
+		{
+		return Size(size[0]-1,size[1]-1);
+		}
+	GLfloat* getBathymetry(void) // Returns the bathymetry grid, or null if it was not read back
+		{
+		return bathymetry.empty()?0:&bathymetry.front();
+		}
+	GLfloat* getWaterLevel(void) // Returns the water level grid, or null if it was not read back
+		{
+		return waterLevel.empty()?0:&waterLevel.front();
+		}
+	GLfloat* getSnowHeight(void) // Returns the snow height grid, or null if it was not read back
+		{
+		return snowHeight.empty()?0:&snowHeight.front();
+		}
+	};
+
+typedef Misc::Autopointer<GridReadback> GridReadbackPtr; // Type for reference-counted pointers to grid read-backs
+
+#endif
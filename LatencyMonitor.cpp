@@ -0,0 +1,210 @@
+/***********************************************************************
+LatencyMonitor - Class to track the latency of depth frames through the
+stages of the AR Sandbox's depth-to-projector pipeline, and to report
+rolling latency percentiles for each stage.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "LatencyMonitor.h"
+
+#include <time.h>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+#include <IO/OpenFile.h>
+#include <IO/OStream.h>
+
+/***************************************
+Static elements of class LatencyMonitor:
+***************************************/
+
+const char* LatencyMonitor::stageNames[LatencyMonitor::NumStages]=
+	{
+	"Dispatch","Filter","Handoff","SetDepthImage","Upload","Render","EndToEnd"
+	};
+
+/*******************************
+Methods of class LatencyMonitor:
+*******************************/
+
+LatencyMonitor::FrameRecord* LatencyMonitor::findRecord(double timeStamp)
+	{
+	/* Search backwards from the most recent record: */
+	unsigned int recordIndex=nextRecordIndex;
+	for(unsigned int i=0;i<numRecords;++i)
+		{
+		recordIndex=(recordIndex+windowSize-1)%windowSize;
+		if(records[recordIndex].timeStamp==timeStamp)
+			return &records[recordIndex];
+		}
+	
+	return 0;
+	}
+
+LatencyMonitor::LatencyMonitor(void)
+	:nextRecordIndex(0),numRecords(0)
+	{
+	}
+
+double LatencyMonitor::getTime(void)
+	{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return double(now.tv_sec)+double(now.tv_nsec)*1.0e-9;
+	}
+
+void LatencyMonitor::frameArrived(double timeStamp,double arrivalTime)
+	{
+	Threads::Mutex::Lock lock(mutex);
+	
+	/* Start a new record in the ring buffer, overwriting the oldest one: */
+	FrameRecord& record=records[nextRecordIndex];
+	record.timeStamp=timeStamp;
+	record.arrivalTime=arrivalTime;
+	record.filteredTime=-1.0;
+	for(int i=0;i<NumStages;++i)
+		record.latencies[i]=-1.0;
+	nextRecordIndex=(nextRecordIndex+1)%windowSize;
+	if(numRecords<windowSize)
+		++numRecords;
+	}
+
+void LatencyMonitor::frameDispatched(double timeStamp,double dispatchEndTime)
+	{
+	Threads::Mutex::Lock lock(mutex);
+	
+	FrameRecord* record=findRecord(timeStamp);
+	if(record!=0&&record->latencies[Dispatch]<0.0)
+		record->latencies[Dispatch]=dispatchEndTime-record->arrivalTime;
+	}
+
+void LatencyMonitor::frameFiltered(double timeStamp,double filteredTime)
+	{
+	Threads::Mutex::Lock lock(mutex);
+	
+	FrameRecord* record=findRecord(timeStamp);
+	if(record!=0&&record->filteredTime<0.0)
+		{
+		record->filteredTime=filteredTime;
+		record->latencies[Filter]=filteredTime-record->arrivalTime;
+		}
+	}
+
+void LatencyMonitor::frameLocked(double timeStamp,double lockTime,double setEndTime)
+	{
+	Threads::Mutex::Lock lock(mutex);
+	
+	FrameRecord* record=findRecord(timeStamp);
+	if(record!=0&&record->filteredTime>=0.0&&record->latencies[Handoff]<0.0)
+		{
+		record->latencies[Handoff]=lockTime-record->filteredTime;
+		record->latencies[SetDepthImage]=setEndTime-lockTime;
+		}
+	}
+
+void LatencyMonitor::frameUploaded(double timeStamp,double uploadStartTime,double uploadEndTime)
+	{
+	Threads::Mutex::Lock lock(mutex);
+	
+	/* Only count the first upload if the frame is uploaded into multiple OpenGL contexts: */
+	FrameRecord* record=findRecord(timeStamp);
+	if(record!=0&&record->latencies[Upload]<0.0)
+		record->latencies[Upload]=uploadEndTime-uploadStartTime;
+	}
+
+void LatencyMonitor::frameRendered(double timeStamp,double renderStartTime,double renderEndTime)
+	{
+	Threads::Mutex::Lock lock(mutex);
+	
+	/* Only count the first display pass if the frame is rendered into multiple windows: */
+	FrameRecord* record=findRecord(timeStamp);
+	if(record!=0&&record->latencies[Render]<0.0)
+		{
+		record->latencies[Render]=renderEndTime-renderStartTime;
+		record->latencies[EndToEnd]=renderEndTime-record->arrivalTime;
+		}
+	}
+
+void LatencyMonitor::printStatistics(std::ostream& os)
+	{
+	/* Collect the latencies of all frames in the window: */
+	std::vector<double> latencies[NumStages];
+	{
+	Threads::Mutex::Lock lock(mutex);
+	for(unsigned int i=0;i<numRecords;++i)
+		for(int stage=0;stage<NumStages;++stage)
+			if(records[i].latencies[stage]>=0.0)
+				latencies[stage].push_back(records[i].latencies[stage]);
+	}
+	
+	/* Print the percentiles of each stage in ms: */
+	std::ios::fmtflags oldFlags=os.flags();
+	std::streamsize oldPrecision=os.precision();
+	os<<std::fixed<<std::setprecision(3);
+	os<<"Latency over last "<<windowSize<<" frames (ms):"<<std::endl;
+	os<<std::setw(14)<<"Stage"<<std::setw(8)<<"Frames"<<std::setw(10)<<"p50"<<std::setw(10)<<"p95"<<std::setw(10)<<"p99"<<std::setw(10)<<"max"<<std::endl;
+	for(int stage=0;stage<NumStages;++stage)
+		{
+		std::vector<double>& l=latencies[stage];
+		os<<std::setw(14)<<stageNames[stage]<<std::setw(8)<<l.size();
+		if(!l.empty())
+			{
+			/* Sort the latencies and pick the nearest-rank percentiles: */
+			std::sort(l.begin(),l.end());
+			static const double percentiles[3]={0.5,0.95,0.99};
+			for(int i=0;i<3;++i)
+				os<<std::setw(10)<<l[size_t(percentiles[i]*double(l.size()-1)+0.5)]*1000.0;
+			os<<std::setw(10)<<l.back()*1000.0;
+			}
+		os<<std::endl;
+		}
+	os.flags(oldFlags);
+	os.precision(oldPrecision);
+	}
+
+void LatencyMonitor::writeCSVFile(const char* fileName)
+	{
+	/* Copy the frame records in order of arrival: */
+	std::vector<FrameRecord> window;
+	{
+	Threads::Mutex::Lock lock(mutex);
+	unsigned int recordIndex=(nextRecordIndex+windowSize-numRecords)%windowSize;
+	for(unsigned int i=0;i<numRecords;++i,recordIndex=(recordIndex+1)%windowSize)
+		window.push_back(records[recordIndex]);
+	}
+	
+	/* Write one line per frame, leaving the latencies of stages a frame did not reach empty: */
+	IO::OStream csvFile(IO::openFile(fileName,IO::File::WriteOnly));
+	csvFile<<"TimeStamp";
+	for(int stage=0;stage<NumStages;++stage)
+		csvFile<<','<<stageNames[stage];
+	csvFile<<std::endl;
+	csvFile<<std::setprecision(9);
+	for(std::vector<FrameRecord>::iterator wIt=window.begin();wIt!=window.end();++wIt)
+		{
+		csvFile<<wIt->timeStamp;
+		for(int stage=0;stage<NumStages;++stage)
+			{
+			csvFile<<',';
+			if(wIt->latencies[stage]>=0.0)
+				csvFile<<wIt->latencies[stage]*1000.0;
+			}
+		csvFile<<std::endl;
+		}
+	}
@@ -0,0 +1,88 @@
+/***********************************************************************
+LatencyMonitor - Class to track the latency of depth frames through the
+stages of the AR Sandbox's depth-to-projector pipeline, and to report
+rolling latency percentiles for each stage.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef LATENCYMONITOR_INCLUDED
+#define LATENCYMONITOR_INCLUDED
+
+#include <iostream>
+#include <Threads/Mutex.h>
+
+class LatencyMonitor
+	{
+	/* Embedded classes: */
+	public:
+	enum Stage // Enumerated type for measured pipeline stages
+		{
+		Dispatch=0, // Time spent in the raw depth frame callback
+		Filter, // Time from a raw frame's arrival until the frame filter delivers the filtered frame
+		Handoff, // Time a filtered frame waits in the triple buffer until the main loop picks it up
+		SetDepthImage, // Time spent handing the filtered frame to the depth image renderer
+		Upload, // Time spent uploading the filtered frame into the depth texture
+		Render, // CPU time of the first display pass rendering the new depth texture
+		EndToEnd, // Time from a raw frame's arrival until the end of the first display pass rendering it
+		NumStages
+		};
+	
+	private:
+	struct FrameRecord // Structure tracking a single depth frame through the pipeline
+		{
+		/* Elements: */
+		public:
+		double timeStamp; // The raw depth frame's time stamp, used to identify the frame
+		double arrivalTime; // Time at which the raw depth frame arrived from the camera
+		double filteredTime; // Time at which the frame filter delivered the filtered frame
+		double latencies[NumStages]; // Latencies of all stages the frame has passed through; negative for stages not yet passed
+		};
+	
+	/* Elements: */
+	static const char* stageNames[NumStages]; // Names of the measured pipeline stages
+	static const unsigned int windowSize=256; // Number of most recent frames contributing to latency statistics
+	Threads::Mutex mutex; // Mutex serializing access to the frame records
+	FrameRecord records[windowSize]; // Ring buffer of the most recent frames
+	unsigned int nextRecordIndex; // Index of the ring buffer slot to be used by the next arriving frame
+	unsigned int numRecords; // Number of valid records in the ring buffer
+	
+	/* Private methods: */
+	FrameRecord* findRecord(double timeStamp); // Returns the most recent record of the frame with the given time stamp, or null; must be called with the mutex locked
+	
+	/* Constructors and destructors: */
+	public:
+	LatencyMonitor(void); // Creates an empty latency monitor
+	private:
+	LatencyMonitor(const LatencyMonitor& source); // Prohibit copy constructor
+	LatencyMonitor& operator=(const LatencyMonitor& source); // Prohibit assignment operator
+	public:
+	
+	/* Methods: */
+	static double getTime(void); // Returns the current time of the monotonic clock shared by all pipeline stages in seconds
+	void frameArrived(double timeStamp,double arrivalTime); // Registers a new raw depth frame before it is passed on to any processing stage
+	void frameDispatched(double timeStamp,double dispatchEndTime); // Registers the time at which the raw depth frame callback finished with the given frame
+	void frameFiltered(double timeStamp,double filteredTime); // Registers the time at which the filtered version of the given frame was delivered
+	void frameLocked(double timeStamp,double lockTime,double setEndTime); // Registers the time at which the main loop picked up the given frame, and the time it finished handing it to the depth image renderer
+	void frameUploaded(double timeStamp,double uploadStartTime,double uploadEndTime); // Registers the first upload of the given frame into a depth texture
+	void frameRendered(double timeStamp,double renderStartTime,double renderEndTime); // Registers the first display pass rendering the given frame
+	void printStatistics(std::ostream& os); // Prints the median, 95th, and 99th percentile latencies of all stages to the given stream
+	void writeCSVFile(const char* fileName); // Writes the latencies of all frames in the current window to a CSV file of the given name
+	};
+
+#endif
@@ -59,7 +59,7 @@ LocalWaterToolFactory* LocalWaterTool::initClass(Vrui::ToolManager& toolManager)
 
 LocalWaterTool::LocalWaterTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputAssignment& inputAssignment)
 	:Vrui::Tool(factory,inputAssignment),
-	 addWaterFunction(0),
+	 addWaterDisksFunction(0),
 	 adding(0.0f)
 	{
 	}
@@ -70,21 +70,21 @@ LocalWaterTool::~LocalWaterTool(void)
 
 void LocalWaterTool::initialize(void)
 	{
-	/* Register a render function with the water table: */
+	/* Register a water disk function with the water table: */
 	if(application->waterTable!=0)
 		{
-		addWaterFunction=Misc::createFunctionCall(this,&LocalWaterTool::addWater);
-		application->waterTable->addRenderFunction(addWaterFunction);
+		addWaterDisksFunction=Misc::createFunctionCall(this,&LocalWaterTool::addWaterDisks);
+		application->waterTable->addWaterDiskFunction(addWaterDisksFunction);
 		}
 	}
 
 void LocalWaterTool::deinitialize(void)
 	{
-	/* Unregister the render function from the water table: */
+	/* Unregister the water disk function from the water table: */
 	if(application->waterTable!=0)
-		application->waterTable->removeRenderFunction(addWaterFunction);
-	delete addWaterFunction;
-	addWaterFunction=0;
+		application->waterTable->removeWaterDiskFunction(addWaterDisksFunction);
+	delete addWaterDisksFunction;
+	addWaterDisksFunction=0;
 	}
 
 const Vrui::ToolFactory* LocalWaterTool::getFactory(void) const
@@ -168,20 +168,15 @@ void LocalWaterTool::glRenderActionTransparent(GLContextData& contextData) const
 	glPopAttrib();
 	}
 
-void LocalWaterTool::addWater(GLContextData& contextData) const
+void LocalWaterTool::addWaterDisks(WaterDiskList& waterDisks) const
 	{
 	if(adding!=0.0f)
 		{
-		glPushAttrib(GL_ENABLE_BIT);
-		glDisable(GL_CULL_FACE);
-		
 		/* Get the current rain disk position and size in camera coordinates: */
 		Vrui::Point rainPos=Vrui::getInverseNavigationTransformation().transform(getButtonDevicePosition(0));
 		Vrui::Scalar rainRadius=Vrui::getPointPickDistance()*Vrui::Scalar(3);
 		
-		/* Render the rain disk: */
-		application->renderRainDisk(rainPos,rainRadius,adding/application->waterSpeed);
-		
-		glPopAttrib();
+		/* Add the rain disk: */
+		waterDisks.push_back(WaterDisk(rainPos,rainRadius,GLfloat(adding/application->waterSpeed)));
 		}
 	}
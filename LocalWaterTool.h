@@ -30,13 +30,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <Vrui/TransparentObject.h>
 #include <Vrui/Application.h>
 
+#include "WaterDisk.h"
+
 /* Forward declarations: */
 namespace Misc {
 template <class ParameterParam>
 class FunctionCall;
 }
 class GLContextData;
-typedef Misc::FunctionCall<GLContextData&> AddWaterFunction;
+typedef Misc::FunctionCall<WaterDiskList&> AddWaterDiskFunction;
 class Sandbox;
 class LocalWaterTool;
 typedef Vrui::GenericToolFactory<LocalWaterTool> LocalWaterToolFactory;
@@ -49,7 +51,7 @@ class LocalWaterTool:public Vrui::Tool,public Vrui::Application::Tool<Sandbox>,p
 	private:
 	static LocalWaterToolFactory* factory; // Pointer to the factory object for this class
 	
-	const AddWaterFunction* addWaterFunction; // Render function registered with the water table
+	const AddWaterDiskFunction* addWaterDisksFunction; // Water disk function registered with the water table
 	GLfloat adding; // Amount of data added or removed from the water table
 	
 	/* Constructors and destructors: */
@@ -71,7 +73,7 @@ class LocalWaterTool:public Vrui::Tool,public Vrui::Application::Tool<Sandbox>,p
 	virtual void glRenderActionTransparent(GLContextData& contextData) const;
 	
 	/* New methods: */
-	void addWater(GLContextData& contextData) const; // Function to render geometry that adds water to the water table
+	void addWaterDisks(WaterDiskList& waterDisks) const; // Function to add the tool's rain disk to the water table's water disk list
 	};
 
 #endif
@@ -223,9 +223,10 @@ void* RemoteServer::communicationThreadMethod(void)
 			{
 			/* Quantize the property grids: */
 			int newGrid=1-currentGrid;
-			quantizeGrid(gridSize[0]-1,gridSize[1]-1,grids.getLockedValue().bathymetry,bathymetry[newGrid]);
-			quantizeGrid(gridSize[0],gridSize[1],grids.getLockedValue().waterLevel,waterLevel[newGrid]);
-			quantizeGrid(gridSize[0],gridSize[1],grids.getLockedValue().snowHeight,snowHeight[newGrid]);
+			GridReadback& readback=*grids.getLockedValue();
+			quantizeGrid(gridSize[0]-1,gridSize[1]-1,readback.getBathymetry(),bathymetry[newGrid]);
+			quantizeGrid(gridSize[0],gridSize[1],readback.getWaterLevel(),waterLevel[newGrid]);
+			quantizeGrid(gridSize[0],gridSize[1],readback.getSnowHeight(),snowHeight[newGrid]);
 			
 			/* Send the quantized grid triplet to all connected clients in streaming state: */
 			std::vector<Client*> deadClients;
@@ -278,12 +279,12 @@ void* RemoteServer::communicationThreadMethod(void)
 	return 0;
 	}
 
-void RemoteServer::readBackCallback(GLfloat*,GLfloat*,GLfloat*,void* userData)
+void RemoteServer::readBackCallback(const GridReadbackPtr& readback,void* userData)
 	{
 	RemoteServer* thisPtr=static_cast<RemoteServer*>(userData);
 	
-	/* Post the new grids to the grid triple buffer and wake up the communication thread: */
-	thisPtr->grids.postNewValue();
+	/* Post the shared grids to the grid triple buffer and wake up the communication thread: */
+	thisPtr->grids.postNewValue(readback);
 	thisPtr->dispatcher.interrupt();
 	}
 
@@ -314,10 +315,6 @@ RemoteServer::RemoteServer(Sandbox* sSandbox,int listenPortId,double sRequestInt
 	eScale=65535.0f/(elevationRange[1]-elevationRange[0]);
 	eOffset=0.5f-elevationRange[0]*eScale;
 	
-	/* Allocate the property grids: */
-	for(int i=0;i<3;++i)
-		grids.getBuffer(i).init(gridSize);
-	
 	/* Create the grid quantization buffers: */
 	for(int i=0;i<2;++i)
 		{
@@ -334,6 +331,9 @@ RemoteServer::RemoteServer(Sandbox* sSandbox,int listenPortId,double sRequestInt
 
 RemoteServer::~RemoteServer(void)
 	{
+	/* Cancel any outstanding grid requests: */
+	sandbox->gridRequest.cancelRequests(this);
+	
 	/* Shut down the communication thread: */
 	dispatcher.stop();
 	communicationThread.join();
@@ -359,13 +359,11 @@ void RemoteServer::frame(double applicationTime)
 	/* Check if it's time to request a new set of grids: */
 	if(numClients>0&&applicationTime>=nextRequestTime)
 		{
-		/* Request new grids: */
-		GridBuffers& gb=grids.startNewValue();
-		if(sandbox->gridRequest.requestGrids(gb.bathymetry,gb.waterLevel,gb.snowHeight,&RemoteServer::readBackCallback,this))
-			{
-			/* Push the next request time forward: */
-			nextRequestTime=(Math::floor(applicationTime/requestInterval)+1.0)*requestInterval;
-			}
+		/* Request new grids; they will be shared with any other requesters reading back grids in the same frame: */
+		sandbox->gridRequest.requestGrids(GridReadback::Bathymetry|GridReadback::WaterLevel|GridReadback::SnowHeight,&RemoteServer::readBackCallback,this);
+		
+		/* Push the next request time forward: */
+		nextRequestTime=(Math::floor(applicationTime/requestInterval)+1.0)*requestInterval;
 		}
 	}
 
@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "Types.h"
 #include "Pixel.h"
+#include "GridReadback.h"
 
 /* Forward declarations: */
 class GLContextData;
@@ -46,35 +47,6 @@ class RemoteServer
 	{
 	/* Embedded classes: */
 	private:
-	struct GridBuffers // Structure representing a triplet of grids
-		{
-		/* Elements: */
-		public:
-		GLfloat* bathymetry;
-		GLfloat* waterLevel;
-		GLfloat* snowHeight;
-		
-		/* Constructors and destructors: */
-		GridBuffers(void)
-			:bathymetry(0),waterLevel(0),snowHeight(0)
-			{
-			}
-		~GridBuffers(void)
-			{
-			delete[] bathymetry;
-			delete[] waterLevel;
-			delete[] snowHeight;
-			}
-		
-		/* Methods: */
-		void init(const GLsizei gridSize[2]) // Initializes the grids
-			{
-			bathymetry=new GLfloat[(gridSize[1]-1)*(gridSize[0]-1)];
-			waterLevel=new GLfloat[gridSize[1]*gridSize[0]];
-			snowHeight=new GLfloat[gridSize[1]*gridSize[0]];
-			}
-		};
-	
 	struct Client // Structure representing a remote client
 		{
 		/* Embedded classes: */
@@ -110,7 +82,7 @@ class RemoteServer
 	Threads::TripleBuffer<std::vector<Vrui::ONTransform> > clientPositions; // Triple buffer of lists of positions/orientations of connected clients
 	double requestInterval; // Time interval between requests for new property grids
 	double nextRequestTime; // Application time at which to request the next property grids
-	Threads::TripleBuffer<GridBuffers> grids; // Triple buffer of arrays to receive property grids
+	Threads::TripleBuffer<GridReadbackPtr> grids; // Triple buffer of shared read-backs of property grids
 	Pixel* bathymetry[2]; // Pair of buffers for the current quantized bathymetry grid
 	Pixel* waterLevel[2]; // Pair of buffers for the current quantized water grid
 	Pixel* snowHeight[2]; // Pair of buffers for the current quantized snow grid
@@ -122,7 +94,7 @@ class RemoteServer
 	static void newConnectionCallback(Threads::EventDispatcher::IOEvent& event); // Callback called when a connection attempt is made at the listening socket
 	static void clientMessageCallback(Threads::EventDispatcher::IOEvent& event); // Callback called when a message is received from a connected client
 	void* communicationThreadMethod(void); // Method handling communication with connected clients in the background
-	static void readBackCallback(GLfloat* bathymetryBuffer,GLfloat* waterLevelBuffer,GLfloat* snowHeightBuffer,void* userData); // Callback called when new property grids have been read back from the GPU
+	static void readBackCallback(const GridReadbackPtr& readback,void* userData); // Callback called when new property grids have been read back from the GPU
 	
 	/* Constructors and destructors: */
 	public:
@@ -0,0 +1,812 @@
+/***********************************************************************
+ReplayDepthFrames - Utility to replay recorded raw depth frames through
+the AR Sandbox's frame filter and hand extractor without a depth camera
+or graphics hardware, to benchmark and regression-test them.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <Misc/SizedTypes.h>
+#include <Misc/FunctionCalls.h>
+#include <Math/Math.h>
+#include <Threads/MutexCond.h>
+#include <IO/File.h>
+#include <IO/OpenFile.h>
+
+#include "FrameFilter.h"
+#include "HandExtractor.h"
+#include "DepthFrameReplayer.h"
+#include "Pixel.h"
+#include "IntraFrameCompressor.h"
+#include "InterFrameCompressor.h"
+#include "IntraFrameDecompressor.h"
+#include "InterFrameDecompressor.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline double getMonotonicTime(void) // Returns the current time of the monotonic clock in seconds
+	{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return double(now.tv_sec)+double(now.tv_nsec)*1.0e-9;
+	}
+
+/**************
+Helper classes:
+**************/
+
+class FilterReceiver // Class to receive filtered frames from a frame filter and fold them into a checksum
+	{
+	/* Elements: */
+	private:
+	Threads::MutexCond frameCond; // Condition variable to signal arrival of a filtered frame
+	unsigned int numFrames; // Number of filtered frames received so far
+	Misc::UInt64 checksum; // FNV-1a hash of the bit patterns of all received filtered depth values
+	double lastTimeStamp; // Time stamp of the most recently received filtered frame
+	bool inOrder; // Flag whether all filtered frames were received in order of increasing time stamps
+	bool keepLatestFrame; // Flag whether to keep a copy of the most recently received filtered frame
+	std::vector<float> latestFrame; // Copy of the most recently received filtered frame if keepLatestFrame is set
+	
+	/* Constructors and destructors: */
+	public:
+	FilterReceiver(bool sKeepLatestFrame)
+		:numFrames(0),checksum(0xcbf29ce484222325ULL),
+		 lastTimeStamp(0.0),inOrder(true),
+		 keepLatestFrame(sKeepLatestFrame)
+		{
+		}
+	
+	/* Methods: */
+	void receiveFilteredFrame(const Kinect::FrameBuffer& frameBuffer) // Called when the frame filter produced a new frame
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		
+		/* Hash the filtered frame: */
+		const unsigned char* fPtr=static_cast<const unsigned char*>(frameBuffer.getBuffer());
+		const unsigned char* fEnd=fPtr+size_t(frameBuffer.getSize(1))*size_t(frameBuffer.getSize(0))*sizeof(float);
+		for(;fPtr!=fEnd;++fPtr)
+			checksum=(checksum^Misc::UInt64(*fPtr))*0x100000001b3ULL;
+		
+		if(keepLatestFrame)
+			{
+			/* Copy the filtered frame, as the frame filter will reuse its buffer: */
+			const float* lfPtr=frameBuffer.getData<float>();
+			latestFrame.assign(lfPtr,lfPtr+size_t(frameBuffer.getSize(1))*size_t(frameBuffer.getSize(0)));
+			}
+		
+		/* Check that the filtered frame is newer than the previous one: */
+		if(numFrames>0&&frameBuffer.timeStamp<=lastTimeStamp)
+			inOrder=false;
+		lastTimeStamp=frameBuffer.timeStamp;
+		
+		/* Signal arrival of the frame: */
+		++numFrames;
+		frameCond.broadcast();
+		}
+	void waitForFrames(unsigned int minNumFrames) // Waits until at least the given number of filtered frames have been received
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		while(numFrames<minNumFrames)
+			frameCond.wait(frameLock);
+		}
+	unsigned int getNumFrames(void)
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		return numFrames;
+		}
+	bool waitForFrames(unsigned int minNumFrames,double timeout) // Waits until at least the given number of filtered frames have been received or the given time in seconds has passed; returns true if the frames were received
+		{
+		double deadline=getMonotonicTime()+timeout;
+		while(getNumFrames()<minNumFrames)
+			{
+			if(getMonotonicTime()>=deadline)
+				return false;
+			usleep(1000);
+			}
+		return true;
+		}
+	double getLastTimeStamp(void)
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		return lastTimeStamp;
+		}
+	bool isInOrder(void)
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		return inOrder;
+		}
+	Misc::UInt64 getChecksum(void)
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		return checksum;
+		}
+	const std::vector<float>& getLatestFrame(void) const // Returns the most recently received filtered frame; only valid while no new frames are being filtered
+		{
+		return latestFrame;
+		}
+	};
+
+class FilterSettings // Class bundling the frame filter settings selected on the command line
+	{
+	/* Elements: */
+	public:
+	FrameFilter::TemporalFilterMode temporalFilterMode;
+	unsigned int numAveragingSlots;
+	unsigned int numFilterThreads;
+	unsigned int minNumSamples;
+	unsigned int maxVariance;
+	float hysteresis;
+	float motionThreshold;
+	unsigned int motionMinNumSamples;
+	bool binned;
+	bool haveROI;
+	Rect roi;
+	FrameFilter::FilterKernel filterKernel;
+	
+	/* Constructors and destructors: */
+	FilterSettings(void) // Creates the same default settings as the AR Sandbox
+		:temporalFilterMode(FrameFilter::BoxFilter),
+		 numAveragingSlots(30),numFilterThreads(1),
+		 minNumSamples(10),maxVariance(2),hysteresis(0.1f),
+		 motionThreshold(5.0f),motionMinNumSamples(3),
+		 binned(false),haveROI(false),
+		 filterKernel(FrameFilter::AutoKernel)
+		{
+		}
+	
+	/* Methods: */
+	FrameFilter* createFrameFilter(const DepthFrameReplayer& replayer) const // Returns a new frame filter for the given depth frame file
+		{
+		Size frameSize=replayer.getDepthFrameSize();
+		PTransform depthProjection=replayer.getDepthProjection();
+		Plane basePlane=replayer.getBasePlane();
+		Math::Interval<double> elevationRange=replayer.getElevationRange();
+		FrameFilter* result=new FrameFilter(frameSize,temporalFilterMode,numAveragingSlots,numFilterThreads,replayer.getPixelDepthCorrection(),depthProjection,basePlane,binned);
+		result->setValidElevationInterval(depthProjection,basePlane,elevationRange.getMin(),elevationRange.getMax());
+		result->setStableParameters(minNumSamples,maxVariance);
+		result->setHysteresis(hysteresis);
+		result->setMotionParameters(motionThreshold,motionMinNumSamples);
+		result->setSpatialFilter(true);
+		if(haveROI)
+			result->setROI(roi);
+		if(!result->setFilterKernel(filterKernel))
+			{
+			delete result;
+			throw std::runtime_error("Requested temporal filter kernel is not supported");
+			}
+		return result;
+		}
+	};
+
+void filterFrames(const DepthFrameReplayer& replayer,FrameFilter& frameFilter,FilterReceiver& receiver) // Feeds all frames from the given file through the given frame filter in order
+	{
+	unsigned int baseNumFrames=receiver.getNumFrames();
+	for(unsigned int frameIndex=0;frameIndex<replayer.getNumFrames();++frameIndex)
+		{
+		frameFilter.receiveRawFrame(replayer.getDepthFrame(frameIndex));
+		receiver.waitForFrames(baseNumFrames+frameIndex+1);
+		}
+	}
+
+void runSettleBenchmark(const FilterSettings& settings,const DepthFrameReplayer& before,const DepthFrameReplayer& after,float tolerance) // Measures how many frames the frame filter needs to settle on a changed surface
+	{
+	if(after.getDepthFrameSize()[0]!=before.getDepthFrameSize()[0]||after.getDepthFrameSize()[1]!=before.getDepthFrameSize()[1])
+		throw std::runtime_error("Depth frame files have mismatching frame sizes");
+	size_t numPixels=size_t(before.getDepthFrameSize()[1])*size_t(before.getDepthFrameSize()[0]);
+	
+	/* Run a frame filter over both files to find the surface it settles on before and after the change: */
+	std::vector<float> beforeSurface,afterSurface;
+	{
+	FrameFilter* frameFilter=settings.createFrameFilter(before);
+	FilterReceiver receiver(true);
+	frameFilter->setOutputFrameFunction(Misc::createFunctionCall(&receiver,&FilterReceiver::receiveFilteredFrame));
+	filterFrames(before,*frameFilter,receiver);
+	beforeSurface=receiver.getLatestFrame();
+	filterFrames(after,*frameFilter,receiver);
+	afterSurface=receiver.getLatestFrame();
+	delete frameFilter;
+	}
+	
+	/* Run a fresh frame filter over both files again, and track when each pixel last left the settled surface and how often it jumped by more than the tolerance: */
+	std::vector<unsigned int> lastUnsettled(numPixels,0U);
+	std::vector<unsigned int> numChanges(numPixels,0U);
+	{
+	FrameFilter* frameFilter=settings.createFrameFilter(before);
+	FilterReceiver receiver(true);
+	frameFilter->setOutputFrameFunction(Misc::createFunctionCall(&receiver,&FilterReceiver::receiveFilteredFrame));
+	filterFrames(before,*frameFilter,receiver);
+	std::vector<float> previous=receiver.getLatestFrame();
+	for(unsigned int frameIndex=0;frameIndex<after.getNumFrames();++frameIndex)
+		{
+		frameFilter->receiveRawFrame(after.getDepthFrame(frameIndex));
+		receiver.waitForFrames(before.getNumFrames()+frameIndex+1);
+		const std::vector<float>& current=receiver.getLatestFrame();
+		for(size_t i=0;i<numPixels;++i)
+			{
+			if(Math::abs(current[i]-afterSurface[i])>tolerance)
+				lastUnsettled[i]=frameIndex+1;
+			if(Math::abs(current[i]-previous[i])>tolerance)
+				++numChanges[i];
+			}
+		previous=current;
+		}
+	delete frameFilter;
+	}
+	
+	/* Separate pixels whose surface changed from static pixels, ignoring pixels that are not stable in either surface: */
+	std::vector<unsigned int> settleFrames;
+	size_t numStaticPixels=0,numStaticChanges=0;
+	for(size_t i=0;i<numPixels;++i)
+		{
+		if(beforeSurface[i]==0.0f||afterSurface[i]==0.0f)
+			continue;
+		if(Math::abs(afterSurface[i]-beforeSurface[i])>tolerance)
+			settleFrames.push_back(lastUnsettled[i]);
+		else
+			{
+			++numStaticPixels;
+			numStaticChanges+=numChanges[i];
+			}
+		}
+	
+	/* Print the results: */
+	std::cout<<std::fixed<<std::setprecision(3);
+	std::cout<<"Settle benchmark: "<<settleFrames.size()<<" changed pixels, "<<numStaticPixels<<" static pixels, tolerance "<<tolerance<<std::endl;
+	if(!settleFrames.empty())
+		{
+		/* Sort the settle times and pick the nearest-rank percentiles: */
+		std::sort(settleFrames.begin(),settleFrames.end());
+		std::cout<<"Frames until changed pixels settle:";
+		static const double percentiles[3]={0.5,0.95,0.99};
+		static const char* percentileNames[3]={"p50","p95","p99"};
+		for(int i=0;i<3;++i)
+			std::cout<<' '<<percentileNames[i]<<' '<<settleFrames[size_t(percentiles[i]*double(settleFrames.size()-1)+0.5)];
+		std::cout<<" max "<<settleFrames.back()<<std::endl;
+		}
+	if(numStaticPixels>0&&after.getNumFrames()>0)
+		std::cout<<"Output jumps on static pixels: "<<double(numStaticChanges)*100.0/(double(numStaticPixels)*double(after.getNumFrames()))<<" per pixel per 100 frames"<<std::endl;
+	}
+
+const char* getTemporalFilterName(FrameFilter::TemporalFilterMode temporalFilterMode)
+	{
+	static const char* temporalFilterNames[5]={"Box","Median","EMA","Kalman","Adaptive"};
+	return temporalFilterNames[temporalFilterMode];
+	}
+
+const char* getFilterKernelName(FrameFilter::FilterKernel filterKernel)
+	{
+	static const char* filterKernelNames[4]={"Auto","Scalar","SSE41","AVX2"};
+	return filterKernelNames[filterKernel];
+	}
+
+Misc::UInt64 runThroughputBenchmark(const FilterSettings& settings,const DepthFrameReplayer& replayer,HandExtractor* handExtractor) // Feeds each frame to a new frame filter in order, waiting for the filtered result before feeding the next one, and prints timing statistics and the filtered frames' checksum
+	{
+	Size frameSize=replayer.getDepthFrameSize();
+	unsigned int numFrames=replayer.getNumFrames();
+	
+	/* Create a frame filter with the given settings: */
+	FrameFilter* frameFilter=settings.createFrameFilter(replayer);
+	FilterReceiver receiver(false);
+	frameFilter->setOutputFrameFunction(Misc::createFunctionCall(&receiver,&FilterReceiver::receiveFilteredFrame));
+	
+	double minFilterTime=0.0,maxFilterTime=0.0,totalFilterTime=0.0;
+	double totalHandTime=0.0;
+	size_t totalNumHands=0;
+	HandExtractor::HandList hands;
+	for(unsigned int frameIndex=0;frameIndex<numFrames;++frameIndex)
+		{
+		Kinect::FrameBuffer frame=replayer.getDepthFrame(frameIndex);
+		
+		/* Filter the frame: */
+		double filterStart=getMonotonicTime();
+		frameFilter->receiveRawFrame(frame);
+		receiver.waitForFrames(frameIndex+1);
+		double filterTime=getMonotonicTime()-filterStart;
+		if(frameIndex==0||minFilterTime>filterTime)
+			minFilterTime=filterTime;
+		if(frameIndex==0||maxFilterTime<filterTime)
+			maxFilterTime=filterTime;
+		totalFilterTime+=filterTime;
+		
+		if(handExtractor!=0)
+			{
+			/* Extract hands from the frame: */
+			double handStart=getMonotonicTime();
+			hands.clear();
+			handExtractor->extractHands(frame.getData<HandExtractor::DepthPixel>(),hands,0);
+			totalHandTime+=getMonotonicTime()-handStart;
+			totalNumHands+=hands.size();
+			}
+		}
+	
+	/* Print the results: */
+	std::cout<<std::fixed<<std::setprecision(3);
+	if(numFrames>0)
+		{
+		std::cout<<"Frame filter ("<<getTemporalFilterName(settings.temporalFilterMode)<<" temporal filter, "<<getFilterKernelName(frameFilter->getFilterKernel())<<" kernel): "<<totalFilterTime*1000.0/double(numFrames)<<" ms average, "<<minFilterTime*1000.0<<" ms min, "<<maxFilterTime*1000.0<<" ms max per frame, ";
+		std::cout<<frameFilter->getNumFilteredPixels()<<(frameFilter->isBinned()?" 2x2 bins":" pixels")<<" of "<<frameSize[1]*frameSize[0]<<" depth pixels filtered"<<std::endl;
+		}
+	if(handExtractor!=0&&numFrames>0)
+		std::cout<<"Hand extractor: "<<totalHandTime*1000.0/double(numFrames)<<" ms average per frame, "<<totalNumHands<<" hands found"<<std::endl;
+	Misc::UInt64 checksum=receiver.getChecksum();
+	std::cout<<"Filtered frame checksum: "<<std::hex<<std::setfill('0')<<std::setw(16)<<checksum<<std::setfill(' ')<<std::dec<<std::endl;
+	
+	delete frameFilter;
+	
+	return checksum;
+	}
+
+void runRealTimeBenchmark(const FilterSettings& settings,DepthFrameReplayer& replayer) // Streams all frames into a new frame filter at their recorded rate and prints the numbers of filtered and dropped frames
+	{
+	/* Create a frame filter with the given settings: */
+	FrameFilter* frameFilter=settings.createFrameFilter(replayer);
+	FilterReceiver receiver(false);
+	frameFilter->setOutputFrameFunction(Misc::createFunctionCall(&receiver,&FilterReceiver::receiveFilteredFrame));
+	
+	/* Stream the frames into the frame filter at their recorded rate: */
+	double startTime=getMonotonicTime();
+	replayer.startStreaming(0,Misc::createFunctionCall(frameFilter,&FrameFilter::receiveRawFrame),true,false);
+	replayer.waitForEndOfStream();
+	replayer.stopStreaming();
+	
+	/* Wait until the frame filter has processed all frames it accepted: */
+	receiver.waitForFrames(frameFilter->getNumReceivedFrames()-frameFilter->getNumDroppedFrames());
+	double elapsed=getMonotonicTime()-startTime;
+	
+	std::cout<<"Replayed "<<replayer.getNumFrames()<<" frames in "<<std::fixed<<std::setprecision(3)<<elapsed<<" s; ";
+	std::cout<<receiver.getNumFrames()<<" frames filtered, "<<frameFilter->getNumDroppedFrames()<<" frames dropped"<<std::endl;
+	
+	delete frameFilter;
+	}
+
+bool runStressTest(const FilterSettings& settings,const DepthFrameReplayer& replayer,unsigned int numStressFrames) // Feeds the given number of frames into a new frame filter back-to-back without waiting, and checks that every frame was either filtered or dropped and that the newest frame always wins
+	{
+	/* Create a frame filter with the given settings: */
+	FrameFilter* frameFilter=settings.createFrameFilter(replayer);
+	FilterReceiver receiver(false);
+	frameFilter->setOutputFrameFunction(Misc::createFunctionCall(&receiver,&FilterReceiver::receiveFilteredFrame));
+	
+	/* Feed the frames cyclically as fast as possible, numbering them by their time stamps: */
+	double startTime=getMonotonicTime();
+	for(unsigned int i=0;i<numStressFrames;++i)
+		{
+		Kinect::FrameBuffer frame=replayer.getDepthFrame(i%replayer.getNumFrames());
+		frame.timeStamp=double(i+1);
+		frameFilter->receiveRawFrame(frame);
+		}
+	double feedTime=getMonotonicTime()-startTime;
+	
+	/* Wait until the frame filter has processed all frames it did not drop: */
+	unsigned int numReceived=frameFilter->getNumReceivedFrames();
+	unsigned int numDropped=frameFilter->getNumDroppedFrames();
+	bool complete=receiver.waitForFrames(numReceived-numDropped,10.0);
+	
+	/* Give a frame filter that filtered more frames than expected a chance to deliver them: */
+	usleep(100000);
+	unsigned int numFiltered=receiver.getNumFrames();
+	
+	/* Check the frame accounting and the latest-frame-wins behavior: */
+	bool accounted=complete&&numFiltered+numDropped==numReceived;
+	bool latestFiltered=receiver.getLastTimeStamp()==double(numStressFrames);
+	bool inOrder=receiver.isInOrder();
+	std::cout<<"Stress test: fed "<<numReceived<<" frames in "<<std::fixed<<std::setprecision(3)<<feedTime*1000.0<<" ms; "<<numFiltered<<" frames filtered, "<<numDropped<<" frames dropped"<<std::endl;
+	std::cout<<"Received = filtered + dropped: "<<(accounted?"yes":"NO")<<", newest frame filtered: "<<(latestFiltered?"yes":"NO")<<", frames filtered in order: "<<(inOrder?"yes":"NO")<<std::endl;
+	
+	delete frameFilter;
+	
+	return accounted&&latestFiltered&&inOrder;
+	}
+
+bool runCompressionBenchmark(const DepthFrameReplayer& replayer,const char* compressFileName) // Compresses all raw depth frames into the given file, the first one using intra-frame and all following ones using inter-frame compression, prints the compression ratio and timing, and checks that the frames decompress losslessly
+	{
+	Size frameSize=replayer.getDepthFrameSize();
+	unsigned int numFrames=replayer.getNumFrames();
+	size_t frameBytes=size_t(frameSize[1])*size_t(frameSize[0])*sizeof(Pixel);
+	
+	/* Compress all frames into the given file: */
+	double compressTime=0.0;
+	{
+	IO::FilePtr file(IO::openFile(compressFileName,IO::File::WriteOnly));
+	for(unsigned int frameIndex=0;frameIndex<numFrames;++frameIndex)
+		{
+		Kinect::FrameBuffer frame=replayer.getDepthFrame(frameIndex);
+		double compressStart=getMonotonicTime();
+		if(frameIndex==0)
+			{
+			IntraFrameCompressor compressor(*file);
+			compressor.compressFrame(frameSize[0],frameSize[1],frame.getData<Pixel>());
+			}
+		else
+			{
+			Kinect::FrameBuffer previousFrame=replayer.getDepthFrame(frameIndex-1);
+			InterFrameCompressor compressor(*file);
+			compressor.compressFrame(frameSize[0],frameSize[1],previousFrame.getData<Pixel>(),frame.getData<Pixel>());
+			}
+		compressTime+=getMonotonicTime()-compressStart;
+		}
+	}
+	
+	/* Determine the size of the compressed stream: */
+	struct stat compressStat;
+	if(stat(compressFileName,&compressStat)!=0)
+		throw std::runtime_error("Unable to determine size of compressed depth frame file");
+	size_t compressedBytes=size_t(compressStat.st_size);
+	
+	/* Decompress all frames from the file and compare them to the originals: */
+	double decompressTime=0.0;
+	bool lossless=true;
+	{
+	IO::FilePtr file(IO::openFile(compressFileName,IO::File::ReadOnly));
+	std::vector<Pixel> frames[2];
+	for(int i=0;i<2;++i)
+		frames[i].resize(size_t(frameSize[1])*size_t(frameSize[0]));
+	for(unsigned int frameIndex=0;frameIndex<numFrames;++frameIndex)
+		{
+		std::vector<Pixel>& previous=frames[(frameIndex+1)%2];
+		std::vector<Pixel>& current=frames[frameIndex%2];
+		double decompressStart=getMonotonicTime();
+		if(frameIndex==0)
+			{
+			IntraFrameDecompressor decompressor(*file);
+			decompressor.decompressFrame(frameSize[0],frameSize[1],&current.front());
+			}
+		else
+			{
+			InterFrameDecompressor decompressor(*file);
+			decompressor.decompressFrame(frameSize[0],frameSize[1],&previous.front(),&current.front());
+			}
+		decompressTime+=getMonotonicTime()-decompressStart;
+		
+		Kinect::FrameBuffer frame=replayer.getDepthFrame(frameIndex);
+		if(memcmp(&current.front(),frame.getData<Pixel>(),frameBytes)!=0)
+			lossless=false;
+		}
+	}
+	
+	/* Print the results: */
+	std::cout<<std::fixed<<std::setprecision(3);
+	if(numFrames>0)
+		{
+		size_t rawBytes=frameBytes*size_t(numFrames);
+		std::cout<<"Compressed "<<numFrames<<" frames from "<<rawBytes<<" to "<<compressedBytes<<" bytes (ratio "<<double(rawBytes)/double(compressedBytes)<<":1) into "<<compressFileName<<std::endl;
+		std::cout<<"Compression: "<<compressTime*1000.0/double(numFrames)<<" ms average per frame, decompression: "<<decompressTime*1000.0/double(numFrames)<<" ms average per frame"<<std::endl;
+		}
+	std::cout<<"Decompressed frames are "<<(lossless?"bit-identical":"NOT bit-identical")<<" to the replayed frames"<<std::endl;
+	
+	return lossless;
+	}
+
+void printUsage(void)
+	{
+	std::cout<<"Usage: SARndboxReplay <depth frame file name> [option 1] ... [option n]"<<std::endl;
+	std::cout<<"  <depth frame file name>"<<std::endl;
+	std::cout<<"     Name of a depth frame file recorded by SARndbox's -rec option"<<std::endl;
+	std::cout<<"  Options:"<<std::endl;
+	std::cout<<"  -h"<<std::endl;
+	std::cout<<"     Prints this help message"<<std::endl;
+	std::cout<<"  -rt"<<std::endl;
+	std::cout<<"     Replays frames at their recorded rate and reports dropped frames"<<std::endl;
+	std::cout<<"     instead of filtering every frame to completion in order"<<std::endl;
+	std::cout<<"  -stress <num frames>"<<std::endl;
+	std::cout<<"     Feeds the given number of frames into the frame filter back-to-back,"<<std::endl;
+	std::cout<<"     faster than it can filter them, and checks that every frame is either"<<std::endl;
+	std::cout<<"     filtered or counted as dropped, and that the newest frame is filtered"<<std::endl;
+	std::cout<<"  -tf <temporal filter>"<<std::endl;
+	std::cout<<"     Selects the frame filter's temporal filter algorithm"<<std::endl;
+	std::cout<<"     (Box, Median, EMA, Kalman, Adaptive, or All to benchmark all"<<std::endl;
+	std::cout<<"     algorithms in turn)"<<std::endl;
+	std::cout<<"     Default: Box"<<std::endl;
+	std::cout<<"  -nas <num averaging slots>"<<std::endl;
+	std::cout<<"     Sets the number of averaging slots in the frame filter"<<std::endl;
+	std::cout<<"     Default: 30"<<std::endl;
+	std::cout<<"  -nft <num filter threads>"<<std::endl;
+	std::cout<<"     Sets the number of threads used by the frame filter"<<std::endl;
+	std::cout<<"     Default: 1"<<std::endl;
+	std::cout<<"  -sp <min num samples> <max variance>"<<std::endl;
+	std::cout<<"     Sets the frame filter parameters minimum number of valid samples"<<std::endl;
+	std::cout<<"     and maximum sample variance before convergence"<<std::endl;
+	std::cout<<"     Default: 10 2"<<std::endl;
+	std::cout<<"  -he <hysteresis envelope>"<<std::endl;
+	std::cout<<"     Sets the size of the hysteresis envelope used for jitter removal"<<std::endl;
+	std::cout<<"     Default: 0.1"<<std::endl;
+	std::cout<<"  -mp <motion threshold> <min num samples after motion>"<<std::endl;
+	std::cout<<"     Sets the adaptive filter's motion detection threshold in raw depth"<<std::endl;
+	std::cout<<"     units, and its minimum number of valid samples after motion"<<std::endl;
+	std::cout<<"     Default: 5 3"<<std::endl;
+	std::cout<<"  -kernel <kernel>"<<std::endl;
+	std::cout<<"     Forces the box temporal filter's implementation (Auto, Scalar, SSE41,"<<std::endl;
+	std::cout<<"     AVX2, or All to run and compare all supported implementations in turn)"<<std::endl;
+	std::cout<<"     Default: Auto"<<std::endl;
+	std::cout<<"  -bf"<<std::endl;
+	std::cout<<"     Filters depth frames at half resolution in bins of 2x2 pixels"<<std::endl;
+	std::cout<<"  -roi <x> <y> <width> <height>"<<std::endl;
+	std::cout<<"     Only filters the given rectangle of depth pixels"<<std::endl;
+	std::cout<<"  -settle <depth frame file name> <tolerance>"<<std::endl;
+	std::cout<<"     Replays the given second depth frame file, recorded after changing"<<std::endl;
+	std::cout<<"     the sand surface, after the first one, and reports how many frames"<<std::endl;
+	std::cout<<"     the frame filter takes to settle within the given tolerance on the"<<std::endl;
+	std::cout<<"     changed surface, and how often it jumps by more than the tolerance"<<std::endl;
+	std::cout<<"     on unchanged pixels"<<std::endl;
+	std::cout<<"  -hands"<<std::endl;
+	std::cout<<"     Runs the hand extractor on each frame in addition to the frame filter"<<std::endl;
+	std::cout<<"  -compress <compressed file name>"<<std::endl;
+	std::cout<<"     Routes the replayed raw depth frames through the intra- and inter-frame"<<std::endl;
+	std::cout<<"     compressors into the given file instead of the frame filter, reports"<<std::endl;
+	std::cout<<"     compression ratio and timing, and checks lossless decompression"<<std::endl;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Parse the command line: */
+	const char* frameFileName=0;
+	bool realTime=false;
+	unsigned int numStressFrames=0;
+	FilterSettings settings;
+	bool extractHands=false;
+	const char* settleFileName=0;
+	float settleTolerance=1.0f;
+	const char* compressFileName=0;
+	std::vector<FrameFilter::TemporalFilterMode> temporalFilterModes;
+	std::vector<FrameFilter::FilterKernel> filterKernels;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"h")==0)
+				{
+				printUsage();
+				return 0;
+				}
+			else if(strcasecmp(argv[i]+1,"rt")==0)
+				realTime=true;
+			else if(strcasecmp(argv[i]+1,"stress")==0&&i+1<argc)
+				{
+				++i;
+				numStressFrames=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"tf")==0&&i+1<argc)
+				{
+				++i;
+				temporalFilterModes.clear();
+				if(strcasecmp(argv[i],"Box")==0)
+					temporalFilterModes.push_back(FrameFilter::BoxFilter);
+				else if(strcasecmp(argv[i],"Median")==0)
+					temporalFilterModes.push_back(FrameFilter::MedianFilter);
+				else if(strcasecmp(argv[i],"EMA")==0)
+					temporalFilterModes.push_back(FrameFilter::EMAFilter);
+				else if(strcasecmp(argv[i],"Kalman")==0)
+					temporalFilterModes.push_back(FrameFilter::KalmanFilter);
+				else if(strcasecmp(argv[i],"Adaptive")==0)
+					temporalFilterModes.push_back(FrameFilter::AdaptiveFilter);
+				else if(strcasecmp(argv[i],"All")==0)
+					{
+					temporalFilterModes.push_back(FrameFilter::BoxFilter);
+					temporalFilterModes.push_back(FrameFilter::MedianFilter);
+					temporalFilterModes.push_back(FrameFilter::EMAFilter);
+					temporalFilterModes.push_back(FrameFilter::KalmanFilter);
+					temporalFilterModes.push_back(FrameFilter::AdaptiveFilter);
+					}
+				else
+					std::cerr<<"Ignoring unrecognized temporal filter "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"nas")==0&&i+1<argc)
+				{
+				++i;
+				settings.numAveragingSlots=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"nft")==0&&i+1<argc)
+				{
+				++i;
+				settings.numFilterThreads=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"sp")==0&&i+2<argc)
+				{
+				++i;
+				settings.minNumSamples=atoi(argv[i]);
+				++i;
+				settings.maxVariance=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"he")==0&&i+1<argc)
+				{
+				++i;
+				settings.hysteresis=float(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"mp")==0&&i+2<argc)
+				{
+				++i;
+				settings.motionThreshold=float(atof(argv[i]));
+				++i;
+				settings.motionMinNumSamples=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"kernel")==0&&i+1<argc)
+				{
+				++i;
+				filterKernels.clear();
+				if(strcasecmp(argv[i],"Auto")==0)
+					filterKernels.push_back(FrameFilter::AutoKernel);
+				else if(strcasecmp(argv[i],"Scalar")==0)
+					filterKernels.push_back(FrameFilter::ScalarKernel);
+				else if(strcasecmp(argv[i],"SSE41")==0)
+					filterKernels.push_back(FrameFilter::SSE41Kernel);
+				else if(strcasecmp(argv[i],"AVX2")==0)
+					filterKernels.push_back(FrameFilter::AVX2Kernel);
+				else if(strcasecmp(argv[i],"All")==0)
+					{
+					filterKernels.push_back(FrameFilter::ScalarKernel);
+					filterKernels.push_back(FrameFilter::SSE41Kernel);
+					filterKernels.push_back(FrameFilter::AVX2Kernel);
+					}
+				else
+					std::cerr<<"Ignoring unrecognized temporal filter kernel "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"bf")==0)
+				settings.binned=true;
+			else if(strcasecmp(argv[i]+1,"roi")==0&&i+4<argc)
+				{
+				settings.haveROI=true;
+				for(int j=0;j<2;++j)
+					{
+					++i;
+					settings.roi.offset[j]=atoi(argv[i]);
+					}
+				for(int j=0;j<2;++j)
+					{
+					++i;
+					settings.roi.size[j]=(unsigned int)(atoi(argv[i]));
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"settle")==0&&i+2<argc)
+				{
+				++i;
+				settleFileName=argv[i];
+				++i;
+				settleTolerance=float(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"hands")==0)
+				extractHands=true;
+			else if(strcasecmp(argv[i]+1,"compress")==0&&i+1<argc)
+				{
+				++i;
+				compressFileName=argv[i];
+				}
+			else
+				std::cerr<<"Ignoring unrecognized command line switch "<<argv[i]<<std::endl;
+			}
+		else if(frameFileName==0)
+			frameFileName=argv[i];
+		else
+			std::cerr<<"Ignoring extra command line argument "<<argv[i]<<std::endl;
+		}
+	if(frameFileName==0)
+		{
+		std::cerr<<"No depth frame file name provided"<<std::endl;
+		printUsage();
+		return 1;
+		}
+	if(temporalFilterModes.empty())
+		temporalFilterModes.push_back(FrameFilter::BoxFilter);
+	if(filterKernels.empty())
+		filterKernels.push_back(FrameFilter::AutoKernel);
+	settings.temporalFilterMode=temporalFilterModes.front();
+	
+	try
+		{
+		/* Open the depth frame file: */
+		DepthFrameReplayer replayer(frameFileName);
+		Size frameSize=replayer.getDepthFrameSize();
+		unsigned int numFrames=replayer.getNumFrames();
+		std::cout<<"Replaying "<<numFrames<<" depth frames of size "<<frameSize[0]<<" x "<<frameSize[1]<<" from "<<frameFileName<<std::endl;
+		
+		if(compressFileName!=0)
+			{
+			/* Run the compression benchmark instead of the throughput benchmark: */
+			return runCompressionBenchmark(replayer,compressFileName)?0:1;
+			}
+		
+		if(settleFileName!=0)
+			{
+			/* Run the settle benchmark instead of the throughput benchmark: */
+			DepthFrameReplayer afterReplayer(settleFileName);
+			std::cout<<"Replaying "<<afterReplayer.getNumFrames()<<" changed depth frames from "<<settleFileName<<std::endl;
+			runSettleBenchmark(settings,replayer,afterReplayer,settleTolerance);
+			return 0;
+			}
+		
+		if(numStressFrames>0&&numFrames>0)
+			{
+			/* Run the stress test instead of the throughput benchmark: */
+			settings.filterKernel=filterKernels.front();
+			return runStressTest(settings,replayer,numStressFrames)?0:1;
+			}
+		
+		if(realTime)
+			{
+			/* Stream the frames into a frame filter at their recorded rate: */
+			settings.filterKernel=filterKernels.front();
+			runRealTimeBenchmark(settings,replayer);
+			return 0;
+			}
+		
+		/* Create a hand extractor if requested: */
+		HandExtractor* handExtractor=0;
+		if(extractHands)
+			handExtractor=new HandExtractor(frameSize,replayer.getPixelDepthCorrection(),replayer.getDepthProjection());
+		
+		/* Run the throughput benchmark with each requested temporal filter algorithm and kernel: */
+		bool checksumsMatch=true;
+		for(std::vector<FrameFilter::TemporalFilterMode>::iterator tfmIt=temporalFilterModes.begin();tfmIt!=temporalFilterModes.end();++tfmIt)
+			{
+			settings.temporalFilterMode=*tfmIt;
+			bool haveReferenceChecksum=false;
+			Misc::UInt64 referenceChecksum=0;
+			bool modeChecksumsMatch=true;
+			unsigned int numRuns=0;
+			for(std::vector<FrameFilter::FilterKernel>::iterator fkIt=filterKernels.begin();fkIt!=filterKernels.end();++fkIt)
+				{
+				if(!FrameFilter::isFilterKernelSupported(settings.temporalFilterMode,settings.numAveragingSlots,*fkIt))
+					{
+					std::cout<<"Skipping unsupported "<<getFilterKernelName(*fkIt)<<" kernel for "<<getTemporalFilterName(*tfmIt)<<" temporal filter"<<std::endl;
+					continue;
+					}
+				settings.filterKernel=*fkIt;
+				Misc::UInt64 checksum=runThroughputBenchmark(settings,replayer,handExtractor);
+				++numRuns;
+				
+				/* Compare the filtered frames against those of the first kernel: */
+				if(!haveReferenceChecksum)
+					{
+					referenceChecksum=checksum;
+					haveReferenceChecksum=true;
+					}
+				else if(checksum!=referenceChecksum)
+					modeChecksumsMatch=false;
+				}
+			if(numRuns>1)
+				std::cout<<"Filtered frames of all "<<getTemporalFilterName(*tfmIt)<<" temporal filter kernels are "<<(modeChecksumsMatch?"bit-identical":"NOT bit-identical")<<std::endl;
+			checksumsMatch=checksumsMatch&&modeChecksumsMatch;
+			}
+		
+		delete handExtractor;
+		
+		if(!checksumsMatch)
+			return 1;
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"SARndboxReplay: Terminated due to exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	
+	return 0;
+	}
@@ -1,6 +1,6 @@
 /***********************************************************************
 Sandbox - Vrui application to drive an augmented reality sandbox.
-Copyright (c) 2012-2025 Oliver Kreylos
+Copyright (c) 2012-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -109,19 +109,162 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "LocalWaterTool.h"
 #include "DEMTool.h"
 #include "BathymetrySaverTool.h"
+#include "DepthFrameRecorder.h"
+#include "LatencyMonitor.h"
+#include "WaterTelemetry.h"
+#include "WaterCheckpoint.h"
+#include "WaterCheckpointStreamer.h"
 
 #include "Config.h"
 
 // DEBUGGING
 // #include <Realtime/Time.h>
 
+/*************************************
+Methods of class Sandbox::GridRequest:
+*************************************/
+
+bool Sandbox::GridRequest::requestGrids(unsigned int gridMask,Sandbox::GridRequest::CallbackFunction callback,void* callbackData)
+	{
+	Threads::Mutex::Lock lock(mutex);
+	
+	/* Extend an already queued request from the same requester: */
+	for(RequestList::iterator rIt=queuedRequests.begin();rIt!=queuedRequests.end();++rIt)
+		if(rIt->callback==callback&&rIt->callbackData==callbackData)
+			{
+			rIt->gridMask|=gridMask;
+			return false;
+			}
+	
+	/* Queue a new request: */
+	Request request;
+	request.gridMask=gridMask;
+	request.callback=callback;
+	request.callbackData=callbackData;
+	queuedRequests.push_back(request);
+	return true;
+	}
+
+void Sandbox::GridRequest::cancelRequests(void* callbackData)
+	{
+	{
+	Threads::Mutex::Lock lock(mutex);
+	
+	/* Remove the requester's queued requests: */
+	for(RequestList::iterator rIt=queuedRequests.begin();rIt!=queuedRequests.end();)
+		{
+		if(rIt->callbackData==callbackData)
+			rIt=queuedRequests.erase(rIt);
+		else
+			++rIt;
+		}
+	
+	/* Remove the requester's requests from all batches in flight, including a batch whose callbacks are being called: */
+	for(std::vector<Batch>::iterator bIt=activeBatches.begin();bIt!=activeBatches.end();++bIt)
+		for(RequestList::iterator rIt=bIt->requests.begin();rIt!=bIt->requests.end();)
+			{
+			if(rIt->callbackData==callbackData)
+				rIt=bIt->requests.erase(rIt);
+			else
+				++rIt;
+			}
+	}
+	
+	/* Wait until a callback that was already removed from its batch returns: */
+	Threads::Mutex::Lock callbackLock(callbackMutex);
+	}
+
+unsigned int Sandbox::GridRequest::startBatch(unsigned int& gridMask)
+	{
+	Threads::Mutex::Lock lock(mutex);
+	
+	if(queuedRequests.empty())
+		return 0;
+	
+	/* Coalesce all queued requests into a single batch served by a single read-back: */
+	++lastBatchId;
+	if(lastBatchId==0)
+		++lastBatchId;
+	activeBatches.push_back(Batch());
+	Batch& batch=activeBatches.back();
+	batch.id=lastBatchId;
+	batch.requests.swap(queuedRequests);
+	
+	/* Read back the union of all requested grids: */
+	gridMask=0x0U;
+	for(RequestList::iterator rIt=batch.requests.begin();rIt!=batch.requests.end();++rIt)
+		gridMask|=rIt->gridMask;
+	
+	return batch.id;
+	}
+
+void Sandbox::GridRequest::requeueBatch(unsigned int batchId)
+	{
+	Threads::Mutex::Lock lock(mutex);
+	
+	/* Find the batch of the given identifier: */
+	for(std::vector<Batch>::iterator bIt=activeBatches.begin();bIt!=activeBatches.end();++bIt)
+		if(bIt->id==batchId)
+			{
+			/* Move the batch's requests back into the queue, merging them with newer requests from the same requesters: */
+			for(RequestList::iterator brIt=bIt->requests.begin();brIt!=bIt->requests.end();++brIt)
+				{
+				RequestList::iterator rIt;
+				for(rIt=queuedRequests.begin();rIt!=queuedRequests.end()&&(rIt->callback!=brIt->callback||rIt->callbackData!=brIt->callbackData);++rIt)
+					;
+				if(rIt!=queuedRequests.end())
+					rIt->gridMask|=brIt->gridMask;
+				else
+					queuedRequests.push_back(*brIt);
+				}
+			
+			activeBatches.erase(bIt);
+			break;
+			}
+	}
+
+void Sandbox::GridRequest::finishBatch(unsigned int batchId,const GridReadbackPtr& grids)
+	{
+	Threads::Mutex::Lock callbackLock(callbackMutex);
+	
+	/* Call the callbacks of the batch's requests one at a time, so that requests cancelled in the meantime are skipped: */
+	while(true)
+		{
+		/* Remove the next request from the batch, or the batch itself once it is empty: */
+		Request request;
+		{
+		Threads::Mutex::Lock lock(mutex);
+		std::vector<Batch>::iterator bIt;
+		for(bIt=activeBatches.begin();bIt!=activeBatches.end()&&bIt->id!=batchId;++bIt)
+			;
+		if(bIt==activeBatches.end())
+			break;
+		if(bIt->requests.empty())
+			{
+			activeBatches.erase(bIt);
+			break;
+			}
+		request=bIt->requests.front();
+		bIt->requests.erase(bIt->requests.begin());
+		}
+		
+		/* Call the request's callback outside the request lock, so that it can queue new requests: */
+		(*request.callback)(grids,request.callbackData);
+		}
+	}
+
 /**********************************
 Methods of class Sandbox::DataItem:
 **********************************/
 
-Sandbox::DataItem::DataItem(void)
-	:waterTableTime(0.0),
-	 shadowFramebufferObject(0),shadowDepthTextureObject(0)
+Sandbox::DataItem::DataItem(Sandbox::GridRequest& sGridRequest)
+	:waterTableTime(0.0),waterTimeStep(0.0f),
+	 waterScheduler(0),
+	 shadowFramebufferObject(0),shadowDepthTextureObject(0),
+	 renderedDepthImageVersion(0),
+	 restoredWaterCheckpointVersion(0),
+	 gridRequest(sGridRequest),
+	 numPendingGridBatches(0)
 	{
 	/* Initialize all required extensions, will throw exceptions if any are unsupported: */
 	GLARBDepthTexture::initExtension();
@@ -137,6 +280,13 @@ Sandbox::DataItem::~DataItem(void)
 	/* Delete all buffers and texture objects: */
 	glDeleteFramebuffersEXT(1,&shadowFramebufferObject);
 	glDeleteTextures(1,&shadowDepthTextureObject);
+	
+	/* Delete the water simulation scheduler: */
+	delete waterScheduler;
+	
+	/* Hand the requests of grid request batches whose read-backs will never complete in this OpenGL context back to the queue: */
+	for(unsigned int i=0;i<numPendingGridBatches;++i)
+		gridRequest.requeueBatch(pendingGridBatchIds[i]);
 	}
 
 /****************************************
@@ -227,23 +377,75 @@ void Sandbox::RenderSettings::loadHeightMap(const char* heightMapName)
 		}
 	}
 
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+void addRect(Rect& rect,const Rect& other)
+	{
+	/* Grow the rectangle to contain the other rectangle, ignoring empty rectangles: */
+	if(other.size[0]==0||other.size[1]==0)
+		return;
+	if(rect.size[0]==0||rect.size[1]==0)
+		{
+		rect=other;
+		return;
+		}
+	
+	for(int i=0;i<2;++i)
+		{
+		int end=Math::max(rect.offset[i]+int(rect.size[i]),other.offset[i]+int(other.size[i]));
+		rect.offset[i]=Math::min(rect.offset[i],other.offset[i]);
+		rect.size[i]=(unsigned int)(end-rect.offset[i]);
+		}
+	}
+
+}
+
 /************************
 Methods of class Sandbox:
 ************************/
 
 void Sandbox::rawDepthFrameDispatcher(const Kinect::FrameBuffer& frameBuffer)
 	{
+	/* Register the frame's arrival with the latency monitor: */
+	latencyMonitor->frameArrived(frameBuffer.timeStamp,LatencyMonitor::getTime());
+	
 	/* Pass the received frame to the frame filter and the hand extractor: */
 	if(frameFilter!=0&&!pauseUpdates)
 		frameFilter->receiveRawFrame(frameBuffer);
 	if(handExtractor!=0)
 		handExtractor->receiveRawFrame(frameBuffer);
+	if(depthFrameRecorder!=0)
+		depthFrameRecorder->receiveRawDepthFrame(frameBuffer);
+	
+	latencyMonitor->frameDispatched(frameBuffer.timeStamp,LatencyMonitor::getTime());
+	}
+
+void Sandbox::rawColorFrameDispatcher(const Kinect::FrameBuffer& frameBuffer)
+	{
+	/* Pass the received frame to the property grid creator and the depth frame recorder: */
+	if(propertyGridCreator!=0)
+		propertyGridCreator->receiveRawFrame(frameBuffer);
+	if(depthFrameRecorder!=0)
+		depthFrameRecorder->receiveRawColorFrame(frameBuffer);
 	}
 
 void Sandbox::receiveFilteredFrame(const Kinect::FrameBuffer& frameBuffer)
 	{
+	latencyMonitor->frameFiltered(frameBuffer.timeStamp,LatencyMonitor::getTime());
+	
+	{
+	Threads::Mutex::Lock filteredFramesLock(filteredFramesMutex);
+	
+	/* Add the new frame's changed pixels to those of all frames posted since the most recently locked one, as the foreground thread might skip frames: */
+	addRect(filteredFramesDirtyRect,frameFilter->getDirtyRect());
+	
 	/* Put the new frame into the frame input buffer: */
 	filteredFrames.postNewValue(frameBuffer);
+	}
 	
 	/* Wake up the foreground thread: */
 	Vrui::requestUpdate();
@@ -269,78 +471,98 @@ void Sandbox::toggleDEM(DEM* dem)
 			rsIt->surfaceRenderer->setDem(activeDem);
 	}
 
-void Sandbox::renderRainDisk(const Point& center,Scalar radius,GLfloat strength) const
+void Sandbox::addRainDisks(WaterDiskList& waterDisks) const
+	{
+	/* Add a rain disk approximating each hand in the most recent extracted hand list: */
+	if(handExtractor!=0)
+		for(HandExtractor::HandList::const_iterator hIt=handExtractor->getLockedExtractedHands().begin();hIt!=handExtractor->getLockedExtractedHands().end();++hIt)
+			waterDisks.push_back(WaterDisk(hIt->center,hIt->radius*Scalar(0.75),GLfloat(rainStrength/waterSpeed)));
+	}
+
+unsigned int Sandbox::runWaterSimulationSteps(GLfloat& totalTimeStep,GLContextData& contextData,TextureTracker& textureTracker) const
 	{
-	/* Create a local coordinate frame to render rain disks: */
-	Vector x=waterTable->getBaseTransform().inverseTransform(Vector(1,0,0));
-	Vector y=waterTable->getBaseTransform().inverseTransform(Vector(0,1,0));
-	
-	/* Set up a disk with smooth decay around the edge: */
-	int numSegments=32;
-	Scalar fudge=Math::sqrt(Math::sqr(waterTable->getCellSize()[0])+Math::sqr(waterTable->getCellSize()[1]))*Scalar(2);
-	Scalar inner=Math::max(radius-fudge*Scalar(0.5),Scalar(0));
-	Scalar outer=radius+fudge*Scalar(0.5);
-	
-	/* Render the inner disk: */
-	glBegin(GL_POLYGON);
-	glVertexAttrib1fARB(1,strength);
-	for(int i=0;i<numSegments;++i)
+	// DEBUGGING
+	// std::cout<<totalTimeStep<<',';
+	// Realtime::TimePointMonotonic timer;
+	
+	unsigned int numSteps=0;
+	while(numSteps<waterMaxSteps&&totalTimeStep>1.0e-8f)
 		{
-		Scalar angle=Scalar(2)*Math::Constants<Scalar>::pi*Scalar(i)/Scalar(numSegments);
-		glVertex(center+x*(Math::cos(angle)*inner)+y*(Math::sin(angle)*inner));
+		/* Run with a self-determined time step to maintain stability: */
+		waterTable->setMaxStepSize(totalTimeStep);
+		GLfloat timeStep=waterTable->runSimulationStep(false,contextData,textureTracker);
+		totalTimeStep-=timeStep;
+		++numSteps;
 		}
-	glEnd();
-	
-	/* Render the smooth edge: */
-	glBegin(GL_QUAD_STRIP);
-	glVertexAttrib1fARB(1,0.0f);
-	glVertex(center+x*outer);
-	glVertexAttrib1fARB(1,strength);
-	glVertex(center+x*inner);
-	for(int i=1;i<numSegments;++i)
+	
+	// DEBUGGING
+	// double elapsed(timer.setAndDiff());
+	// std::cout<<numSteps<<','<<elapsed<<','<<elapsed/numSteps<<std::endl;
+	
+	GLfloat timeDeficit=0.0f;
+	#if 0
+	if(totalTimeStep>1.0e-8f)
 		{
-		Scalar angle=Scalar(2)*Math::Constants<Scalar>::pi*Scalar(i)/Scalar(numSegments);
-		Scalar c=Math::cos(angle);
-		Scalar s=Math::sin(angle);
-		glVertexAttrib1fARB(1,0.0f);
-		glVertex(center+x*(c*outer)+y*(s*outer));
-		glVertexAttrib1fARB(1,strength);
-		glVertex(center+x*(c*inner)+y*(s*inner));
+		std::cout<<'.'<<std::flush;
+		/* Force the final step to avoid simulation slow-down: */
+		waterTable->setMaxStepSize(totalTimeStep);
+		GLfloat timeStep=waterTable->runSimulationStep(true,contextData,textureTracker);
+		totalTimeStep-=timeStep;
+		++numSteps;
 		}
-	glVertexAttrib1fARB(1,0.0f);
-	glVertex(center+x*outer);
-	glVertexAttrib1fARB(1,strength);
-	glVertex(center+x*inner);
-	glEnd();
+	#elif 1
+	if(totalTimeStep>1.0e-8f)
+		{
+		std::cout<<"Ran out of time by "<<totalTimeStep<<std::endl;
+		
+		/* Drop the remaining time instead of carrying it over, to not fall further behind: */
+		timeDeficit=totalTimeStep;
+		totalTimeStep=0.0f;
+		}
+	#endif
+	
+	/* Log the number of steps and the dropped simulation time: */
+	waterTelemetry->simulationRun(Vrui::getApplicationTime(),numSteps,timeDeficit);
+	
+	return numSteps;
 	}
 
-void Sandbox::addWater(GLContextData& contextData) const
+void Sandbox::requestWaterCheckpoint(const std::string& fileName)
 	{
-	/* Check if the most recent rain object list is not empty: */
-	if(handExtractor!=0&&!handExtractor->getLockedExtractedHands().empty())
+	Threads::Mutex::Lock waterCheckpointLock(waterCheckpointMutex);
+	
+	/* Replace any previous request that has not been picked up yet: */
+	requestedWaterCheckpointFileName=fileName;
+	}
+
+void Sandbox::restoreWaterCheckpoint(WaterCheckpoint* checkpoint)
+	{
+	try
 		{
-		/* Render all rain objects into the water table: */
-		glPushAttrib(GL_ENABLE_BIT);
-		glDisable(GL_CULL_FACE);
-		
-		/* Create a local coordinate frame to render rain disks: */
-		Vector z=waterTable->getBaseTransform().inverseTransform(Vector(0,0,1));
-		Vector x=Geometry::normal(z);
-		Vector y=Geometry::cross(z,x);
-		x.normalize();
-		y.normalize();
-		
-		GLfloat rain=rainStrength/waterSpeed;
-		glVertexAttrib1fARB(1,rain);
-		
-		for(HandExtractor::HandList::const_iterator hIt=handExtractor->getLockedExtractedHands().begin();hIt!=handExtractor->getLockedExtractedHands().end();++hIt)
-			{
-			/* Render a rain disk approximating the hand: */
-			renderRainDisk(hIt->center,hIt->radius*Scalar(0.75),rainStrength/waterSpeed);
-			}
-		
-		glPopAttrib();
+		/* Restore the simulation parameters, which also checks the checkpoint's grid size: */
+		waterTable->restoreCheckpointParameters(*checkpoint);
 		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Cannot restore water checkpoint due to exception "<<err.what()<<std::endl;
+		delete checkpoint;
+		return;
+		}
+	
+	/* Update the water control dialog to reflect the restored parameters: */
+	if(snowLineSlider!=0)
+		snowLineSlider->setValue(waterTable->getSnowLine());
+	if(snowMeltSlider!=0)
+		snowMeltSlider->setValue(waterTable->getSnowMelt());
+	if(waterModeRadioBox!=0)
+		waterModeRadioBox->setSelectedToggle(waterTable->getMode()==WaterTable2::Engineering?1:0);
+	if(waterAttenuationSlider!=0)
+		waterAttenuationSlider->setValue(1.0-waterTable->getAttenuation());
+	
+	/* Schedule the checkpoint's simulation state to be restored in all OpenGL contexts: */
+	delete restoredWaterCheckpoint;
+	restoredWaterCheckpoint=checkpoint;
+	++restoredWaterCheckpointVersion;
 	}
 
 void Sandbox::pauseUpdatesCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData)
@@ -512,12 +734,27 @@ GLMotif::PopupWindow* Sandbox::createWaterControlDialog(void)
 	GLMotif::Margin* frameRateMargin=new GLMotif::Margin("FrameRateMargin",waterControlDialog,false);
 	frameRateMargin->setAlignment(GLMotif::Alignment::LEFT);
 	
-	frameRateTextField=new GLMotif::TextField("FrameRateTextField",frameRateMargin,8);
+	GLMotif::RowColumn* frameRateBox=new GLMotif::RowColumn("FrameRateBox",frameRateMargin,false);
+	frameRateBox->setOrientation(GLMotif::RowColumn::HORIZONTAL);
+	frameRateBox->setPacking(GLMotif::RowColumn::PACK_TIGHT);
+	frameRateBox->setNumMinorWidgets(1);
+	
+	frameRateTextField=new GLMotif::TextField("FrameRateTextField",frameRateBox,8);
 	frameRateTextField->setFieldWidth(7);
 	frameRateTextField->setPrecision(2);
 	frameRateTextField->setFloatFormat(GLMotif::TextField::FIXED);
 	frameRateTextField->setValue(0.0);
 	
+	new GLMotif::Label("ActiveWaterTilesLabel",frameRateBox,"Active %");
+	
+	activeWaterTilesTextField=new GLMotif::TextField("ActiveWaterTilesTextField",frameRateBox,6);
+	activeWaterTilesTextField->setFieldWidth(5);
+	activeWaterTilesTextField->setPrecision(1);
+	activeWaterTilesTextField->setFloatFormat(GLMotif::TextField::FIXED);
+	activeWaterTilesTextField->setValue(100.0);
+	
+	frameRateBox->manageChild();
+	
 	frameRateMargin->manageChild();
 	
 	new GLMotif::Label("WaterModeLabel",waterControlDialog,"Water Mode");
@@ -625,6 +862,11 @@ void printUsage(void)
 	std::cout<<"  -f <frame file name prefix>"<<std::endl;
 	std::cout<<"     Reads a pre-recorded 3D video stream from a pair of color/depth files of"<<std::endl;
 	std::cout<<"     the given file name prefix"<<std::endl;
+	std::cout<<"  -rec <depth frame file name>"<<std::endl;
+	std::cout<<"     Records all raw depth frames received from the 3D camera into a depth"<<std::endl;
+	std::cout<<"     frame file of the given name, for offline replay with SARndboxReplay"<<std::endl;
+	std::cout<<"  -recColor"<<std::endl;
+	std::cout<<"     Records the most recent raw color frame along with each raw depth frame"<<std::endl;
 	std::cout<<"  -s <scale factor>"<<std::endl;
 	std::cout<<"     Scale factor from real sandbox to simulated terrain"<<std::endl;
 	std::cout<<"     Default: 100.0 (1:100 scale, 1cm in sandbox is 1m in terrain"<<std::endl;
@@ -641,6 +883,10 @@ void printUsage(void)
 	std::cout<<"     Sets the number of averaging slots in the frame filter; latency is"<<std::endl;
 	std::cout<<"     <num averaging slots> * 1/30 s"<<std::endl;
 	std::cout<<"     Default: 30"<<std::endl;
+	std::cout<<"  -nft <num filter threads>"<<std::endl;
+	std::cout<<"     Sets the number of threads used by the frame filter, each processing a"<<std::endl;
+	std::cout<<"     horizontal band of the depth frame"<<std::endl;
+	std::cout<<"     Default: 1"<<std::endl;
 	std::cout<<"  -sp <min num samples> <max variance>"<<std::endl;
 	std::cout<<"     Sets the frame filter parameters minimum number of valid samples and"<<std::endl;
 	std::cout<<"     maximum sample variance before convergence"<<std::endl;
@@ -648,6 +894,16 @@ void printUsage(void)
 	std::cout<<"  -he <hysteresis envelope>"<<std::endl;
 	std::cout<<"     Sets the size of the hysteresis envelope used for jitter removal"<<std::endl;
 	std::cout<<"     Default: 0.1"<<std::endl;
+	std::cout<<"  -ffm"<<std::endl;
+	std::cout<<"     Prints a breakdown of the frame filter's memory footprint"<<std::endl;
+	std::cout<<"  -roi"<<std::endl;
+	std::cout<<"     Only filters the depth pixels showing the sandbox instead of the entire"<<std::endl;
+	std::cout<<"     depth frame"<<std::endl;
+	std::cout<<"  -nroi"<<std::endl;
+	std::cout<<"     Filters the entire depth frame instead of only the depth pixels showing"<<std::endl;
+	std::cout<<"     the sandbox (default)"<<std::endl;
+	std::cout<<"  -bf"<<std::endl;
+	std::cout<<"     Filters depth frames at half resolution in bins of 2x2 pixels"<<std::endl;
 	std::cout<<"  -wts <water grid width> <water grid height>"<<std::endl;
 	std::cout<<"     Sets the width and height of the water flow simulation grid"<<std::endl;
 	std::cout<<"     Default: 640 480"<<std::endl;
@@ -657,6 +913,47 @@ void printUsage(void)
 	std::cout<<"     Default: 1.0 30"<<std::endl;
 	std::cout<<"  -weng"<<std::endl;
 	std::cout<<"     Sets the water simulation to engineering mode"<<std::endl;
+	std::cout<<"  -wfi"<<std::endl;
+	std::cout<<"     Runs the second half of each water simulation step as a single fused"<<std::endl;
+	std::cout<<"     shader pass"<<std::endl;
+	std::cout<<"  -whp"<<std::endl;
+	std::cout<<"     Stores water flow derivatives and water rates in half precision to"<<std::endl;
+	std::cout<<"     reduce memory bandwidth; water levels and flows remain in single"<<std::endl;
+	std::cout<<"     precision"<<std::endl;
+	std::cout<<"  -wrf <water render factor>"<<std::endl;
+	std::cout<<"     Runs the water flow simulation on a grid coarser than the water grid size"<<std::endl;
+	std::cout<<"     by the given factor, and reconstructs water at the full water grid size"<<std::endl;
+	std::cout<<"     from the full-resolution bathymetry for rendering"<<std::endl;
+	std::cout<<"     Default: 1"<<std::endl;
+	std::cout<<"  -wsr <water simulation rate> <water max ticks per frame>"<<std::endl;
+	std::cout<<"     Runs the water simulation in ticks at the given fixed rate per second,"<<std::endl;
+	std::cout<<"     at most the given number per frame, and renders water interpolated"<<std::endl;
+	std::cout<<"     between the two most recent ticks; rate 0 advances the simulation by each"<<std::endl;
+	std::cout<<"     frame's duration"<<std::endl;
+	std::cout<<"     Default: 0 4"<<std::endl;
+	std::cout<<"  -wsp <water scheduler policy>"<<std::endl;
+	std::cout<<"     Selects how fixed-rate water simulation ticks that do not fit into a frame"<<std::endl;
+	std::cout<<"     are handled: CatchUp runs them during later frames, Degrade drops them"<<std::endl;
+	std::cout<<"     Default: CatchUp"<<std::endl;
+	std::cout<<"  -wdts <water dry tile size> <water dry depth>"<<std::endl;
+	std::cout<<"     Skips simulating square tiles of the water grid of the given size while"<<std::endl;
+	std::cout<<"     they and their neighbors contain no water deeper than the given depth in cm;"<<std::endl;
+	std::cout<<"     tile size 0 simulates the entire grid"<<std::endl;
+	std::cout<<"     Default: 0 0.001"<<std::endl;
+	std::cout<<"  -wsi <water stats interval>"<<std::endl;
+	std::cout<<"     Reduces the water grid to health statistics (total volume, maximum flow"<<std::endl;
+	std::cout<<"     speed, wet cells, maximum depth) every given number of water simulation"<<std::endl;
+	std::cout<<"     steps, to be reported via the waterStats control pipe command; 0"<<std::endl;
+	std::cout<<"     disables health statistics"<<std::endl;
+	std::cout<<"     Default: 0"<<std::endl;
+	std::cout<<"  -wcp <water checkpoint file name> <water checkpoint interval>"<<std::endl;
+	std::cout<<"     Saves the complete water simulation state to the water checkpoint file of"<<std::endl;
+	std::cout<<"     the given name every given number of seconds, for warm restarts via -wrc"<<std::endl;
+	std::cout<<"     Default: none 60"<<std::endl;
+	std::cout<<"  -wrc <water checkpoint file name>"<<std::endl;
+	std::cout<<"     Restores the water simulation state and parameters from the water"<<std::endl;
+	std::cout<<"     checkpoint file of the given name at start-up"<<std::endl;
+	std::cout<<"     Default: none"<<std::endl;
 	std::cout<<"  -wmts <water table minimum time step>"<<std::endl;
 	std::cout<<"     Sets the minimum time step for water simulation to ensure frame rates at"<<std::endl;
 	std::cout<<"     the cost of water simulation accuracy in high-flow regions"<<std::endl;
@@ -729,16 +1026,22 @@ Sandbox::Sandbox(int& argc,char**& argv)
 	 remoteServer(0),
 	 camera(0),pixelDepthCorrection(0),
 	 frameFilter(0),pauseUpdates(false),
+	 filteredFramesDirtyRect(Size(0,0)),
 	 depthImageRenderer(0),
 	 waterTable(0),
+	 waterSimulationRate(0.0),waterMaxTicksPerFrame(4),waterSchedulerPolicy(WaterScheduler::CatchUp),
+	 activeWaterTileFraction(1.0f),waterTelemetry(0),
+	 waterCheckpointStreamer(0),waterCheckpointInterval(60.0),nextWaterCheckpointTime(0.0),
+	 restoredWaterCheckpoint(0),restoredWaterCheckpointVersion(0),
 	 propertyGridCreator(0),
-	 handExtractor(0),addWaterFunction(0),addWaterFunctionRegistered(false),
+	 handExtractor(0),addRainDisksFunction(0),
+	 depthFrameRecorder(0),latencyMonitor(0),
 	 sun(0),
 	 activeDem(0),
 	 mainMenu(0),pauseUpdatesToggle(0),
 	 gridPropertyFileHelper(Vrui::getWidgetManager(),"GridProperty.tiff",".tif;.tiff"),
 	 waterControlDialog(0),
-	 snowLineSlider(0),waterSpeedSlider(0),waterMaxStepsSlider(0),frameRateTextField(0),waterAttenuationSlider(0),
+	 snowLineSlider(0),waterSpeedSlider(0),waterMaxStepsSlider(0),frameRateTextField(0),activeWaterTilesTextField(0),waterAttenuationSlider(0),
 	 controlPipeFd(-1)
 	{
 	/* Read the sandbox's default configuration parameters: */
@@ -760,14 +1063,35 @@ Sandbox::Sandbox(int& argc,char**& argv)
 	if(haveHeightMapPlane)
 		heightMapPlane=cfg.retrieveValue<Plane>("./heightMapPlane");
 	unsigned int numAveragingSlots=cfg.retrieveValue<unsigned int>("./numAveragingSlots",30);
+	unsigned int numFilterThreads=cfg.retrieveValue<unsigned int>("./numFilterThreads",1);
 	unsigned int minNumSamples=cfg.retrieveValue<unsigned int>("./minNumSamples",10);
 	unsigned int maxVariance=cfg.retrieveValue<unsigned int>("./maxVariance",2);
 	float hysteresis=cfg.retrieveValue<float>("./hysteresis",0.1f);
+	std::string temporalFilterName=cfg.retrieveString("./temporalFilter","Box");
+	float emaWeight=cfg.retrieveValue<float>("./emaWeight",0.1f);
+	float kalmanProcessNoise=cfg.retrieveValue<float>("./kalmanProcessNoise",0.01f);
+	float kalmanMeasurementNoise=cfg.retrieveValue<float>("./kalmanMeasurementNoise",2.0f);
+	float motionThreshold=cfg.retrieveValue<float>("./motionThreshold",5.0f);
+	unsigned int motionMinNumSamples=cfg.retrieveValue<unsigned int>("./motionMinNumSamples",3);
+	bool filterROI=cfg.retrieveValue<bool>("./filterROI",false);
+	bool binnedFilter=cfg.retrieveValue<bool>("./binnedFilter",false);
 	Size wtSize(640,480);
 	cfg.updateValue("./waterTableSize",wtSize);
 	waterSpeed=cfg.retrieveValue<double>("./waterSpeed",1.0);
 	waterMaxSteps=cfg.retrieveValue<unsigned int>("./waterMaxSteps",30U);
 	float waterMinTimeStep=cfg.retrieveValue<float>("./waterMinTimeStep",0.0f);
+	waterSimulationRate=cfg.retrieveValue<double>("./waterSimulationRate",waterSimulationRate);
+	waterMaxTicksPerFrame=cfg.retrieveValue<unsigned int>("./waterMaxTicksPerFrame",waterMaxTicksPerFrame);
+	std::string waterSchedulerPolicyName=cfg.retrieveString("./waterSchedulerPolicy","CatchUp");
+	bool fusedWaterIntegration=cfg.retrieveValue<bool>("./fusedWaterIntegration",false);
+	bool halfPrecisionWater=cfg.retrieveValue<bool>("./halfPrecisionWater",false);
+	unsigned int waterRenderFactor=cfg.retrieveValue<unsigned int>("./waterRenderFactor",1U);
+	unsigned int waterDryTileSize=cfg.retrieveValue<unsigned int>("./waterDryTileSize",0U);
+	float waterDryDepth=cfg.retrieveValue<float>("./waterDryDepth",0.001f);
+	unsigned int waterStatsInterval=cfg.retrieveValue<unsigned int>("./waterStatsInterval",0U);
+	waterCheckpointFileName=cfg.retrieveString("./waterCheckpointFileName","");
+	waterCheckpointInterval=cfg.retrieveValue<double>("./waterCheckpointInterval",waterCheckpointInterval);
+	std::string waterRestoreFileName=cfg.retrieveString("./waterRestoreFileName","");
 	Math::Interval<double> rainElevationRange=cfg.retrieveValue<Math::Interval<double> >("./rainElevationRange",Math::Interval<double>(-1000.0,1000.0));
 	rainStrength=cfg.retrieveValue<GLfloat>("./rainStrength",0.25f);
 	double snowLine=cfg.retrieveValue<double>("./snowLine",1000.0);
@@ -779,10 +1103,13 @@ Sandbox::Sandbox(int& argc,char**& argv)
 	/* Process command line parameters: */
 	bool printHelp=false;
 	const char* frameFilePrefix=0;
+	const char* recordFileName=0;
+	bool recordColor=false;
 	const char* kinectServerName=0;
 	bool useRemoteServer=false;
 	int remoteServerPortId=26000;
 	bool engineering=false;
+	bool printFilterMemory=false;
 	int windowIndex=0;
 	renderSettings.push_back(RenderSettings());
 	for(int i=1;i<argc;++i)
@@ -812,6 +1139,13 @@ Sandbox::Sandbox(int& argc,char**& argv)
 				++i;
 				frameFilePrefix=argv[i];
 				}
+			else if(strcasecmp(argv[i]+1,"rec")==0)
+				{
+				++i;
+				recordFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"recColor")==0)
+				recordColor=true;
 			else if(strcasecmp(argv[i]+1,"p")==0)
 				{
 				++i;
@@ -853,6 +1187,11 @@ Sandbox::Sandbox(int& argc,char**& argv)
 				++i;
 				numAveragingSlots=atoi(argv[i]);
 				}
+			else if(strcasecmp(argv[i]+1,"nft")==0)
+				{
+				++i;
+				numFilterThreads=atoi(argv[i]);
+				}
 			else if(strcasecmp(argv[i]+1,"sp")==0)
 				{
 				++i;
@@ -865,6 +1204,14 @@ Sandbox::Sandbox(int& argc,char**& argv)
 				++i;
 				hysteresis=float(atof(argv[i]));
 				}
+			else if(strcasecmp(argv[i]+1,"ffm")==0)
+				printFilterMemory=true;
+			else if(strcasecmp(argv[i]+1,"roi")==0)
+				filterROI=true;
+			else if(strcasecmp(argv[i]+1,"nroi")==0)
+				filterROI=false;
+			else if(strcasecmp(argv[i]+1,"bf")==0)
+				binnedFilter=true;
 			else if(strcasecmp(argv[i]+1,"wts")==0)
 				{
 				for(int j=0;j<2;++j)
@@ -889,6 +1236,51 @@ Sandbox::Sandbox(int& argc,char**& argv)
 				{
 				engineering=true;
 				}
+			else if(strcasecmp(argv[i]+1,"wfi")==0)
+				fusedWaterIntegration=true;
+			else if(strcasecmp(argv[i]+1,"whp")==0)
+				halfPrecisionWater=true;
+			else if(strcasecmp(argv[i]+1,"wrf")==0)
+				{
+				++i;
+				waterRenderFactor=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"wsr")==0)
+				{
+				++i;
+				waterSimulationRate=atof(argv[i]);
+				++i;
+				waterMaxTicksPerFrame=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"wsp")==0)
+				{
+				++i;
+				waterSchedulerPolicyName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"wdts")==0)
+				{
+				++i;
+				waterDryTileSize=(unsigned int)(atoi(argv[i]));
+				++i;
+				waterDryDepth=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"wsi")==0)
+				{
+				++i;
+				waterStatsInterval=(unsigned int)(atoi(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"wcp")==0)
+				{
+				++i;
+				waterCheckpointFileName=argv[i];
+				++i;
+				waterCheckpointInterval=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"wrc")==0)
+				{
+				++i;
+				waterRestoreFileName=argv[i];
+				}
 			else if(strcasecmp(argv[i]+1,"rer")==0)
 				{
 				++i;
@@ -1133,18 +1525,45 @@ Sandbox::Sandbox(int& argc,char**& argv)
 	evaporationRate*=sf;
 	demDistScale*=sf;
 	
+	/* Select the frame filter's temporal filter algorithm: */
+	FrameFilter::TemporalFilterMode temporalFilterMode=FrameFilter::BoxFilter;
+	if(strcasecmp(temporalFilterName.c_str(),"Median")==0)
+		temporalFilterMode=FrameFilter::MedianFilter;
+	else if(strcasecmp(temporalFilterName.c_str(),"EMA")==0)
+		temporalFilterMode=FrameFilter::EMAFilter;
+	else if(strcasecmp(temporalFilterName.c_str(),"Kalman")==0)
+		temporalFilterMode=FrameFilter::KalmanFilter;
+	else if(strcasecmp(temporalFilterName.c_str(),"Adaptive")==0)
+		temporalFilterMode=FrameFilter::AdaptiveFilter;
+	else if(strcasecmp(temporalFilterName.c_str(),"Box")!=0)
+		std::cerr<<"Ignoring unrecognized temporal filter "<<temporalFilterName<<"; using box filter"<<std::endl;
+	
+	/* Create the latency monitor: */
+	latencyMonitor=new LatencyMonitor;
+	
 	/* Create the frame filter object: */
-	frameFilter=new FrameFilter(frameSize,numAveragingSlots,pixelDepthCorrection,cameraIps.depthProjection,basePlane);
+	frameFilter=new FrameFilter(frameSize,temporalFilterMode,numAveragingSlots,numFilterThreads,pixelDepthCorrection,cameraIps.depthProjection,basePlane,binnedFilter);
 	frameFilter->setValidElevationInterval(cameraIps.depthProjection,basePlane,elevationRange.getMin(),elevationRange.getMax());
 	frameFilter->setStableParameters(minNumSamples,maxVariance);
 	frameFilter->setHysteresis(hysteresis);
+	frameFilter->setEMAWeight(emaWeight);
+	frameFilter->setKalmanNoise(kalmanProcessNoise,kalmanMeasurementNoise);
+	frameFilter->setMotionParameters(motionThreshold,motionMinNumSamples);
 	frameFilter->setSpatialFilter(true);
+	if(filterROI)
+		{
+		/* Only filter the depth pixels showing the sandbox anywhere inside the valid elevation range: */
+		frameFilter->setROI(cameraIps.depthProjection,basePlane,basePlaneCorners,elevationRange.getMin(),elevationRange.getMax());
+		}
 	frameFilter->setOutputFrameFunction(Misc::createFunctionCall(this,&Sandbox::receiveFilteredFrame));
+	if(printFilterMemory)
+		FrameFilter::printMemoryFootprint(std::cout,frameSize,temporalFilterMode,numAveragingSlots,binnedFilter);
 	
 	/* Create the depth image renderer: */
 	depthImageRenderer=new DepthImageRenderer(frameSize);
 	depthImageRenderer->setIntrinsics(cameraIps);
 	depthImageRenderer->setBasePlane(basePlane);
+	depthImageRenderer->setLatencyMonitor(latencyMonitor);
 	
 	{
 	/* Calculate the transformation from camera space to sandbox space: */
@@ -1171,13 +1590,36 @@ Sandbox::Sandbox(int& argc,char**& argv)
 	
 	if(waterSpeed>0.0)
 		{
-		/* Initialize the water flow simulator: */
-		waterTable=new WaterTable2(wtSize,depthImageRenderer,basePlaneCorners);
+		/* Initialize the water flow simulator on a grid coarsened by the water render factor: */
+		if(waterRenderFactor<1)
+			waterRenderFactor=1;
+		Size wtSimSize(wtSize[0]/waterRenderFactor,wtSize[1]/waterRenderFactor);
+		waterTable=new WaterTable2(wtSimSize,depthImageRenderer,basePlaneCorners);
+		waterTable->setRenderFactor(waterRenderFactor);
 		waterTable->setElevationRange(elevationRange.getMin(),rainElevationRange.getMax());
 		if(engineering)
 			waterTable->setMode(WaterTable2::Engineering);
 		if(waterMinTimeStep>0.0f)
 			waterTable->forceMinStepSize(waterMinTimeStep);
+		waterTable->setFusedIntegration(fusedWaterIntegration);
+		waterTable->setHalfPrecision(halfPrecisionWater);
+		waterTable->setDryTileSkipping(waterDryTileSize,waterDryDepth);
+		waterTable->setStatsInterval(waterStatsInterval);
+		
+		/* Create the water simulation's telemetry log: */
+		waterTelemetry=new WaterTelemetry;
+		
+		/* Create the water simulation's checkpoint streamer and start reading the initial state for a warm restart: */
+		waterCheckpointStreamer=new WaterCheckpointStreamer;
+		if(!waterRestoreFileName.empty())
+			waterCheckpointStreamer->readCheckpoint(waterRestoreFileName);
+		nextWaterCheckpointTime=waterCheckpointInterval;
+		
+		/* Select the water simulation scheduler's policy: */
+		if(strcasecmp(waterSchedulerPolicyName.c_str(),"Degrade")==0)
+			waterSchedulerPolicy=WaterScheduler::Degrade;
+		else if(strcasecmp(waterSchedulerPolicyName.c_str(),"CatchUp")!=0)
+			std::cerr<<"Ignoring unrecognized water scheduler policy "<<waterSchedulerPolicyName<<"; using catch-up policy"<<std::endl;
 		snowLine=Math::clamp(snowLine,elevationRange.getMin(),elevationRange.getMax());
 		waterTable->setSnowLine(snowLine);
 		waterTable->setSnowMelt(snowMelt);
@@ -1190,15 +1632,30 @@ Sandbox::Sandbox(int& argc,char**& argv)
 		/* Create the hand extractor object: */
 		handExtractor=new HandExtractor(frameSize,pixelDepthCorrection,cameraIps.depthProjection);
 		
-		/* Register a render function with the water table: */
-		addWaterFunction=Misc::createFunctionCall(this,&Sandbox::addWater);
-		waterTable->addRenderFunction(addWaterFunction);
-		addWaterFunctionRegistered=true;
+		/* Register a water disk function with the water table: */
+		addRainDisksFunction=Misc::createFunctionCall(this,&Sandbox::addRainDisks);
+		waterTable->addWaterDiskFunction(addRainDisksFunction);
+		}
+	
+	if(recordFileName!=0)
+		{
+		/* Create a depth frame recorder: */
+		try
+			{
+			Size colorFrameSize(0,0);
+			if(recordColor)
+				colorFrameSize=camera->getActualFrameSize(Kinect::FrameSource::COLOR);
+			depthFrameRecorder=new DepthFrameRecorder(recordFileName,frameSize,colorFrameSize,pixelDepthCorrection,cameraIps.depthProjection,basePlane,elevationRange);
+			}
+		catch(const std::runtime_error& err)
+			{
+			std::cerr<<"Unable to record depth frames due to exception "<<err.what()<<std::endl;
+			}
 		}
 	
 	/* Start streaming color and depth frames: */
-	if(propertyGridCreator!=0)
-		camera->startStreaming(Misc::createFunctionCall(propertyGridCreator,&PropertyGridCreator::receiveRawFrame),Misc::createFunctionCall(this,&Sandbox::rawDepthFrameDispatcher));
+	if(propertyGridCreator!=0||(depthFrameRecorder!=0&&recordColor))
+		camera->startStreaming(Misc::createFunctionCall(this,&Sandbox::rawColorFrameDispatcher),Misc::createFunctionCall(this,&Sandbox::rawDepthFrameDispatcher));
 	else
 		camera->startStreaming(0,Misc::createFunctionCall(this,&Sandbox::rawDepthFrameDispatcher));
 	
@@ -1296,13 +1753,18 @@ Sandbox::~Sandbox(void)
 	camera->stopStreaming();
 	delete camera;
 	delete frameFilter;
+	delete depthFrameRecorder;
+	delete latencyMonitor;
 	
 	/* Delete helper objects: */
 	delete handExtractor;
 	delete propertyGridCreator;
 	delete waterTable;
+	delete waterTelemetry;
+	delete waterCheckpointStreamer;
+	delete restoredWaterCheckpoint;
 	delete depthImageRenderer;
-	delete addWaterFunction;
+	delete addRainDisksFunction;
 	delete[] pixelDepthCorrection;
 	delete remoteServer;
 	
@@ -1377,32 +1839,36 @@ void Sandbox::frame(void)
 	if(remoteServer!=0)
 		remoteServer->frame(Vrui::getApplicationTime());
 	
-	/* Check if the filtered frame has been updated: */
-	if(filteredFrames.lockNewValue())
+	/* Check if the filtered frame has been updated, and retrieve the depth pixels changed since the previously locked frame: */
+	bool newFilteredFrame;
+	Rect filteredFrameDirtyRect;
+	{
+	Threads::Mutex::Lock filteredFramesLock(filteredFramesMutex);
+	newFilteredFrame=filteredFrames.lockNewValue();
+	if(newFilteredFrame)
+		{
+		filteredFrameDirtyRect=filteredFramesDirtyRect;
+		filteredFramesDirtyRect=Rect(Size(0,0));
+		}
+	}
+	if(newFilteredFrame)
 		{
-		/* Update the depth image renderer's depth image: */
-		depthImageRenderer->setDepthImage(filteredFrames.getLockedValue());
+		/* Update the depth image renderer's depth image, which only re-uploads and re-rasterizes the changed pixels: */
+		double lockTime=LatencyMonitor::getTime();
+		depthImageRenderer->setDepthImage(filteredFrames.getLockedValue(),filteredFrameDirtyRect);
+		latencyMonitor->frameLocked(filteredFrames.getLockedValue().timeStamp,lockTime,LatencyMonitor::getTime());
 		}
 	
 	if(handExtractor!=0)
 		{
 		/* Lock the most recent extracted hand list: */
 		handExtractor->lockNewExtractedHands();
-		
-		#if 0
-		
-		/* Register/unregister the rain rendering function based on whether hands have been detected: */
-		bool registerWaterFunction=!handExtractor->getLockedExtractedHands().empty();
-		if(addWaterFunctionRegistered!=registerWaterFunction)
-			{
-			if(registerWaterFunction)
-				waterTable->addRenderFunction(addWaterFunction);
-			else
-				waterTable->removeRenderFunction(addWaterFunction);
-			addWaterFunctionRegistered=registerWaterFunction;
-			}
-		
-		#endif
+		}
+	
+	if(waterTable!=0)
+		{
+		/* Collect this frame's rain disks and local water tool disks, to be rendered into the water table by a single draw call per simulation step: */
+		waterTable->updateWaterDisks();
 		}
 	
 	/* Update all surface renderers: */
@@ -1706,16 +2172,121 @@ void Sandbox::frame(void)
 					else
 						std::cerr<<"Wrong number of arguments for dippingBedThickness control pipe command"<<std::endl;
 					}
+				else if(isToken(tokens[0],"frameFilterStats"))
+					{
+					if(tokens.size()==1)
+						{
+						if(frameFilter!=0)
+							{
+							/* Print the frame filter's frame counts and spatial filter tile statistics: */
+							Misc::UInt64 numConsideredTiles,numSkippedTiles;
+							frameFilter->getSpatialFilterTileCounts(numConsideredTiles,numSkippedTiles);
+							std::cout<<"Frame filter: "<<frameFilter->getNumReceivedFrames()<<" frames received, "<<frameFilter->getNumDroppedFrames()<<" frames dropped"<<std::endl;
+							std::cout<<"Temporal filter: "<<frameFilter->getNumFilteredPixels()<<(frameFilter->isBinned()?" 2x2 bins":" pixels")<<" of "<<frameSize[1]*frameSize[0]<<" depth pixels filtered per frame"<<std::endl;
+							std::cout<<"Spatial filter: "<<frameFilter->getLastNumSkippedTiles()<<" of "<<frameFilter->getNumTiles()<<" tiles skipped in last frame";
+							if(numConsideredTiles>0)
+								std::cout<<", "<<double(numSkippedTiles)*100.0/double(numConsideredTiles)<<"% of tiles skipped overall";
+							std::cout<<std::endl;
+							}
+						}
+					else
+						std::cerr<<"Wrong number of arguments for frameFilterStats control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"waterStats"))
+					{
+					if(tokens.size()==1||tokens.size()==2)
+						{
+						if(waterTelemetry!=0)
+							{
+							/* Print a summary of the water simulation's telemetry log: */
+							waterTelemetry->printStatistics(std::cout);
+							
+							if(tokens.size()==2)
+								{
+								try
+									{
+									/* Dump the telemetry log to a CSV file: */
+									waterTelemetry->writeCSVFile(tokens[1].c_str());
+									}
+								catch(const std::runtime_error& err)
+									{
+									std::cerr<<"Cannot write water telemetry file "<<tokens[1]<<" due to exception "<<err.what()<<std::endl;
+									}
+								}
+							}
+						}
+					else
+						std::cerr<<"Wrong number of arguments for waterStats control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"saveWaterCheckpoint"))
+					{
+					if(tokens.size()==2)
+						{
+						if(waterTable!=0)
+							requestWaterCheckpoint(tokens[1]);
+						}
+					else
+						std::cerr<<"Wrong number of arguments for saveWaterCheckpoint control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"loadWaterCheckpoint"))
+					{
+					if(tokens.size()==2)
+						{
+						if(waterTable!=0)
+							waterCheckpointStreamer->readCheckpoint(tokens[1]);
+						}
+					else
+						std::cerr<<"Wrong number of arguments for loadWaterCheckpoint control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"latencyStats"))
+					{
+					if(tokens.size()==1||tokens.size()==2)
+						{
+						/* Print latency percentiles for all pipeline stages: */
+						latencyMonitor->printStatistics(std::cout);
+						
+						if(tokens.size()==2)
+							{
+							try
+								{
+								/* Dump the per-frame latencies to a CSV file: */
+								latencyMonitor->writeCSVFile(tokens[1].c_str());
+								}
+							catch(const std::runtime_error& err)
+								{
+								std::cerr<<"Cannot write latency file "<<tokens[1]<<" due to exception "<<err.what()<<std::endl;
+								}
+							}
+						}
+					else
+						std::cerr<<"Wrong number of arguments for latencyStats control pipe command"<<std::endl;
+					}
 				else
 					std::cerr<<"Unrecognized control pipe command "<<tokens[0]<<std::endl;
 				}
 			}
 		}
 	
+	if(waterCheckpointStreamer!=0)
+		{
+		/* Restore a water simulation checkpoint if one has been read in the background: */
+		WaterCheckpoint* checkpoint=waterCheckpointStreamer->retrieveReadCheckpoint();
+		if(checkpoint!=0)
+			restoreWaterCheckpoint(checkpoint);
+		
+		/* Request a periodic water simulation checkpoint if one is due: */
+		if(!waterCheckpointFileName.empty()&&waterCheckpointInterval>0.0&&Vrui::getApplicationTime()>=nextWaterCheckpointTime)
+			{
+			requestWaterCheckpoint(waterCheckpointFileName);
+			nextWaterCheckpointTime=Vrui::getApplicationTime()+waterCheckpointInterval;
+			}
+		}
+	
 	if(frameRateTextField!=0&&Vrui::getWidgetManager()->isVisible(waterControlDialog))
 		{
 		/* Update the frame rate display: */
 		frameRateTextField->setValue(1.0/Vrui::getCurrentFrameTime());
+		activeWaterTilesTextField->setValue(double(activeWaterTileFraction)*100.0);
 		}
 	
 	if(pauseUpdates)
@@ -1724,6 +2295,8 @@ void Sandbox::frame(void)
 
 void Sandbox::display(GLContextData& contextData) const
 	{
+	double renderStartTime=LatencyMonitor::getTime();
+	
 	/* Get the data item: */
 	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
 	
@@ -1741,76 +2314,116 @@ void Sandbox::display(GLContextData& contextData) const
 	/* Check if the water simulation state needs to be updated: */
 	if(waterTable!=0&&dataItem->waterTableTime!=Vrui::getApplicationTime())
 		{
-		/* Retrieve a potential pending grid read-back request: */
-		GridRequest::Request request=gridRequest.getRequest();
-		
-		/* Update the water table's bathymetry grid: */
-		waterTable->updateBathymetry(contextData,textureTracker);
+		/* Complete grid request batches whose read-backs were started during a previous frame and have finished since: */
+		while(dataItem->numPendingGridBatches>0)
+			{
+			GridReadback& grids=*dataItem->pendingGridReadbacks[0];
+			if(!waterTable->finishGridReadback(contextData,grids.getBathymetry(),grids.getWaterLevel(),grids.getSnowHeight(),false))
+				break;
+			
+			/* Hand the same read-back grids to all requesters in the batch that have not cancelled their requests: */
+			gridRequest.finishBatch(dataItem->pendingGridBatchIds[0],dataItem->pendingGridReadbacks[0]);
+			
+			dataItem->pendingGridBatchIds[0]=dataItem->pendingGridBatchIds[1];
+			dataItem->pendingGridReadbacks[0]=dataItem->pendingGridReadbacks[1];
+			dataItem->pendingGridReadbacks[1]=0;
+			--dataItem->numPendingGridBatches;
+			}
 		
-		/* Check if the grid request is active and wants bathymetry data: */
-		if(request.isActive()&&request.bathymetryBuffer!=0)
+		/* Restore the most recently read water simulation checkpoint if it has not been restored in this OpenGL context yet: */
+		if(dataItem->restoredWaterCheckpointVersion!=restoredWaterCheckpointVersion)
 			{
-			/* Read back the current bathymetry grid: */
-			waterTable->readBathymetryTexture(contextData,textureTracker,request.bathymetryBuffer);
+			waterTable->restoreCheckpoint(*restoredWaterCheckpoint,contextData,textureTracker);
+			dataItem->restoredWaterCheckpointVersion=restoredWaterCheckpointVersion;
 			}
 		
+		/* Update the water table's bathymetry grid: */
+		waterTable->updateBathymetry(contextData,textureTracker);
+		
 		/* Update the water simulation property grid: */
 		propertyGridCreator->updatePropertyGrid(contextData,textureTracker);
 		
-		/* Run the water flow simulation's main pass: */
-		GLfloat totalTimeStep=GLfloat(Vrui::getFrameTime()*waterSpeed);
-		
-		// DEBUGGING
-		// std::cout<<totalTimeStep<<',';
-		// Realtime::TimePointMonotonic timer;
-		
-		unsigned int numSteps=0;
-		while(numSteps<waterMaxSteps&&totalTimeStep>1.0e-8f)
+		/* Run the water flow simulation's main pass; step sizes are reported one step late, so the step still in flight is accounted for in the next frame or tick: */
+		GLfloat& totalTimeStep=dataItem->waterTimeStep;
+		if(dataItem->waterScheduler!=0)
 			{
-			/* Run with a self-determined time step to maintain stability: */
-			waterTable->setMaxStepSize(totalTimeStep);
-			GLfloat timeStep=waterTable->runSimulationStep(false,contextData,textureTracker);
-			totalTimeStep-=timeStep;
-			++numSteps;
+			/* Run all simulation ticks that are due at this frame's time, each covering the same amount of simulation time: */
+			double now=Vrui::getApplicationTime();
+			unsigned int numTicks=dataItem->waterScheduler->startFrame(now);
+			GLfloat tickTimeStep=GLfloat(dataItem->waterScheduler->getTickInterval()*waterSpeed);
+			for(unsigned int tick=0;tick<numTicks;++tick)
+				{
+				/* Store the state before the final tick to interpolate between it and the final state: */
+				if(tick==numTicks-1)
+					waterTable->storePreviousState(contextData,textureTracker);
+				
+				totalTimeStep+=tickTimeStep;
+				runWaterSimulationSteps(totalTimeStep,contextData,textureTracker);
+				}
+			
+			/* Blend the two most recent simulation states for rendering at this frame's time: */
+			waterTable->interpolateStates(GLfloat(dataItem->waterScheduler->getInterpolationWeight(now)),contextData,textureTracker);
+			}
+		else
+			{
+			/* Run simulation steps covering this frame's duration: */
+			totalTimeStep+=GLfloat(Vrui::getFrameTime()*waterSpeed);
+			runWaterSimulationSteps(totalTimeStep,contextData,textureTracker);
 			}
 		
-		// DEBUGGING
-		// double elapsed(timer.setAndDiff());
-		// std::cout<<numSteps<<','<<elapsed<<','<<elapsed/numSteps<<std::endl;
+		/* Reconstruct the water state at rendering resolution if the simulation runs on a coarser grid: */
+		waterTable->upsampleStates(contextData,textureTracker);
 		
-		#if 0
-		if(totalTimeStep>1.0e-8f)
+		/* Remember the fraction of the water table that was simulated for the frame rate display: */
+		activeWaterTileFraction=waterTable->getActiveTileFraction(contextData);
+		
+		/* Log the most recent health statistics if their read-back completed: */
+		WaterStats waterStats;
+		if(waterTable->retrieveStats(contextData,waterStats))
+			waterTelemetry->statsRetrieved(waterStats);
+		
+		if(dataItem->waterCheckpointFileName.empty())
 			{
-			std::cout<<'.'<<std::flush;
-			/* Force the final step to avoid simulation slow-down: */
-			waterTable->setMaxStepSize(totalTimeStep);
-			GLfloat timeStep=waterTable->runSimulationStep(true,contextData,textureTracker);
-			totalTimeStep-=timeStep;
-			++numSteps;
+			/* Start reading back the water simulation state if a checkpoint has been requested and no other OpenGL context picked up the request yet: */
+			Threads::Mutex::Lock waterCheckpointLock(waterCheckpointMutex);
+			if(!requestedWaterCheckpointFileName.empty()&&waterTable->startCheckpoint(contextData,textureTracker))
+				{
+				dataItem->waterCheckpointFileName=requestedWaterCheckpointFileName;
+				requestedWaterCheckpointFileName.clear();
+				}
 			}
-		#elif 1
-		if(totalTimeStep>1.0e-8f)
-			std::cout<<"Ran out of time by "<<totalTimeStep<<std::endl;
-		#endif
-		
-		/* Check if the grid request is active and wants water level data: */
-		if(request.isActive()&&request.waterLevelBuffer!=0)
+		else
 			{
-			/* Read back the current water level grid: */
-			waterTable->readQuantityTexture(contextData,textureTracker,GL_RED,request.waterLevelBuffer);
+			/* Hand the read-back water simulation state to the background writer once the GPU has delivered it: */
+			WaterCheckpoint* checkpoint=waterTable->finishCheckpoint(contextData,false);
+			if(checkpoint!=0)
+				{
+				waterCheckpointStreamer->writeCheckpoint(checkpoint,dataItem->waterCheckpointFileName);
+				dataItem->waterCheckpointFileName.clear();
+				}
 			}
 		
-		/* Check if the grid request is active and wants snow height data: */
-		if(request.isActive()&&request.snowHeightBuffer!=0)
+		if(dataItem->numPendingGridBatches<2)
 			{
-			/* Read back the current snow height grid: */
-			waterTable->readSnowTexture(contextData,textureTracker,request.snowHeightBuffer);
+			/* Start reading back the union of all queued grid requests without stalling; the batch completes during a later frame once its read-back has finished: */
+			unsigned int gridMask;
+			unsigned int batchId=gridRequest.startBatch(gridMask);
+			if(batchId!=0)
+				{
+				if(waterTable->startGridReadback(contextData,textureTracker,(gridMask&GridReadback::Bathymetry)!=0x0U,(gridMask&GridReadback::WaterLevel)!=0x0U,(gridMask&GridReadback::SnowHeight)!=0x0U))
+					{
+					dataItem->pendingGridBatchIds[dataItem->numPendingGridBatches]=batchId;
+					dataItem->pendingGridReadbacks[dataItem->numPendingGridBatches]=new GridReadback(waterTable->getSize(),gridMask);
+					++dataItem->numPendingGridBatches;
+					}
+				else
+					{
+					/* Serve the batch's requests with a later read-back: */
+					gridRequest.requeueBatch(batchId);
+					}
+				}
 			}
 		
-		/* Finish an active grid request: */
-		if(request.isActive())
-			request.complete();
-		
 		/* Mark the water simulation state as up-to-date for this frame: */
 		dataItem->waterTableTime=Vrui::getApplicationTime();
 		}
@@ -2056,6 +2669,13 @@ void Sandbox::display(GLContextData& contextData) const
 		
 		glPopAttrib();
 		}
+	
+	if(dataItem->renderedDepthImageVersion!=depthImageRenderer->getDepthImageVersion())
+		{
+		/* Register the first rendering of a new depth image in this OpenGL context with the latency monitor: */
+		latencyMonitor->frameRendered(depthImageRenderer->getDepthImageTimeStamp(),renderStartTime,LatencyMonitor::getTime());
+		dataItem->renderedDepthImageVersion=depthImageRenderer->getDepthImageVersion();
+		}
 	}
 
 void Sandbox::resetNavigation(void)
@@ -2106,9 +2726,13 @@ void Sandbox::eventCallback(Vrui::Application::EventID eventId,Vrui::InputDevice
 void Sandbox::initContext(GLContextData& contextData) const
 	{
 	/* Create a data item and add it to the context: */
-	DataItem* dataItem=new DataItem;
+	DataItem* dataItem=new DataItem(gridRequest);
 	contextData.addDataItem(this,dataItem);
 	
+	/* Create a fixed-rate water simulation scheduler if requested: */
+	if(waterTable!=0&&waterSimulationRate>0.0)
+		dataItem->waterScheduler=new WaterScheduler(waterSimulationRate,waterMaxTicksPerFrame,waterSchedulerPolicy);
+	
 	{
 	/* Save the currently bound frame buffer: */
 	GLint currentFrameBuffer;
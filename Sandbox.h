@@ -1,6 +1,6 @@
 /***********************************************************************
 Sandbox - Vrui application to drive an augmented reality sandbox.
-Copyright (c) 2012-2025 Oliver Kreylos
+Copyright (c) 2012-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -22,6 +22,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef SANDBOX_INCLUDED
 #define SANDBOX_INCLUDED
 
+#include <string>
+#include <vector>
 #include <Threads/Mutex.h>
 #include <Threads/TripleBuffer.h>
 #include <Math/Interval.h>
@@ -46,6 +48,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <Kinect/FrameSource.h>
 
 #include "Types.h"
+#include "WaterScheduler.h"
+#include "WaterDisk.h"
+#include "GridReadback.h"
 
 /* Forward declarations: */
 namespace Misc {
@@ -69,10 +74,16 @@ class DepthImageRenderer;
 class ElevationColorMap;
 class DEM;
 class SurfaceRenderer;
+class TextureTracker;
 class WaterTable2;
 class PropertyGridCreator;
 class HandExtractor;
-typedef Misc::FunctionCall<GLContextData&> AddWaterFunction;
+class DepthFrameRecorder;
+class LatencyMonitor;
+class WaterTelemetry;
+class WaterCheckpoint;
+class WaterCheckpointStreamer;
+typedef Misc::FunctionCall<WaterDiskList&> AddWaterDiskFunction;
 class RemoteServer;
 class WaterRenderer;
 
@@ -84,86 +95,73 @@ class Sandbox:public Vrui::Application,public GLObject
 	typedef Geometry::OrthonormalTransformation<Scalar,3> ONTransform; // Type for rigid body transformations
 	typedef Kinect::FrameSource::DepthCorrection::PixelCorrection PixelDepthCorrection; // Type for per-pixel depth correction factors
 	
-	struct DataItem:public GLObject::DataItem
-		{
-		/* Elements: */
-		public:
-		double waterTableTime; // Simulation time stamp of the water table in this OpenGL context
-		Size shadowBufferSize; // Size of the shadow rendering frame buffer
-		GLuint shadowFramebufferObject; // Frame buffer object to render shadow maps
-		GLuint shadowDepthTextureObject; // Depth texture for the shadow rendering frame buffer
-		
-		/* Constructors and destructors: */
-		DataItem(void);
-		virtual ~DataItem(void);
-		};
-	
-	struct GridRequest // Structure representing a request to read back bathymetry and/or water level grids from the GPU
+	struct GridRequest // Structure representing a queue of requests to read back bathymetry, water level, and/or snow height grids from the GPU; all requests queued before a read-back starts are served by that read-back's shared grids
 		{
 		/* Embedded classes: */
 		public:
-		typedef void (*CallbackFunction)(GLfloat*,GLfloat*,GLfloat*,void*); // Type for callback functions
+		typedef void (*CallbackFunction)(const GridReadbackPtr&,void*); // Type for callback functions
 		
 		struct Request // Structure holding a request's parameters
 			{
 			/* Elements: */
 			public:
-			GLfloat* bathymetryBuffer; // Pointer to a buffer to hold the requested bathymetry grid if requested
-			GLfloat* waterLevelBuffer; // Pointer to a buffer to hold the requested water level grid if requested
-			GLfloat* snowHeightBuffer; // Pointer to a buffer to hold the requested snow height grid if requested
+			unsigned int gridMask; // Bit mask of requested grids, as GridReadback::GridMask
 			CallbackFunction callback; // Function to call when the grid(s) has/have been read back
 			void* callbackData; // Additional data element to pass to callback function
-			
-			/* Constructors and destructors: */
-			Request(void) // Creates an inactive request
-				:bathymetryBuffer(0),waterLevelBuffer(0),snowHeightBuffer(0),
-				 callback(0),callbackData(0)
-				{
-				}
-			
-			/* Methods: */
-			bool isActive(void) const // Returns true if there is a pending request
-				{
-				return callback!=0;
-				}
-			void complete(void) // Calls the read-back callback
-				{
-				(*callback)(bathymetryBuffer,waterLevelBuffer,snowHeightBuffer,callbackData);
-				}
+			};
+		
+		typedef std::vector<Request> RequestList; // Type for lists of requests
+		
+		struct Batch // Structure holding the requests served by a read-back in flight
+			{
+			/* Elements: */
+			public:
+			unsigned int id; // Unique identifier of the batch
+			RequestList requests; // Requests to be completed when the read-back finishes
 			};
 		
 		/* Elements: */
 		Threads::Mutex mutex; // Mutex serializing access to the request structure
-		Request currentRequest; // The currently pending grid request
+		Threads::Mutex callbackMutex; // Mutex held while completed requests' callbacks are called, so that cancelling requests can wait for a callback in progress
+		RequestList queuedRequests; // Requests waiting for the next read-back
+		std::vector<Batch> activeBatches; // Batches of requests whose read-backs are in flight
+		unsigned int lastBatchId; // Identifier of the most recently started batch
 		
 		/* Constructors and destructors: */
-		GridRequest(void) // Creates an inactive grid request
+		GridRequest(void) // Creates an empty request queue
+			:lastBatchId(0)
 			{
 			}
 		
 		/* Methods: */
-		bool requestGrids(GLfloat* newBathymetryBuffer,GLfloat* newWaterLevelBuffer,GLfloat* newSnowHeightBuffer,CallbackFunction newCallback,void* newCallbackData) // Requests a grid read-back; returns true if request has been granted
-			{
-			Threads::Mutex::Lock lock(mutex);
-			if(currentRequest.callback==0)
-				{
-				currentRequest.bathymetryBuffer=newBathymetryBuffer;
-				currentRequest.waterLevelBuffer=newWaterLevelBuffer;
-				currentRequest.snowHeightBuffer=newSnowHeightBuffer;
-				currentRequest.callback=newCallback;
-				currentRequest.callbackData=newCallbackData;
-				return true;
-				}
-			else
-				return false;
-			}
-		Request getRequest(void) // Returns the current grid request and deactivates it
-			{
-			Threads::Mutex::Lock lock(mutex);
-			Request result=currentRequest;
-			currentRequest.callback=0;
-			return result;
-			}
+		bool requestGrids(unsigned int gridMask,CallbackFunction callback,void* callbackData); // Queues a grid read-back request; returns false if the same callback already has a queued request, which is extended to the given grids instead
+		void cancelRequests(void* callbackData); // Cancels all queued and in-flight requests with the given callback data and waits for a callback in progress to return; must be called before the callback data is destroyed, and not from inside a callback
+		unsigned int startBatch(unsigned int& gridMask); // Moves all queued requests into a new batch and returns its identifier and the union of their grid masks, or returns 0 if no requests are queued
+		void requeueBatch(unsigned int batchId); // Moves the requests of the batch of the given identifier back into the queue to be served by a later read-back
+		void finishBatch(unsigned int batchId,const GridReadbackPtr& grids); // Removes the batch of the given identifier and calls the callbacks of its requests that have not been cancelled with the given grids
+		};
+	
+	struct DataItem:public GLObject::DataItem
+		{
+		/* Elements: */
+		public:
+		double waterTableTime; // Simulation time stamp of the water table in this OpenGL context
+		GLfloat waterTimeStep; // Amount of simulation time not yet covered by water simulation steps with known step sizes, carried over between frames
+		WaterScheduler* waterScheduler; // Scheduler running water simulation ticks at a fixed rate in this OpenGL context, or null if the water simulation advances by each frame's duration
+		Size shadowBufferSize; // Size of the shadow rendering frame buffer
+		GLuint shadowFramebufferObject; // Frame buffer object to render shadow maps
+		GLuint shadowDepthTextureObject; // Depth texture for the shadow rendering frame buffer
+		unsigned int renderedDepthImageVersion; // Version number of the depth image most recently rendered in this OpenGL context, to measure latency
+		std::string waterCheckpointFileName; // Name of the file to which the water simulation state read back in this OpenGL context will be saved, or empty if no read-back is pending
+		unsigned int restoredWaterCheckpointVersion; // Version number of the water simulation checkpoint most recently restored in this OpenGL context
+		GridRequest& gridRequest; // Queue of grid read-back requests whose batches are served in this OpenGL context
+		unsigned int pendingGridBatchIds[2]; // Identifiers of grid request batches whose read-backs are in flight in this OpenGL context, oldest first
+		GridReadbackPtr pendingGridReadbacks[2]; // Grids receiving the read-backs in flight in this OpenGL context
+		unsigned int numPendingGridBatches; // Number of grid request batches whose read-backs are in flight in this OpenGL context
+		
+		/* Constructors and destructors: */
+		DataItem(GridRequest& sGridRequest);
+		virtual ~DataItem(void);
 		};
 	
 	struct RenderSettings // Structure to hold per-window rendering settings
@@ -211,6 +209,8 @@ class Sandbox:public Vrui::Application,public GLObject
 	FrameFilter* frameFilter; // Processing object to filter raw depth frames from the Kinect camera
 	bool pauseUpdates; // Pauses updates of the topography
 	Threads::TripleBuffer<Kinect::FrameBuffer> filteredFrames; // Triple buffer for incoming filtered depth frames
+	Threads::Mutex filteredFramesMutex; // Mutex serializing posting and locking filtered depth frames and their changed pixel rectangles
+	Rect filteredFramesDirtyRect; // Rectangle of depth pixels changed by all filtered depth frames posted since the most recently locked one
 	DepthImageRenderer* depthImageRenderer; // Object managing the current filtered depth image
 	ONTransform boxTransform; // Transformation from camera space to baseplane space (x along long sandbox axis, z up)
 	Scalar boxSize; // Radius of sphere around sandbox area
@@ -218,12 +218,26 @@ class Sandbox:public Vrui::Application,public GLObject
 	WaterTable2* waterTable; // Water flow simulation object
 	double waterSpeed; // Relative speed of water flow simulation
 	unsigned int waterMaxSteps; // Maximum number of water simulation steps per frame
+	double waterSimulationRate; // Fixed rate of water simulation ticks per second, or 0 to advance the water simulation by each frame's duration
+	unsigned int waterMaxTicksPerFrame; // Maximum number of water simulation ticks per frame
+	WaterScheduler::Policy waterSchedulerPolicy; // Policy for frames that can not run all due water simulation ticks
+	mutable GLfloat activeWaterTileFraction; // Fraction of the water table simulated during the most recent water simulation step
+	WaterTelemetry* waterTelemetry; // Rolling log of water simulation step counts, time deficits, and health statistics
+	WaterCheckpointStreamer* waterCheckpointStreamer; // Object writing and reading water simulation checkpoint files in the background
+	std::string waterCheckpointFileName; // Name of the file to which the water simulation state is saved periodically, or empty to disable periodic checkpoints
+	double waterCheckpointInterval; // Application time between periodic water simulation checkpoints in seconds
+	double nextWaterCheckpointTime; // Application time at which the next periodic water simulation checkpoint is due
+	mutable Threads::Mutex waterCheckpointMutex; // Mutex serializing access to the pending water simulation checkpoint request
+	mutable std::string requestedWaterCheckpointFileName; // Name of the file to which the next water simulation state read-back will be saved, or empty if no checkpoint is requested
+	WaterCheckpoint* restoredWaterCheckpoint; // The most recently read water simulation checkpoint, to be restored in all OpenGL contexts
+	unsigned int restoredWaterCheckpointVersion; // Version number of the most recently read water simulation checkpoint
 	GLfloat rainStrength; // Amount of water deposited by rain tools and objects on each water simulation step
 	PropertyGridCreator* propertyGridCreator; // Object to create water simulation property grids from color camera images
 	HandExtractor* handExtractor; // Object to detect splayed hands above the sand surface to make rain
-	const AddWaterFunction* addWaterFunction; // Render function registered with the water table
-	bool addWaterFunctionRegistered; // Flag if the water adding function is currently registered with the water table
-	mutable GridRequest gridRequest; // Structure holding pending grid read-back requests
+	const AddWaterDiskFunction* addRainDisksFunction; // Water disk function registered with the water table
+	DepthFrameRecorder* depthFrameRecorder; // Optional object to record raw depth and color frames for offline replay
+	LatencyMonitor* latencyMonitor; // Object tracking the latency of depth frames through the processing and rendering pipeline
+	mutable GridRequest gridRequest; // Queue of pending grid read-back requests
 	std::vector<RenderSettings> renderSettings; // List of per-window rendering settings
 	Vrui::Lightsource* sun; // An external fixed light source
 	DEM* activeDem; // The currently active DEM
@@ -236,6 +250,7 @@ class Sandbox:public Vrui::Application,public GLObject
 	GLMotif::TextFieldSlider* waterSpeedSlider;
 	GLMotif::TextFieldSlider* waterMaxStepsSlider;
 	GLMotif::TextField* frameRateTextField;
+	GLMotif::TextField* activeWaterTilesTextField;
 	GLMotif::RadioBox* waterModeRadioBox;
 	GLMotif::TextFieldSlider* waterAttenuationSlider;
 	GLMotif::TextFieldSlider* waterRoughnessSlider;
@@ -244,10 +259,13 @@ class Sandbox:public Vrui::Application,public GLObject
 	
 	/* Private methods: */
 	void rawDepthFrameDispatcher(const Kinect::FrameBuffer& frameBuffer); // Callback receiving raw depth frames from the Kinect camera; forwards them to the frame filter and rain maker objects
+	void rawColorFrameDispatcher(const Kinect::FrameBuffer& frameBuffer); // Callback receiving raw color frames from the Kinect camera; forwards them to the property grid creator and depth frame recorder
 	void receiveFilteredFrame(const Kinect::FrameBuffer& frameBuffer); // Callback receiving filtered depth frames from the filter object
 	void toggleDEM(DEM* dem); // Sets or toggles the currently active DEM
-	void renderRainDisk(const Point& center,Scalar radius,GLfloat strength) const; // Renders a disk of rain, during rain processing
-	void addWater(GLContextData& contextData) const; // Function to render geometry that adds water to the water table
+	void addRainDisks(WaterDiskList& waterDisks) const; // Function to add a disk of rain for each extracted hand to the water table's water disk list
+	unsigned int runWaterSimulationSteps(GLfloat& totalTimeStep,GLContextData& contextData,TextureTracker& textureTracker) const; // Runs water simulation steps until the given amount of simulation time is covered or the maximum number of steps is reached; returns the number of steps
+	void requestWaterCheckpoint(const std::string& fileName); // Requests saving the water simulation state to a checkpoint file of the given name during the next display pass
+	void restoreWaterCheckpoint(WaterCheckpoint* checkpoint); // Restores the simulation parameters from the given checkpoint and schedules restoring its state in all OpenGL contexts; takes ownership of the checkpoint
 	void pauseUpdatesCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
 	void loadGridPropertyFileCallback(GLMotif::FileSelectionDialog::OKCallbackData* cbData);
 	void saveGridPropertyFileCallback(GLMotif::FileSelectionDialog::OKCallbackData* cbData);
@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <Geometry/OrthogonalTransformation.h>
 #include <Geometry/AffineTransformation.h>
 #include <Geometry/ProjectiveTransformation.h>
+#include <GL/Extensions/GLARBVertexShader.h>
 
 /***********************
 Methods of class Shader:
@@ -151,6 +152,12 @@ unsigned int Shader::setUniformLocation(const char* uniformName)
 	return result;
 	}
 
+GLint Shader::getAttribLocation(const char* attribName) const
+	{
+	/* Query the attribute location from the linked shader program object: */
+	return glGetAttribLocationARB(shaderProgram,attribName);
+	}
+
 namespace {
 
 /*************************************************************
@@ -73,6 +73,7 @@ class Shader
 		{
 		return uniformLocations[uniformIndex];
 		}
+	GLint getAttribLocation(const char* attribName) const; // Returns the location of the vertex attribute of the given name in the linked shader program, or -1 if the attribute is not used
 	
 	/* Methods to use and disable shader programs: */
 	void use(void) // Installs the shader program as the active shader program in the current OpenGL context and prepares to upload uniform variables
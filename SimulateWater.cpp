@@ -0,0 +1,615 @@
+/***********************************************************************
+SimulateWater - Utility to run the CPU reference implementation of the
+AR Sandbox's water flow simulation on synthetic scenarios without a GPU,
+to benchmark it and to check its water level grids against golden
+outputs.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <Misc/SizedTypes.h>
+#include <Misc/StdError.h>
+#include <Math/Math.h>
+#include <IO/File.h>
+#include <IO/OpenFile.h>
+
+#include "WaterTable2CPU.h"
+#include "WaterScenario.h"
+#include "WaterGridFile.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline double getMonotonicTime(void) // Returns the current time of the monotonic clock in seconds
+	{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return double(now.tv_sec)+double(now.tv_nsec)*1.0e-9;
+	}
+
+/**************
+Helper classes:
+**************/
+
+class SimulationSettings // Class holding the settings of a simulation run
+	{
+	/* Elements: */
+	public:
+	WaterScenario scenario; // The simulated scenario
+	Size size; // Water table size in cells
+	float cellSize; // Water table cell width and height
+	WaterTable2CPU::Mode mode; // Water simulation mode
+	float attenuation; // Attenuation factor for partial discharges in traditional mode
+	float roughness,absorption; // Global roughness coefficient and absorption rate in engineering mode
+	unsigned int numThreads; // Number of simulation threads
+	unsigned int tileSize; // Tile size for local time stepping, or zero to use global time steps
+	unsigned int maxTileLevel; // Maximum time stepping level of any tile
+	float dryDepth; // Water column height up to which a cell is considered dry for local time stepping
+	bool halfPrecision; // Flag whether to store derivatives and auxiliary grids at half precision
+	bool printStats; // Flag whether to print health statistics along with each collected water level grid
+	unsigned int numFrames; // Number of simulated display frames
+	double frameTime; // Duration of each simulated display frame in seconds
+	double waterSpeed; // Ratio of simulated time to display time
+	unsigned int waterMaxSteps; // Maximum number of simulation steps per display frame
+	unsigned int gridInterval; // Number of display frames between saved or checked water level grids
+	
+	/* Constructors and destructors: */
+	SimulationSettings(void) // Creates default settings matching the AR Sandbox's defaults where applicable
+		:scenario(DamBreak),size(320,240),cellSize(0.25f),
+		 mode(WaterTable2CPU::Traditional),attenuation(127.0f/128.0f),
+		 roughness(0.01f),absorption(0.0f),
+		 numThreads(1),
+		 tileSize(0),maxTileLevel(3),dryDepth(1.0e-3f),
+		 halfPrecision(false),printStats(false),
+		 numFrames(300),frameTime(1.0/60.0),waterSpeed(1.0),waterMaxSteps(30),
+		 gridInterval(60)
+		{
+		}
+	
+	/* Methods: */
+	WaterTable2CPU* createWaterTable(void) const // Creates a water table and initializes it with the scenario's bathymetry and water
+		{
+		float cs[2]={cellSize,cellSize};
+		WaterTable2CPU* result=new WaterTable2CPU(size,cs,numThreads);
+		result->setMode(mode);
+		result->setAttenuation(attenuation);
+		result->setProperties(roughness,absorption);
+		result->setLocalTimeStepping(tileSize,maxTileLevel,dryDepth);
+		result->setHalfPrecision(halfPrecision);
+		
+		/* Create the scenario's vertex-centered bathymetry grid: */
+		Size bSize=result->getBathymetrySize();
+		std::vector<float> bathymetry(size_t(bSize[1])*size_t(bSize[0]));
+		createScenarioBathymetry(scenario,size,&bathymetry.front());
+		result->updateBathymetry(&bathymetry.front());
+		
+		/* Create the scenario's cell-centered water level and water source grids: */
+		std::vector<float> water(size_t(size[1])*size_t(size[0]));
+		std::vector<float> source(size_t(size[1])*size_t(size[0]));
+		createScenarioWater(scenario,size,&water.front(),&source.front());
+		result->setWaterLevel(&water.front());
+		if(scenario==Rain)
+			{
+			/* Let it snow on the upper end of the valley: */
+			result->setWaterSource(&source.front());
+			result->setSnowLine(rainScenarioSnowLine);
+			}
+		
+		return result;
+		}
+	};
+
+class WaterGrids // Class holding a sequence of water level grids and the simulation times at which they were taken
+	{
+	/* Elements: */
+	public:
+	Size size; // Size of all grids
+	std::vector<double> times; // Simulation times of all grids
+	std::vector<std::vector<float> > grids; // Water level grids
+	
+	/* Constructors and destructors: */
+	WaterGrids(const Size& sSize)
+		:size(sSize)
+		{
+		}
+	
+	/* Methods: */
+	void addGrid(double time,const WaterTable2CPU& waterTable) // Adds the given water table's current water level grid
+		{
+		times.push_back(time);
+		grids.push_back(std::vector<float>(size_t(size[1])*size_t(size[0])));
+		waterTable.readQuantityGrid(1,&grids.back().front());
+		}
+	void write(const char* fileName) const // Writes all grids to a water grid file of the given name
+		{
+		IO::FilePtr file(IO::openFile(fileName,IO::File::WriteOnly));
+		file->setEndianness(Misc::LittleEndian);
+		
+		/* Write the file header: */
+		WaterGridFileHeader header;
+		for(int i=0;i<2;++i)
+			header.gridSize[i]=size[i];
+		header.numGrids=Misc::UInt32(grids.size());
+		file->write(header.magic,sizeof(header.magic));
+		file->write(&header.version,1);
+		file->write(header.gridSize,2);
+		file->write(&header.numGrids,1);
+		
+		/* Write the grid records: */
+		for(size_t i=0;i<grids.size();++i)
+			{
+			file->write<Misc::Float64>(times[i]);
+			file->write(&grids[i].front(),grids[i].size());
+			}
+		}
+	void read(const char* fileName) // Replaces all grids with those read from a water grid file of the given name
+		{
+		IO::FilePtr file(IO::openFile(fileName,IO::File::ReadOnly));
+		file->setEndianness(Misc::LittleEndian);
+		
+		/* Read and check the file header: */
+		WaterGridFileHeader header;
+		file->read(header.magic,sizeof(header.magic));
+		file->read(&header.version,1);
+		file->read(header.gridSize,2);
+		file->read(&header.numGrids,1);
+		if(!header.isValid())
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"%s is not a water grid file",fileName);
+		size=Size(header.gridSize[0],header.gridSize[1]);
+		
+		/* Read the grid records: */
+		times.resize(header.numGrids);
+		grids.resize(header.numGrids);
+		for(unsigned int i=0;i<header.numGrids;++i)
+			{
+			times[i]=file->read<Misc::Float64>();
+			grids[i].resize(size_t(size[1])*size_t(size[0]));
+			file->read(&grids[i].front(),grids[i].size());
+			}
+		}
+	};
+
+bool checkGrids(const WaterGrids& grids,const WaterGrids& golden,float tolerance) // Compares the given water level grids against golden grids; returns true if all grids match within the given tolerance
+	{
+	if(grids.size[0]!=golden.size[0]||grids.size[1]!=golden.size[1]||grids.grids.size()!=golden.grids.size())
+		{
+		std::cout<<"Mismatch: "<<grids.grids.size()<<" grids of size "<<grids.size[0]<<" x "<<grids.size[1];
+		std::cout<<" vs. "<<golden.grids.size()<<" golden grids of size "<<golden.size[0]<<" x "<<golden.size[1]<<std::endl;
+		return false;
+		}
+	
+	bool result=true;
+	std::ios::fmtflags oldFlags=std::cout.flags();
+	std::streamsize oldPrecision=std::cout.precision();
+	std::cout<<std::setw(10)<<"Time"<<std::setw(14)<<"Max diff"<<std::setw(14)<<"RMS diff"<<std::setw(14)<<"Cells > tol"<<std::endl;
+	for(size_t i=0;i<grids.grids.size();++i)
+		{
+		/* Compare the two grids cell by cell: */
+		const std::vector<float>& g=grids.grids[i];
+		const std::vector<float>& gg=golden.grids[i];
+		double maxDiff=0.0;
+		double sumDiff2=0.0;
+		size_t numFailedCells=0;
+		for(size_t j=0;j<g.size();++j)
+			{
+			double diff=Math::abs(double(g[j])-double(gg[j]));
+			if(!(diff<=double(tolerance))) // Also catches NaNs
+				{
+				++numFailedCells;
+				diff=Math::max(diff,double(tolerance));
+				}
+			maxDiff=Math::max(maxDiff,diff);
+			sumDiff2+=diff*diff;
+			}
+		
+		std::cout<<std::fixed<<std::setprecision(4)<<std::setw(10)<<grids.times[i];
+		std::cout<<std::scientific<<std::setprecision(3)<<std::setw(14)<<maxDiff<<std::setw(14)<<Math::sqrt(sumDiff2/double(g.size()));
+		std::cout<<std::setw(14)<<numFailedCells;
+		if(Math::abs(grids.times[i]-golden.times[i])>1.0e-3)
+			std::cout<<" (golden time "<<std::fixed<<std::setprecision(4)<<golden.times[i]<<')';
+		std::cout<<std::endl;
+		if(numFailedCells!=0)
+			result=false;
+		}
+	std::cout.flags(oldFlags);
+	std::cout.precision(oldPrecision);
+	
+	return result;
+	}
+
+double runSimulation(const SimulationSettings& settings,WaterGrids& grids) // Runs a simulation with the given settings and collects water level grids at regular intervals; prints benchmark results and returns the relative change in total water volume, or the absolute change if the initial volume is zero
+	{
+	/* Create and initialize the water table: */
+	WaterTable2CPU* waterTable=settings.createWaterTable();
+	Size size=waterTable->getSize();
+	std::cout<<"Simulating "<<settings.numFrames<<" frames on a "<<size[0]<<" x "<<size[1]<<" water grid using "<<waterTable->getNumThreads()<<" thread(s) in "<<(settings.halfPrecision?"half":"single")<<" precision"<<std::endl;
+	double initialVolume=waterTable->calcWaterVolume();
+	if(settings.printStats)
+		std::cout<<std::setw(10)<<"Time"<<std::setw(8)<<"Steps"<<std::setw(14)<<"Volume"<<std::setw(12)<<"Max speed"<<std::setw(10)<<"Wet cells"<<std::setw(12)<<"Max depth"<<std::endl;
+	
+	/* Run the simulation the same way the AR Sandbox does in each frame, and collect water level grids at regular intervals: */
+	double simulationTime=0.0;
+	unsigned int numSteps=0;
+	unsigned int numGridSteps=0;
+	unsigned int numDeficitFrames=0;
+	double startTime=getMonotonicTime();
+	for(unsigned int frame=0;frame<settings.numFrames;++frame)
+		{
+		float totalTimeStep=float(settings.frameTime*settings.waterSpeed);
+		unsigned int numFrameSteps=0;
+		while(numFrameSteps<settings.waterMaxSteps&&totalTimeStep>1.0e-8f)
+			{
+			/* Run with a self-determined time step to maintain stability: */
+			waterTable->setMaxStepSize(totalTimeStep);
+			float timeStep=waterTable->runSimulationStep(false);
+			totalTimeStep-=timeStep;
+			simulationTime+=double(timeStep);
+			++numFrameSteps;
+			}
+		numSteps+=numFrameSteps;
+		if(totalTimeStep>1.0e-8f)
+			++numDeficitFrames;
+		
+		if((frame+1)%settings.gridInterval==0)
+			{
+			/* Collect the current water level grid, excluding the time to do so from the benchmark: */
+			double collectStartTime=getMonotonicTime();
+			grids.addGrid(simulationTime,*waterTable);
+			if(settings.printStats)
+				{
+				/* Print the current health statistics: */
+				WaterStats stats;
+				waterTable->calcStats(settings.dryDepth,stats);
+				std::ios::fmtflags oldFlags=std::cout.flags();
+				std::streamsize oldPrecision=std::cout.precision();
+				std::cout<<std::fixed<<std::setprecision(4)<<std::setw(10)<<simulationTime<<std::setw(8)<<numSteps-numGridSteps;
+				std::cout<<std::setw(14)<<stats.volume<<std::setw(12)<<stats.maxSpeed<<std::setw(10)<<stats.numWetCells<<std::setw(12)<<stats.maxDepth<<std::endl;
+				std::cout.flags(oldFlags);
+				std::cout.precision(oldPrecision);
+				numGridSteps=numSteps;
+				}
+			startTime+=getMonotonicTime()-collectStartTime;
+			}
+		}
+	double elapsed=getMonotonicTime()-startTime;
+	
+	/* Print the benchmark results: */
+	std::cout<<"Ran "<<numSteps<<" simulation steps covering "<<simulationTime<<" s of simulated time in "<<elapsed<<" s"<<std::endl;
+	if(numDeficitFrames!=0)
+		std::cout<<numDeficitFrames<<" frame(s) ran out of simulation steps"<<std::endl;
+	std::cout<<"Steps per second: "<<double(numSteps)/elapsed<<std::endl;
+	if(waterTable->getTileSize()!=0)
+		{
+		/* Print local time stepping statistics: */
+		const WaterTable2CPU::LocalTimeSteppingStats& stats=waterTable->getLocalTimeSteppingStats();
+		std::cout<<"Cell updates per second: "<<stats.numCellSteps/elapsed<<std::endl;
+		std::cout<<"Local time stepping: "<<stats.numBaseSteps<<" base steps in "<<stats.numCycles<<" cycles, ";
+		std::cout<<100.0*stats.numActiveTileCycles/stats.numTileCycles<<"% active tiles, ";
+		std::cout<<stats.numGlobalCellSteps/stats.numCellSteps<<"x fewer cell updates than global time stepping"<<std::endl;
+		
+		/* Print a histogram of the final tile activity mask: */
+		Size tileGridSize=waterTable->getTileGridSize();
+		std::vector<unsigned char> mask(size_t(tileGridSize[1])*size_t(tileGridSize[0]));
+		waterTable->readTileMask(&mask.front());
+		unsigned int levelCounts[9]={0,0,0,0,0,0,0,0,0};
+		for(std::vector<unsigned char>::iterator mIt=mask.begin();mIt!=mask.end();++mIt)
+			++levelCounts[*mIt<8?*mIt:8];
+		std::cout<<"Final tiles per level:";
+		for(int level=0;level<8;++level)
+			if(levelCounts[level]!=0)
+				std::cout<<' '<<level<<": "<<levelCounts[level];
+		std::cout<<", dry: "<<levelCounts[8]<<std::endl;
+		}
+	else
+		std::cout<<"Cell updates per second: "<<double(numSteps)*double(size[1])*double(size[0])/elapsed<<std::endl;
+	std::cout<<"Simulated time per second: "<<simulationTime/elapsed<<" s"<<std::endl;
+	
+	/* Print the change in total water volume: */
+	double finalVolume=waterTable->calcWaterVolume();
+	double volumeChange=initialVolume!=0.0?(finalVolume-initialVolume)/initialVolume:finalVolume;
+	std::cout<<"Water volume: "<<initialVolume<<" initial, "<<finalVolume<<" final, ";
+	if(initialVolume!=0.0)
+		std::cout<<volumeChange<<" relative change"<<std::endl;
+	else
+		std::cout<<volumeChange<<" absolute change, no relative change from an empty initial state"<<std::endl;
+	delete waterTable;
+	
+	return volumeChange;
+	}
+
+void printUsage(void)
+	{
+	std::cout<<"Usage: SARndboxSimulateWater [option 1] ... [option n]"<<std::endl;
+	std::cout<<"  Options:"<<std::endl;
+	std::cout<<"  -h"<<std::endl;
+	std::cout<<"     Prints this help message"<<std::endl;
+	std::cout<<"  -scenario <scenario name>"<<std::endl;
+	std::cout<<"     Selects the simulated scenario (DamBreak, Basin, Rain, or Trench)"<<std::endl;
+	std::cout<<"     Default: DamBreak"<<std::endl;
+	std::cout<<"  -wts <water grid width> <water grid height>"<<std::endl;
+	std::cout<<"     Sets the width and height of the water flow simulation grid"<<std::endl;
+	std::cout<<"     Default: 320 240"<<std::endl;
+	std::cout<<"  -cs <cell size>"<<std::endl;
+	std::cout<<"     Sets the width and height of water flow simulation grid cells"<<std::endl;
+	std::cout<<"     Default: 0.25"<<std::endl;
+	std::cout<<"  -mode <simulation mode>"<<std::endl;
+	std::cout<<"     Selects the water simulation mode (Traditional or Engineering)"<<std::endl;
+	std::cout<<"     Default: Traditional"<<std::endl;
+	std::cout<<"  -att <attenuation>"<<std::endl;
+	std::cout<<"     Sets the attenuation factor for partial discharges in traditional"<<std::endl;
+	std::cout<<"     mode"<<std::endl;
+	std::cout<<"     Default: 0.9921875"<<std::endl;
+	std::cout<<"  -props <roughness> <absorption>"<<std::endl;
+	std::cout<<"     Sets the global roughness coefficient and absorption rate in"<<std::endl;
+	std::cout<<"     engineering mode"<<std::endl;
+	std::cout<<"     Default: 0.01 0"<<std::endl;
+	std::cout<<"  -nst <num simulation threads>"<<std::endl;
+	std::cout<<"     Sets the number of threads used by the water flow simulation"<<std::endl;
+	std::cout<<"     Default: 1"<<std::endl;
+	std::cout<<"  -lts <tile size> <max tile level> <dry depth>"<<std::endl;
+	std::cout<<"     Enables local time stepping on square tiles of the given size, which"<<std::endl;
+	std::cout<<"     advance in steps of up to 2^<max tile level> base steps, and are"<<std::endl;
+	std::cout<<"     skipped if they and their neighbors hold no water deeper than the"<<std::endl;
+	std::cout<<"     given dry depth; only available in this CPU reference simulation, as"<<std::endl;
+	std::cout<<"     the GPU-based simulation always uses global time steps"<<std::endl;
+	std::cout<<"     Default: global time stepping"<<std::endl;
+	std::cout<<"  -precision <precision>"<<std::endl;
+	std::cout<<"     Selects the storage precision of derivatives and auxiliary grids"<<std::endl;
+	std::cout<<"     (Single or Half), or runs the simulation in both precisions and"<<std::endl;
+	std::cout<<"     compares half precision results against single precision (Compare)"<<std::endl;
+	std::cout<<"     Default: Single"<<std::endl;
+	std::cout<<"  -frames <num frames> <frame time>"<<std::endl;
+	std::cout<<"     Sets the number and duration in seconds of simulated display frames"<<std::endl;
+	std::cout<<"     Default: 300 0.0166667"<<std::endl;
+	std::cout<<"  -ws <water speed> <water max steps>"<<std::endl;
+	std::cout<<"     Sets the relative speed of the water simulation and the maximum"<<std::endl;
+	std::cout<<"     number of simulation steps per display frame"<<std::endl;
+	std::cout<<"     Default: 1.0 30"<<std::endl;
+	std::cout<<"  -gi <grid interval>"<<std::endl;
+	std::cout<<"     Sets the number of display frames between saved or checked water"<<std::endl;
+	std::cout<<"     level grids"<<std::endl;
+	std::cout<<"     Default: 60"<<std::endl;
+	std::cout<<"  -stats"<<std::endl;
+	std::cout<<"     Prints health statistics (total volume, maximum flow speed, wet cells,"<<std::endl;
+	std::cout<<"     maximum depth) along with each saved or checked water level grid"<<std::endl;
+	std::cout<<"  -save <water grid file name>"<<std::endl;
+	std::cout<<"     Saves water level grids to a golden output file"<<std::endl;
+	std::cout<<"  -check <water grid file name> <tolerance>"<<std::endl;
+	std::cout<<"     Checks water level grids against a golden output file, and exits"<<std::endl;
+	std::cout<<"     with a non-zero status if any cell differs by more than the given"<<std::endl;
+	std::cout<<"     tolerance"<<std::endl;
+	std::cout<<"  -mass <tolerance>"<<std::endl;
+	std::cout<<"     Checks that the total water volume at the end of each simulation run"<<std::endl;
+	std::cout<<"     differs from the initial volume by at most the given relative"<<std::endl;
+	std::cout<<"     tolerance, and exits with a non-zero status otherwise; only"<<std::endl;
+	std::cout<<"     meaningful for scenarios without water sources whose water does not"<<std::endl;
+	std::cout<<"     reach the dry grid boundary, such as Basin"<<std::endl;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Parse the command line: */
+	SimulationSettings settings;
+	const char* saveFileName=0;
+	const char* checkFileName=0;
+	float checkTolerance=1.0e-3f;
+	bool comparePrecisions=false;
+	double massTolerance=-1.0;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"h")==0)
+				{
+				printUsage();
+				return 0;
+				}
+			else if(strcasecmp(argv[i]+1,"scenario")==0&&i+1<argc)
+				{
+				++i;
+				if(!parseWaterScenario(argv[i],settings.scenario))
+					std::cerr<<"Ignoring unrecognized scenario "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"wts")==0&&i+2<argc)
+				{
+				for(int j=0;j<2;++j)
+					{
+					++i;
+					settings.size[j]=(unsigned int)(atoi(argv[i]));
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"cs")==0&&i+1<argc)
+				{
+				++i;
+				settings.cellSize=float(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"mode")==0&&i+1<argc)
+				{
+				++i;
+				if(strcasecmp(argv[i],"Traditional")==0)
+					settings.mode=WaterTable2CPU::Traditional;
+				else if(strcasecmp(argv[i],"Engineering")==0)
+					settings.mode=WaterTable2CPU::Engineering;
+				else
+					std::cerr<<"Ignoring unrecognized simulation mode "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"att")==0&&i+1<argc)
+				{
+				++i;
+				settings.attenuation=float(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"props")==0&&i+2<argc)
+				{
+				++i;
+				settings.roughness=float(atof(argv[i]));
+				++i;
+				settings.absorption=float(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"nst")==0&&i+1<argc)
+				{
+				++i;
+				settings.numThreads=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"lts")==0&&i+3<argc)
+				{
+				++i;
+				settings.tileSize=atoi(argv[i]);
+				++i;
+				settings.maxTileLevel=atoi(argv[i]);
+				++i;
+				settings.dryDepth=float(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"precision")==0&&i+1<argc)
+				{
+				++i;
+				if(strcasecmp(argv[i],"Single")==0)
+					settings.halfPrecision=false;
+				else if(strcasecmp(argv[i],"Half")==0)
+					settings.halfPrecision=true;
+				else if(strcasecmp(argv[i],"Compare")==0)
+					{
+					settings.halfPrecision=false;
+					comparePrecisions=true;
+					}
+				else
+					std::cerr<<"Ignoring unrecognized precision "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"frames")==0&&i+2<argc)
+				{
+				++i;
+				settings.numFrames=atoi(argv[i]);
+				++i;
+				settings.frameTime=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"ws")==0&&i+2<argc)
+				{
+				++i;
+				settings.waterSpeed=atof(argv[i]);
+				++i;
+				settings.waterMaxSteps=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"gi")==0&&i+1<argc)
+				{
+				++i;
+				settings.gridInterval=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"stats")==0)
+				settings.printStats=true;
+			else if(strcasecmp(argv[i]+1,"save")==0&&i+1<argc)
+				{
+				++i;
+				saveFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"check")==0&&i+2<argc)
+				{
+				++i;
+				checkFileName=argv[i];
+				++i;
+				checkTolerance=float(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"mass")==0&&i+1<argc)
+				{
+				++i;
+				massTolerance=atof(argv[i]);
+				}
+			else
+				std::cerr<<"Ignoring unrecognized command line option "<<argv[i]<<std::endl;
+			}
+		else
+			std::cerr<<"Ignoring unrecognized command line argument "<<argv[i]<<std::endl;
+		}
+	if(settings.size[0]<3||settings.size[1]<3||settings.gridInterval==0)
+		{
+		std::cerr<<"Invalid water grid size or grid interval"<<std::endl;
+		return 1;
+		}
+	
+	try
+		{
+		/* Run the simulation: */
+		WaterGrids grids(settings.size);
+		std::vector<double> volumeChanges;
+		volumeChanges.push_back(runSimulation(settings,grids));
+		
+		if(comparePrecisions)
+			{
+			/* Run the simulation again in half precision, and compare its water level grids against the single precision ones: */
+			SimulationSettings halfSettings=settings;
+			halfSettings.halfPrecision=true;
+			WaterGrids halfGrids(settings.size);
+			volumeChanges.push_back(runSimulation(halfSettings,halfGrids));
+			std::cout<<"Comparing half precision water level grids against single precision with tolerance "<<checkTolerance<<std::endl;
+			checkGrids(halfGrids,grids,checkTolerance);
+			}
+		
+		if(massTolerance>=0.0)
+			{
+			/* Check that all simulation runs conserved the total water volume: */
+			bool massConserved=true;
+			for(std::vector<double>::iterator vcIt=volumeChanges.begin();vcIt!=volumeChanges.end();++vcIt)
+				if(!(Math::abs(*vcIt)<=massTolerance)) // Also catches NaNs
+					massConserved=false;
+			if(!massConserved)
+				{
+				std::cout<<"Mass conservation check with tolerance "<<massTolerance<<" FAILED"<<std::endl;
+				return 1;
+				}
+			std::cout<<"Mass conservation check with tolerance "<<massTolerance<<" passed"<<std::endl;
+			}
+		
+		if(saveFileName!=0)
+			{
+			/* Save the collected water level grids: */
+			grids.write(saveFileName);
+			std::cout<<"Saved "<<grids.grids.size()<<" water level grids to "<<saveFileName<<std::endl;
+			}
+		
+		if(checkFileName!=0)
+			{
+			/* Check the collected water level grids against the golden output: */
+			WaterGrids golden(grids.size);
+			golden.read(checkFileName);
+			std::cout<<"Checking "<<grids.grids.size()<<" water level grids against "<<checkFileName<<" with tolerance "<<checkTolerance<<std::endl;
+			if(!checkGrids(grids,golden,checkTolerance))
+				{
+				std::cout<<"Check FAILED"<<std::endl;
+				return 1;
+				}
+			std::cout<<"Check passed"<<std::endl;
+			}
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Caught exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	
+	return 0;
+	}
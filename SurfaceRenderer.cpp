@@ -877,16 +877,16 @@ void SurfaceRenderer::renderSinglePass(const SurfaceRenderer::Rect& viewport,con
 		waterTable->uploadWaterTextureTransform(dataItem->heightMapShader);
 		
 		/* Bind the bathymetry texture: */
-		dataItem->heightMapShader.uploadUniform(waterTable->bindBathymetryTexture(contextData,textureTracker,true));
+		dataItem->heightMapShader.uploadUniform(waterTable->bindRenderBathymetryTexture(contextData,textureTracker,true));
 		
 		/* Bind the snow height texture: */
-		dataItem->heightMapShader.uploadUniform(waterTable->bindSnowTexture(contextData,textureTracker,true));
+		dataItem->heightMapShader.uploadUniform(waterTable->bindRenderSnowTexture(contextData,textureTracker,true));
 		
 		/* Bind the conserved quantities texture: */
-		dataItem->heightMapShader.uploadUniform(waterTable->bindQuantityTexture(contextData,textureTracker,true));
+		dataItem->heightMapShader.uploadUniform(waterTable->bindRenderQuantityTexture(contextData,textureTracker,true));
 		
 		/* Upload the water grid cell size for normal vector calculation: */
-		dataItem->heightMapShader.uploadUniform2v(1,waterTable->getCellSize());
+		dataItem->heightMapShader.uploadUniform2v(1,waterTable->getRenderCellSize());
 		
 		/* Upload the water opacity factor: */
 		dataItem->heightMapShader.uploadUniform(waterOpacity);
@@ -0,0 +1,161 @@
+/***********************************************************************
+WaterCheckpoint - Class holding the complete state of a water flow
+simulation, i.e., its bathymetry, conserved quantity, and snow height
+grids and its simulation parameters, and reading and writing it from/to
+compact binary checkpoint files.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "WaterCheckpoint.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <string>
+#include <stdexcept>
+#include <Misc/StdError.h>
+#include <IO/File.h>
+#include <IO/OpenFile.h>
+
+/********************************
+Methods of class WaterCheckpoint:
+********************************/
+
+WaterCheckpoint::WaterCheckpoint(const Size& sSize)
+	:size(sSize),
+	 mode(0),
+	 theta(0.0f),g(0.0f),epsilon(0.0f),
+	 attenuation(1.0f),maxStepSize(0.0f),
+	 snowLine(0.0f),snowMelt(0.0f),waterDeposit(0.0f),
+	 dryBoundary(true),
+	 bathymetry(size_t(size[1]-1)*size_t(size[0]-1)),
+	 quantity(size_t(size[1])*size_t(size[0])*3),
+	 snow(size_t(size[1])*size_t(size[0]))
+	{
+	for(int i=0;i<2;++i)
+		{
+		cellSize[i]=0.0f;
+		maxPropagationSpeed[i]=0.0f;
+		}
+	}
+
+WaterCheckpoint::WaterCheckpoint(const char* fileName)
+	{
+	IO::FilePtr file(IO::openFile(fileName,IO::File::ReadOnly));
+	file->setEndianness(Misc::LittleEndian);
+	
+	/* Read and check the file header: */
+	WaterCheckpointFileHeader header;
+	file->read(header.magic,sizeof(header.magic));
+	file->read(&header.version,1);
+	file->read(header.gridSize,2);
+	if(!header.isValid())
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"%s is not a water checkpoint file",fileName);
+	if(header.gridSize[0]<2||header.gridSize[1]<2||header.gridSize[0]>WaterCheckpointFileHeader::maxGridSize||header.gridSize[1]>WaterCheckpointFileHeader::maxGridSize)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"%s has invalid grid size %u x %u",fileName,header.gridSize[0],header.gridSize[1]);
+	
+	/* Check the grid size against the file's size before allocating any grids: */
+	struct stat fileStats;
+	if(stat(fileName,&fileStats)!=0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to query size of %s due to error %s",fileName,strerror(errno));
+	if(Misc::UInt64(fileStats.st_size)!=header.getFileSize())
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"%s has %llu bytes instead of the %llu bytes required by its grid size %u x %u",fileName,(unsigned long long)(fileStats.st_size),(unsigned long long)(header.getFileSize()),header.gridSize[0],header.gridSize[1]);
+	size=Size(header.gridSize[0],header.gridSize[1]);
+	
+	/* Read the simulation parameters: */
+	mode=file->read<Misc::UInt32>();
+	dryBoundary=file->read<Misc::UInt32>()!=0;
+	file->read(cellSize,2);
+	theta=file->read<Misc::Float32>();
+	g=file->read<Misc::Float32>();
+	epsilon=file->read<Misc::Float32>();
+	file->read(maxPropagationSpeed,2);
+	attenuation=file->read<Misc::Float32>();
+	maxStepSize=file->read<Misc::Float32>();
+	snowLine=file->read<Misc::Float32>();
+	snowMelt=file->read<Misc::Float32>();
+	waterDeposit=file->read<Misc::Float32>();
+	
+	/* Read the grids: */
+	bathymetry.resize(size_t(size[1]-1)*size_t(size[0]-1));
+	file->read(&bathymetry.front(),bathymetry.size());
+	quantity.resize(size_t(size[1])*size_t(size[0])*3);
+	file->read(&quantity.front(),quantity.size());
+	snow.resize(size_t(size[1])*size_t(size[0]));
+	file->read(&snow.front(),snow.size());
+	}
+
+void WaterCheckpoint::write(const char* fileName) const
+	{
+	/* Write into a temporary file next to the destination, so that a crash or full disk never leaves a truncated checkpoint behind: */
+	std::string tempFileName=fileName;
+	tempFileName.append(".tmp");
+	try
+		{
+		writeFile(tempFileName.c_str());
+		}
+	catch(const std::runtime_error&)
+		{
+		/* Remove the partially written temporary file: */
+		remove(tempFileName.c_str());
+		throw;
+		}
+	
+	/* Atomically replace any existing checkpoint file with the complete temporary file: */
+	if(rename(tempFileName.c_str(),fileName)!=0)
+		{
+		int error=errno;
+		remove(tempFileName.c_str());
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to rename %s to %s due to error %s",tempFileName.c_str(),fileName,strerror(error));
+		}
+	}
+
+void WaterCheckpoint::writeFile(const char* fileName) const
+	{
+	IO::FilePtr file(IO::openFile(fileName,IO::File::WriteOnly));
+	file->setEndianness(Misc::LittleEndian);
+	
+	/* Write the file header: */
+	WaterCheckpointFileHeader header;
+	for(int i=0;i<2;++i)
+		header.gridSize[i]=size[i];
+	file->write(header.magic,sizeof(header.magic));
+	file->write(&header.version,1);
+	file->write(header.gridSize,2);
+	
+	/* Write the simulation parameters: */
+	file->write<Misc::UInt32>(mode);
+	file->write<Misc::UInt32>(dryBoundary?1U:0U);
+	file->write(cellSize,2);
+	file->write<Misc::Float32>(theta);
+	file->write<Misc::Float32>(g);
+	file->write<Misc::Float32>(epsilon);
+	file->write(maxPropagationSpeed,2);
+	file->write<Misc::Float32>(attenuation);
+	file->write<Misc::Float32>(maxStepSize);
+	file->write<Misc::Float32>(snowLine);
+	file->write<Misc::Float32>(snowMelt);
+	file->write<Misc::Float32>(waterDeposit);
+	
+	/* Write the grids: */
+	file->write(&bathymetry.front(),bathymetry.size());
+	file->write(&quantity.front(),quantity.size());
+	file->write(&snow.front(),snow.size());
+	}
@@ -0,0 +1,117 @@
+/***********************************************************************
+WaterCheckpoint - Class holding the complete state of a water flow
+simulation, i.e., its bathymetry, conserved quantity, and snow height
+grids and its simulation parameters, and reading and writing it from/to
+compact binary checkpoint files.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef WATERCHECKPOINT_INCLUDED
+#define WATERCHECKPOINT_INCLUDED
+
+#include <string.h>
+#include <vector>
+#include <Misc/SizedTypes.h>
+
+#include "Types.h"
+
+/***********************************************************************
+A water checkpoint file is written in little-endian byte order and
+consists of a fixed-size header, followed by the simulation parameters
+as 32-bit unsigned integers (mode, dry boundary flag) and 32-bit
+floating-point numbers (cell size, theta, g, epsilon, maximum
+propagation speeds, attenuation, maximum step size, snow line, snow
+melt rate, water deposit), followed by the vertex-centered bathymetry
+grid, the cell-centered conserved quantity grid with interleaved
+(w, hu, hv) components, and the cell-centered snow height grid as 32-bit
+floating-point numbers in row-major order.
+***********************************************************************/
+
+struct WaterCheckpointFileHeader // Structure for the header at the beginning of a water checkpoint file
+	{
+	/* Elements: */
+	public:
+	char magic[16]; // File identifier, "SARndboxWaterCP" padded with NUL characters
+	Misc::UInt32 version; // File format version number
+	Misc::UInt32 gridSize[2]; // Width and height of the cell-centered grids
+	
+	static const Misc::UInt32 currentVersion=1; // Version number of the current file format
+	static const Misc::UInt32 maxGridSize=32768; // Maximum width and height of the cell-centered grids, beyond any OpenGL texture size
+	
+	/* Constructors and destructors: */
+	WaterCheckpointFileHeader(void) // Creates a header for the current file format version with all other fields set to zero
+		{
+		memset(this,0,sizeof(WaterCheckpointFileHeader));
+		strcpy(magic,"SARndboxWaterCP");
+		version=currentVersion;
+		}
+	
+	/* Methods: */
+	bool isValid(void) const // Returns true if the header identifies a water checkpoint file of a supported version
+		{
+		return strncmp(magic,"SARndboxWaterCP",sizeof(magic))==0&&version==currentVersion;
+		}
+	Misc::UInt64 getFileSize(void) const // Returns the size in bytes of a water checkpoint file with this header's grid size, which must not exceed the maximum grid size
+		{
+		/* Add the header, two integer and twelve floating-point simulation parameters, and the bathymetry, conserved quantity, and snow height grids: */
+		Misc::UInt64 numCells=Misc::UInt64(gridSize[1])*Misc::UInt64(gridSize[0]);
+		Misc::UInt64 numBathymetryCells=Misc::UInt64(gridSize[1]-1)*Misc::UInt64(gridSize[0]-1);
+		return sizeof(magic)+3*sizeof(Misc::UInt32)+2*sizeof(Misc::UInt32)+12*sizeof(Misc::Float32)+(numBathymetryCells+numCells*4)*sizeof(Misc::Float32);
+		}
+	};
+
+class WaterCheckpoint
+	{
+	/* Elements: */
+	public:
+	Size size; // Width and height of the cell-centered grids; the bathymetry grid is one smaller in each direction
+	float cellSize[2]; // Width and height of water table cells in world coordinate units
+	unsigned int mode; // Water simulation mode, as WaterTable2::Mode
+	float theta; // Coefficient for minmod flux-limiting differential operator
+	float g; // Gravitiational acceleration constant
+	float epsilon; // Coefficient for desingularizing division operator
+	float maxPropagationSpeed[2]; // Maximum propagation speeds in x and y to guarantee minimum step size
+	float attenuation; // Attenuation factor for partial discharges
+	float maxStepSize; // Maximum step size for each Runge-Kutta integration step
+	float snowLine; // The elevation of the snow line relative to the base plane
+	float snowMelt; // The rate of snow melt in elevation units per second
+	float waterDeposit; // Amount of water added at every iteration of the flow simulation
+	bool dryBoundary; // Flag whether dry boundary conditions are enforced at the end of each simulation step
+	std::vector<float> bathymetry; // The vertex-centered bathymetry grid
+	std::vector<float> quantity; // The cell-centered conserved quantity grid, with interleaved (w, hu, hv) components
+	std::vector<float> snow; // The cell-centered snow height grid
+	
+	/* Private methods: */
+	private:
+	void writeFile(const char* fileName) const; // Writes the checkpoint directly to a file of the given name
+	
+	/* Constructors and destructors: */
+	public:
+	WaterCheckpoint(const Size& sSize); // Creates a checkpoint with grids of the given size and uninitialized contents
+	WaterCheckpoint(const char* fileName); // Reads a checkpoint from a water checkpoint file of the given name
+	
+	/* Methods: */
+	Size getBathymetrySize(void) const // Returns the width and height of the bathymetry grid
+		{
+		return Size(size[0]-1,size[1]-1);
+		}
+	void write(const char* fileName) const; // Writes the checkpoint to a temporary file and then renames it to a water checkpoint file of the given name
+	};
+
+#endif
@@ -0,0 +1,159 @@
+/***********************************************************************
+WaterCheckpointStreamer - Class to write and read water checkpoint files
+in a background thread, so that saving and loading checkpoints does not
+stall the render loop.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "WaterCheckpointStreamer.h"
+
+#include <stdexcept>
+#include <Misc/MessageLogger.h>
+
+#include "WaterCheckpoint.h"
+
+/****************************************
+Methods of class WaterCheckpointStreamer:
+****************************************/
+
+void* WaterCheckpointStreamer::ioThreadMethod(void)
+	{
+	while(true)
+		{
+		Job job;
+		{
+		Threads::MutexCond::Lock queueLock(queueCond);
+		
+		/* Wait until a job arrives or the streamer shuts down: */
+		while(runIOThread&&queue.empty())
+			queueCond.wait(queueLock);
+		
+		/* Bail out if the streamer is shutting down and all pending jobs have been executed: */
+		if(queue.empty())
+			break;
+		
+		/* Take the oldest job from the queue: */
+		job=queue.front();
+		queue.pop_front();
+		}
+		
+		if(job.checkpoint!=0)
+			{
+			/* Write the checkpoint and release it: */
+			try
+				{
+				job.checkpoint->write(job.fileName.c_str());
+				}
+			catch(const std::runtime_error& err)
+				{
+				Misc::formattedUserError("WaterCheckpointStreamer: Unable to write water checkpoint file %s due to exception %s",job.fileName.c_str(),err.what());
+				}
+			delete job.checkpoint;
+			}
+		else
+			{
+			/* Read the checkpoint: */
+			WaterCheckpoint* checkpoint=0;
+			try
+				{
+				checkpoint=new WaterCheckpoint(job.fileName.c_str());
+				}
+			catch(const std::runtime_error& err)
+				{
+				Misc::formattedUserError("WaterCheckpointStreamer: Unable to read water checkpoint file %s due to exception %s",job.fileName.c_str(),err.what());
+				}
+			
+			if(checkpoint!=0)
+				{
+				/* Replace any read checkpoint that has not been retrieved yet: */
+				Threads::MutexCond::Lock queueLock(queueCond);
+				delete lastReadCheckpoint;
+				lastReadCheckpoint=checkpoint;
+				}
+			}
+		}
+	
+	return 0;
+	}
+
+WaterCheckpointStreamer::WaterCheckpointStreamer(void)
+	:lastReadCheckpoint(0),
+	 runIOThread(true)
+	{
+	/* Start the background I/O thread: */
+	ioThread.start(this,&WaterCheckpointStreamer::ioThreadMethod);
+	}
+
+WaterCheckpointStreamer::~WaterCheckpointStreamer(void)
+	{
+	/* Shut down the I/O thread after it has executed all pending jobs: */
+	{
+	Threads::MutexCond::Lock queueLock(queueCond);
+	runIOThread=false;
+	queueCond.signal();
+	}
+	ioThread.join();
+	
+	/* Release a read checkpoint that was never retrieved: */
+	delete lastReadCheckpoint;
+	}
+
+void WaterCheckpointStreamer::writeCheckpoint(WaterCheckpoint* checkpoint,const std::string& fileName)
+	{
+	Threads::MutexCond::Lock queueLock(queueCond);
+	
+	/* Drop the checkpoint if the I/O thread is falling behind: */
+	if(queue.size()>=maxQueueSize)
+		{
+		Misc::formattedUserError("WaterCheckpointStreamer: Dropping water checkpoint file %s because too many checkpoint operations are pending",fileName.c_str());
+		delete checkpoint;
+		return;
+		}
+	
+	/* Append a write job to the queue: */
+	queue.push_back(Job());
+	queue.back().checkpoint=checkpoint;
+	queue.back().fileName=fileName;
+	
+	/* Wake up the I/O thread: */
+	queueCond.signal();
+	}
+
+void WaterCheckpointStreamer::readCheckpoint(const std::string& fileName)
+	{
+	Threads::MutexCond::Lock queueLock(queueCond);
+	
+	/* Append a read job to the queue; read jobs are never dropped: */
+	queue.push_back(Job());
+	queue.back().checkpoint=0;
+	queue.back().fileName=fileName;
+	
+	/* Wake up the I/O thread: */
+	queueCond.signal();
+	}
+
+WaterCheckpoint* WaterCheckpointStreamer::retrieveReadCheckpoint(void)
+	{
+	Threads::MutexCond::Lock queueLock(queueCond);
+	
+	/* Hand the most recently read checkpoint to the caller: */
+	WaterCheckpoint* result=lastReadCheckpoint;
+	lastReadCheckpoint=0;
+	return result;
+	}
@@ -0,0 +1,73 @@
+/***********************************************************************
+WaterCheckpointStreamer - Class to write and read water checkpoint files
+in a background thread, so that saving and loading checkpoints does not
+stall the render loop.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef WATERCHECKPOINTSTREAMER_INCLUDED
+#define WATERCHECKPOINTSTREAMER_INCLUDED
+
+#include <string>
+#include <deque>
+#include <Threads/Thread.h>
+#include <Threads/MutexCond.h>
+
+/* Forward declarations: */
+class WaterCheckpoint;
+
+class WaterCheckpointStreamer
+	{
+	/* Embedded classes: */
+	private:
+	struct Job // Structure holding a checkpoint file operation waiting to be executed
+		{
+		/* Elements: */
+		public:
+		WaterCheckpoint* checkpoint; // Checkpoint to be written, or null if the job reads a checkpoint
+		std::string fileName; // Name of the checkpoint file to be written or read
+		};
+	
+	/* Elements: */
+	static const size_t maxQueueSize=4; // Maximum number of jobs waiting to be executed before new checkpoints to be written are dropped
+	Threads::MutexCond queueCond; // Condition variable protecting the job queue and the most recently read checkpoint
+	std::deque<Job> queue; // Queue of jobs waiting to be executed
+	WaterCheckpoint* lastReadCheckpoint; // Most recently read checkpoint that has not yet been retrieved, or null
+	volatile bool runIOThread; // Flag to keep the background I/O thread running
+	Threads::Thread ioThread; // The background I/O thread
+	
+	/* Private methods: */
+	void* ioThreadMethod(void); // Method for the background I/O thread
+	
+	/* Constructors and destructors: */
+	public:
+	WaterCheckpointStreamer(void); // Creates a streamer with an empty job queue
+	private:
+	WaterCheckpointStreamer(const WaterCheckpointStreamer& source); // Prohibit copy constructor
+	WaterCheckpointStreamer& operator=(const WaterCheckpointStreamer& source); // Prohibit assignment operator
+	public:
+	~WaterCheckpointStreamer(void); // Executes all pending jobs and releases any checkpoint that has been read but not retrieved
+	
+	/* Methods: */
+	void writeCheckpoint(WaterCheckpoint* checkpoint,const std::string& fileName); // Writes the given checkpoint to the file of the given name in the background; streamer takes ownership of the checkpoint
+	void readCheckpoint(const std::string& fileName); // Reads a checkpoint from the file of the given name in the background
+	WaterCheckpoint* retrieveReadCheckpoint(void); // Returns the most recently read checkpoint, or null if no read has completed since the last call; caller takes ownership of the checkpoint
+	};
+
+#endif
@@ -0,0 +1,48 @@
+/***********************************************************************
+WaterDisk - Structure describing a disk-shaped source or sink of water,
+such as rain falling from a hand or a local water tool, to be added to
+the water table during every water flow simulation step.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef WATERDISK_INCLUDED
+#define WATERDISK_INCLUDED
+
+#include <vector>
+
+#include "Types.h"
+
+struct WaterDisk // Structure describing a disk-shaped water source or sink
+	{
+	/* Elements: */
+	public:
+	Point center; // Center of the disk in camera space
+	Scalar radius; // Radius of the disk in camera space units; the disk's rate decays smoothly across a narrow band around its edge
+	float rate; // Rate at which water is added inside the disk in elevation units per second; negative rates remove water
+	
+	/* Constructors and destructors: */
+	WaterDisk(const Point& sCenter,Scalar sRadius,float sRate) // Elementwise constructor
+		:center(sCenter),radius(sRadius),rate(sRate)
+		{
+		}
+	};
+
+typedef std::vector<WaterDisk> WaterDiskList; // Type for lists of water disks
+
+#endif
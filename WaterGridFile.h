@@ -0,0 +1,64 @@
+/***********************************************************************
+WaterGridFile - Definition of the file format for sequences of water
+level grids produced by a water flow simulation, used as golden outputs
+to check water simulation implementations against each other.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef WATERGRIDFILE_INCLUDED
+#define WATERGRIDFILE_INCLUDED
+
+#include <string.h>
+#include <Misc/SizedTypes.h>
+
+/***********************************************************************
+A water grid file is written in little-endian byte order and consists
+of a fixed-size header followed by a sequence of grid records. Each
+grid record holds the simulation time at which the grid was taken as a
+64-bit floating-point number, followed by the cell-centered water level
+grid as 32-bit floating-point numbers in row-major order.
+***********************************************************************/
+
+struct WaterGridFileHeader // Structure for the header at the beginning of a water grid file
+	{
+	/* Elements: */
+	public:
+	char magic[16]; // File identifier, "SARndboxWater" padded with NUL characters
+	Misc::UInt32 version; // File format version number
+	Misc::UInt32 gridSize[2]; // Width and height of water level grids
+	Misc::UInt32 numGrids; // Number of grid records following the header
+	
+	static const Misc::UInt32 currentVersion=1; // Version number of the current file format
+	
+	/* Constructors and destructors: */
+	WaterGridFileHeader(void) // Creates a header for the current file format version with all other fields set to zero
+		{
+		memset(this,0,sizeof(WaterGridFileHeader));
+		strcpy(magic,"SARndboxWater");
+		version=currentVersion;
+		}
+	
+	/* Methods: */
+	bool isValid(void) const // Returns true if the header identifies a water grid file of a supported version
+		{
+		return strncmp(magic,"SARndboxWater",sizeof(magic))==0&&version==currentVersion;
+		}
+	};
+
+#endif
@@ -59,12 +59,12 @@ Methods of class WaterRenderer:
 
 WaterRenderer::WaterRenderer(const WaterTable2* sWaterTable)
 	:waterTable(sWaterTable),
-	 waterGridSize(waterTable->getSize()),
+	 waterGridSize(waterTable->getRenderSize()),
 	 bathymetryGridSize(waterGridSize[0]-1,waterGridSize[1]-1)
 	{
-	/* Copy the water table's grid cell size: */
+	/* Copy the water table's rendering grid cell size: */
 	for(int i=0;i<2;++i)
-		cellSize[i]=waterTable->getCellSize()[i];
+		cellSize[i]=waterTable->getRenderCellSize()[i];
 	
 	/* Get the water table's domain: */
 	const WaterTable2::Box& wd=waterTable->getDomain();
@@ -149,10 +149,10 @@ void WaterRenderer::render(const PTransform& projection,const OGTransform& model
 	textureTracker.reset();
 	
 	/* Bind the water quantity texture: */
-	dataItem->waterShader.uploadUniform(waterTable->bindQuantityTexture(contextData,textureTracker,false));
+	dataItem->waterShader.uploadUniform(waterTable->bindRenderQuantityTexture(contextData,textureTracker,false));
 	
 	/* Bind the bathymetry texture: */
-	dataItem->waterShader.uploadUniform(waterTable->bindBathymetryTexture(contextData,textureTracker,false));
+	dataItem->waterShader.uploadUniform(waterTable->bindRenderBathymetryTexture(contextData,textureTracker,false));
 	
 	/* Calculate and upload the vertex transformation from grid space to eye space: */
 	PTransform modelviewGridTransform=gridTransform;
@@ -0,0 +1,116 @@
+/***********************************************************************
+WaterScenario - Synthetic water flow simulation scenarios shared by the
+CPU reference simulation and the GPU-based offline simulation, so that
+both can be run from identical initial states and checked against each
+other.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "WaterScenario.h"
+
+#include <string.h>
+#include <Math/Math.h>
+
+/***************************************
+Functions for synthetic water scenarios:
+***************************************/
+
+bool parseWaterScenario(const char* name,WaterScenario& scenario)
+	{
+	static const WaterScenario scenarios[4]={DamBreak,Basin,Rain,Trench};
+	for(int i=0;i<4;++i)
+		if(strcasecmp(name,getWaterScenarioName(scenarios[i]))==0)
+			{
+			scenario=scenarios[i];
+			return true;
+			}
+	return false;
+	}
+
+const char* getWaterScenarioName(WaterScenario scenario)
+	{
+	static const char* scenarioNames[4]={"DamBreak","Basin","Rain","Trench"};
+	return scenarioNames[scenario];
+	}
+
+void createScenarioBathymetry(WaterScenario scenario,const Size& size,float* bathymetry)
+	{
+	float* bPtr=bathymetry;
+	for(unsigned int y=0;y<size[1]-1;++y)
+		for(unsigned int x=0;x<size[0]-1;++x,++bPtr)
+			{
+			/* Calculate the vertex's normalized position: */
+			float u=float(x+1)/float(size[0]);
+			float v=float(y+1)/float(size[1]);
+			
+			switch(scenario)
+				{
+				case DamBreak:
+					*bPtr=0.0f;
+					break;
+				
+				case Basin:
+					*bPtr=8.0f*(Math::sqr(u-0.5f)+Math::sqr(v-0.5f));
+					break;
+				
+				case Rain:
+					*bPtr=3.0f*(1.0f-u)+6.0f*Math::sqr(v-0.5f);
+					break;
+				
+				case Trench:
+					*bPtr=Math::abs(v-0.5f)<0.04f?-30.0f:0.0f;
+					break;
+				}
+			}
+	}
+
+void createScenarioWater(WaterScenario scenario,const Size& size,float* waterLevel,float* waterSource)
+	{
+	float* wPtr=waterLevel;
+	float* sPtr=waterSource;
+	for(unsigned int y=0;y<size[1];++y)
+		for(unsigned int x=0;x<size[0];++x,++wPtr,++sPtr)
+			{
+			/* Calculate the cell's normalized position: */
+			float u=(float(x)+0.5f)/float(size[0]);
+			float v=(float(y)+0.5f)/float(size[1]);
+			
+			*sPtr=0.0f;
+			switch(scenario)
+				{
+				case DamBreak:
+					*wPtr=x<size[0]/3?2.0f:0.0f;
+					break;
+				
+				case Basin:
+					*wPtr=1.0f+(u-0.5f);
+					break;
+				
+				case Rain:
+					*wPtr=0.0f;
+					if(Math::sqr(u-0.15f)+Math::sqr((v-0.5f)*float(size[1])/float(size[0]))<Math::sqr(0.08f))
+						*sPtr=2.0f;
+					break;
+				
+				case Trench:
+					*wPtr=u<0.6f?0.5f+0.5f*u:0.0f;
+					break;
+				}
+			}
+	}
@@ -0,0 +1,45 @@
+/***********************************************************************
+WaterScenario - Synthetic water flow simulation scenarios shared by the
+CPU reference simulation and the GPU-based offline simulation, so that
+both can be run from identical initial states and checked against each
+other.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef WATERSCENARIO_INCLUDED
+#define WATERSCENARIO_INCLUDED
+
+#include "Types.h"
+
+enum WaterScenario // Enumerated type for built-in simulation scenarios
+	{
+	DamBreak, // A column of water collapsing onto a flat dry bed
+	Basin, // A tilted water surface sloshing back and forth in a bowl-shaped basin
+	Rain, // Rain and snow falling onto the upper end of a sloped valley
+	Trench // A shallow lake crossed by a deep trench, where fast waves in the trench limit global step sizes
+	};
+
+static const float rainScenarioSnowLine=2.5f; // Elevation of the snow line in the Rain scenario
+
+bool parseWaterScenario(const char* name,WaterScenario& scenario); // Sets the given scenario from the given case-insensitive name; returns false if the name is not recognized
+const char* getWaterScenarioName(WaterScenario scenario); // Returns the name of the given scenario
+void createScenarioBathymetry(WaterScenario scenario,const Size& size,float* bathymetry); // Writes the given scenario's vertex-centered bathymetry for a water table of the given size in cells into the given grid of size minus 1
+void createScenarioWater(WaterScenario scenario,const Size& size,float* waterLevel,float* waterSource); // Writes the given scenario's initial cell-centered water levels and water source rates for a water table of the given size into the given grids
+
+#endif
@@ -0,0 +1,99 @@
+/***********************************************************************
+WaterScheduler - Class to schedule water flow simulation ticks at a
+fixed rate independent of the display frame rate, and to calculate
+weights to interpolate between the two most recent simulation states
+for rendering.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "WaterScheduler.h"
+
+#include <Math/Math.h>
+
+/*******************************
+Methods of class WaterScheduler:
+*******************************/
+
+WaterScheduler::WaterScheduler(double sTickRate,unsigned int sMaxTicksPerFrame,WaterScheduler::Policy sPolicy)
+	:tickInterval(1.0/sTickRate),
+	 maxTicksPerFrame(sMaxTicksPerFrame>0?sMaxTicksPerFrame:1),
+	 policy(sPolicy),
+	 maxBacklog(0.25),
+	 started(false),tickTime(0.0),
+	 numDroppedTicks(0)
+	{
+	}
+
+void WaterScheduler::setMaxBacklog(double newMaxBacklog)
+	{
+	maxBacklog=newMaxBacklog;
+	}
+
+unsigned int WaterScheduler::startFrame(double time)
+	{
+	/* Start the tick clock on the first frame: */
+	if(!started)
+		{
+		tickTime=time;
+		started=true;
+		return 0;
+		}
+	
+	/* Calculate the number of ticks that became due since the most recent tick: */
+	double numDue=Math::floor((time-tickTime)/tickInterval);
+	if(numDue<=0.0)
+		return 0;
+	
+	/* Run all due ticks if they fit into the frame: */
+	if(numDue<=double(maxTicksPerFrame))
+		{
+		tickTime+=numDue*tickInterval;
+		return (unsigned int)(numDue);
+		}
+	
+	if(policy==Degrade)
+		{
+		/* Drop all due ticks that do not fit into the frame and restart the tick clock at the most recent due tick: */
+		numDroppedTicks+=(unsigned int)(numDue)-maxTicksPerFrame;
+		tickTime+=numDue*tickInterval;
+		}
+	else
+		{
+		/* Run as many ticks as fit into the frame and leave the rest for later frames: */
+		tickTime+=double(maxTicksPerFrame)*tickInterval;
+		
+		/* Drop the ticks that exceed the maximum backlog: */
+		double numExcess=Math::floor((time-tickTime-maxBacklog)/tickInterval);
+		if(numExcess>0.0)
+			{
+			numDroppedTicks+=(unsigned int)(numExcess);
+			tickTime+=numExcess*tickInterval;
+			}
+		}
+	
+	return maxTicksPerFrame;
+	}
+
+double WaterScheduler::getInterpolationWeight(double time) const
+	{
+	/* Rendering lags one tick behind the most recent tick, so that it always falls between the two most recent simulation states: */
+	if(!started)
+		return 1.0;
+	return Math::clamp((time-tickTime)/tickInterval,0.0,1.0);
+	}
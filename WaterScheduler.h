@@ -0,0 +1,74 @@
+/***********************************************************************
+WaterScheduler - Class to schedule water flow simulation ticks at a
+fixed rate independent of the display frame rate, and to calculate
+weights to interpolate between the two most recent simulation states
+for rendering.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef WATERSCHEDULER_INCLUDED
+#define WATERSCHEDULER_INCLUDED
+
+class WaterScheduler
+	{
+	/* Embedded classes: */
+	public:
+	enum Policy // Enumerated type for policies dealing with frames that can not run all due ticks
+		{
+		CatchUp=0, // Runs the ticks that did not fit into a frame during later frames, until the backlog exceeds a limit
+		Degrade // Drops the ticks that did not fit into a frame, slowing down the simulation relative to real time
+		};
+	
+	/* Elements: */
+	private:
+	double tickInterval; // Real time between two simulation ticks in seconds
+	unsigned int maxTicksPerFrame; // Maximum number of simulation ticks run during a single frame
+	Policy policy; // Policy for frames that can not run all due ticks
+	double maxBacklog; // Maximum amount of real time by which the simulation may fall behind under the catch-up policy
+	bool started; // Flag whether the scheduler has seen its first frame
+	double tickTime; // Real time at which the most recent simulation tick was due
+	unsigned int numDroppedTicks; // Total number of ticks dropped since the scheduler was created
+	
+	/* Constructors and destructors: */
+	public:
+	WaterScheduler(double sTickRate,unsigned int sMaxTicksPerFrame,Policy sPolicy); // Creates a scheduler running the given number of ticks per second, at most the given number per frame, and dealing with overload according to the given policy
+	
+	/* Methods: */
+	double getTickInterval(void) const // Returns the real time between two simulation ticks in seconds
+		{
+		return tickInterval;
+		}
+	unsigned int getMaxTicksPerFrame(void) const // Returns the maximum number of simulation ticks run during a single frame
+		{
+		return maxTicksPerFrame;
+		}
+	Policy getPolicy(void) const // Returns the policy for frames that can not run all due ticks
+		{
+		return policy;
+		}
+	unsigned int getNumDroppedTicks(void) const // Returns the total number of dropped simulation ticks
+		{
+		return numDroppedTicks;
+		}
+	void setMaxBacklog(double newMaxBacklog); // Sets the maximum amount of real time by which the simulation may fall behind under the catch-up policy
+	unsigned int startFrame(double time); // Returns the number of simulation ticks to run for a frame starting at the given real time
+	double getInterpolationWeight(double time) const; // Returns the weight of the most recent simulation state, relative to the state before the most recent tick, when rendering at the given real time
+	};
+
+#endif
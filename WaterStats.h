@@ -0,0 +1,51 @@
+/***********************************************************************
+WaterStats - Structure holding health statistics of a water flow
+simulation state, shared by the GPU-based water table and its CPU
+reference implementation.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef WATERSTATS_INCLUDED
+#define WATERSTATS_INCLUDED
+
+/***********************************************************************
+Water column heights are measured between the water surface and the
+bathymetry at each cell's center, and flow speeds use the same
+desingularized velocities as the simulation itself. The total volume
+sums signed water column heights, so that it is exactly conserved by
+the simulation's flux updates.
+***********************************************************************/
+
+struct WaterStats // Structure holding health statistics of a water flow simulation state
+	{
+	/* Elements: */
+	public:
+	double volume; // Total volume of water on the water table in cubic world coordinate units
+	float maxSpeed; // Maximum flow speed of any cell in world coordinate units per second
+	unsigned int numWetCells; // Number of cells whose water column height exceeds the dry depth
+	float maxDepth; // Maximum water column height of any cell
+	
+	/* Constructors and destructors: */
+	WaterStats(void) // Creates statistics of an empty water table
+		:volume(0.0),maxSpeed(0.0f),numWetCells(0),maxDepth(0.0f)
+		{
+		}
+	};
+
+#endif
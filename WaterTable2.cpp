@@ -2,7 +2,7 @@
 WaterTable2 - Class to simulate water flowing over a surface using
 improved water flow simulation based on Saint-Venant system of partial
 differenctial equations.
-Copyright (c) 2012-2025 Oliver Kreylos
+Copyright (c) 2012-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -24,17 +24,26 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "WaterTable2.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <string>
+#include <Misc/StdError.h>
+#include <Misc/MessageLogger.h>
 #include <Math/Math.h>
+#include <Math/Constants.h>
 #include <Geometry/AffineCombiner.h>
 #include <Geometry/Vector.h>
 #include <GL/gl.h>
 #include <GL/GLMiscTemplates.h>
 #include <GL/Extensions/GLARBDrawBuffers.h>
+#include <GL/Extensions/GLARBDrawInstanced.h>
 #include <GL/Extensions/GLARBFragmentShader.h>
+#include <GL/Extensions/GLARBInstancedArrays.h>
+#include <GL/Extensions/GLARBPixelBufferObject.h>
+#include <GL/Extensions/GLARBSync.h>
 #include <GL/Extensions/GLARBTextureFloat.h>
 #include <GL/Extensions/GLARBTextureRectangle.h>
 #include <GL/Extensions/GLARBTextureRg.h>
+#include <GL/Extensions/GLARBVertexBufferObject.h>
 #include <GL/Extensions/GLARBVertexShader.h>
 #include <GL/Extensions/GLEXTFramebufferObject.h>
 #include <GL/GLContextData.h>
@@ -44,12 +53,21 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "DepthImageRenderer.h"
 #include "PropertyGridCreator.h"
 #include "ShaderHelper.h"
+#include "WaterCheckpoint.h"
 
 // DEBUGGING
 #include <iostream>
 
 namespace {
 
+/****************
+Helper constants:
+****************/
+
+const unsigned int statsBlockSize=16; // Width and height of blocks of cells reduced to partial health statistics on the GPU
+const unsigned int numWaterDiskSegments=32; // Number of segments around the water disk template
+const unsigned int numWaterDiskVertices=numWaterDiskSegments*9; // Number of vertices in the water disk template, one triangle for the inner disk and two for the decay band per segment
+
 /****************
 Helper functions:
 ****************/
@@ -214,23 +232,76 @@ WaterTable2::DataItem::DataItem(void)
 	 bathymetryVersion(0),
 	 snow(GL_TEXTURE_RECTANGLE_ARB),
 	 quantity(GL_TEXTURE_RECTANGLE_ARB),
+	 previousQuantityTextureObject(0),previousQuantityValid(false),
+	 renderQuantity(GL_TEXTURE_RECTANGLE_ARB),renderInterpolated(false),
+	 renderBathymetry(GL_TEXTURE_RECTANGLE_ARB),
+	 upsampledQuantity(GL_TEXTURE_RECTANGLE_ARB),
+	 upsampledSnow(GL_TEXTURE_RECTANGLE_ARB),
 	 derivativeTextureObject(0),
 	 maxStepSize(GL_TEXTURE_RECTANGLE_ARB),
+	 stepSizeTextureObject(0),
+	 stepSizeReadSlot(0),numPendingStepSizes(0),
 	 waterTextureObject(0),
-	 bathymetryFramebufferObject(0),derivativeFramebufferObject(0),maxStepSizeFramebufferObject(0),integrationFramebufferObject(0),waterFramebufferObject(0)
+	 waterDisksVersion(0),
+	 tileSize(0),numTiles(0,0),
+	 wetTileTextureObject(0),wetTileBufferObject(0),wetTileFence(0),wetTileScanValid(false),
+	 numActiveTiles(0),
+	 numStatsBlocks(0,0),
+	 statsTextureObject(0),statsBufferObject(0),statsFence(0),numStepsSinceStats(0),
+	 checkpointBufferObject(0),checkpointFence(0),
+	 gridReadSlot(0),numPendingGrids(0),
+	 bathymetryFramebufferObject(0),derivativeFramebufferObject(0),maxStepSizeFramebufferObject(0),stepSizeFramebufferObject(0),integrationFramebufferObject(0),waterFramebufferObject(0),wetTileFramebufferObject(0),interpolationFramebufferObject(0),statsFramebufferObject(0),renderBathymetryFramebufferObject(0),upsampleFramebufferObject(0)
 	{
+	for(int i=0;i<2;++i)
+		{
+		stepSizeBufferObjects[i]=0;
+		stepSizeFences[i]=0;
+		waterDiskBufferObjects[i]=0;
+		gridBufferObjects[i]=0;
+		gridFences[i]=0;
+		}
+	for(int i=0;i<3;++i)
+		waterDiskAttributeLocations[i]=-1;
 	}
 
 WaterTable2::DataItem::~DataItem(void)
 	{
 	/* Delete all allocated textures and buffers: */
+	glDeleteTextures(1,&previousQuantityTextureObject);
 	glDeleteTextures(1,&derivativeTextureObject);
+	glDeleteTextures(1,&stepSizeTextureObject);
+	glDeleteBuffersARB(2,stepSizeBufferObjects);
+	for(int i=0;i<2;++i)
+		if(stepSizeFences[i]!=0)
+			glDeleteSync(stepSizeFences[i]);
 	glDeleteTextures(1,&waterTextureObject);
+	glDeleteBuffersARB(2,waterDiskBufferObjects);
+	glDeleteTextures(1,&wetTileTextureObject);
+	glDeleteBuffersARB(1,&wetTileBufferObject);
+	if(wetTileFence!=0)
+		glDeleteSync(wetTileFence);
+	glDeleteTextures(1,&statsTextureObject);
+	glDeleteBuffersARB(1,&statsBufferObject);
+	if(statsFence!=0)
+		glDeleteSync(statsFence);
+	glDeleteBuffersARB(1,&checkpointBufferObject);
+	if(checkpointFence!=0)
+		glDeleteSync(checkpointFence);
+	glDeleteBuffersARB(2,gridBufferObjects);
+	for(int i=0;i<2;++i)
+		if(gridFences[i]!=0)
+			glDeleteSync(gridFences[i]);
 	glDeleteFramebuffersEXT(1,&bathymetryFramebufferObject);
 	glDeleteFramebuffersEXT(1,&derivativeFramebufferObject);
 	glDeleteFramebuffersEXT(1,&maxStepSizeFramebufferObject);
+	glDeleteFramebuffersEXT(1,&stepSizeFramebufferObject);
 	glDeleteFramebuffersEXT(1,&integrationFramebufferObject);
 	glDeleteFramebuffersEXT(1,&waterFramebufferObject);
+	glDeleteFramebuffersEXT(1,&wetTileFramebufferObject);
+	glDeleteFramebuffersEXT(1,&interpolationFramebufferObject);
+	glDeleteFramebuffersEXT(1,&statsFramebufferObject);
+	glDeleteFramebuffersEXT(1,&renderBathymetryFramebufferObject);
+	glDeleteFramebuffersEXT(1,&upsampleFramebufferObject);
 	}
 
 /****************************
@@ -260,6 +331,27 @@ void WaterTable2::calcTransformations(void)
 	bathymetryPmv*=baseTransform;
 	}
 	
+	/* Calculate the combined modelview and projection matrix to render depth images into the rendering-resolution bathymetry grid: */
+	{
+	renderBathymetryPmv=PTransform::identity;
+	PTransform::Matrix& rbpmvm=renderBathymetryPmv.getMatrix();
+	Scalar hw=Math::div2(renderCellSize[0]);
+	Scalar left=domain.min[0]+hw;
+	Scalar right=domain.max[0]-hw;
+	Scalar hh=Math::div2(renderCellSize[1]);
+	Scalar bottom=domain.min[1]+hh;
+	Scalar top=domain.max[1]-hh;
+	Scalar near=-domain.max[2];
+	Scalar far=-domain.min[2];
+	rbpmvm(0,0)=Scalar(2)/(right-left);
+	rbpmvm(0,3)=-(right+left)/(right-left);
+	rbpmvm(1,1)=Scalar(2)/(top-bottom);
+	rbpmvm(1,3)=-(top+bottom)/(top-bottom);
+	rbpmvm(2,2)=Scalar(-2)/(far-near);
+	rbpmvm(2,3)=-(far+near)/(far-near);
+	renderBathymetryPmv*=baseTransform;
+	}
+	
 	/* Calculate the combined modelview and projection matrix to render water-adding geometry into the water texture: */
 	{
 	waterAddPmv=PTransform::identity;
@@ -285,12 +377,12 @@ void WaterTable2::calcTransformations(void)
 		for(int i=0;i<4;++i,++wapPtr)
 			*wapPtr=GLfloat(waterAddPmv.getMatrix()(i,j));
 	
-	/* Calculate a transformation from camera space into water texture space: */
+	/* Calculate a transformation from camera space into rendering grid texture space: */
 	waterTextureTransform=PTransform::identity;
 	PTransform::Matrix& wttm=waterTextureTransform.getMatrix();
-	wttm(0,0)=Scalar(size[0])/(domain.max[0]-domain.min[0]);
+	wttm(0,0)=Scalar(renderSize[0])/(domain.max[0]-domain.min[0]);
 	wttm(0,3)=wttm(0,0)*-domain.min[0];
-	wttm(1,1)=Scalar(size[1])/(domain.max[1]-domain.min[1]);
+	wttm(1,1)=Scalar(renderSize[1])/(domain.max[1]-domain.min[1]);
 	wttm(1,3)=wttm(1,1)*-domain.min[1];
 	waterTextureTransform*=baseTransform;
 	
@@ -301,7 +393,45 @@ void WaterTable2::calcTransformations(void)
 			*wttmPtr=GLfloat(wttm(i,j));
 	}
 
-GLfloat WaterTable2::calcDerivative(GLContextData& contextData,TextureTracker& textureTracker,int quantityTextureIndex,bool calcMaxStepSize) const
+Rect WaterTable2::calcDirtyGridRect(const WaterTable2::Box& dirtyBox,const PTransform& gridPmv,const Size& gridSize) const
+	{
+	/* Project the box's corners into the grid's pixel space: */
+	Scalar min[2],max[2];
+	for(int i=0;i<2;++i)
+		{
+		min[i]=Math::Constants<Scalar>::max;
+		max[i]=-Math::Constants<Scalar>::max;
+		}
+	for(int corner=0;corner<8;++corner)
+		{
+		Point c;
+		for(int i=0;i<3;++i)
+			c[i]=(corner&(0x1<<i))!=0?dirtyBox.max[i]:dirtyBox.min[i];
+		Point gc=gridPmv.transform(c);
+		for(int i=0;i<2;++i)
+			{
+			Scalar p=(gc[i]+Scalar(1))*Scalar(0.5)*Scalar(gridSize[i]);
+			min[i]=Math::min(min[i],p);
+			max[i]=Math::max(max[i],p);
+			}
+		}
+	
+	/* Round outwards and grow by one pixel to account for rasterization, and clamp to the grid: */
+	Rect result(Size(0,0));
+	for(int i=0;i<2;++i)
+		{
+		Scalar p0=Math::max(Math::floor(min[i])-Scalar(1),Scalar(0));
+		Scalar p1=Math::min(Math::ceil(max[i])+Scalar(1),Scalar(gridSize[i]));
+		if(p0>=p1)
+			return Rect(Size(0,0));
+		result.offset[i]=int(p0);
+		result.size[i]=(unsigned int)(p1)-(unsigned int)(p0);
+		}
+	
+	return result;
+	}
+
+void WaterTable2::calcDerivative(GLContextData& contextData,TextureTracker& textureTracker,int quantityTextureIndex,bool calcMaxStepSize) const
 	{
 	/* Retrieve the context data item: */
 	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
@@ -329,21 +459,29 @@ GLfloat WaterTable2::calcDerivative(GLContextData& contextData,TextureTracker& t
 	if(mode==Engineering)
 		derivativeShader->uploadUniform(propertyGridCreator->bindPropertyGridTexture(contextData,textureTracker));
 	
-	/* Run the temporal derivative computation: */
-	glBegin(GL_QUADS);
-	glVertex2i(0,0);
-	glVertex2i(size[0],0);
-	glVertex2i(size[0],size[1]);
-	glVertex2i(0,size[1]);
-	glEnd();
+	if(calcMaxStepSize&&dataItem->tileSize!=0)
+		{
+		/* Reset the maximum step size texture, as inactive tiles will not overwrite what the previous reduction left behind: */
+		GLfloat currentClearColor[4];
+		glGetFloatv(GL_COLOR_CLEAR_VALUE,currentClearColor);
+		glDrawBuffer(GL_COLOR_ATTACHMENT1_EXT);
+		glClearColor(maxStepSize,0.0f,0.0f,0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glClearColor(currentClearColor[0],currentClearColor[1],currentClearColor[2],currentClearColor[3]);
+		GLenum drawBuffers[2]={GL_COLOR_ATTACHMENT0_EXT,GL_COLOR_ATTACHMENT1_EXT};
+		glDrawBuffersARB(2,drawBuffers);
+		}
+	
+	/* Run the temporal derivative computation on all active tiles: */
+	renderActiveTiles(dataItem);
 	
 	/*********************************************************************
 	Step 2: Gather the maximum step size by reducing the maximum step size
-	texture.
+	texture. The final reduction step writes into the step size texture,
+	where the step size stays for the integration shaders to read without
+	a round trip through the CPU.
 	*********************************************************************/
 	
-	GLfloat stepSize=maxStepSize;
-	
 	if(calcMaxStepSize)
 		{
 		/* Install the maximum step size reduction shader: */
@@ -361,13 +499,17 @@ GLfloat WaterTable2::calcDerivative(GLContextData& contextData,TextureTracker& t
 			dataItem->maxStepSizeShader.resetUniforms();
 			textureTracker.reset();
 			
-			/* Set up the simulation frame buffer for maximum step size reduction: */
-			glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+(1-dataItem->maxStepSize.current));
-			
 			/* Reduce the viewport by a factor of two: */
 			Size nextReducedSize((reducedSize[0]+1)/2,(reducedSize[1]+1)/2);
 			glViewport(nextReducedSize);
 			dataItem->maxStepSizeShader.uploadUniform(GLfloat(reducedSize[0]-1),GLfloat(reducedSize[1]-1));
+			dataItem->maxStepSizeShader.uploadUniform(maxStepSize);
+			
+			/* Set up the simulation frame buffer for maximum step size reduction, writing the final 1x1 result into the step size texture: */
+			if(nextReducedSize[0]>1||nextReducedSize[1]>1)
+				glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+(1-dataItem->maxStepSize.current));
+			else
+				glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->stepSizeFramebufferObject);
 			
 			/* Bind the current max step size texture: */
 			dataItem->maxStepSize.bind(textureTracker,dataItem->maxStepSizeShader,dataItem->maxStepSize.current,false);
@@ -387,29 +529,430 @@ GLfloat WaterTable2::calcDerivative(GLContextData& contextData,TextureTracker& t
 			reducedSize=nextReducedSize;
 			dataItem->maxStepSize.current=1-dataItem->maxStepSize.current;
 			}
-		
-		/* Read the final value written into the last reduced 1x1 frame buffer: */
-		glReadBuffer(GL_COLOR_ATTACHMENT0_EXT+dataItem->maxStepSize.current);
-		glReadPixels(0,0,1,1,GL_LUMINANCE,GL_FLOAT,&stepSize);
-		
-		/* Limit the step size to the client-specified range: */
-		stepSize=Math::min(stepSize,maxStepSize);
 		}
+	}
+
+GLfloat WaterTable2::retrieveStepSize(WaterTable2::DataItem* dataItem) const
+	{
+	/* Find the pixel buffer object holding the oldest pending step size read-back: */
+	int slot=(dataItem->stepSizeReadSlot+2-dataItem->numPendingStepSizes)%2;
+	
+	/* Wait until the GPU has written the step size into the pixel buffer object, as the simulation can not advance without it: */
+	GLenum waitResult;
+	unsigned int numTimeouts=0;
+	while((waitResult=glClientWaitSync(dataItem->stepSizeFences[slot],GL_SYNC_FLUSH_COMMANDS_BIT,GLuint64(1000000000)))==GL_TIMEOUT_EXPIRED)
+		Misc::formattedConsoleWarning("WaterTable2: Still waiting for step size read-back after %u s",++numTimeouts);
+	if(waitResult==GL_WAIT_FAILED)
+		{
+		/* Fall back to draining the command queue, which also completes the read-back: */
+		Misc::formattedConsoleWarning("WaterTable2: Waiting for step size read-back failed; finishing all pending OpenGL commands instead");
+		glFinish();
+		}
+	glDeleteSync(dataItem->stepSizeFences[slot]);
+	dataItem->stepSizeFences[slot]=0;
+	--dataItem->numPendingStepSizes;
+	
+	/* Read the step size from the pixel buffer object: */
+	GLfloat stepSize;
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->stepSizeBufferObjects[slot]);
+	glGetBufferSubDataARB(GL_PIXEL_PACK_BUFFER_ARB,0,sizeof(GLfloat),&stepSize);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
 	
 	return stepSize;
 	}
 
+void WaterTable2::updateActiveTiles(WaterTable2::DataItem* dataItem,TextureTracker& textureTracker) const
+	{
+	/* Check if the dry tile size changed since the wet tile state was allocated: */
+	if(dataItem->tileSize!=dryTileSize)
+		{
+		/* Discard a pending wet tile flag read-back: */
+		if(dataItem->wetTileFence!=0)
+			{
+			glDeleteSync(dataItem->wetTileFence);
+			dataItem->wetTileFence=0;
+			}
+		
+		dataItem->tileSize=dryTileSize;
+		if(dataItem->tileSize!=0)
+			{
+			/* Calculate the size of the tile grid, with partial tiles along the right and top edges: */
+			for(int i=0;i<2;++i)
+				dataItem->numTiles[i]=(size[i]+dataItem->tileSize-1)/dataItem->tileSize;
+			
+			/* Allocate the wet tile texture and attach it to the wet tile frame buffer: */
+			textureTracker.reset();
+			textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->wetTileTextureObject);
+			glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_R8,dataItem->numTiles[0],dataItem->numTiles[1],0,GL_RED,GL_UNSIGNED_BYTE,0);
+			glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->wetTileFramebufferObject);
+			glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT,GL_TEXTURE_RECTANGLE_ARB,dataItem->wetTileTextureObject,0);
+			
+			/* Allocate the wet tile pixel buffer object, with rows padded to the default pack alignment of four bytes: */
+			glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->wetTileBufferObject);
+			glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB,((dataItem->numTiles[0]+3U)&~3U)*dataItem->numTiles[1],0,GL_STREAM_READ_ARB);
+			glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+			
+			/* Simulate all tiles until the first wet tile scan completes: */
+			size_t numTiles=size_t(dataItem->numTiles[0])*size_t(dataItem->numTiles[1]);
+			dataItem->wetTiles.assign(numTiles,1);
+			dataItem->tileActivities.assign(numTiles,2);
+			}
+		else
+			{
+			/* Release the wet tile state: */
+			dataItem->wetTiles.clear();
+			dataItem->tileActivities.clear();
+			dataItem->activeTiles.clear();
+			dataItem->activeTileQuads.clear();
+			dataItem->borderTileQuads.clear();
+			}
+		}
+	
+	if(dataItem->tileSize==0)
+		return;
+	
+	/* Check if the pending wet tile flag read-back has completed, without waiting for it: */
+	if(dataItem->wetTileFence!=0)
+		{
+		GLenum waitResult=glClientWaitSync(dataItem->wetTileFence,GL_SYNC_FLUSH_COMMANDS_BIT,0);
+		if(waitResult==GL_ALREADY_SIGNALED||waitResult==GL_CONDITION_SATISFIED)
+			{
+			glDeleteSync(dataItem->wetTileFence);
+			dataItem->wetTileFence=0;
+			
+			if(dataItem->wetTileScanValid)
+				{
+				/* Map the pixel buffer object holding the read-back wet tile flags: */
+				glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->wetTileBufferObject);
+				const unsigned char* flags=static_cast<const unsigned char*>(glMapBufferARB(GL_PIXEL_PACK_BUFFER_ARB,GL_READ_ONLY_ARB));
+				unsigned int stride=(dataItem->numTiles[0]+3U)&~3U;
+				
+				/* Grow the set of wet tiles by one tile in all directions, so that water can not flow into tiles that are not simulated: */
+				unsigned char* wtPtr=&dataItem->wetTiles[0];
+				for(unsigned int y=0;y<dataItem->numTiles[1];++y)
+					{
+					unsigned int y0=y>0?y-1:y;
+					unsigned int y1=y+1<dataItem->numTiles[1]?y+1:y;
+					for(unsigned int x=0;x<dataItem->numTiles[0];++x,++wtPtr)
+						{
+						unsigned int x0=x>0?x-1:x;
+						unsigned int x1=x+1<dataItem->numTiles[0]?x+1:x;
+						unsigned char wet=0;
+						for(unsigned int ny=y0;ny<=y1;++ny)
+							for(unsigned int nx=x0;nx<=x1;++nx)
+								wet|=flags[ny*stride+nx];
+						*wtPtr=wet!=0?1:0;
+						}
+					}
+				
+				glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+				glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+				}
+			}
+		}
+	
+	/*********************************************************************
+	Select all wet tiles and their neighbors, and keep simulating tiles
+	that left that set for two more steps so that both conserved quantity
+	buffers hold their final state before they are frozen. Collect quads
+	covering horizontal runs of active tiles.
+	*********************************************************************/
+	
+	dataItem->activeTileQuads.clear();
+	dataItem->numActiveTiles=0;
+	dataItem->activeTiles.resize(dataItem->tileActivities.size());
+	const unsigned char* wtPtr=&dataItem->wetTiles[0];
+	unsigned char* taPtr=&dataItem->tileActivities[0];
+	unsigned char* atPtr=&dataItem->activeTiles[0];
+	GLint ts=GLint(dataItem->tileSize);
+	for(unsigned int y=0;y<dataItem->numTiles[1];++y)
+		{
+		GLint y0=GLint(y)*ts;
+		GLint y1=Math::min(y0+ts,GLint(size[1]));
+		GLint runStart=-1;
+		for(unsigned int x=0;x<=dataItem->numTiles[0];++x)
+			{
+			/* Check if the current tile is active: */
+			bool active=false;
+			if(x<dataItem->numTiles[0])
+				{
+				if(*wtPtr!=0)
+					*taPtr=2;
+				active=*taPtr!=0;
+				if(active)
+					{
+					++dataItem->numActiveTiles;
+					if(*wtPtr==0)
+						--*taPtr;
+					}
+				*atPtr=active?1:0;
+				++wtPtr;
+				++taPtr;
+				++atPtr;
+				}
+			
+			if(active&&runStart<0)
+				{
+				/* Start a new run: */
+				runStart=GLint(x)*ts;
+				}
+			else if(!active&&runStart>=0)
+				{
+				/* Finish the current run: */
+				dataItem->activeTileQuads.push_back(runStart);
+				dataItem->activeTileQuads.push_back(y0);
+				dataItem->activeTileQuads.push_back(Math::min(GLint(x)*ts,GLint(size[0])));
+				dataItem->activeTileQuads.push_back(y1);
+				runStart=-1;
+				}
+			}
+		}
+	
+	/*********************************************************************
+	Collect quads covering horizontal runs of inactive tiles that border
+	active tiles. The derivative stencil of active cells along the edge of
+	the active set reaches into those tiles, which must therefore hold
+	valid intermediate quantities during two-pass integration steps.
+	*********************************************************************/
+	
+	dataItem->borderTileQuads.clear();
+	const unsigned char* atRow=&dataItem->activeTiles[0];
+	for(unsigned int y=0;y<dataItem->numTiles[1];++y,atRow+=dataItem->numTiles[0])
+		{
+		GLint y0=GLint(y)*ts;
+		GLint y1=Math::min(y0+ts,GLint(size[1]));
+		const unsigned char* atRow0=y>0?atRow-dataItem->numTiles[0]:atRow;
+		const unsigned char* atRow1=y+1<dataItem->numTiles[1]?atRow+dataItem->numTiles[0]:atRow;
+		GLint runStart=-1;
+		for(unsigned int x=0;x<=dataItem->numTiles[0];++x)
+			{
+			/* Check if the current tile is inactive and has an active neighbor: */
+			bool border=false;
+			if(x<dataItem->numTiles[0]&&atRow[x]==0)
+				{
+				unsigned int x0=x>0?x-1:x;
+				unsigned int x1=x+1<dataItem->numTiles[0]?x+1:x;
+				for(unsigned int nx=x0;nx<=x1;++nx)
+					border=border||atRow0[nx]!=0||atRow[nx]!=0||atRow1[nx]!=0;
+				}
+			
+			if(border&&runStart<0)
+				{
+				/* Start a new run: */
+				runStart=GLint(x)*ts;
+				}
+			else if(!border&&runStart>=0)
+				{
+				/* Finish the current run: */
+				dataItem->borderTileQuads.push_back(runStart);
+				dataItem->borderTileQuads.push_back(y0);
+				dataItem->borderTileQuads.push_back(Math::min(GLint(x)*ts,GLint(size[0])));
+				dataItem->borderTileQuads.push_back(y1);
+				runStart=-1;
+				}
+			}
+		}
+	}
+
+void WaterTable2::activateTiles(WaterTable2::DataItem* dataItem,const Rect& rect) const
+	{
+	/* Bail out if dry tile skipping is disabled or the wet tile state has not been allocated yet: */
+	if(dataItem->tileSize==0||dataItem->tileSize!=dryTileSize)
+		return;
+	
+	/* Find the range of tiles overlapping the given rectangle, grown by one tile in all directions so that water can flow out of it: */
+	unsigned int ts=dataItem->tileSize;
+	unsigned int tMin[2],tMax[2];
+	for(int i=0;i<2;++i)
+		{
+		tMin[i]=(unsigned int)(rect.offset[i])/ts;
+		tMin[i]=tMin[i]>0?tMin[i]-1:0;
+		tMax[i]=Math::min(((unsigned int)(rect.offset[i])+rect.size[i]+ts-1)/ts+1,dataItem->numTiles[i]);
+		}
+	
+	/* Mark the tiles as wet until the next wet tile scan, which will keep them active for at least two more steps so that both conserved quantity buffers receive the changed state: */
+	for(unsigned int y=tMin[1];y<tMax[1];++y)
+		for(unsigned int x=tMin[0];x<tMax[0];++x)
+			dataItem->wetTiles[y*dataItem->numTiles[0]+x]=1;
+	
+	/* Ignore a pending wet tile scan, which does not reflect the changed state: */
+	dataItem->wetTileScanValid=false;
+	}
+
+void WaterTable2::scanWetTiles(WaterTable2::DataItem* dataItem,TextureTracker& textureTracker) const
+	{
+	/* Bail out if dry tile skipping is disabled or the previous scan has not been picked up yet: */
+	if(dataItem->tileSize==0||dataItem->wetTileFence!=0)
+		return;
+	
+	/* Set up the wet tile frame buffer: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->wetTileFramebufferObject);
+	glViewport(dataItem->numTiles);
+	
+	/* Set up the wet tile shader: */
+	dataItem->wetTileShader.use();
+	textureTracker.reset();
+	dataItem->wetTileShader.uploadUniform(GLfloat(dataItem->tileSize));
+	dataItem->wetTileShader.uploadUniform(GLfloat(size[0]),GLfloat(size[1]));
+	dataItem->wetTileShader.uploadUniform(dryDepth);
+	dataItem->bathymetry.bind(textureTracker,dataItem->wetTileShader,dataItem->bathymetry.current,false);
+	dataItem->quantity.bind(textureTracker,dataItem->wetTileShader,dataItem->quantity.current,false);
+	
+	/* Run the wet tile reduction; we're using size[] instead of the tile grid size here because the vertex shader will scale properly: */
+	glBegin(GL_QUADS);
+	glVertex2i(0,0);
+	glVertex2i(size[0],0);
+	glVertex2i(size[0],size[1]);
+	glVertex2i(0,size[1]);
+	glEnd();
+	
+	/* Start reading back the wet tile flags without waiting for the result: */
+	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->wetTileBufferObject);
+	glReadPixels(0,0,dataItem->numTiles[0],dataItem->numTiles[1],GL_RED,GL_UNSIGNED_BYTE,0);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	glReadBuffer(GL_NONE);
+	dataItem->wetTileFence=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+	dataItem->wetTileScanValid=true;
+	}
+
+void WaterTable2::renderWaterDisks(WaterTable2::DataItem* dataItem) const
+	{
+	/* Upload the per-instance attributes of the current water disks if they changed since the last upload: */
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB,dataItem->waterDiskBufferObjects[1]);
+	if(dataItem->waterDisksVersion!=waterDisksVersion)
+		{
+		glBufferDataARB(GL_ARRAY_BUFFER_ARB,waterDisks.size()*5*sizeof(GLfloat),0,GL_STREAM_DRAW_ARB);
+		GLfloat* iPtr=static_cast<GLfloat*>(glMapBufferARB(GL_ARRAY_BUFFER_ARB,GL_WRITE_ONLY_ARB));
+		for(WaterDiskList::const_iterator wdIt=waterDisks.begin();wdIt!=waterDisks.end();++wdIt,iPtr+=5)
+			{
+			for(int i=0;i<3;++i)
+				iPtr[i]=GLfloat(wdIt->center[i]);
+			iPtr[3]=GLfloat(wdIt->radius);
+			iPtr[4]=wdIt->rate;
+			}
+		glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
+		dataItem->waterDisksVersion=waterDisksVersion;
+		}
+	
+	/* Set up the water disk shader: */
+	dataItem->waterDiskShader.use();
+	dataItem->waterDiskShader.uploadUniformMatrix4(1,GL_FALSE,waterAddPmvMatrix);
+	Vector x=baseTransform.inverseTransform(Vector(1,0,0));
+	dataItem->waterDiskShader.uploadUniform(GLfloat(x[0]),GLfloat(x[1]),GLfloat(x[2]));
+	Vector y=baseTransform.inverseTransform(Vector(0,1,0));
+	dataItem->waterDiskShader.uploadUniform(GLfloat(y[0]),GLfloat(y[1]),GLfloat(y[2]));
+	dataItem->waterDiskShader.uploadUniform(Math::sqrt(Math::sqr(cellSize[0])+Math::sqr(cellSize[1]))*2.0f);
+	
+	/* Set up the per-instance disk and disk rate attributes: */
+	const GLint* locs=dataItem->waterDiskAttributeLocations;
+	glEnableVertexAttribArrayARB(locs[1]);
+	glVertexAttribPointerARB(locs[1],4,GL_FLOAT,GL_FALSE,5*sizeof(GLfloat),static_cast<const GLfloat*>(0));
+	glVertexAttribDivisorARB(locs[1],1);
+	glEnableVertexAttribArrayARB(locs[2]);
+	glVertexAttribPointerARB(locs[2],1,GL_FLOAT,GL_FALSE,5*sizeof(GLfloat),static_cast<const GLfloat*>(0)+4);
+	glVertexAttribDivisorARB(locs[2],1);
+	
+	/* Set up the per-vertex template attribute: */
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB,dataItem->waterDiskBufferObjects[0]);
+	glEnableVertexAttribArrayARB(locs[0]);
+	glVertexAttribPointerARB(locs[0],3,GL_FLOAT,GL_FALSE,0,static_cast<const GLfloat*>(0));
+	
+	/* Render all water disks, which can face either way depending on the base transformation: */
+	glPushAttrib(GL_ENABLE_BIT);
+	glDisable(GL_CULL_FACE);
+	glDrawArraysInstancedARB(GL_TRIANGLES,0,numWaterDiskVertices,GLsizei(waterDisks.size()));
+	glPopAttrib();
+	
+	/* Reset the vertex attribute state: */
+	glDisableVertexAttribArrayARB(locs[0]);
+	for(int i=1;i<3;++i)
+		{
+		glVertexAttribDivisorARB(locs[i],0);
+		glDisableVertexAttribArrayARB(locs[i]);
+		}
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB,0);
+	}
+
+void WaterTable2::renderActiveTiles(const WaterTable2::DataItem* dataItem) const
+	{
+	glBegin(GL_QUADS);
+	if(dataItem->tileSize!=0)
+		{
+		/* Render one quad for each horizontal run of active tiles: */
+		for(std::vector<GLint>::const_iterator atqIt=dataItem->activeTileQuads.begin();atqIt!=dataItem->activeTileQuads.end();atqIt+=4)
+			{
+			glVertex2i(atqIt[0],atqIt[1]);
+			glVertex2i(atqIt[2],atqIt[1]);
+			glVertex2i(atqIt[2],atqIt[3]);
+			glVertex2i(atqIt[0],atqIt[3]);
+			}
+		}
+	else
+		{
+		/* Render a single quad covering the entire grid: */
+		glVertex2i(0,0);
+		glVertex2i(size[0],0);
+		glVertex2i(size[0],size[1]);
+		glVertex2i(0,size[1]);
+		}
+	glEnd();
+	}
+
+void WaterTable2::reduceStats(WaterTable2::DataItem* dataItem,TextureTracker& textureTracker) const
+	{
+	/* Bail out if health statistics are disabled or not yet due, or the previous reduction has not been picked up yet: */
+	if(statsInterval==0||++dataItem->numStepsSinceStats<statsInterval||dataItem->statsFence!=0)
+		return;
+	dataItem->numStepsSinceStats=0;
+	
+	/* Set up the statistics frame buffer: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->statsFramebufferObject);
+	glViewport(dataItem->numStatsBlocks);
+	
+	/* Set up the statistics shader: */
+	dataItem->statsShader.use();
+	textureTracker.reset();
+	dataItem->statsShader.uploadUniform(GLfloat(statsBlockSize));
+	dataItem->statsShader.uploadUniform(GLfloat(size[0]),GLfloat(size[1]));
+	dataItem->statsShader.uploadUniform(dryDepth);
+	dataItem->statsShader.uploadUniform(epsilon);
+	dataItem->bathymetry.bind(textureTracker,dataItem->statsShader,dataItem->bathymetry.current,false);
+	dataItem->quantity.bind(textureTracker,dataItem->statsShader,dataItem->quantity.current,false);
+	
+	/* Run the block reduction; we're using size[] instead of the block grid size here because the vertex shader will scale properly: */
+	glBegin(GL_QUADS);
+	glVertex2i(0,0);
+	glVertex2i(size[0],0);
+	glVertex2i(size[0],size[1]);
+	glVertex2i(0,size[1]);
+	glEnd();
+	
+	/* Start reading back the partial statistics without waiting for the result: */
+	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->statsBufferObject);
+	glReadPixels(0,0,dataItem->numStatsBlocks[0],dataItem->numStatsBlocks[1],GL_RGBA,GL_FLOAT,0);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	glReadBuffer(GL_NONE);
+	dataItem->statsFence=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+	}
+
 WaterTable2::WaterTable2(const Size& sSize,const GLfloat sCellSize[2])
 	:size(sSize),
 	 depthImageRenderer(0),
 	 baseTransform(ONTransform::identity),
+	 renderFactor(1),renderSize(sSize),
 	 mode(Traditional),
 	 propertyGridCreator(0),
-	 dryBoundary(true)
+	 waterDisksVersion(0),
+	 dryBoundary(true),fusedIntegration(false),
+	 dryTileSize(0),dryDepth(1.0e-3f),
+	 halfPrecision(false),
+	 statsInterval(0)
 	{
 	/* Initialize the water table cell size: */
 	for(int i=0;i<2;++i)
-		cellSize[i]=sCellSize[i];
+		renderCellSize[i]=cellSize[i]=sCellSize[i];
 	
 	/* Calculate a simulation domain: */
 	for(int i=0;i<2;++i)
@@ -417,6 +960,8 @@ WaterTable2::WaterTable2(const Size& sSize,const GLfloat sCellSize[2])
 		domain.min[i]=Scalar(0);
 		domain.max[i]=Scalar(size[i])*Scalar(cellSize[i]);
 		}
+	domain.min[2]=Scalar(-20);
+	domain.max[2]=Scalar(100);
 	
 	/* Calculate the water table transformations: */
 	calcTransformations();
@@ -440,9 +985,14 @@ WaterTable2::WaterTable2(const Size& sSize,const GLfloat sCellSize[2])
 WaterTable2::WaterTable2(const Size& sSize,const DepthImageRenderer* sDepthImageRenderer,const Point basePlaneCorners[4])
 	:size(sSize),
 	 depthImageRenderer(sDepthImageRenderer),
+	 renderFactor(1),renderSize(sSize),
 	 mode(Traditional),
 	 propertyGridCreator(0),
-	 dryBoundary(true)
+	 waterDisksVersion(0),
+	 dryBoundary(true),fusedIntegration(false),
+	 dryTileSize(0),dryDepth(1.0e-3f),
+	 halfPrecision(false),
+	 statsInterval(0)
 	{
 	/* Project the corner points to the base plane and calculate their centroid: */
 	const Plane& basePlane=depthImageRenderer->getBasePlane();
@@ -473,7 +1023,7 @@ WaterTable2::WaterTable2(const Size& sSize,const DepthImageRenderer* sDepthImage
 	
 	/* Calculate the grid's cell size: */
 	for(int i=0;i<2;++i)
-		cellSize[i]=GLfloat((domain.max[i]-domain.min[i])/Scalar(size[i]));
+		renderCellSize[i]=cellSize[i]=GLfloat((domain.max[i]-domain.min[i])/Scalar(size[i]));
 	
 	// DEBUGGING
 	// std::cout<<cellSize[0]<<" x "<<cellSize[1]<<std::endl;
@@ -501,10 +1051,15 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	{
 	/* Initialize required OpenGL extensions: */
 	GLARBDrawBuffers::initExtension();
+	GLARBDrawInstanced::initExtension();
 	GLARBFragmentShader::initExtension();
+	GLARBInstancedArrays::initExtension();
+	GLARBPixelBufferObject::initExtension();
+	GLARBSync::initExtension();
 	GLARBTextureFloat::initExtension();
 	GLARBTextureRectangle::initExtension();
 	GLARBTextureRg::initExtension();
+	GLARBVertexBufferObject::initExtension();
 	GLARBVertexShader::initExtension();
 	GLEXTFramebufferObject::initExtension();
 	Shader::initExtensions();
@@ -523,12 +1078,35 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	dataItem->quantity.init(size[0],size[1],3,GL_RGB32F,GL_RGB,domain.min[2],0.0f,0.0f);
 	
 	{
-	/* Create the cell-centered temporal derivative texture: */
+	/* Create the cell-centered previous quantity state texture: */
+	glGenTextures(1,&dataItem->previousQuantityTextureObject);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->previousQuantityTextureObject);
+	sampleNearest();
+	GLfloat* q=makeBuffer(size[0],size[1],3,domain.min[2],0.0f,0.0f);
+	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_RGB32F,size[0],size[1],0,GL_RGB,GL_FLOAT,q);
+	delete[] q;
+	}
+	
+	/* Create the cell-centered interpolated quantity state texture: */
+	dataItem->renderQuantity.init(size[0],size[1],3,GL_RGB32F,GL_RGB,domain.min[2],0.0f,0.0f);
+	
+	if(renderFactor>1)
+		{
+		/* Create the vertex-centered bathymetry texture at rendering resolution: */
+		dataItem->renderBathymetry.init(renderSize[0]-1,renderSize[1]-1,1,GL_R32F,GL_LUMINANCE,domain.min[2]);
+		
+		/* Create the cell-centered reconstructed quantity state and snow height textures at rendering resolution: */
+		dataItem->upsampledQuantity.init(renderSize[0],renderSize[1],3,GL_RGB32F,GL_RGB,domain.min[2],0.0f,0.0f);
+		dataItem->upsampledSnow.init(renderSize[0],renderSize[1],1,GL_R32F,GL_LUMINANCE,0.0f);
+		}
+	
+	{
+	/* Create the cell-centered temporal derivative texture, which does not accumulate and can therefore use half precision: */
 	glGenTextures(1,&dataItem->derivativeTextureObject);
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->derivativeTextureObject);
 	sampleNearest();
 	GLfloat* qt=makeBuffer(size[0],size[1],3,0.0f,0.0f,0.0f);
-	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_RGB32F,size[0],size[1],0,GL_RGB,GL_FLOAT,qt);
+	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,halfPrecision?GL_RGB16F:GL_RGB32F,size[0],size[1],0,GL_RGB,GL_FLOAT,qt);
 	delete[] qt;
 	}
 	
@@ -536,15 +1114,92 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	dataItem->maxStepSize.init(size[0],size[1],1,GL_R32F,GL_LUMINANCE,10000.0f);
 	
 	{
-	/* Create the cell-centered water texture: */
+	/* Create the 1x1 step size texture: */
+	glGenTextures(1,&dataItem->stepSizeTextureObject);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->stepSizeTextureObject);
+	sampleNearest();
+	GLfloat s=0.0f;
+	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_R32F,1,1,0,GL_LUMINANCE,GL_FLOAT,&s);
+	}
+	
+	{
+	/* Create the pixel buffer objects to read back step sizes: */
+	glGenBuffersARB(2,dataItem->stepSizeBufferObjects);
+	for(int i=0;i<2;++i)
+		{
+		glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->stepSizeBufferObjects[i]);
+		glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB,sizeof(GLfloat),0,GL_STREAM_READ_ARB);
+		}
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	}
+	
+	{
+	/* Create the cell-centered water rate texture, which does not accumulate across frames and can therefore use half precision: */
 	glGenTextures(1,&dataItem->waterTextureObject);
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->waterTextureObject);
 	sampleNearest();
 	GLfloat* w=makeBuffer(size[0],size[1],1,0.0f);
-	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_R32F,size[0],size[1],0,GL_LUMINANCE,GL_FLOAT,w);
+	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,halfPrecision?GL_R16F:GL_R32F,size[0],size[1],0,GL_LUMINANCE,GL_FLOAT,w);
 	delete[] w;
 	}
 	
+	{
+	/* Create the water disk template and instance vertex buffer objects; the instance buffer will be filled when water disks are rendered: */
+	glGenBuffersARB(2,dataItem->waterDiskBufferObjects);
+	
+	/* Upload the water disk template as (cosine, sine, band edge) vertices of an inner triangle fan and a surrounding decay band: */
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB,dataItem->waterDiskBufferObjects[0]);
+	glBufferDataARB(GL_ARRAY_BUFFER_ARB,numWaterDiskVertices*3*sizeof(GLfloat),0,GL_STATIC_DRAW_ARB);
+	GLfloat* tPtr=static_cast<GLfloat*>(glMapBufferARB(GL_ARRAY_BUFFER_ARB,GL_WRITE_ONLY_ARB));
+	for(unsigned int i=0;i<numWaterDiskSegments;++i)
+		{
+		/* Calculate the directions of the segment's two sides: */
+		double a0=2.0*Math::Constants<double>::pi*double(i)/double(numWaterDiskSegments);
+		double a1=2.0*Math::Constants<double>::pi*double(i+1)/double(numWaterDiskSegments);
+		GLfloat c0=GLfloat(Math::cos(a0));
+		GLfloat s0=GLfloat(Math::sin(a0));
+		GLfloat c1=GLfloat(Math::cos(a1));
+		GLfloat s1=GLfloat(Math::sin(a1));
+		GLfloat segment[9][3]=
+			{
+			{0.0f,0.0f,0.0f},{c0,s0,0.0f},{c1,s1,0.0f}, // Inner disk triangle
+			{c0,s0,0.0f},{c0,s0,1.0f},{c1,s1,1.0f}, // First decay band triangle
+			{c0,s0,0.0f},{c1,s1,1.0f},{c1,s1,0.0f} // Second decay band triangle
+			};
+		for(int j=0;j<9;++j)
+			for(int k=0;k<3;++k,++tPtr)
+				*tPtr=segment[j][k];
+		}
+	glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB,0);
+	}
+	
+	{
+	/* Create the wet tile texture; its size depends on the dry tile size, and it will be allocated on first use: */
+	glGenTextures(1,&dataItem->wetTileTextureObject);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->wetTileTextureObject);
+	sampleNearest();
+	
+	/* Create the pixel buffer object to read back wet tile flags: */
+	glGenBuffersARB(1,&dataItem->wetTileBufferObject);
+	}
+	
+	{
+	/* Create the partial health statistics texture, with partial blocks along the right and top edges: */
+	for(int i=0;i<2;++i)
+		dataItem->numStatsBlocks[i]=(size[i]+statsBlockSize-1)/statsBlockSize;
+	glGenTextures(1,&dataItem->statsTextureObject);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->statsTextureObject);
+	sampleNearest();
+	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_RGBA32F,dataItem->numStatsBlocks[0],dataItem->numStatsBlocks[1],0,GL_RGBA,GL_FLOAT,0);
+	
+	/* Create the pixel buffer object to read back partial health statistics: */
+	glGenBuffersARB(1,&dataItem->statsBufferObject);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->statsBufferObject);
+	glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->numStatsBlocks[0]*dataItem->numStatsBlocks[1]*4*sizeof(GLfloat),0,GL_STREAM_READ_ARB);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	}
+	
 	/* Protect the newly-created textures: */
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
 	
@@ -593,6 +1248,17 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	glReadBuffer(GL_NONE);
 	}
 	
+	{
+	/* Create the step size frame buffer: */
+	glGenFramebuffersEXT(1,&dataItem->stepSizeFramebufferObject);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->stepSizeFramebufferObject);
+	
+	/* Attach the step size texture to the step size frame buffer: */
+	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT,GL_TEXTURE_RECTANGLE_ARB,dataItem->stepSizeTextureObject,0);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	}
+	
 	{
 	/* Create the integration step frame buffer: */
 	glGenFramebuffersEXT(1,&dataItem->integrationFramebufferObject);
@@ -622,6 +1288,59 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	glReadBuffer(GL_NONE);
 	}
 	
+	{
+	/* Create the wet tile frame buffer; the wet tile texture will be attached when it is allocated: */
+	glGenFramebuffersEXT(1,&dataItem->wetTileFramebufferObject);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->wetTileFramebufferObject);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glReadBuffer(GL_NONE);
+	}
+	
+	{
+	/* Create the quantity interpolation frame buffer: */
+	glGenFramebuffersEXT(1,&dataItem->interpolationFramebufferObject);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->interpolationFramebufferObject);
+	
+	/* Attach the interpolated quantity texture to the quantity interpolation frame buffer: */
+	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT,GL_TEXTURE_RECTANGLE_ARB,dataItem->renderQuantity.textureObjects[0],0);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glReadBuffer(GL_NONE);
+	}
+	
+	{
+	/* Create the health statistics frame buffer: */
+	glGenFramebuffersEXT(1,&dataItem->statsFramebufferObject);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->statsFramebufferObject);
+	
+	/* Attach the partial health statistics texture to the health statistics frame buffer: */
+	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT,GL_TEXTURE_RECTANGLE_ARB,dataItem->statsTextureObject,0);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glReadBuffer(GL_NONE);
+	}
+	
+	if(renderFactor>1)
+		{
+		/* Create the rendering-resolution bathymetry rendering frame buffer: */
+		glGenFramebuffersEXT(1,&dataItem->renderBathymetryFramebufferObject);
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->renderBathymetryFramebufferObject);
+		
+		/* Attach the rendering-resolution bathymetry texture to the rendering-resolution bathymetry rendering frame buffer: */
+		glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT,GL_TEXTURE_RECTANGLE_ARB,dataItem->renderBathymetry.textureObjects[0],0);
+		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+		glReadBuffer(GL_NONE);
+		
+		/* Create the upsampling frame buffer: */
+		glGenFramebuffersEXT(1,&dataItem->upsampleFramebufferObject);
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->upsampleFramebufferObject);
+		
+		/* Attach the reconstructed quantity state and snow height textures to the upsampling frame buffer: */
+		glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT,GL_TEXTURE_RECTANGLE_ARB,dataItem->upsampledQuantity.textureObjects[0],0);
+		glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT1_EXT,GL_TEXTURE_RECTANGLE_ARB,dataItem->upsampledSnow.textureObjects[0],0);
+		GLenum drawBuffers[2]={GL_COLOR_ATTACHMENT0_EXT,GL_COLOR_ATTACHMENT1_EXT};
+		glDrawBuffersARB(2,drawBuffers);
+		glReadBuffer(GL_NONE);
+		}
+	
 	/* Restore the previously bound frame buffer: */
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
 	
@@ -676,6 +1395,7 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	dataItem->maxStepSizeShader.addShader(compileFragmentShader("Water2MaxStepSizeShader"));
 	dataItem->maxStepSizeShader.link();
 	dataItem->maxStepSizeShader.setUniformLocation("fullTextureSize");
+	dataItem->maxStepSizeShader.setUniformLocation("maxStepSize");
 	dataItem->maxStepSizeShader.setUniformLocation("maxStepSizeSampler");
 	
 	/* Create the boundary condition shader: */
@@ -688,44 +1408,89 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	dataItem->eulerStepShaders[0].addShader(vertexShader,false);
 	dataItem->eulerStepShaders[0].addShader(compileFragmentShader("Water2EulerStepShader"));
 	dataItem->eulerStepShaders[0].link();
-	dataItem->eulerStepShaders[0].setUniformLocation("stepSize");
 	dataItem->eulerStepShaders[0].setUniformLocation("attenuation");
 	dataItem->eulerStepShaders[0].setUniformLocation("quantitySampler");
 	dataItem->eulerStepShaders[0].setUniformLocation("derivativeSampler");
+	dataItem->eulerStepShaders[0].setUniformLocation("stepSizeSampler");
 	
 	/* Create the "engineering" Euler integration step shader: */
 	dataItem->eulerStepShaders[1].addShader(vertexShader,false);
 	dataItem->eulerStepShaders[1].addShader(compileFragmentShader("Water2EngineeringEulerStepShader"));
 	dataItem->eulerStepShaders[1].link();
-	dataItem->eulerStepShaders[1].setUniformLocation("stepSize");
 	dataItem->eulerStepShaders[1].setUniformLocation("quantitySampler");
 	dataItem->eulerStepShaders[1].setUniformLocation("derivativeSampler");
+	dataItem->eulerStepShaders[1].setUniformLocation("stepSizeSampler");
 	
 	/* Create the "traditional" Runge-Kutta integration step shader: */
 	dataItem->rungeKuttaStepShaders[0].addShader(vertexShader,false);
 	dataItem->rungeKuttaStepShaders[0].addShader(compileFragmentShader("Water2RungeKuttaStepShader"));
 	dataItem->rungeKuttaStepShaders[0].link();
-	dataItem->rungeKuttaStepShaders[0].setUniformLocation("stepSize");
 	dataItem->rungeKuttaStepShaders[0].setUniformLocation("attenuation");
 	dataItem->rungeKuttaStepShaders[0].setUniformLocation("quantitySampler");
 	dataItem->rungeKuttaStepShaders[0].setUniformLocation("quantityStarSampler");
 	dataItem->rungeKuttaStepShaders[0].setUniformLocation("derivativeSampler");
+	dataItem->rungeKuttaStepShaders[0].setUniformLocation("stepSizeSampler");
 	
 	/* Create the "engineering" Runge-Kutta integration step shader: */
 	dataItem->rungeKuttaStepShaders[1].addShader(vertexShader,false);
 	dataItem->rungeKuttaStepShaders[1].addShader(compileFragmentShader("Water2EngineeringRungeKuttaStepShader"));
 	dataItem->rungeKuttaStepShaders[1].link();
-	dataItem->rungeKuttaStepShaders[1].setUniformLocation("stepSize");
 	dataItem->rungeKuttaStepShaders[1].setUniformLocation("quantitySampler");
 	dataItem->rungeKuttaStepShaders[1].setUniformLocation("quantityStarSampler");
 	dataItem->rungeKuttaStepShaders[1].setUniformLocation("derivativeSampler");
+	dataItem->rungeKuttaStepShaders[1].setUniformLocation("stepSizeSampler");
+	
+	/* Create the "traditional" fused Runge-Kutta integration step shader: */
+	dataItem->fusedRungeKuttaStepShaders[0].addShader(vertexShader,false);
+	dataItem->fusedRungeKuttaStepShaders[0].addShader(compileFragmentShader("Water2FusedRungeKuttaStepShader"));
+	dataItem->fusedRungeKuttaStepShaders[0].link();
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("cellSize");
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("theta");
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("g");
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("epsilon");
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("maxPropagationSpeed");
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("attenuation");
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("dryBoundary");
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("boundary");
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("bathymetrySampler");
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("quantitySampler");
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("derivativeSampler");
+	dataItem->fusedRungeKuttaStepShaders[0].setUniformLocation("stepSizeSampler");
+	
+	/* Create the "engineering" fused Runge-Kutta integration step shader: */
+	dataItem->fusedRungeKuttaStepShaders[1].addShader(vertexShader,false);
+	dataItem->fusedRungeKuttaStepShaders[1].addShader(compileFragmentShader("Water2EngineeringFusedRungeKuttaStepShader"));
+	dataItem->fusedRungeKuttaStepShaders[1].link();
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("cellSize");
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("theta");
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("g");
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("epsilon");
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("maxPropagationSpeed");
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("dryBoundary");
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("boundary");
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("bathymetrySampler");
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("quantitySampler");
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("derivativeSampler");
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("stepSizeSampler");
+	dataItem->fusedRungeKuttaStepShaders[1].setUniformLocation("gridPropertySampler");
 	
 	/* Create the water adder rendering shader: */
 	dataItem->waterAddShader.addShader(compileVertexShader("Water2WaterAddShader"));
 	dataItem->waterAddShader.addShader(compileFragmentShader("Water2WaterAddShader"));
 	dataItem->waterAddShader.link();
 	dataItem->waterAddShader.setUniformLocation("pmv");
-	dataItem->waterAddShader.setUniformLocation("stepSize");
+	
+	/* Create the water disk rendering shader: */
+	dataItem->waterDiskShader.addShader(compileVertexShader("Water2WaterDiskShader"));
+	dataItem->waterDiskShader.addShader(compileFragmentShader("Water2WaterAddShader"));
+	dataItem->waterDiskShader.link();
+	dataItem->waterDiskShader.setUniformLocation("pmv");
+	dataItem->waterDiskShader.setUniformLocation("diskX");
+	dataItem->waterDiskShader.setUniformLocation("diskY");
+	dataItem->waterDiskShader.setUniformLocation("edgeWidth");
+	dataItem->waterDiskAttributeLocations[0]=dataItem->waterDiskShader.getAttribLocation("diskVertex");
+	dataItem->waterDiskAttributeLocations[1]=dataItem->waterDiskShader.getAttribLocation("disk");
+	dataItem->waterDiskAttributeLocations[2]=dataItem->waterDiskShader.getAttribLocation("diskRate");
 	
 	/* Create the water shader: */
 	dataItem->waterShader.addShader(vertexShader,false);
@@ -735,11 +1500,62 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	dataItem->waterShader.setUniformLocation("snowSampler");
 	dataItem->waterShader.setUniformLocation("quantitySampler");
 	dataItem->waterShader.setUniformLocation("waterSampler");
+	dataItem->waterShader.setUniformLocation("stepSizeSampler");
 	dataItem->waterShader.setUniformLocation("snowLine");
 	dataItem->waterShader.setUniformLocation("snowMelt");
 	
+	/* Create the wet tile shader: */
+	dataItem->wetTileShader.addShader(vertexShader,false);
+	dataItem->wetTileShader.addShader(compileFragmentShader("Water2WetTileShader"));
+	dataItem->wetTileShader.link();
+	dataItem->wetTileShader.setUniformLocation("tileSize");
+	dataItem->wetTileShader.setUniformLocation("gridSize");
+	dataItem->wetTileShader.setUniformLocation("dryDepth");
+	dataItem->wetTileShader.setUniformLocation("bathymetrySampler");
+	dataItem->wetTileShader.setUniformLocation("quantitySampler");
+	
+	/* Create the quantity interpolation shader: */
+	dataItem->interpolationShader.addShader(vertexShader,false);
+	dataItem->interpolationShader.addShader(compileFragmentShader("Water2InterpolationShader"));
+	dataItem->interpolationShader.link();
+	dataItem->interpolationShader.setUniformLocation("weight");
+	dataItem->interpolationShader.setUniformLocation("previousQuantitySampler");
+	dataItem->interpolationShader.setUniformLocation("quantitySampler");
+	
+	/* Create the health statistics shader: */
+	dataItem->statsShader.addShader(vertexShader,false);
+	dataItem->statsShader.addShader(compileFragmentShader("Water2StatsShader"));
+	dataItem->statsShader.link();
+	dataItem->statsShader.setUniformLocation("blockSize");
+	dataItem->statsShader.setUniformLocation("gridSize");
+	dataItem->statsShader.setUniformLocation("dryDepth");
+	dataItem->statsShader.setUniformLocation("epsilon");
+	dataItem->statsShader.setUniformLocation("bathymetrySampler");
+	dataItem->statsShader.setUniformLocation("quantitySampler");
+	
 	/* Delete the shared vertex shader: */
 	glDeleteObjectARB(vertexShader);
+	
+	if(renderFactor>1)
+		{
+		/* Create a simple vertex shader to render quads in rendering grid pixel space: */
+		snprintf(vertexShaderSource,sizeof(vertexShaderSource),vertexShaderSourceTemplate,2.0/double(renderSize[0]),2.0/double(renderSize[1]));
+		GLhandleARB renderVertexShader=glCompileVertexShaderFromString(vertexShaderSource);
+		
+		/* Create the upsampling shader: */
+		dataItem->upsampleShader.addShader(renderVertexShader,false);
+		dataItem->upsampleShader.addShader(compileFragmentShader("Water2UpsampleShader"));
+		dataItem->upsampleShader.link();
+		dataItem->upsampleShader.setUniformLocation("renderFactor");
+		dataItem->upsampleShader.setUniformLocation("dryDepth");
+		dataItem->upsampleShader.setUniformLocation("bathymetrySampler");
+		dataItem->upsampleShader.setUniformLocation("snowSampler");
+		dataItem->upsampleShader.setUniformLocation("quantitySampler");
+		dataItem->upsampleShader.setUniformLocation("renderBathymetrySampler");
+		
+		/* Delete the rendering grid vertex shader: */
+		glDeleteObjectARB(renderVertexShader);
+		}
 	}
 
 void WaterTable2::setElevationRange(Scalar newMin,Scalar newMax)
@@ -797,6 +1613,35 @@ void WaterTable2::removeRenderFunction(const AddWaterFunction* removeRenderFunct
 			}
 	}
 
+void WaterTable2::addWaterDiskFunction(const AddWaterDiskFunction* newWaterDiskFunction)
+	{
+	/* Store the new water disk function: */
+	waterDiskFunctions.push_back(newWaterDiskFunction);
+	}
+
+void WaterTable2::removeWaterDiskFunction(const AddWaterDiskFunction* removeWaterDiskFunction)
+	{
+	/* Find the given water disk function in the list and remove it: */
+	for(std::vector<const AddWaterDiskFunction*>::iterator wdfIt=waterDiskFunctions.begin();wdfIt!=waterDiskFunctions.end();++wdfIt)
+		if(*wdfIt==removeWaterDiskFunction)
+			{
+			/* Remove the list element: */
+			waterDiskFunctions.erase(wdfIt);
+			break;
+			}
+	}
+
+void WaterTable2::updateWaterDisks(void)
+	{
+	/* Collect the current water disks from all water disk functions: */
+	waterDisks.clear();
+	for(std::vector<const AddWaterDiskFunction*>::const_iterator wdfIt=waterDiskFunctions.begin();wdfIt!=waterDiskFunctions.end();++wdfIt)
+		(**wdfIt)(waterDisks);
+	
+	/* Invalidate the water disk instance buffers in all OpenGL contexts: */
+	++waterDisksVersion;
+	}
+
 void WaterTable2::setSnowLine(GLfloat newSnowLine)
 	{
 	snowLine=newSnowLine;
@@ -817,37 +1662,315 @@ void WaterTable2::setDryBoundary(bool newDryBoundary)
 	dryBoundary=newDryBoundary;
 	}
 
-void WaterTable2::updateBathymetry(GLContextData& contextData,TextureTracker& textureTracker) const
+void WaterTable2::setFusedIntegration(bool newFusedIntegration)
 	{
-	/* Get the data item: */
+	fusedIntegration=newFusedIntegration;
+	}
+
+void WaterTable2::setDryTileSkipping(unsigned int newDryTileSize,GLfloat newDryDepth)
+	{
+	dryTileSize=newDryTileSize;
+	dryDepth=newDryDepth;
+	}
+
+void WaterTable2::setHalfPrecision(bool newHalfPrecision)
+	{
+	halfPrecision=newHalfPrecision;
+	}
+
+void WaterTable2::setRenderFactor(unsigned int newRenderFactor)
+	{
+	/* Bail out if the bathymetry is not rendered from a depth image renderer, as there would be no source for a bathymetry grid at rendering resolution: */
+	if(depthImageRenderer==0||newRenderFactor==0)
+		return;
+	
+	/* Calculate the size and cell size of the rendering grid: */
+	renderFactor=newRenderFactor;
+	for(int i=0;i<2;++i)
+		{
+		renderSize[i]=size[i]*renderFactor;
+		renderCellSize[i]=cellSize[i]/GLfloat(renderFactor);
+		}
+	
+	/* Update the water table transformations: */
+	calcTransformations();
+	}
+
+void WaterTable2::setStatsInterval(unsigned int newStatsInterval)
+	{
+	statsInterval=newStatsInterval;
+	}
+
+bool WaterTable2::retrieveStats(GLContextData& contextData,WaterStats& stats) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Check if the pending health statistics read-back has completed, without waiting for it: */
+	if(dataItem->statsFence==0)
+		return false;
+	GLenum waitResult=glClientWaitSync(dataItem->statsFence,GL_SYNC_FLUSH_COMMANDS_BIT,0);
+	if(waitResult!=GL_ALREADY_SIGNALED&&waitResult!=GL_CONDITION_SATISFIED)
+		return false;
+	glDeleteSync(dataItem->statsFence);
+	dataItem->statsFence=0;
+	
+	/* Map the pixel buffer object holding the read-back partial statistics: */
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->statsBufferObject);
+	const GLfloat* blockStats=static_cast<const GLfloat*>(glMapBufferARB(GL_PIXEL_PACK_BUFFER_ARB,GL_READ_ONLY_ARB));
+	
+	/* Combine the partial statistics of all blocks, summing water column heights in double precision: */
+	double volume=0.0;
+	stats.maxSpeed=0.0f;
+	double numWetCells=0.0;
+	stats.maxDepth=0.0f;
+	unsigned int numBlocks=dataItem->numStatsBlocks[0]*dataItem->numStatsBlocks[1];
+	for(unsigned int i=0;i<numBlocks;++i,blockStats+=4)
+		{
+		volume+=double(blockStats[0]);
+		stats.maxSpeed=Math::max(stats.maxSpeed,blockStats[1]);
+		numWetCells+=double(blockStats[2]);
+		stats.maxDepth=Math::max(stats.maxDepth,blockStats[3]);
+		}
+	stats.volume=volume*double(cellSize[0])*double(cellSize[1]);
+	stats.numWetCells=(unsigned int)(numWetCells+0.5);
+	
+	glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	
+	return true;
+	}
+
+bool WaterTable2::startCheckpoint(GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Bail out if the previous read-back has not been picked up yet: */
+	if(dataItem->checkpointFence!=0)
+		return false;
+	
+	/* Create the pixel buffer object on first use, as checkpoints are rare and the buffer is large: */
+	size_t numBathymetryCells=size_t(size[1]-1)*size_t(size[0]-1);
+	size_t numCells=size_t(size[1])*size_t(size[0]);
+	if(dataItem->checkpointBufferObject==0)
+		{
+		glGenBuffersARB(1,&dataItem->checkpointBufferObject);
+		glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->checkpointBufferObject);
+		glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB,(numBathymetryCells+numCells*4)*sizeof(GLfloat),0,GL_STREAM_READ_ARB);
+		}
+	else
+		glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->checkpointBufferObject);
+	
+	/* Start reading back the current bathymetry, conserved quantity, and snow height textures back-to-back into the pixel buffer object: */
+	textureTracker.reset();
+	textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetry.textureObjects[dataItem->bathymetry.current]);
+	glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RED,GL_FLOAT,0);
+	textureTracker.reset();
+	textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantity.textureObjects[dataItem->quantity.current]);
+	glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RGB,GL_FLOAT,reinterpret_cast<GLvoid*>(numBathymetryCells*sizeof(GLfloat)));
+	textureTracker.reset();
+	textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->snow.textureObjects[dataItem->snow.current]);
+	glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RED,GL_FLOAT,reinterpret_cast<GLvoid*>((numBathymetryCells+numCells*3)*sizeof(GLfloat)));
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	dataItem->checkpointFence=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+	
+	return true;
+	}
+
+WaterCheckpoint* WaterTable2::finishCheckpoint(GLContextData& contextData,bool wait) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Check if the pending read-back has completed, waiting for it if requested: */
+	if(dataItem->checkpointFence==0)
+		return 0;
+	GLenum waitResult=glClientWaitSync(dataItem->checkpointFence,GL_SYNC_FLUSH_COMMANDS_BIT,wait?GLuint64(1000000000):GLuint64(0));
+	if(waitResult!=GL_ALREADY_SIGNALED&&waitResult!=GL_CONDITION_SATISFIED)
+		return 0;
+	glDeleteSync(dataItem->checkpointFence);
+	dataItem->checkpointFence=0;
+	
+	/* Create a checkpoint holding the current simulation parameters: */
+	WaterCheckpoint* result=new WaterCheckpoint(size);
+	for(int i=0;i<2;++i)
+		{
+		result->cellSize[i]=cellSize[i];
+		result->maxPropagationSpeed[i]=maxPropagationSpeed[i];
+		}
+	result->mode=(unsigned int)(mode);
+	result->theta=theta;
+	result->g=g;
+	result->epsilon=epsilon;
+	result->attenuation=attenuation;
+	result->maxStepSize=maxStepSize;
+	result->snowLine=snowLine;
+	result->snowMelt=snowMelt;
+	result->waterDeposit=waterDeposit;
+	result->dryBoundary=dryBoundary;
+	
+	/* Copy the read-back grids from the pixel buffer object into the checkpoint: */
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->checkpointBufferObject);
+	const GLfloat* grids=static_cast<const GLfloat*>(glMapBufferARB(GL_PIXEL_PACK_BUFFER_ARB,GL_READ_ONLY_ARB));
+	memcpy(&result->bathymetry.front(),grids,result->bathymetry.size()*sizeof(GLfloat));
+	grids+=result->bathymetry.size();
+	memcpy(&result->quantity.front(),grids,result->quantity.size()*sizeof(GLfloat));
+	grids+=result->quantity.size();
+	memcpy(&result->snow.front(),grids,result->snow.size()*sizeof(GLfloat));
+	glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	
+	return result;
+	}
+
+void WaterTable2::restoreCheckpointParameters(const WaterCheckpoint& checkpoint)
+	{
+	/* Check the checkpoint's size: */
+	if(checkpoint.size!=size)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Checkpoint size %u x %u does not match water table size %u x %u",checkpoint.size[0],checkpoint.size[1],size[0],size[1]);
+	
+	/* Copy the simulation parameters: */
+	theta=checkpoint.theta;
+	g=checkpoint.g;
+	epsilon=checkpoint.epsilon;
+	for(int i=0;i<2;++i)
+		maxPropagationSpeed[i]=checkpoint.maxPropagationSpeed[i];
+	mode=checkpoint.mode==(unsigned int)(Engineering)?Engineering:Traditional;
+	attenuation=checkpoint.attenuation;
+	maxStepSize=checkpoint.maxStepSize;
+	snowLine=checkpoint.snowLine;
+	snowMelt=checkpoint.snowMelt;
+	waterDeposit=checkpoint.waterDeposit;
+	dryBoundary=checkpoint.dryBoundary;
+	}
+
+void WaterTable2::restoreCheckpoint(const WaterCheckpoint& checkpoint,GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Check the checkpoint's size: */
+	if(checkpoint.size!=size)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Checkpoint size %u x %u does not match water table size %u x %u",checkpoint.size[0],checkpoint.size[1],size[0],size[1]);
+	
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Upload the checkpoint's grids into the current buffer slots; the conserved quantities already match the bathymetry, so no adaptation is needed: */
+	textureTracker.reset();
+	textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetry.textureObjects[dataItem->bathymetry.current]);
+	glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,getBathymetrySize(),GL_LUMINANCE,GL_FLOAT,&checkpoint.bathymetry.front());
+	textureTracker.reset();
+	textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantity.textureObjects[dataItem->quantity.current]);
+	glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,size,GL_RGB,GL_FLOAT,&checkpoint.quantity.front());
+	textureTracker.reset();
+	textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->snow.textureObjects[dataItem->snow.current]);
+	glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,size,GL_LUMINANCE,GL_FLOAT,&checkpoint.snow.front());
+	textureTracker.reset();
+	
+	/* Don't interpolate between the state before the restore and the restored state: */
+	dataItem->previousQuantityValid=false;
+	
+	/* Re-render the entire bathymetry grid on the next update, as incremental updates would only replace the parts touched by depth image changes: */
+	dataItem->bathymetryVersion=0;
+	
+	/* Simulate all tiles until a wet tile scan of the restored state completes: */
+	activateTiles(dataItem,Rect(size));
+	}
+
+GLfloat WaterTable2::getActiveTileFraction(GLContextData& contextData) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Return the fraction of active tiles, or the entire grid if dry tile skipping is disabled: */
+	if(dataItem->tileSize==0)
+		return 1.0f;
+	return GLfloat(dataItem->numActiveTiles)/(GLfloat(dataItem->numTiles[0])*GLfloat(dataItem->numTiles[1]));
+	}
+
+void WaterTable2::updateBathymetry(GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Get the data item: */
 	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
 	
 	/* Check if the current bathymetry texture is outdated: */
-	if(dataItem->bathymetryVersion!=depthImageRenderer->getDepthImageVersion())
+	unsigned int depthImageVersion=depthImageRenderer->getDepthImageVersion();
+	if(dataItem->bathymetryVersion!=depthImageVersion)
 		{
+		/* Find the parts of the bathymetry grids touched by the surface patches that changed since the current bathymetry grid, or the entire grids if the changes were not tracked: */
+		Size bathymetrySize=getBathymetrySize();
+		Size renderBathymetrySize(renderSize[0]-1,renderSize[1]-1);
+		Rect bathymetryRect(bathymetrySize);
+		Rect renderBathymetryRect(renderBathymetrySize);
+		Rect dirtyRect;
+		Box dirtyBox;
+		if(depthImageRenderer->getDirtyRegion(dataItem->bathymetryVersion,dirtyRect,dirtyBox))
+			{
+			bathymetryRect=calcDirtyGridRect(dirtyBox,bathymetryPmv,bathymetrySize);
+			if(renderFactor>1)
+				renderBathymetryRect=calcDirtyGridRect(dirtyBox,renderBathymetryPmv,renderBathymetrySize);
+			}
+		bool fullUpdate=bathymetryRect.size[0]==bathymetrySize[0]&&bathymetryRect.size[1]==bathymetrySize[1];
+		
+		/* Skip the update if the changes lie entirely outside the grids: */
+		if(bathymetryRect.size[0]==0||bathymetryRect.size[1]==0)
+			{
+			dataItem->bathymetryVersion=depthImageVersion;
+			return;
+			}
+		
 		/* Retrieve the current and new buffer slots for the bathymetry and quantity textures: */
 		int oldBathymetry=dataItem->bathymetry.current;
 		int newBathymetry=1-oldBathymetry;
 		int oldQuantity=dataItem->quantity.current;
 		int newQuantity=1-oldQuantity;
 		
+		/* Grow the changed bathymetry rectangle by one pixel, as the bathymetry update reads the neighboring bathymetry pixels from the new slot: */
+		Rect readRect=bathymetryRect;
+		if(!fullUpdate)
+			{
+			for(int i=0;i<2;++i)
+				{
+				int end=Math::min(readRect.offset[i]+int(readRect.size[i])+1,int(bathymetrySize[i]));
+				readRect.offset[i]=Math::max(readRect.offset[i]-1,0);
+				readRect.size[i]=(unsigned int)(end-readRect.offset[i]);
+				}
+			}
+		
+		/* Find the conserved quantity cells whose corners touch the changed bathymetry pixels: */
+		Rect quantityRect=bathymetryRect;
+		for(int i=0;i<2;++i)
+			quantityRect.size[i]=Math::min(quantityRect.size[i]+1,size[i]-(unsigned int)(quantityRect.offset[i]));
+		
 		/* Save relevant OpenGL state: */
-		glPushAttrib(GL_VIEWPORT_BIT);
+		glPushAttrib(GL_SCISSOR_BIT|GL_VIEWPORT_BIT);
 		GLint currentFrameBuffer;
 		glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
 		GLfloat currentClearColor[4];
 		glGetFloatv(GL_COLOR_CLEAR_VALUE,currentClearColor);
 		
-		/* Bind the bathymetry rendering frame buffer and clear it: */
+		/* Bind the bathymetry rendering frame buffer and clear the changed part: */
 		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->bathymetryFramebufferObject);
 		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+newBathymetry);
-		glViewport(getBathymetrySize());
+		glViewport(bathymetrySize);
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(readRect.offset[0],readRect.offset[1],readRect.size[0],readRect.size[1]);
 		glClearColor(GLfloat(domain.min[2]),0.0f,0.0f,1.0f);
 		glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
 		
-		/* Render the surface into the bathymetry grid: */
+		/* Render the surface into the changed part of the bathymetry grid: */
 		depthImageRenderer->renderElevation(bathymetryPmv,contextData,textureTracker);
 		
+		if(renderFactor>1&&renderBathymetryRect.size[0]!=0&&renderBathymetryRect.size[1]!=0)
+			{
+			/* Render the surface into the changed part of the rendering-resolution bathymetry grid, which is updated in place: */
+			glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->renderBathymetryFramebufferObject);
+			glViewport(renderBathymetrySize);
+			glScissor(renderBathymetryRect.offset[0],renderBathymetryRect.offset[1],renderBathymetryRect.size[0],renderBathymetryRect.size[1]);
+			glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+			depthImageRenderer->renderElevation(renderBathymetryPmv,contextData,textureTracker);
+			}
+		glDisable(GL_SCISSOR_TEST);
+		
 		/* Set up the integration frame buffer to update the conserved quantities based on bathymetry changes: */
 		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->integrationFramebufferObject);
 		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+newQuantity);
@@ -860,18 +1983,43 @@ void WaterTable2::updateBathymetry(GLContextData& contextData,TextureTracker& te
 		dataItem->bathymetry.bind(textureTracker,dataItem->bathymetryShader,newBathymetry,false);
 		dataItem->quantity.bind(textureTracker,dataItem->bathymetryShader,oldQuantity,false);
 		
-		/* Run the bathymetry update: */
+		/* Run the bathymetry update on the cells whose corners changed: */
+		GLint qx0=quantityRect.offset[0];
+		GLint qy0=quantityRect.offset[1];
+		GLint qx1=qx0+GLint(quantityRect.size[0]);
+		GLint qy1=qy0+GLint(quantityRect.size[1]);
 		glBegin(GL_QUADS);
-		glVertex2i(0,0);
-		glVertex2i(size[0],0);
-		glVertex2i(size[0],size[1]);
-		glVertex2i(0,size[1]);
+		glVertex2i(qx0,qy0);
+		glVertex2i(qx1,qy0);
+		glVertex2i(qx1,qy1);
+		glVertex2i(qx0,qy1);
 		glEnd();
 		
-		/* Update the bathymetry and quantity grids: */
-		dataItem->bathymetry.current=newBathymetry;
-		dataItem->bathymetryVersion=depthImageRenderer->getDepthImageVersion();
-		dataItem->quantity.current=newQuantity;
+		if(fullUpdate)
+			{
+			/* Make the new bathymetry and quantity grids current: */
+			dataItem->bathymetry.current=newBathymetry;
+			dataItem->quantity.current=newQuantity;
+			}
+		else
+			{
+			/* Copy the changed parts of the new bathymetry and quantity grids back into the current grids, whose other parts are up to date: */
+			textureTracker.reset();
+			glReadBuffer(GL_COLOR_ATTACHMENT0_EXT+newQuantity);
+			textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantity.textureObjects[oldQuantity]);
+			glCopyTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,qx0,qy0,qx0,qy0,quantityRect.size[0],quantityRect.size[1]);
+			glReadBuffer(GL_NONE);
+			glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->bathymetryFramebufferObject);
+			glReadBuffer(GL_COLOR_ATTACHMENT0_EXT+newBathymetry);
+			textureTracker.reset();
+			textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetry.textureObjects[oldBathymetry]);
+			glCopyTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,readRect.offset[0],readRect.offset[1],readRect.offset[0],readRect.offset[1],readRect.size[0],readRect.size[1]);
+			glReadBuffer(GL_NONE);
+			}
+		dataItem->bathymetryVersion=depthImageVersion;
+		
+		/* Simulate the changed cells until both conserved quantity buffers hold their adapted state, as frozen tiles would otherwise revert to their old state on the next buffer swap: */
+		activateTiles(dataItem,quantityRect);
 		
 		/* Restore OpenGL state: */
 		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
@@ -919,11 +2067,15 @@ void WaterTable2::updateBathymetry(const GLfloat* bathymetryGrid,GLContextData&
 	glVertex2i(size[0],size[1]);
 	glVertex2i(0,size[1]);
 	glEnd();
-
-	/* Update the bathymetry and quantity grids: */
+	
+	/* Update the bathymetry and quantity grids, and re-render the entire bathymetry grid on the next depth image update: */
 	dataItem->bathymetry.current=newBathymetry;
+	dataItem->bathymetryVersion=0;
 	dataItem->quantity.current=newQuantity;
-
+	
+	/* Simulate all tiles until a wet tile scan of the adapted state completes: */
+	activateTiles(dataItem,Rect(size));
+	
 	/* Restore OpenGL state: */
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
 	glPopAttrib();
@@ -964,10 +2116,13 @@ void WaterTable2::setWaterLevel(const GLfloat* waterGrid,GLContextData& contextD
 	glVertex2i(size[0],size[1]);
 	glVertex2i(0,size[1]);
 	glEnd();
-
+	
 	/* Update the quantity grid: */
 	dataItem->quantity.current=newQuantity;
-
+	
+	/* Simulate all tiles until a wet tile scan of the new water level completes: */
+	activateTiles(dataItem,Rect(size));
+	
 	/* Restore OpenGL state: */
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
 	glPopAttrib();
@@ -983,112 +2138,178 @@ GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& context
 	GLint currentFrameBuffer;
 	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
 	
-	/*********************************************************************
-	Step 1: Calculate temporal derivative of most recent quantities.
-	*********************************************************************/
-	
-	GLfloat stepSize=calcDerivative(contextData,textureTracker,dataItem->quantity.current,!forceStepSize);
-	
-	// DEBUGGING
-	// std::cout<<stepSize<<' ';
-	
-	/*********************************************************************
-	Step 2: Perform the tentative Euler integration step.
-	*********************************************************************/
-	
-	/* Set up the Euler step integration frame buffer: */
-	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->integrationFramebufferObject);
-	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+2);
-	glViewport(size);
-	
-	/* Set up the Euler integration step shader: */
-	Shader* eulerStepShader=&dataItem->eulerStepShaders[mode];
-	eulerStepShader->use();
-	textureTracker.reset();
-	eulerStepShader->uploadUniform(stepSize);
-	if(mode==Traditional)
-		eulerStepShader->uploadUniform(Math::pow(attenuation,stepSize));
-	dataItem->quantity.bind(textureTracker,*eulerStepShader,dataItem->quantity.current,false);
-	eulerStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->derivativeTextureObject));
-	
-	/* Run the Euler integration step: */
-	glBegin(GL_QUADS);
-	glVertex2i(0,0);
-	glVertex2i(size[0],0);
-	glVertex2i(size[0],size[1]);
-	glVertex2i(0,size[1]);
-	glEnd();
+	/* Select the tiles to simulate during this step based on the most recent wet tile scan: */
+	updateActiveTiles(dataItem,textureTracker);
 	
 	/*********************************************************************
-	Step 3: Calculate temporal derivative of intermediate quantities.
+	Step 1: Calculate temporal derivative of most recent quantities, and
+	the step size for this simulation step.
 	*********************************************************************/
 	
-	calcDerivative(contextData,textureTracker,2,false);
-	
-	/*********************************************************************
-	Step 4: Perform the final Runge-Kutta integration step.
-	*********************************************************************/
+	calcDerivative(contextData,textureTracker,dataItem->quantity.current,!forceStepSize);
 	
-	/* Set up the Runge-Kutta step integration frame buffer: */
-	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->integrationFramebufferObject);
-	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+(1-dataItem->quantity.current));
-	glViewport(size);
+	if(forceStepSize)
+		{
+		/* Write the client-specified step size into the step size texture: */
+		GLfloat currentClearColor[4];
+		glGetFloatv(GL_COLOR_CLEAR_VALUE,currentClearColor);
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->stepSizeFramebufferObject);
+		glViewport(0,0,1,1);
+		glClearColor(maxStepSize,0.0f,0.0f,0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glClearColor(currentClearColor[0],currentClearColor[1],currentClearColor[2],currentClearColor[3]);
+		}
 	
-	/* Set up the Runge-Kutta integration step shader: */
-	Shader* rungeKuttaStepShader=&dataItem->rungeKuttaStepShaders[mode];
-	rungeKuttaStepShader->use();
-	textureTracker.reset();
-	rungeKuttaStepShader->uploadUniform(stepSize);
-	if(mode==Traditional)
-		rungeKuttaStepShader->uploadUniform(Math::pow(attenuation,stepSize));
-	dataItem->quantity.bind(textureTracker,*rungeKuttaStepShader,dataItem->quantity.current,false);
-	dataItem->quantity.bind(textureTracker,*rungeKuttaStepShader,2,false);
-	rungeKuttaStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->derivativeTextureObject));
-	
-	/* Run the Runge-Kutta integration step: */
-	glBegin(GL_QUADS);
-	glVertex2i(0,0);
-	glVertex2i(size[0],0);
-	glVertex2i(size[0],size[1]);
-	glVertex2i(0,size[1]);
-	glEnd();
+	/* Start reading back the step size into the next pixel buffer object without waiting for the result: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->stepSizeFramebufferObject);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->stepSizeBufferObjects[dataItem->stepSizeReadSlot]);
+	glReadPixels(0,0,1,1,GL_RED,GL_FLOAT,0);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	dataItem->stepSizeFences[dataItem->stepSizeReadSlot]=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+	dataItem->stepSizeReadSlot=1-dataItem->stepSizeReadSlot;
+	++dataItem->numPendingStepSizes;
 	
-	if(dryBoundary)
+	if(fusedIntegration)
 		{
-		/* Set up the boundary condition shader to enforce dry boundaries: */
-		dataItem->boundaryShader.use();
+		/*******************************************************************
+		Steps 2-4: Perform the tentative Euler integration step, calculate
+		the temporal derivative of the intermediate quantities, perform the
+		final Runge-Kutta integration step, and enforce dry boundaries in a
+		single pass. The shader recalculates the intermediate quantities of
+		all cells in its stencil from the current quantities and the first
+		temporal derivative.
+		*******************************************************************/
+		
+		/* Set up the Runge-Kutta step integration frame buffer: */
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->integrationFramebufferObject);
+		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+(1-dataItem->quantity.current));
+		glViewport(size);
+		
+		/* Set up the fused Runge-Kutta integration step shader: */
+		Shader* fusedStepShader=&dataItem->fusedRungeKuttaStepShaders[mode];
+		fusedStepShader->use();
 		textureTracker.reset();
-		dataItem->bathymetry.bind(textureTracker,dataItem->boundaryShader,dataItem->bathymetry.current,false);
+		fusedStepShader->uploadUniform2v(1,cellSize);
+		fusedStepShader->uploadUniform(theta);
+		fusedStepShader->uploadUniform(g);
+		fusedStepShader->uploadUniform(epsilon);
+		fusedStepShader->uploadUniform2v(1,maxPropagationSpeed);
+		if(mode==Traditional)
+			fusedStepShader->uploadUniform(attenuation);
+		fusedStepShader->uploadUniform(GLint(dryBoundary?1:0));
+		fusedStepShader->uploadUniform(GLfloat(size[0])-1.0f,GLfloat(size[1])-1.0f);
+		dataItem->bathymetry.bind(textureTracker,*fusedStepShader,dataItem->bathymetry.current,false);
+		dataItem->quantity.bind(textureTracker,*fusedStepShader,dataItem->quantity.current,false);
+		fusedStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->derivativeTextureObject));
+		fusedStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->stepSizeTextureObject));
+		if(mode==Engineering)
+			fusedStepShader->uploadUniform(propertyGridCreator->bindPropertyGridTexture(contextData,textureTracker));
 		
-		/* Run the boundary condition shader on the outermost layer of pixels: */
-		//glColorMask(GL_TRUE,GL_FALSE,GL_FALSE,GL_FALSE);
-		glBegin(GL_LINE_LOOP);
-		glVertex2f(0.5f,0.5f);
-		glVertex2f(GLfloat(size[0])-0.5f,0.5f);
-		glVertex2f(GLfloat(size[0])-0.5f,GLfloat(size[1])-0.5f);
-		glVertex2f(0.5f,GLfloat(size[1])-0.5f);
-		glEnd();
-		//glColorMask(GL_TRUE,GL_TRUE,GL_TRUE,GL_TRUE);
+		/* Run the fused Runge-Kutta integration step on all active tiles: */
+		renderActiveTiles(dataItem);
+		}
+	else
+		{
+		/*******************************************************************
+		Step 2: Perform the tentative Euler integration step.
+		*******************************************************************/
+		
+		/* Set up the Euler step integration frame buffer: */
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->integrationFramebufferObject);
+		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+2);
+		glViewport(size);
+		
+		if(dataItem->tileSize!=0&&!dataItem->borderTileQuads.empty())
+			{
+			/* Copy the current quantities of inactive tiles bordering active tiles into the intermediate slot, which holds stale data there; frozen tiles' intermediate quantities equal their current quantities: */
+			glReadBuffer(GL_COLOR_ATTACHMENT0_EXT+dataItem->quantity.current);
+			textureTracker.reset();
+			textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantity.textureObjects[2]);
+			for(std::vector<GLint>::const_iterator btqIt=dataItem->borderTileQuads.begin();btqIt!=dataItem->borderTileQuads.end();btqIt+=4)
+				glCopyTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,btqIt[0],btqIt[1],btqIt[0],btqIt[1],btqIt[2]-btqIt[0],btqIt[3]-btqIt[1]);
+			glReadBuffer(GL_NONE);
+			}
+		
+		/* Set up the Euler integration step shader: */
+		Shader* eulerStepShader=&dataItem->eulerStepShaders[mode];
+		eulerStepShader->use();
+		textureTracker.reset();
+		if(mode==Traditional)
+			eulerStepShader->uploadUniform(attenuation);
+		dataItem->quantity.bind(textureTracker,*eulerStepShader,dataItem->quantity.current,false);
+		eulerStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->derivativeTextureObject));
+		eulerStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->stepSizeTextureObject));
+		
+		/* Run the Euler integration step on all active tiles: */
+		renderActiveTiles(dataItem);
+		
+		/*******************************************************************
+		Step 3: Calculate temporal derivative of intermediate quantities.
+		*******************************************************************/
+		
+		calcDerivative(contextData,textureTracker,2,false);
+		
+		/*******************************************************************
+		Step 4: Perform the final Runge-Kutta integration step.
+		*******************************************************************/
+		
+		/* Set up the Runge-Kutta step integration frame buffer: */
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->integrationFramebufferObject);
+		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+(1-dataItem->quantity.current));
+		glViewport(size);
+		
+		/* Set up the Runge-Kutta integration step shader: */
+		Shader* rungeKuttaStepShader=&dataItem->rungeKuttaStepShaders[mode];
+		rungeKuttaStepShader->use();
+		textureTracker.reset();
+		if(mode==Traditional)
+			rungeKuttaStepShader->uploadUniform(attenuation);
+		dataItem->quantity.bind(textureTracker,*rungeKuttaStepShader,dataItem->quantity.current,false);
+		dataItem->quantity.bind(textureTracker,*rungeKuttaStepShader,2,false);
+		rungeKuttaStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->derivativeTextureObject));
+		rungeKuttaStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->stepSizeTextureObject));
+		
+		/* Run the Runge-Kutta integration step on all active tiles: */
+		renderActiveTiles(dataItem);
+		
+		if(dryBoundary)
+			{
+			/* Set up the boundary condition shader to enforce dry boundaries: */
+			dataItem->boundaryShader.use();
+			textureTracker.reset();
+			dataItem->bathymetry.bind(textureTracker,dataItem->boundaryShader,dataItem->bathymetry.current,false);
+			
+			/* Run the boundary condition shader on the outermost layer of pixels: */
+			//glColorMask(GL_TRUE,GL_FALSE,GL_FALSE,GL_FALSE);
+			glBegin(GL_LINE_LOOP);
+			glVertex2f(0.5f,0.5f);
+			glVertex2f(GLfloat(size[0])-0.5f,0.5f);
+			glVertex2f(GLfloat(size[0])-0.5f,GLfloat(size[1])-0.5f);
+			glVertex2f(0.5f,GLfloat(size[1])-0.5f);
+			glEnd();
+			//glColorMask(GL_TRUE,GL_TRUE,GL_TRUE,GL_TRUE);
+			}
 		}
 	
 	/* Update the current quantities: */
 	dataItem->quantity.current=1-dataItem->quantity.current;
 	
-	if(waterDeposit!=0.0f||!renderFunctions.empty())
+	if(waterDeposit!=0.0f||!renderFunctions.empty()||!waterDisks.empty())
 		{
 		/* Save OpenGL state: */
 		GLfloat currentClearColor[4];
 		glGetFloatv(GL_COLOR_CLEAR_VALUE,currentClearColor);
 		
 		/*******************************************************************
-		Step 5: Render all water sources and sinks additively into the water
-		texture.
+		Step 5: Render the rates of all water sources and sinks additively
+		into the water texture. The water update shader scales them by the
+		step size.
 		*******************************************************************/
 		
 		/* Set up and clear the water frame buffer: */
 		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->waterFramebufferObject);
 		glViewport(size);
-		glClearColor(waterDeposit*stepSize,0.0f,0.0f,0.0f);
+		glClearColor(waterDeposit,0.0f,0.0f,0.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 		
 		/* Enable additive rendering: */
@@ -1098,12 +2319,15 @@ GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& context
 		/* Set up the water adding shader: */
 		dataItem->waterAddShader.use();
 		dataItem->waterAddShader.uploadUniformMatrix4(1,GL_FALSE,waterAddPmvMatrix);
-		dataItem->waterAddShader.uploadUniform(stepSize);
 		
 		/* Call all render functions: */
 		for(std::vector<const AddWaterFunction*>::const_iterator rfIt=renderFunctions.begin();rfIt!=renderFunctions.end();++rfIt)
 			(**rfIt)(contextData);
 		
+		/* Render all water disks collected for the current frame: */
+		if(!waterDisks.empty())
+			renderWaterDisks(dataItem);
+		
 		/* Restore OpenGL state: */
 		glDisable(GL_BLEND);
 		glClearColor(currentClearColor[0],currentClearColor[1],currentClearColor[2],currentClearColor[3]);
@@ -1127,8 +2351,9 @@ GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& context
 		dataItem->snow.bind(textureTracker,dataItem->waterShader,dataItem->snow.current,false);
 		dataItem->quantity.bind(textureTracker,dataItem->waterShader,dataItem->quantity.current,false);
 		dataItem->waterShader.uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->waterTextureObject));
+		dataItem->waterShader.uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->stepSizeTextureObject));
 		dataItem->waterShader.uploadUniform(snowLine);
-		dataItem->waterShader.uploadUniform(snowMelt*stepSize);
+		dataItem->waterShader.uploadUniform(snowMelt);
 		
 		/* Run the water update: */
 		glBegin(GL_QUADS);
@@ -1143,12 +2368,134 @@ GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& context
 		dataItem->quantity.current=1-dataItem->quantity.current;
 		}
 	
+	/* Start scanning the new quantities for wet tiles if the previous scan has been picked up: */
+	scanWetTiles(dataItem,textureTracker);
+	
+	/* Start reducing the new quantities to health statistics if they are due: */
+	reduceStats(dataItem,textureTracker);
+	
 	/* Restore OpenGL state: */
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
 	glPopAttrib();
 	
-	/* Return the Runge-Kutta step's step size: */
-	return stepSize;
+	/* Return the previous step's step size, whose read-back has had an entire simulation step's worth of GPU work to complete: */
+	return dataItem->numPendingStepSizes>1?retrieveStepSize(dataItem):0.0f;
+	}
+
+void WaterTable2::storePreviousState(GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Save relevant OpenGL state: */
+	GLint currentFrameBuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
+	
+	/* Copy the current conserved quantities into the previous quantity texture: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->integrationFramebufferObject);
+	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT+dataItem->quantity.current);
+	textureTracker.reset();
+	textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->previousQuantityTextureObject);
+	glCopyTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,0,0,0,0,size[0],size[1]);
+	glReadBuffer(GL_NONE);
+	dataItem->previousQuantityValid=true;
+	
+	/* Restore OpenGL state: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
+	}
+
+void WaterTable2::interpolateStates(GLfloat weight,GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Show the current state until a previous state has been stored: */
+	if(!dataItem->previousQuantityValid)
+		weight=1.0f;
+	
+	/* Save relevant OpenGL state: */
+	glPushAttrib(GL_VIEWPORT_BIT);
+	GLint currentFrameBuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
+	
+	/* Set up the quantity interpolation frame buffer: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->interpolationFramebufferObject);
+	glViewport(size);
+	
+	/* Set up the quantity interpolation shader: */
+	dataItem->interpolationShader.use();
+	textureTracker.reset();
+	dataItem->interpolationShader.uploadUniform(weight);
+	dataItem->interpolationShader.uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->previousQuantityTextureObject));
+	dataItem->quantity.bind(textureTracker,dataItem->interpolationShader,dataItem->quantity.current,false);
+	
+	/* Run the quantity interpolation: */
+	glBegin(GL_QUADS);
+	glVertex2i(0,0);
+	glVertex2i(size[0],0);
+	glVertex2i(size[0],size[1]);
+	glVertex2i(0,size[1]);
+	glEnd();
+	
+	/* Bind the interpolated quantities for rendering from now on: */
+	dataItem->renderInterpolated=true;
+	
+	/* Restore OpenGL state: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
+	glPopAttrib();
+	}
+
+void WaterTable2::upsampleStates(GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Bail out if the rendering grid is the simulation grid: */
+	if(renderFactor<=1)
+		return;
+	
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Save relevant OpenGL state: */
+	glPushAttrib(GL_VIEWPORT_BIT);
+	GLint currentFrameBuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
+	
+	/* Set up the upsampling frame buffer: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->upsampleFramebufferObject);
+	glViewport(renderSize);
+	
+	/* Set up the upsampling shader, sampling the simulation grids with bilinear interpolation: */
+	dataItem->upsampleShader.use();
+	textureTracker.reset();
+	dataItem->upsampleShader.uploadUniform(GLfloat(renderFactor));
+	dataItem->upsampleShader.uploadUniform(dryDepth);
+	dataItem->bathymetry.bind(textureTracker,dataItem->upsampleShader,dataItem->bathymetry.current,true);
+	dataItem->snow.bind(textureTracker,dataItem->upsampleShader,dataItem->snow.current,true);
+	if(dataItem->renderInterpolated)
+		dataItem->renderQuantity.bind(textureTracker,dataItem->upsampleShader,dataItem->renderQuantity.current,true);
+	else
+		dataItem->quantity.bind(textureTracker,dataItem->upsampleShader,dataItem->quantity.current,true);
+	dataItem->renderBathymetry.bind(textureTracker,dataItem->upsampleShader,dataItem->renderBathymetry.current,true);
+	
+	/* Run the upsampling: */
+	glBegin(GL_QUADS);
+	glVertex2i(0,0);
+	glVertex2i(renderSize[0],0);
+	glVertex2i(renderSize[0],renderSize[1]);
+	glVertex2i(0,renderSize[1]);
+	glEnd();
+	
+	/* Restore OpenGL state: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
+	glPopAttrib();
+	}
+
+GLfloat WaterTable2::finishSimulationSteps(GLContextData& contextData) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Return the step size of the most recent unreported simulation step: */
+	return dataItem->numPendingStepSizes>0?retrieveStepSize(dataItem):0.0f;
 	}
 
 void WaterTable2::uploadWaterTextureTransform(Shader& shader) const
@@ -1180,8 +2527,50 @@ GLint WaterTable2::bindQuantityTexture(GLContextData& contextData,TextureTracker
 	/* Get the data item: */
 	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
 	
-	/* Bind the current conserved quantities texture to the given texture tracker and return the index of the used texture unit: */
-	return dataItem->quantity.bindCurrent(textureTracker,linearSampling);
+	/* Bind the current or interpolated conserved quantities texture to the given texture tracker and return the index of the used texture unit: */
+	if(dataItem->renderInterpolated)
+		return dataItem->renderQuantity.bindCurrent(textureTracker,linearSampling);
+	else
+		return dataItem->quantity.bindCurrent(textureTracker,linearSampling);
+	}
+
+GLint WaterTable2::bindRenderBathymetryTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const
+	{
+	/* Bind the simulation grid's bathymetry texture if the rendering grid is the simulation grid: */
+	if(renderFactor<=1)
+		return bindBathymetryTexture(contextData,textureTracker,linearSampling);
+	
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Bind the rendering-resolution bathymetry texture to the given texture tracker and return the index of the used texture unit: */
+	return dataItem->renderBathymetry.bindCurrent(textureTracker,linearSampling);
+	}
+
+GLint WaterTable2::bindRenderSnowTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const
+	{
+	/* Bind the simulation grid's snow height texture if the rendering grid is the simulation grid: */
+	if(renderFactor<=1)
+		return bindSnowTexture(contextData,textureTracker,linearSampling);
+	
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Bind the interpolated snow height texture to the given texture tracker and return the index of the used texture unit: */
+	return dataItem->upsampledSnow.bindCurrent(textureTracker,linearSampling);
+	}
+
+GLint WaterTable2::bindRenderQuantityTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const
+	{
+	/* Bind the simulation grid's conserved quantities texture if the rendering grid is the simulation grid: */
+	if(renderFactor<=1)
+		return bindQuantityTexture(contextData,textureTracker,linearSampling);
+	
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Bind the reconstructed conserved quantities texture to the given texture tracker and return the index of the used texture unit: */
+	return dataItem->upsampledQuantity.bindCurrent(textureTracker,linearSampling);
 	}
 
 void WaterTable2::readBathymetryTexture(GLContextData& contextData,TextureTracker& textureTracker,GLfloat* buffer) const
@@ -1222,3 +2611,89 @@ void WaterTable2::readQuantityTexture(GLContextData& contextData,TextureTracker&
 	/* Read the requested components of the texture image into the given buffer: */
 	glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,components,GL_FLOAT,buffer);
 	}
+
+bool WaterTable2::startGridReadback(GLContextData& contextData,TextureTracker& textureTracker,bool readBathymetry,bool readWaterLevel,bool readSnowHeight) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Bail out if both pixel buffer objects hold read-backs that have not been retrieved yet: */
+	if(dataItem->numPendingGrids>=2)
+		return false;
+	
+	/* Create the pixel buffer objects on first use, each holding the bathymetry, water level, and snow height grids back-to-back: */
+	size_t numBathymetryCells=size_t(size[1]-1)*size_t(size[0]-1);
+	size_t numCells=size_t(size[1])*size_t(size[0]);
+	if(dataItem->gridBufferObjects[0]==0)
+		{
+		glGenBuffersARB(2,dataItem->gridBufferObjects);
+		for(int i=0;i<2;++i)
+			{
+			glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->gridBufferObjects[i]);
+			glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB,(numBathymetryCells+numCells*2)*sizeof(GLfloat),0,GL_STREAM_READ_ARB);
+			}
+		}
+	
+	/* Start reading back the requested grids into the next pixel buffer object: */
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->gridBufferObjects[dataItem->gridReadSlot]);
+	if(readBathymetry)
+		{
+		textureTracker.reset();
+		textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetry.textureObjects[dataItem->bathymetry.current]);
+		glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RED,GL_FLOAT,0);
+		}
+	if(readWaterLevel)
+		{
+		textureTracker.reset();
+		textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantity.textureObjects[dataItem->quantity.current]);
+		glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RED,GL_FLOAT,reinterpret_cast<GLvoid*>(numBathymetryCells*sizeof(GLfloat)));
+		}
+	if(readSnowHeight)
+		{
+		textureTracker.reset();
+		textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->snow.textureObjects[dataItem->snow.current]);
+		glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RED,GL_FLOAT,reinterpret_cast<GLvoid*>((numBathymetryCells+numCells)*sizeof(GLfloat)));
+		}
+	textureTracker.reset();
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	dataItem->gridFences[dataItem->gridReadSlot]=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+	dataItem->gridReadSlot=1-dataItem->gridReadSlot;
+	++dataItem->numPendingGrids;
+	
+	return true;
+	}
+
+bool WaterTable2::finishGridReadback(GLContextData& contextData,GLfloat* bathymetryBuffer,GLfloat* waterLevelBuffer,GLfloat* snowHeightBuffer,bool wait) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Bail out if there are no pending read-backs: */
+	if(dataItem->numPendingGrids==0)
+		return false;
+	
+	/* Check if the oldest pending read-back has completed, waiting for it if requested: */
+	int slot=(dataItem->gridReadSlot+2-dataItem->numPendingGrids)%2;
+	GLenum waitResult=glClientWaitSync(dataItem->gridFences[slot],GL_SYNC_FLUSH_COMMANDS_BIT,wait?GLuint64(1000000000):GLuint64(0));
+	if(waitResult!=GL_ALREADY_SIGNALED&&waitResult!=GL_CONDITION_SATISFIED)
+		return false;
+	glDeleteSync(dataItem->gridFences[slot]);
+	dataItem->gridFences[slot]=0;
+	--dataItem->numPendingGrids;
+	
+	/* Copy the requested grids out of the mapped pixel buffer object: */
+	size_t numBathymetryCells=size_t(size[1]-1)*size_t(size[0]-1);
+	size_t numCells=size_t(size[1])*size_t(size[0]);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->gridBufferObjects[slot]);
+	const GLfloat* grids=static_cast<const GLfloat*>(glMapBufferARB(GL_PIXEL_PACK_BUFFER_ARB,GL_READ_ONLY_ARB));
+	if(bathymetryBuffer!=0)
+		memcpy(bathymetryBuffer,grids,numBathymetryCells*sizeof(GLfloat));
+	if(waterLevelBuffer!=0)
+		memcpy(waterLevelBuffer,grids+numBathymetryCells,numCells*sizeof(GLfloat));
+	if(snowHeightBuffer!=0)
+		memcpy(snowHeightBuffer,grids+numBathymetryCells+numCells,numCells*sizeof(GLfloat));
+	glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	
+	return true;
+	}
@@ -2,7 +2,7 @@
 WaterTable2 - Class to simulate water flowing over a surface using
 improved water flow simulation based on Saint-Venant system of partial
 differenctial equations.
-Copyright (c) 2012-2025 Oliver Kreylos
+Copyright (c) 2012-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -31,18 +31,23 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <Geometry/OrthonormalTransformation.h>
 #include <GL/gl.h>
 #include <GL/Extensions/GLARBShaderObjects.h>
+#include <GL/Extensions/GLARBSync.h>
 #include <GL/GLObject.h>
 #include <GL/GLContextData.h>
 
 #include "Types.h"
 #include "Shader.h"
+#include "WaterStats.h"
+#include "WaterDisk.h"
 
 /* Forward declarations: */
 class TextureTracker;
 class DepthImageRenderer;
 class PropertyGridCreator;
+class WaterCheckpoint;
 
 typedef Misc::FunctionCall<GLContextData&> AddWaterFunction; // Type for render functions called to locally add water to the water table
+typedef Misc::FunctionCall<WaterDiskList&> AddWaterDiskFunction; // Type for functions called once per frame to append disk-shaped water sources and sinks to a list
 
 class WaterTable2:public GLObject
 	{
@@ -88,14 +93,58 @@ class WaterTable2:public GLObject
 		unsigned int bathymetryVersion; // Version number of the most recent bathymetry grid
 		BufferedTexture<2> snow; // Double-buffered one-component float texture object holding the cell-centered snow height grid
 		BufferedTexture<3> quantity; // Double-buffered three-component color texture object (with one extra "scratch" slot) holding the cell-centered conserved quantity grid (w, hu, hv)
+		GLuint previousQuantityTextureObject; // Three-component color texture object holding the conserved quantity grid before the most recent simulation tick, for interpolated rendering
+		bool previousQuantityValid; // Flag whether the previous conserved quantity texture holds a stored simulation state
+		BufferedTexture<1> renderQuantity; // Single-buffered three-component color texture object holding conserved quantities interpolated between the previous and current simulation states
+		bool renderInterpolated; // Flag whether the quantity texture binding method binds the interpolated conserved quantity texture
+		BufferedTexture<1> renderBathymetry; // Single-buffered one-component float color texture object holding the vertex-centered bathymetry grid at rendering resolution
+		BufferedTexture<1> upsampledQuantity; // Single-buffered three-component color texture object holding the cell-centered conserved quantity grid reconstructed at rendering resolution
+		BufferedTexture<1> upsampledSnow; // Single-buffered one-component float texture object holding the cell-centered snow height grid interpolated to rendering resolution
 		GLuint derivativeTextureObject; // Three-component color texture object holding the cell-centered temporal derivative grid
 		BufferedTexture<2> maxStepSize; // Double-buffered one-component color texture objects to gather the maximum step size for Runge-Kutta integration steps
+		GLuint stepSizeTextureObject; // One-component 1x1 color texture object holding the step size of the current Runge-Kutta integration step, read directly by the integration and water update shaders
+		GLuint stepSizeBufferObjects[2]; // Pixel buffer objects to read back step sizes asynchronously
+		GLsync stepSizeFences[2]; // Fences signaling completion of the step size read-backs into the pixel buffer objects
+		int stepSizeReadSlot; // Index of the pixel buffer object that will receive the next step size read-back
+		unsigned int numPendingStepSizes; // Number of step size read-backs that have been issued but not yet retrieved
 		GLuint waterTextureObject; // One-component color texture object to add or remove water to/from the conserved quantity grid
+		GLuint waterDiskBufferObjects[2]; // Vertex buffer objects holding the water disk template and the per-instance attributes of the current water disks
+		unsigned int waterDisksVersion; // Version number of the water disk list whose attributes are in the instance vertex buffer object
+		GLint waterDiskAttributeLocations[3]; // Locations of the water disk shader's template vertex, disk, and disk rate attributes
+		unsigned int tileSize; // Size of dry skipping tiles for which the wet tile state below was allocated, or 0 if none was allocated
+		Size numTiles; // Number of dry skipping tiles in x and y
+		GLuint wetTileTextureObject; // One-component color texture object holding one wet flag per dry skipping tile
+		GLuint wetTileBufferObject; // Pixel buffer object to read back wet tile flags asynchronously
+		GLsync wetTileFence; // Fence signaling completion of the pending wet tile flag read-back, or 0 if there is none
+		bool wetTileScanValid; // Flag whether the pending wet tile flag read-back still reflects the current water state
+		std::vector<unsigned char> wetTiles; // Wet tile flags from the most recently completed read-back, grown by one tile in all directions
+		std::vector<unsigned char> tileActivities; // Number of further simulation steps for which each tile will be simulated
+		std::vector<unsigned char> activeTiles; // Flags whether each tile is simulated during the current simulation step
+		std::vector<GLint> activeTileQuads; // Corners of quads covering horizontal runs of active tiles, in pixel coordinates
+		std::vector<GLint> borderTileQuads; // Corners of quads covering horizontal runs of inactive tiles bordering active tiles, in pixel coordinates
+		unsigned int numActiveTiles; // Number of tiles simulated during the most recent simulation step
+		Size numStatsBlocks; // Number of health statistics reduction blocks in x and y
+		GLuint statsTextureObject; // Four-component color texture object holding partial health statistics of each reduction block
+		GLuint statsBufferObject; // Pixel buffer object to read back partial health statistics asynchronously
+		GLsync statsFence; // Fence signaling completion of the pending health statistics read-back, or 0 if there is none
+		unsigned int numStepsSinceStats; // Number of simulation steps since the most recent health statistics reduction
+		GLuint checkpointBufferObject; // Pixel buffer object to read back the complete simulation state asynchronously, or 0 if none was allocated yet
+		GLsync checkpointFence; // Fence signaling completion of the pending simulation state read-back, or 0 if there is none
+		GLuint gridBufferObjects[2]; // Pixel buffer objects to read back the bathymetry, water level, and snow height grids asynchronously, or 0 if none were allocated yet
+		GLsync gridFences[2]; // Fences signaling completion of the grid read-backs into the pixel buffer objects
+		int gridReadSlot; // Index of the pixel buffer object that will receive the next grid read-back
+		unsigned int numPendingGrids; // Number of grid read-backs that have been issued but not yet retrieved
 		GLuint bathymetryFramebufferObject; // Frame buffer used to render the bathymetry surface into the bathymetry grid
 		GLuint derivativeFramebufferObject; // Frame buffer used for temporal derivative computation
 		GLuint maxStepSizeFramebufferObject; // Frame buffer used to calculate the maximum integration step size
+		GLuint stepSizeFramebufferObject; // Frame buffer holding the step size texture, separate from the maximum step size frame buffer because the step size texture's size differs from the grid's
 		GLuint integrationFramebufferObject; // Frame buffer used for the Euler and Runge-Kutta integration steps
 		GLuint waterFramebufferObject; // Frame buffer used for the water rendering step
+		GLuint wetTileFramebufferObject; // Frame buffer used to reduce the conserved quantity grid to wet tile flags
+		GLuint interpolationFramebufferObject; // Frame buffer used to interpolate conserved quantities for rendering
+		GLuint statsFramebufferObject; // Frame buffer used to reduce the conserved quantity grid to partial health statistics
+		GLuint renderBathymetryFramebufferObject; // Frame buffer used to render the bathymetry surface into the rendering-resolution bathymetry grid
+		GLuint upsampleFramebufferObject; // Frame buffer used to reconstruct conserved quantities and snow heights at rendering resolution
 		Shader bathymetryShader; // Shader to update cell-centered conserved quantities after a change to the bathymetry grid
 		Shader waterAdaptShader; // Shader to adapt a new conserved quantity grid to the current bathymetry grid
 		Shader derivativeShaders[2]; // Shaders to compute face-centered partial fluxes and cell-centered temporal derivatives, depending on simulation mode
@@ -103,8 +152,14 @@ class WaterTable2:public GLObject
 		Shader boundaryShader; // Shader to enforce boundary conditions on the quantities grid
 		Shader eulerStepShaders[2]; // Shaders to compute an Euler integration step, depending on simulation mode
 		Shader rungeKuttaStepShaders[2]; // Shaders to compute a Runge-Kutta integration step, depending on simulation mode
+		Shader fusedRungeKuttaStepShaders[2]; // Shaders to compute the Euler step, the intermediate temporal derivative, the Runge-Kutta integration step, and dry boundaries in a single pass, depending on simulation mode
 		Shader waterAddShader; // Shader to render water adder objects
+		Shader waterDiskShader; // Shader to render all water disks as instances of the water disk template
 		Shader waterShader; // Shader to add or remove water from the conserved quantities grid
+		Shader wetTileShader; // Shader to reduce the conserved quantity grid to wet tile flags
+		Shader interpolationShader; // Shader to interpolate between the previous and current conserved quantity grids
+		Shader statsShader; // Shader to reduce the conserved quantity grid to partial health statistics
+		Shader upsampleShader; // Shader to reconstruct conserved quantities and snow heights at rendering resolution
 		
 		/* Constructors and destructors: */
 		DataItem(void);
@@ -117,7 +172,11 @@ class WaterTable2:public GLObject
 	ONTransform baseTransform; // Transformation from camera space to upright elevation map space
 	Box domain; // Domain of elevation map space in rotated camera space
 	GLfloat cellSize[2]; // Width and height of water table cells in world coordinate units
+	unsigned int renderFactor; // Ratio between the resolutions of the rendering grid and the simulation grid
+	Size renderSize; // Width and height of the rendering grid in pixels
+	GLfloat renderCellSize[2]; // Width and height of rendering grid cells in world coordinate units
 	PTransform bathymetryPmv; // Combined projection and modelview matrix to render the current surface into the bathymetry grid
+	PTransform renderBathymetryPmv; // Combined projection and modelview matrix to render the current surface into the rendering-resolution bathymetry grid
 	PTransform waterAddPmv; // Combined projection and modelview matrix to render water-adding geometry into the water grid
 	GLfloat waterAddPmvMatrix[16]; // Same, in GLSL-compatible format
 	GLfloat theta; // Coefficient for minmod flux-limiting differential operator
@@ -128,17 +187,33 @@ class WaterTable2:public GLObject
 	GLfloat attenuation; // Attenuation factor for partial discharges
 	PropertyGridCreator* propertyGridCreator; // Pointer to property grid creation object used in engineering mode
 	GLfloat maxStepSize; // Maximum step size for each Runge-Kutta integration step
-	PTransform waterTextureTransform; // Projective transformation from camera space to water level texture space
+	PTransform waterTextureTransform; // Projective transformation from camera space to rendering grid texture space
 	GLfloat waterTextureTransformMatrix[16]; // Same in GLSL-compatible format
 	std::vector<const AddWaterFunction*> renderFunctions; // A list of functions that are called after each water flow simulation step to locally add or remove water from the water table
+	std::vector<const AddWaterDiskFunction*> waterDiskFunctions; // A list of functions that are called once per frame to collect disk-shaped water sources and sinks
+	WaterDiskList waterDisks; // Disk-shaped water sources and sinks collected during the most recent frame, rendered with a single draw call after each water flow simulation step
+	unsigned int waterDisksVersion; // Version number of the water disk list
 	GLfloat snowLine; // The elevation of the snow line relative to the base plane
 	GLfloat snowMelt; // The rate of snow melt in elevation units per second
 	GLfloat waterDeposit; // A fixed amount of water added at every iteration of the flow simulation, for evaporation etc.
 	bool dryBoundary; // Flag whether to enforce dry boundary conditions at the end of each simulation step
+	bool fusedIntegration; // Flag whether to run the second half of each simulation step as a single fused pass
+	unsigned int dryTileSize; // Size of square tiles whose simulation is skipped while they and their neighbors are dry, or 0 to simulate the entire grid
+	GLfloat dryDepth; // Water column height below which a cell counts as dry for dry tile skipping
+	bool halfPrecision; // Flag whether temporal derivatives and water rates are stored in half precision textures
+	unsigned int statsInterval; // Number of simulation steps between health statistics reductions, or 0 to disable them
 	
 	/* Private methods: */
 	void calcTransformations(void); // Calculates derived transformations
-	GLfloat calcDerivative(GLContextData& contextData,TextureTracker& textureTracker,int quantityTextureIndex,bool calcMaxStepSize) const; // Calculates the temporal derivative of the conserved quantities in the given texture object and returns maximum step size if flag is true
+	Rect calcDirtyGridRect(const Box& dirtyBox,const PTransform& gridPmv,const Size& gridSize) const; // Returns the rectangle of pixels of a grid of the given size touched by rendering the given camera-space box with the given projection, grown by one pixel
+	void calcDerivative(GLContextData& contextData,TextureTracker& textureTracker,int quantityTextureIndex,bool calcMaxStepSize) const; // Calculates the temporal derivative of the conserved quantities in the given texture object and reduces the maximum step size into the step size texture if flag is true
+	GLfloat retrieveStepSize(DataItem* dataItem) const; // Waits for the oldest pending step size read-back and returns its step size
+	void updateActiveTiles(DataItem* dataItem,TextureTracker& textureTracker) const; // Picks up a completed wet tile flag read-back, if there is one, and selects the tiles to simulate during the next simulation step
+	void activateTiles(DataItem* dataItem,const Rect& rect) const; // Keeps simulating all tiles overlapping the given rectangle of cells, and their neighbors, until a wet tile scan of the changed state completes
+	void scanWetTiles(DataItem* dataItem,TextureTracker& textureTracker) const; // Reduces the current conserved quantity grid to wet tile flags and starts reading them back without waiting for the result
+	void renderWaterDisks(DataItem* dataItem) const; // Renders all water disks into the water texture with a single instanced draw call
+	void renderActiveTiles(const DataItem* dataItem) const; // Renders quads covering all tiles to be simulated during the current simulation step, or the entire grid if dry tile skipping is disabled
+	void reduceStats(DataItem* dataItem,TextureTracker& textureTracker) const; // Reduces the current conserved quantity grid to partial health statistics and starts reading them back without waiting for the result, if due and the previous read-back has been picked up
 	
 	/* Constructors and destructors: */
 	public:
@@ -184,12 +259,19 @@ class WaterTable2:public GLObject
 	void setPropertyGridCreator(PropertyGridCreator* newPropertyGridCreator); // Sets the property grid creator to be used in engineering mode
 	void forceMinStepSize(GLfloat newMinStepSize); // Forces the given minimum step size for all subsequent integration steps by limiting cell fluxes
 	void setMaxStepSize(GLfloat newMaxStepSize); // Sets the maximum step size for all subsequent integration steps
-	const PTransform& getWaterTextureTransform(void) const // Returns the matrix transforming from camera space into water texture space
+	GLfloat getMaxStepSize(void) const // Returns the maximum step size for all subsequent integration steps
+		{
+		return maxStepSize;
+		}
+	const PTransform& getWaterTextureTransform(void) const // Returns the matrix transforming from camera space into rendering grid texture space
 		{
 		return waterTextureTransform;
 		}
 	void addRenderFunction(const AddWaterFunction* newRenderFunction); // Adds a render function to the list; object remains owned by caller
 	void removeRenderFunction(const AddWaterFunction* removeRenderFunction); // Removes the given render function from the list but does not delete it
+	void addWaterDiskFunction(const AddWaterDiskFunction* newWaterDiskFunction); // Adds a water disk function to the list; object remains owned by caller
+	void removeWaterDiskFunction(const AddWaterDiskFunction* removeWaterDiskFunction); // Removes the given water disk function from the list but does not delete it
+	void updateWaterDisks(void); // Collects the current frame's water disks from all water disk functions; must be called once per frame, outside of rendering
 	GLfloat getSnowLine(void) const // Returns the elevation of the snow line relative to the base plane
 		{
 		return snowLine;
@@ -206,17 +288,69 @@ class WaterTable2:public GLObject
 		}
 	void setWaterDeposit(GLfloat newWaterDeposit); // Sets the amount of deposited water
 	void setDryBoundary(bool newDryBoundary); // Enables or disables enforcement of dry boundaries
+	bool getFusedIntegration(void) const // Returns true if the second half of each simulation step runs as a single fused pass
+		{
+		return fusedIntegration;
+		}
+	void setFusedIntegration(bool newFusedIntegration); // Enables or disables running the Euler step, the intermediate temporal derivative, the Runge-Kutta step, and dry boundary enforcement as a single fused pass
+	unsigned int getDryTileSize(void) const // Returns the size of dry skipping tiles, or 0 if dry tile skipping is disabled
+		{
+		return dryTileSize;
+		}
+	GLfloat getDryDepth(void) const // Returns the water column height below which a cell counts as dry for dry tile skipping
+		{
+		return dryDepth;
+		}
+	void setDryTileSkipping(unsigned int newDryTileSize,GLfloat newDryDepth); // Skips simulating square tiles of the given size while they and their neighbors contain no cells with water column heights above the given dry depth; tile size 0 simulates the entire grid
+	bool getHalfPrecision(void) const // Returns true if temporal derivatives and water rates are stored in half precision textures
+		{
+		return halfPrecision;
+		}
+	void setHalfPrecision(bool newHalfPrecision); // Stores temporal derivatives and water rates in half precision textures to reduce memory bandwidth; conserved quantities, snow heights, and step sizes remain in single precision; only affects OpenGL contexts initialized afterwards
+	unsigned int getRenderFactor(void) const // Returns the ratio between the resolutions of the rendering grid and the simulation grid
+		{
+		return renderFactor;
+		}
+	const Size& getRenderSize(void) const // Returns the size of the rendering grid
+		{
+		return renderSize;
+		}
+	const GLfloat* getRenderCellSize(void) const // Returns the rendering grid's cell size
+		{
+		return renderCellSize;
+		}
+	void setRenderFactor(unsigned int newRenderFactor); // Renders water on a grid whose resolution is the given multiple of the simulation grid's, reconstructed from the simulation grid and a bathymetry grid at rendering resolution; 1 renders the simulation grid directly; must be called before the water table's OpenGL contexts are initialized and before renderers are attached to the water table; only has an effect on water tables that render their bathymetry from a depth image renderer
+	unsigned int getStatsInterval(void) const // Returns the number of simulation steps between health statistics reductions, or 0 if they are disabled
+		{
+		return statsInterval;
+		}
+	void setStatsInterval(unsigned int newStatsInterval); // Reduces the conserved quantity grid to health statistics every given number of simulation steps; 0 disables health statistics
+	bool retrieveStats(GLContextData& contextData,WaterStats& stats) const; // Returns true and the health statistics of the most recent reduction in the given OpenGL context if its read-back completed since the last call; does not wait for pending read-backs
+	bool startCheckpoint(GLContextData& contextData,TextureTracker& textureTracker) const; // Starts reading back the current bathymetry, conserved quantity, and snow height grids in the given OpenGL context without waiting for the result; returns false if a previous read-back has not been picked up yet
+	WaterCheckpoint* finishCheckpoint(GLContextData& contextData,bool wait) const; // Returns a new checkpoint holding the simulation state read back in the given OpenGL context and the current simulation parameters, or null if there is no pending read-back, or if it has not completed and flag is false
+	void restoreCheckpointParameters(const WaterCheckpoint& checkpoint); // Sets all simulation parameters from the given checkpoint, which must match the water table's size
+	void restoreCheckpoint(const WaterCheckpoint& checkpoint,GLContextData& contextData,TextureTracker& textureTracker) const; // Replaces the bathymetry, conserved quantity, and snow height grids in the given OpenGL context with those in the given checkpoint, which must match the water table's size
+	GLfloat getActiveTileFraction(GLContextData& contextData) const; // Returns the fraction of the grid simulated during the most recent simulation step in the given OpenGL context
 	void updateBathymetry(GLContextData& contextData,TextureTracker& textureTracker) const; // Prepares the water table for subsequent calls to the runSimulationStep() method
 	void updateBathymetry(const GLfloat* bathymetryGrid,GLContextData& contextData,TextureTracker& textureTracker) const; // Updates the bathymetry directly with a vertex-centered elevation grid of grid size minus 1
 	void setWaterLevel(const GLfloat* waterGrid,GLContextData& contextData,TextureTracker& textureTracker) const; // Sets the current water level to the given grid, and resets flux components to zero
-	GLfloat runSimulationStep(bool forceStepSize,GLContextData& contextData,TextureTracker& textureTracker) const; // Runs a water flow simulation step, always uses maxStepSize if flag is true (may lead to instability); returns step size taken by Runge-Kutta integration step
+	GLfloat runSimulationStep(bool forceStepSize,GLContextData& contextData,TextureTracker& textureTracker) const; // Runs a water flow simulation step, always uses maxStepSize if flag is true (may lead to instability); returns step size taken by the previous step's Runge-Kutta integration step, or zero if there was none, as step sizes stay on the GPU and are read back one step late
+	void storePreviousState(GLContextData& contextData,TextureTracker& textureTracker) const; // Stores the current conserved quantity grid as the previous simulation state for interpolated rendering
+	void interpolateStates(GLfloat weight,GLContextData& contextData,TextureTracker& textureTracker) const; // Blends the previous and current conserved quantity grids with the given weight of the current grid; from now on, the quantity texture binding method binds the blended grid
+	void upsampleStates(GLContextData& contextData,TextureTracker& textureTracker) const; // Reconstructs the conserved quantity and snow height grids at rendering resolution from the most recent, or most recently interpolated, simulation state; does nothing if the rendering grid is the simulation grid
+	GLfloat finishSimulationSteps(GLContextData& contextData) const; // Returns the step size taken by the most recent simulation step that has not yet been reported by runSimulationStep(), or zero; blocks until the GPU finished that step's size calculation
 	void uploadWaterTextureTransform(Shader& shader) const; // Uploads the water texture transformation into the GLSL 4x4 matrix at the next uniform location in the given shader
 	GLint bindBathymetryTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const; // Binds the bathymetry texture object to the next available texture unit in the given texture tracker and sets filtering mode to linear if flag is true; returns the used texture unit's index
 	GLint bindSnowTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const; // Binds the most recent snow height texture object to the next available texture unit in the given texture tracker and sets filtering mode to linear if flag is true; returns the used texture unit's index
-	GLint bindQuantityTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const; // Binds the most recent conserved quantities texture object to the next available texture unit in the given texture tracker and sets filtering mode to linear if flag is true; returns the used texture unit's index
+	GLint bindQuantityTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const; // Binds the most recent, or most recently interpolated, conserved quantities texture object to the next available texture unit in the given texture tracker and sets filtering mode to linear if flag is true; returns the used texture unit's index
+	GLint bindRenderBathymetryTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const; // Binds the bathymetry texture object at rendering resolution like bindBathymetryTexture()
+	GLint bindRenderSnowTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const; // Binds the snow height texture object at rendering resolution like bindSnowTexture()
+	GLint bindRenderQuantityTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const; // Binds the conserved quantities texture object at rendering resolution like bindQuantityTexture()
 	void readBathymetryTexture(GLContextData& contextData,TextureTracker& textureTracker,GLfloat* buffer) const; // Reads the current bathymetry texture into the given buffer
 	void readSnowTexture(GLContextData& contextData,TextureTracker& textureTracker,GLfloat* buffer) const; // Reads the current snow height texture into the given buffer
 	void readQuantityTexture(GLContextData& contextData,TextureTracker& textureTracker,GLenum components,GLfloat* buffer) const; // Reads the given component(s) of the current conserved quantities texture into the given buffer
+	bool startGridReadback(GLContextData& contextData,TextureTracker& textureTracker,bool readBathymetry,bool readWaterLevel,bool readSnowHeight) const; // Starts reading back the requested current grids in the given OpenGL context into one of two pixel buffer objects without waiting for the result; returns false if two previous read-backs have not been retrieved yet
+	bool finishGridReadback(GLContextData& contextData,GLfloat* bathymetryBuffer,GLfloat* waterLevelBuffer,GLfloat* snowHeightBuffer,bool wait) const; // Copies the grids of the oldest pending read-back in the given OpenGL context into the given buffers, which must be null for grids that were not requested; returns false if there is no pending read-back, or if it has not completed and flag is false
 	Size getBathymetrySize(void) const // Returns the width or height of the bathymetry grid
 		{
 		return Size(size[0]-1,size[1]-1);
@@ -0,0 +1,1666 @@
+/***********************************************************************
+WaterTable2CPU - Class to simulate water flowing over a surface on the
+CPU, using the same Kurganov-Petrova scheme for the Saint-Venant system
+of partial differential equations as the GPU-based WaterTable2 class,
+for headless validation and benchmarking.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "WaterTable2CPU.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <Misc/SizedTypes.h>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+
+/***********************************************************************
+All arithmetic in this class mirrors the Water2* GLSL shaders used by
+WaterTable2 operation by operation, in single precision and in the same
+order of evaluation, so that results only differ from the GPU's by
+rounding. The derivative pass calculates each cell's reconstruction
+slopes and each face's fluxes once instead of re-calculating them in
+both adjacent cells as the shaders do, which yields identical values.
+All cell-centered grids are stored as separate planes per component
+with two layers of ghost cells replicating the outermost interior
+cells, which mirrors the shaders' clamped texture sampling and keeps
+the inner loops free of boundary checks.
+
+Local time stepping splits the grid into square tiles and runs in
+cycles. At the beginning of each cycle, tiles whose 3x3 neighborhood
+holds no water are skipped, and every other tile is assigned the highest
+level L such that steps of 2^L base steps are stable in its
+neighborhood, where the base step is the global step size. Levels of
+neighboring tiles differ by at most one. A tile taking a step assembles
+its neighbors' quantities at the step's start time into a private patch,
+interpolating neighbors that are in the middle of longer steps, and runs
+the regular Runge-Kutta step on that patch. Fluxes across tile
+boundaries are integrated over each cycle, and at the end of a cycle,
+cells along boundaries between tiles of different levels are corrected
+to use the finer tile's fluxes, which keeps the scheme conservative. If
+all tiles are active and on level zero, results are bit-identical to
+global time stepping.
+
+Half precision mode emulates WaterTable2's FP16 texture formats by
+rounding every value that the GPU would store in an FP16 texture, i.e.,
+temporal derivatives and water sources, to the nearest half precision
+value. Conserved quantities, snow heights, and step sizes remain in
+single precision.
+***********************************************************************/
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+template <class ValueParam>
+inline ValueParam* allocPlane(size_t numValues) // Allocates a plane of values aligned to a cache line boundary
+	{
+	void* result=0;
+	if(posix_memalign(&result,64,numValues*sizeof(ValueParam))!=0)
+		throw std::bad_alloc();
+	return static_cast<ValueParam*>(result);
+	}
+
+inline float roundToHalf(float value) // Returns the given value rounded to the nearest half precision value
+	{
+	/* Extract the value's magnitude as an IEEE 754 bit pattern: */
+	Misc::UInt32 bits;
+	memcpy(&bits,&value,sizeof(float));
+	Misc::UInt32 sign=bits&0x80000000U;
+	Misc::UInt32 magnitude=bits&0x7fffffffU;
+	if(magnitude>=0x7f800000U) // Infinity or NaN
+		return value;
+	
+	if(magnitude<0x38800000U)
+		{
+		/* Quantize subnormal half precision values to multiples of 2^-24: */
+		float scaled=Math::abs(value)*16777216.0f;
+		float result=float(Math::floor(scaled+0.5f))/16777216.0f;
+		return sign!=0U?-result:result;
+		}
+	
+	/* Round the mantissa to 10 bits, breaking ties towards even: */
+	magnitude+=0x0fffU+((magnitude>>13)&0x1U);
+	magnitude&=~0x1fffU;
+	
+	/* Overflow to infinity: */
+	if(magnitude>=0x47800000U)
+		magnitude=0x7f800000U;
+	
+	bits=sign|magnitude;
+	memcpy(&value,&bits,sizeof(float));
+	return value;
+	}
+
+inline float minmod(float d01,float d02,float d12) // Returns the minmod-limited slope of the given left, central, and right differences
+	{
+	float dMin=Math::min(Math::min(d01,d02),d12);
+	float dMax=Math::max(Math::max(d01,d02),d12);
+	return dMin>0.0f?dMin:dMax<0.0f?dMax:0.0f;
+	}
+
+inline float calcUvFactor(float h,float epsilon) // Returns the factor converting discharge to velocity using a desingularizing division operator
+	{
+	float h4=h*h*h*h;
+	return 1.41421356237309f*h/Math::sqrt(h4+Math::max(h4,epsilon));
+	}
+
+inline float calcFaceFlux(float lw,float ln,float lt,float rw,float rn,float rt,float b,float g,float epsilon,float maxSpeed,float halfCellSize,float& fw,float& fn,float& ft) // Calculates the flux across a face from the reconstructed quantities on its left and right sides as water level and normal and tangential discharge; returns the maximum possible step size
+	{
+	/* Calculate one-sided water column heights: */
+	float hl=Math::max(lw-b,0.0f);
+	float hr=Math::max(rw-b,0.0f);
+	
+	/* Calculate one-sided velocities: */
+	float uvl=calcUvFactor(hl,epsilon);
+	float unl=ln*uvl;
+	float utl=lt*uvl;
+	float uvr=calcUvFactor(hr,epsilon);
+	float unr=rn*uvr;
+	float utr=rt*uvr;
+	
+	/* Recalculate discharges based on desingularized velocities: */
+	ln=unl*hl;
+	lt=utl*hl;
+	rn=unr*hr;
+	rt=utr*hr;
+	
+	/* Calculate one-sided local speeds of propagation, limited to guarantee minimum step size: */
+	float sghl=Math::sqrt(g*hl);
+	float sghr=Math::sqrt(g*hr);
+	float am=Math::min(Math::max(Math::min(unl-sghl,unr-sghr),-maxSpeed),0.0f); // am is always <=0.0
+	float ap=Math::min(Math::max(Math::max(unl+sghl,unr+sghr),0.0f),maxSpeed); // ap is always >=0.0
+	
+	/* Calculate the complete flux from the one-sided flux quadratures: */
+	if(ap-am!=0.0f)
+		{
+		float apam=ap*am;
+		float apmam=ap-am;
+		fw=((ln*ap-rn*am)+(rw-lw)*apam)/apmam;
+		fn=(((unl*ln+0.5f*g*hl*hl)*ap-(unr*rn+0.5f*g*hr*hr)*am)+(rn-ln)*apam)/apmam;
+		ft=(((utl*ln)*ap-(utr*rn)*am)+(rt-lt)*apam)/apmam;
+		}
+	else
+		fw=fn=ft=0.0f;
+	
+	/* Return maximum possible step size: */
+	return halfCellSize/Math::max(-am,ap);
+	}
+
+}
+
+/*******************************
+Methods of class WaterTable2CPU:
+*******************************/
+
+void WaterTable2CPU::fillGhostCells(float* grid) const
+	{
+	/* Replicate the left- and right-most interior cells of each row: */
+	int w=int(size[0]);
+	int h=int(size[1]);
+	for(int y=0;y<h;++y)
+		{
+		float* row=getCell(grid,0,y);
+		row[-2]=row[-1]=row[0];
+		row[w+1]=row[w]=row[w-1];
+		}
+	
+	/* Replicate the bottom- and top-most rows including their ghost cells: */
+	size_t rowSize=size_t(stride)*sizeof(float);
+	memcpy(getCell(grid,-2,-2),getCell(grid,-2,0),rowSize);
+	memcpy(getCell(grid,-2,-1),getCell(grid,-2,0),rowSize);
+	memcpy(getCell(grid,-2,h),getCell(grid,-2,h-1),rowSize);
+	memcpy(getCell(grid,-2,h+1),getCell(grid,-2,h-1),rowSize);
+	}
+
+void WaterTable2CPU::calcSlopeYRow(const WaterTable2CPU::GridView q[3],int x0,int y,int w,float* slope[3]) const
+	{
+	float thetaOverCellSize=theta/cellSize[1];
+	float twoCellSize=2.0f*cellSize[1];
+	float halfCellSize=cellSize[1]*0.5f;
+	
+	/* Calculate minmod-limited slopes of all components: */
+	for(int i=0;i<3;++i)
+		{
+		const float* q0=q[i].getCell(x0,y-1);
+		const float* q1=q[i].getCell(x0,y);
+		const float* q2=q[i].getCell(x0,y+1);
+		float* sPtr=slope[i];
+		for(int x=0;x<w;++x)
+			sPtr[x]=minmod((q1[x]-q0[x])*thetaOverCellSize,(q2[x]-q0[x])/twoCellSize,(q2[x]-q1[x])*thetaOverCellSize);
+		}
+	
+	/* Check the water level slopes against the south and north face-centered bathymetry values: */
+	const float* q1=q[0].getCell(x0,y);
+	const float* b0=getCell(faceBathymetry[1],x0,y);
+	const float* b1=getCell(faceBathymetry[1],x0,y+1);
+	float* s0=slope[0];
+	for(int x=0;x<w;++x)
+		{
+		float s=s0[x];
+		if(q1[x]-s*halfCellSize<b0[x])
+			s=(q1[x]-b0[x])/halfCellSize;
+		if(q1[x]+s*halfCellSize<b1[x])
+			s=(b1[x]-q1[x])/halfCellSize;
+		s0[x]=s;
+		}
+	
+	/* Convert the slopes to reconstruction offsets from the cell center to the faces: */
+	for(int i=0;i<3;++i)
+		for(int x=0;x<w;++x)
+			slope[i][x]*=halfCellSize;
+	}
+
+void WaterTable2CPU::calcSlopeXRow(const WaterTable2CPU::GridView q[3],int x0,int y,int w,float* slope[3]) const
+	{
+	float thetaOverCellSize=theta/cellSize[0];
+	float twoCellSize=2.0f*cellSize[0];
+	float halfCellSize=cellSize[0]*0.5f;
+	
+	/* Calculate minmod-limited slopes of all components, starting at the cell to the left of the row segment: */
+	for(int i=0;i<3;++i)
+		{
+		const float* qPtr=q[i].getCell(x0-1,y);
+		float* sPtr=slope[i];
+		for(int x=0;x<w+2;++x)
+			sPtr[x]=minmod((qPtr[x]-qPtr[x-1])*thetaOverCellSize,(qPtr[x+1]-qPtr[x-1])/twoCellSize,(qPtr[x+1]-qPtr[x])*thetaOverCellSize);
+		}
+	
+	/* Check the water level slopes against the west and east face-centered bathymetry values: */
+	const float* qPtr=q[0].getCell(x0-1,y);
+	const float* b=getCell(faceBathymetry[0],x0-1,y);
+	float* s0=slope[0];
+	for(int x=0;x<w+2;++x)
+		{
+		float s=s0[x];
+		if(qPtr[x]-s*halfCellSize<b[x])
+			s=(qPtr[x]-b[x])/halfCellSize;
+		if(qPtr[x]+s*halfCellSize<b[x+1])
+			s=(b[x+1]-qPtr[x])/halfCellSize;
+		s0[x]=s;
+		}
+	
+	/* Convert the slopes to reconstruction offsets from the cell center to the faces: */
+	for(int i=0;i<3;++i)
+		for(int x=0;x<w+2;++x)
+			slope[i][x]*=halfCellSize;
+	}
+
+float WaterTable2CPU::calcFluxYRow(const WaterTable2CPU::GridView q[3],int x0,int y,int w,float* const lowerSlope[3],float* const upperSlope[3],float* flux[3]) const
+	{
+	float halfCellSize=0.5f*cellSize[1];
+	
+	/* Get the quantities of the cells below and above the faces: */
+	const float* lq[3];
+	const float* uq[3];
+	for(int i=0;i<3;++i)
+		{
+		lq[i]=q[i].getCell(x0,y-1);
+		uq[i]=q[i].getCell(x0,y);
+		}
+	const float* b=getCell(faceBathymetry[1],x0,y);
+	
+	/* Calculate the fluxes using the north-side reconstruction of the lower cell and the south-side reconstruction of the upper cell, with hv as normal discharge: */
+	float stepSize=Math::Constants<float>::max;
+	for(int x=0;x<w;++x)
+		{
+		float cellStepSize=calcFaceFlux(lq[0][x]+lowerSlope[0][x],lq[2][x]+lowerSlope[2][x],lq[1][x]+lowerSlope[1][x],
+		                                uq[0][x]-upperSlope[0][x],uq[2][x]-upperSlope[2][x],uq[1][x]-upperSlope[1][x],
+		                                b[x],g,epsilon,maxPropagationSpeed[1],halfCellSize,
+		                                flux[0][x],flux[2][x],flux[1][x]);
+		stepSize=Math::min(stepSize,cellStepSize);
+		}
+	
+	return stepSize;
+	}
+
+float WaterTable2CPU::calcFluxXRow(const WaterTable2CPU::GridView q[3],int x0,int y,int w,float* const slope[3],float* flux[3]) const
+	{
+	float halfCellSize=0.5f*cellSize[0];
+	
+	/* Get the quantities of the cells to the left of the faces, starting at the cell to the left of the row segment: */
+	const float* qPtr[3];
+	for(int i=0;i<3;++i)
+		qPtr[i]=q[i].getCell(x0-1,y);
+	const float* b=getCell(faceBathymetry[0],x0,y);
+	
+	/* Calculate the fluxes using the east-side reconstruction of the left cell and the west-side reconstruction of the right cell, with hu as normal discharge: */
+	float stepSize=Math::Constants<float>::max;
+	for(int x=0;x<=w;++x)
+		{
+		float cellStepSize=calcFaceFlux(qPtr[0][x]+slope[0][x],qPtr[1][x]+slope[1][x],qPtr[2][x]+slope[2][x],
+		                                qPtr[0][x+1]-slope[0][x+1],qPtr[1][x+1]-slope[1][x+1],qPtr[2][x+1]-slope[2][x+1],
+		                                b[x],g,epsilon,maxPropagationSpeed[0],halfCellSize,
+		                                flux[0][x],flux[1][x],flux[2][x]);
+		stepSize=Math::min(stepSize,cellStepSize);
+		}
+	
+	return stepSize;
+	}
+
+void WaterTable2CPU::calcDerivativeRow(const WaterTable2CPU::GridView quantity[3],const WaterTable2CPU::GridView derivative[3],int x0,int y,int w,float* const fluxX[3],float* const lowerFluxY[3],float* const upperFluxY[3]) const
+	{
+	const float* q[3];
+	float* qt[3];
+	for(int i=0;i<3;++i)
+		{
+		q[i]=quantity[i].getCell(x0,y);
+		qt[i]=derivative[i].getCell(x0,y);
+		}
+	const float* bx=getCell(faceBathymetry[0],x0,y);
+	const float* bs=getCell(faceBathymetry[1],x0,y);
+	const float* bn=getCell(faceBathymetry[1],x0,y+1);
+	
+	if(mode==Traditional)
+		{
+		for(int x=0;x<w;++x)
+			{
+			/* Calculate the water column height at the cell center: */
+			float h=Math::max(q[0][x]-(bx[x]+bx[x+1])*0.5f,0.0f);
+			
+			/* Calculate the temporal derivative from the bed slope source terms and the face fluxes: */
+			qt[0][x]=(0.0f-(fluxX[0][x+1]-fluxX[0][x])/cellSize[0])-(upperFluxY[0][x]-lowerFluxY[0][x])/cellSize[1];
+			qt[1][x]=(-g*h*(bx[x+1]-bx[x])/cellSize[0]-(fluxX[1][x+1]-fluxX[1][x])/cellSize[0])-(upperFluxY[1][x]-lowerFluxY[1][x])/cellSize[1];
+			qt[2][x]=(-g*h*(bn[x]-bs[x])/cellSize[1]-(fluxX[2][x+1]-fluxX[2][x])/cellSize[0])-(upperFluxY[2][x]-lowerFluxY[2][x])/cellSize[1];
+			}
+		}
+	else
+		{
+		const float* roughness=getCell(properties[0],x0,y);
+		const float* absorption=getCell(properties[1],x0,y);
+		for(int x=0;x<w;++x)
+			{
+			/* Calculate the water column height at the cell center: */
+			float h=Math::max(q[0][x]-(bx[x]+bx[x+1])*0.5f,0.0f);
+			
+			/* Calculate bed friction and absorption: */
+			float cz=Math::pow(h,1.0f/6.0f)/roughness[x];
+			float uvFactor=calcUvFactor(h,epsilon);
+			float u=q[1][x]*uvFactor;
+			float v=q[2][x]*uvFactor;
+			float vcz2=Math::sqrt(u*u+v*v)/Math::max(cz*cz,epsilon*0.01f);
+			
+			/* Calculate the temporal derivative from the bed slope, friction, and absorption source terms and the face fluxes: */
+			qt[0][x]=((0.0f+-absorption[x])-(fluxX[0][x+1]-fluxX[0][x])/cellSize[0])-(upperFluxY[0][x]-lowerFluxY[0][x])/cellSize[1];
+			qt[1][x]=((-g*h*(bx[x+1]-bx[x])/cellSize[0]+-g*u*vcz2)-(fluxX[1][x+1]-fluxX[1][x])/cellSize[0])-(upperFluxY[1][x]-lowerFluxY[1][x])/cellSize[1];
+			qt[2][x]=((-g*h*(bn[x]-bs[x])/cellSize[1]+-g*v*vcz2)-(fluxX[2][x+1]-fluxX[2][x])/cellSize[0])-(upperFluxY[2][x]-lowerFluxY[2][x])/cellSize[1];
+			}
+		}
+	
+	if(halfPrecision)
+		{
+		/* Round the temporal derivative to half precision: */
+		for(int i=0;i<3;++i)
+			for(int x=0;x<w;++x)
+				qt[i][x]=roundToHalf(qt[i][x]);
+		}
+	}
+
+float WaterTable2CPU::calcDerivative(int x0,int y0,int x1,int y1,const WaterTable2CPU::GridView q[3],const WaterTable2CPU::GridView qt[3],WaterTable2CPU::Band& band,const WaterTable2CPU::FluxRecorder* recorder) const
+	{
+	int w=x1-x0;
+	
+	/* Calculate the reconstruction offsets of the rows below and at the beginning of the rectangle, and the fluxes across the rectangle's lower faces: */
+	float** slopeY[3]={band.slopeY[0],band.slopeY[1],band.slopeY[2]};
+	float** fluxY[2]={band.fluxY[0],band.fluxY[1]};
+	calcSlopeYRow(q,x0,y0-1,w,slopeY[0]);
+	calcSlopeYRow(q,x0,y0,w,slopeY[1]);
+	float stepSize=calcFluxYRow(q,x0,y0,w,slopeY[0],slopeY[1],fluxY[0]);
+	if(recorder!=0)
+		recorder->recordFluxY(x0,y0,w,fluxY[0]);
+	
+	for(int y=y0;y<y1;++y)
+		{
+		/* Calculate the reconstruction offsets of the next row and the fluxes across this row's upper faces: */
+		calcSlopeYRow(q,x0,y+1,w,slopeY[2]);
+		stepSize=Math::min(stepSize,calcFluxYRow(q,x0,y+1,w,slopeY[1],slopeY[2],fluxY[1]));
+		
+		/* Calculate the fluxes across this row's vertical faces: */
+		calcSlopeXRow(q,x0,y,w,band.slopeX);
+		stepSize=Math::min(stepSize,calcFluxXRow(q,x0,y,w,band.slopeX,band.fluxX));
+		if(recorder!=0)
+			{
+			recorder->recordFluxY(x0,y+1,w,fluxY[1]);
+			recorder->recordFluxX(x0,y,w,band.fluxX);
+			}
+		
+		/* Calculate the temporal derivative of this row: */
+		calcDerivativeRow(q,qt,x0,y,w,band.fluxX,fluxY[0],fluxY[1]);
+		
+		/* Rotate the rolling buffers: */
+		float** tempSlope=slopeY[0];
+		slopeY[0]=slopeY[1];
+		slopeY[1]=slopeY[2];
+		slopeY[2]=tempSlope;
+		float** tempFlux=fluxY[0];
+		fluxY[0]=fluxY[1];
+		fluxY[1]=tempFlux;
+		}
+	
+	return stepSize;
+	}
+
+void WaterTable2CPU::eulerStep(WaterTable2CPU::Band& band)
+	{
+	int w=int(size[0]);
+	for(int y=int(band.yBegin);y<int(band.yEnd);++y)
+		for(int i=0;i<3;++i)
+			{
+			const float* q=getCell(quantity[i],0,y);
+			const float* qt=getCell(derivative[i],0,y);
+			float* qStar=getCell(quantityStar[i],0,y);
+			
+			/* Calculate the Euler step, and attenuate partial discharges: */
+			float att=i>0?passAttenuation:1.0f;
+			for(int x=0;x<w;++x)
+				qStar[x]=(q[x]+qt[x]*passStepSize)*att;
+			}
+	}
+
+void WaterTable2CPU::rungeKuttaStep(WaterTable2CPU::Band& band)
+	{
+	int w=int(size[0]);
+	int h=int(size[1]);
+	for(int y=int(band.yBegin);y<int(band.yEnd);++y)
+		{
+		for(int i=0;i<3;++i)
+			{
+			float* q=getCell(quantity[i],0,y);
+			const float* qStar=getCell(quantityStar[i],0,y);
+			const float* qt=getCell(derivative[i],0,y);
+			
+			/* Calculate the Runge-Kutta step, and attenuate partial discharges: */
+			float att=i>0?passAttenuation:1.0f;
+			for(int x=0;x<w;++x)
+				q[x]=((q[x]+qStar[x]+qt[x]*passStepSize)*0.5f)*att;
+			}
+		
+		if(dryBoundary)
+			{
+			/* Set the outermost layer of cells to dry conditions: */
+			const float* b=getCell(cellBathymetry,0,y);
+			float* q[3];
+			for(int i=0;i<3;++i)
+				q[i]=getCell(quantity[i],0,y);
+			if(y==0||y==h-1)
+				{
+				for(int x=0;x<w;++x)
+					{
+					q[0][x]=b[x];
+					q[1][x]=q[2][x]=0.0f;
+					}
+				}
+			else
+				{
+				q[0][0]=b[0];
+				q[1][0]=q[2][0]=0.0f;
+				q[0][w-1]=b[w-1];
+				q[1][w-1]=q[2][w-1]=0.0f;
+				}
+			}
+		}
+	}
+
+void WaterTable2CPU::updateWater(int x0,int y0,int x1,int y1,float stepSize)
+	{
+	int w=x1-x0;
+	float melt=snowMelt*stepSize;
+	for(int y=y0;y<y1;++y)
+		{
+		const float* b=getCell(cellBathymetry,x0,y);
+		float* s=getCell(snow,x0,y);
+		float* q[3];
+		for(int i=0;i<3;++i)
+			q[i]=getCell(quantity[i],x0,y);
+		const float* ws=waterSource!=0?getCell(waterSource,x0,y):0;
+		for(int x=0;x<w;++x)
+			{
+			/* Calculate the old water column height: */
+			float hOld=q[0][x]-b[x];
+			
+			/* Calculate the effective changes in water and snow level from the summed water rates: */
+			float precip=waterDeposit;
+			if(ws!=0)
+				precip+=ws[x];
+			precip*=stepSize;
+			float dWater=precip;
+			float dSnow=precip*4.0f; // Snow is four times fluffier than water
+			
+			/* Make it rain or snow depending on bathymetry elevation: */
+			if(precip>0.0f)
+				{
+				float t=Math::min(Math::max((b[x]-(snowLine-0.25f))/((snowLine+0.25f)-(snowLine-0.25f)),0.0f),1.0f);
+				float waterSnowFactor=t*t*(3.0f-2.0f*t);
+				dWater=dWater*(1.0f-waterSnowFactor);
+				dSnow=dSnow*waterSnowFactor;
+				}
+			
+			/* Melt snow into water: */
+			float cellMelt=Math::min(melt,s[x]);
+			dSnow=dSnow-cellMelt;
+			dWater=dWater+cellMelt/4.0f; // Snow is four times fluffier than water
+			
+			/* Update the snow height: */
+			s[x]=Math::max(s[x]+dSnow,0.0f);
+			
+			/* Update the conserved quantities: */
+			if(dWater>=0.0f)
+				{
+				/* Update the water surface level, and leave the partial discharges alone, as new water is added with zero velocity: */
+				q[0][x]=(hOld+dWater)+b[x];
+				}
+			else
+				{
+				/* Update the water surface height: */
+				float hNew=Math::max(hOld+dWater,0.0f);
+				q[0][x]=hNew+b[x];
+				
+				/* Update the partial discharges, as water is removed at current velocity: */
+				float scale=hOld>0.0f?hNew/hOld:0.0f;
+				q[1][x]=hOld>0.0f?q[1][x]*scale:0.0f;
+				q[2][x]=hOld>0.0f?q[2][x]*scale:0.0f;
+				}
+			}
+		}
+	}
+
+void WaterTable2CPU::FluxRecorder::recordFluxY(int rowX0,int y,int w,float* const flux[3]) const
+	{
+	/* Check whether the row's south faces are the tile's south or north faces: */
+	float* side=y==y0?sides[2]:y==y1?sides[3]:0;
+	if(side!=0)
+		{
+		int xBegin=rowX0>x0?rowX0:x0;
+		int xEnd=rowX0+w<x1?rowX0+w:x1;
+		for(int x=xBegin;x<xEnd;++x)
+			for(int i=0;i<3;++i)
+				side[(x-x0)*3+i]+=flux[i][x-rowX0]*scale;
+		}
+	}
+
+void WaterTable2CPU::FluxRecorder::recordFluxX(int rowX0,int y,int w,float* const flux[3]) const
+	{
+	if(y>=y0&&y<y1)
+		{
+		/* Check whether the row segment contains the tile's west or east faces: */
+		if(x0>=rowX0&&x0<=rowX0+w)
+			for(int i=0;i<3;++i)
+				sides[0][(y-y0)*3+i]+=flux[i][x0-rowX0]*scale;
+		if(x1>=rowX0&&x1<=rowX0+w)
+			for(int i=0;i<3;++i)
+				sides[1][(y-y0)*3+i]+=flux[i][x1-rowX0]*scale;
+		}
+	}
+
+void WaterTable2CPU::initFluxRecorder(const WaterTable2CPU::Tile& tile,float* fluxes,float scale,WaterTable2CPU::FluxRecorder& recorder) const
+	{
+	recorder.x0=tile.x0;
+	recorder.y0=tile.y0;
+	recorder.x1=tile.x1;
+	recorder.y1=tile.y1;
+	recorder.scale=scale;
+	for(int side=0;side<4;++side)
+		recorder.sides[side]=tile.getSide(fluxes,side);
+	}
+
+void WaterTable2CPU::scanTile(WaterTable2CPU::Tile& tile) const
+	{
+	/* Check whether any cell holds water deeper than the dry depth, or will receive water from a water source or melting snow: */
+	int w=tile.x1-tile.x0;
+	bool wet=waterDeposit>0.0f;
+	for(int y=tile.y0;y<tile.y1&&!wet;++y)
+		{
+		const float* q=getCell(quantity[0],tile.x0,y);
+		const float* b=getCell(cellBathymetry,tile.x0,y);
+		const float* s=getCell(snow,tile.x0,y);
+		const float* ws=waterSource!=0?getCell(waterSource,tile.x0,y):0;
+		for(int x=0;x<w&&!wet;++x)
+			wet=q[x]-b[x]>dryDepth||(s[x]>0.0f&&snowMelt>0.0f)||(ws!=0&&ws[x]>0.0f);
+		}
+	tile.wet=wet;
+	}
+
+void WaterTable2CPU::startTile(WaterTable2CPU::Tile& tile,WaterTable2CPU::Band& band)
+	{
+	/* Reset the tile's flux registers: */
+	size_t numFluxes=tile.getNumFluxes();
+	for(size_t i=0;i<numFluxes;++i)
+		tile.startFluxes[i]=tile.fluxRegister[i]=0.0f;
+	
+	/* Calculate the tile's temporal derivative from the current quantities, and record the fluxes across its boundary faces: */
+	GridView q[3],qt[3];
+	for(int i=0;i<3;++i)
+		{
+		q[i]=getGridView(quantity[i]);
+		qt[i]=getGridView(derivative[i]);
+		}
+	FluxRecorder recorder;
+	initFluxRecorder(tile,tile.startFluxes,1.0f,recorder);
+	tile.minStepSize=calcDerivative(tile.x0,tile.y0,tile.x1,tile.y1,q,qt,band,&recorder);
+	}
+
+void WaterTable2CPU::activateTile(WaterTable2CPU::Tile& tile)
+	{
+	/* Save the tile's current quantities: */
+	size_t rowSize=size_t(tile.x1-tile.x0)*sizeof(float);
+	for(int i=0;i<3;++i)
+		for(int y=tile.y0;y<tile.y1;++y)
+			memcpy(getCell(quantityOld[i],tile.x0,y),getCell(quantity[i],tile.x0,y),rowSize);
+	
+	/* Start the tile's next step: */
+	tile.timeOld=passTime;
+	tile.timeNew=passTime+(1U<<tile.level);
+	}
+
+void WaterTable2CPU::assemblePatch(const WaterTable2CPU::Tile& tile,const WaterTable2CPU::GridView patch[3]) const
+	{
+	/* Calculate the part of the patch inside the grid: */
+	int ts=int(tileSize);
+	int ix0=Math::max(tile.x0-4,0);
+	int iy0=Math::max(tile.y0-4,0);
+	int ix1=Math::min(tile.x1+4,int(size[0]));
+	int iy1=Math::min(tile.y1+4,int(size[1]));
+	
+	/* Copy the quantities of all tiles overlapping the patch at the current base step: */
+	for(int ty=iy0/ts;ty<=(iy1-1)/ts;++ty)
+		for(int tx=ix0/ts;tx<=(ix1-1)/ts;++tx)
+			{
+			const Tile& source=tiles[ty*int(numTiles[0])+tx];
+			int x0=Math::max(source.x0,ix0);
+			int y0=Math::max(source.y0,iy0);
+			int x1=Math::min(source.x1,ix1);
+			int y1=Math::min(source.y1,iy1);
+			size_t rowSize=size_t(x1-x0)*sizeof(float);
+			for(int i=0;i<3;++i)
+				for(int y=y0;y<y1;++y)
+					{
+					float* pPtr=patch[i].getCell(x0,y);
+					if(!source.active||source.timeNew==passTime)
+						memcpy(pPtr,getCell(quantity[i],x0,y),rowSize);
+					else if(source.timeOld==passTime)
+						memcpy(pPtr,getCell(quantityOld[i],x0,y),rowSize);
+					else
+						{
+						/* Interpolate the quantities of a tile that is in the middle of a longer step: */
+						const float* qOld=getCell(quantityOld[i],x0,y);
+						const float* qNew=getCell(quantity[i],x0,y);
+						float t=float(passTime-source.timeOld)/float(source.timeNew-source.timeOld);
+						for(int x=0;x<x1-x0;++x)
+							pPtr[x]=qOld[x]+(qNew[x]-qOld[x])*t;
+						}
+					}
+			}
+	
+	/* Replicate the outermost interior cells into the patch's ghost cells: */
+	fillPatchGhostCells(patch,ix0,iy0,ix1,iy1,Math::max(tile.x0-4,-2),Math::max(tile.y0-4,-2),Math::min(tile.x1+4,int(size[0])+2),Math::min(tile.y1+4,int(size[1])+2));
+	}
+
+void WaterTable2CPU::fillPatchGhostCells(const WaterTable2CPU::GridView patch[3],int ix0,int iy0,int ix1,int iy1,int gx0,int gy0,int gx1,int gy1) const
+	{
+	size_t rowSize=size_t(gx1-gx0)*sizeof(float);
+	for(int i=0;i<3;++i)
+		{
+		/* Replicate the left- and right-most interior cells of each interior row: */
+		for(int y=iy0;y<iy1;++y)
+			{
+			float* row=patch[i].getCell(ix0,y);
+			for(int x=gx0-ix0;x<0;++x)
+				row[x]=row[0];
+			for(int x=ix1-ix0;x<gx1-ix0;++x)
+				row[x]=row[ix1-1-ix0];
+			}
+		
+		/* Replicate the bottom- and top-most rows including their ghost cells: */
+		for(int y=gy0;y<iy0;++y)
+			memcpy(patch[i].getCell(gx0,y),patch[i].getCell(gx0,iy0),rowSize);
+		for(int y=iy1;y<gy1;++y)
+			memcpy(patch[i].getCell(gx0,y),patch[i].getCell(gx0,iy1-1),rowSize);
+		}
+	}
+
+void WaterTable2CPU::stepTile(WaterTable2CPU::Tile& tile,WaterTable2CPU::Band& band)
+	{
+	int w=int(size[0]);
+	int h=int(size[1]);
+	float stepSize=passStepSize*float(1U<<tile.level);
+	float att=mode==Traditional?Math::pow(attenuation,stepSize):1.0f;
+	
+	/* Create views of the band's patches, which extend four cells beyond the tile on each side: */
+	GridView q[3],qStar[3],qt[3];
+	ptrdiff_t patchStride=ptrdiff_t(tileSize+8);
+	for(int i=0;i<3;++i)
+		{
+		q[i]=GridView(band.patchQuantity[i],tile.x0-4,tile.y0-4,patchStride);
+		qStar[i]=GridView(band.patchQuantityStar[i],tile.x0-4,tile.y0-4,patchStride);
+		qt[i]=GridView(band.patchDerivative[i],tile.x0-4,tile.y0-4,patchStride);
+		}
+	
+	/* Assemble the conserved quantities around the tile at the current base step: */
+	assemblePatch(tile,q);
+	
+	/*********************************************************************
+	Step 1: Calculate the temporal derivative within two cells around the
+	tile, using the derivative calculated at the beginning of the cycle in
+	the cycle's first step.
+	*********************************************************************/
+	
+	int ex0=Math::max(tile.x0-2,0);
+	int ey0=Math::max(tile.y0-2,0);
+	int ex1=Math::min(tile.x1+2,w);
+	int ey1=Math::min(tile.y1+2,h);
+	FluxRecorder recorder;
+	initFluxRecorder(tile,tile.fluxRegister,0.5f*stepSize,recorder);
+	if(passTime==0)
+		{
+		size_t rowSize=size_t(ex1-ex0)*sizeof(float);
+		for(int i=0;i<3;++i)
+			for(int y=ey0;y<ey1;++y)
+				memcpy(qt[i].getCell(ex0,y),getCell(derivative[i],ex0,y),rowSize);
+		size_t numFluxes=tile.getNumFluxes();
+		for(size_t i=0;i<numFluxes;++i)
+			tile.fluxRegister[i]+=tile.startFluxes[i]*recorder.scale;
+		}
+	else
+		calcDerivative(ex0,ey0,ex1,ey1,q,qt,band,&recorder);
+	
+	/*********************************************************************
+	Step 2: Perform the tentative Euler integration step within two cells
+	around the tile.
+	*********************************************************************/
+	
+	for(int i=0;i<3;++i)
+		{
+		float attI=i>0?att:1.0f;
+		for(int y=ey0;y<ey1;++y)
+			{
+			const float* qPtr=q[i].getCell(ex0,y);
+			const float* qtPtr=qt[i].getCell(ex0,y);
+			float* qStarPtr=qStar[i].getCell(ex0,y);
+			for(int x=0;x<ex1-ex0;++x)
+				qStarPtr[x]=(qPtr[x]+qtPtr[x]*stepSize)*attI;
+			}
+		}
+	fillPatchGhostCells(qStar,ex0,ey0,ex1,ey1,Math::max(tile.x0-2,-2),Math::max(tile.y0-2,-2),Math::min(tile.x1+2,w+2),Math::min(tile.y1+2,h+2));
+	
+	/*********************************************************************
+	Step 3: Calculate the temporal derivative of the intermediate
+	quantities on the tile.
+	*********************************************************************/
+	
+	calcDerivative(tile.x0,tile.y0,tile.x1,tile.y1,qStar,qt,band,&recorder);
+	
+	/*********************************************************************
+	Step 4: Perform the final Runge-Kutta integration step on the tile and
+	enforce dry boundaries.
+	*********************************************************************/
+	
+	int tw=tile.x1-tile.x0;
+	for(int i=0;i<3;++i)
+		{
+		float attI=i>0?att:1.0f;
+		for(int y=tile.y0;y<tile.y1;++y)
+			{
+			const float* qPtr=q[i].getCell(tile.x0,y);
+			const float* qStarPtr=qStar[i].getCell(tile.x0,y);
+			const float* qtPtr=qt[i].getCell(tile.x0,y);
+			float* qNew=getCell(quantity[i],tile.x0,y);
+			for(int x=0;x<tw;++x)
+				qNew[x]=((qPtr[x]+qStarPtr[x]+qtPtr[x]*stepSize)*0.5f)*attI;
+			}
+		}
+	
+	if(dryBoundary)
+		{
+		/* Set the tile's cells in the outermost layer of cells to dry conditions: */
+		for(int y=tile.y0;y<tile.y1;++y)
+			{
+			const float* b=getCell(cellBathymetry,0,y);
+			float* qRow[3];
+			for(int i=0;i<3;++i)
+				qRow[i]=getCell(quantity[i],0,y);
+			if(y==0||y==h-1)
+				{
+				for(int x=tile.x0;x<tile.x1;++x)
+					{
+					qRow[0][x]=b[x];
+					qRow[1][x]=qRow[2][x]=0.0f;
+					}
+				}
+			else
+				{
+				if(tile.x0==0)
+					{
+					qRow[0][0]=b[0];
+					qRow[1][0]=qRow[2][0]=0.0f;
+					}
+				if(tile.x1==w)
+					{
+					qRow[0][w-1]=b[w-1];
+					qRow[1][w-1]=qRow[2][w-1]=0.0f;
+					}
+				}
+			}
+		}
+	
+	if(waterDeposit!=0.0f||waterSource!=0)
+		{
+		/*******************************************************************
+		Step 5: Add or remove water and snow.
+		*******************************************************************/
+		
+		updateWater(tile.x0,tile.y0,tile.x1,tile.y1,stepSize);
+		}
+	}
+
+void WaterTable2CPU::correctTileFluxes(void)
+	{
+	for(unsigned int ty=0;ty<numTiles[1];++ty)
+		for(unsigned int tx=0;tx<numTiles[0];++tx)
+			{
+			Tile& tile=tiles[ty*numTiles[0]+tx];
+			unsigned int level=tile.active?tile.level:maxTileLevel+1;
+			
+			if(tx+1<numTiles[0])
+				{
+				/* Check the faces shared with the east neighbor: */
+				Tile& east=tiles[ty*numTiles[0]+tx+1];
+				unsigned int eastLevel=east.active?east.level:maxTileLevel+1;
+				if(level!=eastLevel)
+					{
+					/* Replace the integrated fluxes applied to the coarser tile's cells with those applied to the finer tile's cells: */
+					bool westCoarse=level>eastLevel;
+					const float* fine=westCoarse?east.getSide(east.fluxRegister,0):tile.getSide(tile.fluxRegister,1);
+					const float* coarse=westCoarse?tile.getSide(tile.fluxRegister,1):east.getSide(east.fluxRegister,0);
+					int x=westCoarse?tile.x1-1:east.x0;
+					float scale=(westCoarse?-1.0f:1.0f)/cellSize[0];
+					for(int y=tile.y0;y<tile.y1;++y,fine+=3,coarse+=3)
+						{
+						for(int i=0;i<3;++i)
+							*getCell(quantity[i],x,y)+=(fine[i]-coarse[i])*scale;
+						float* q0=getCell(quantity[0],x,y);
+						*q0=Math::max(*q0,*getCell(cellBathymetry,x,y));
+						}
+					}
+				}
+			
+			if(ty+1<numTiles[1])
+				{
+				/* Check the faces shared with the north neighbor: */
+				Tile& north=tiles[(ty+1)*numTiles[0]+tx];
+				unsigned int northLevel=north.active?north.level:maxTileLevel+1;
+				if(level!=northLevel)
+					{
+					/* Replace the integrated fluxes applied to the coarser tile's cells with those applied to the finer tile's cells: */
+					bool southCoarse=level>northLevel;
+					const float* fine=southCoarse?north.getSide(north.fluxRegister,2):tile.getSide(tile.fluxRegister,3);
+					const float* coarse=southCoarse?tile.getSide(tile.fluxRegister,3):north.getSide(north.fluxRegister,2);
+					int y=southCoarse?tile.y1-1:north.y0;
+					float scale=(southCoarse?-1.0f:1.0f)/cellSize[1];
+					for(int x=tile.x0;x<tile.x1;++x,fine+=3,coarse+=3)
+						{
+						for(int i=0;i<3;++i)
+							*getCell(quantity[i],x,y)+=(fine[i]-coarse[i])*scale;
+						float* q0=getCell(quantity[0],x,y);
+						*q0=Math::max(*q0,*getCell(cellBathymetry,x,y));
+						}
+					}
+				}
+			}
+	}
+
+float WaterTable2CPU::runLocalTimeSteppingCycle(bool forceStepSize)
+	{
+	unsigned int numAllTiles=numTiles[0]*numTiles[1];
+	int ntx=int(numTiles[0]);
+	int nty=int(numTiles[1]);
+	
+	/* Find all wet tiles: */
+	for(numPassTiles=0;numPassTiles<numAllTiles;++numPassTiles)
+		passTiles[numPassTiles]=numPassTiles;
+	runPass(TileScanPass);
+	
+	/* Activate all wet tiles and their neighbors: */
+	unsigned int numActiveTiles=0;
+	for(int ty=0;ty<nty;++ty)
+		for(int tx=0;tx<ntx;++tx)
+			{
+			Tile& tile=tiles[ty*ntx+tx];
+			tile.active=false;
+			for(int y=Math::max(ty-1,0);y<=Math::min(ty+1,nty-1);++y)
+				for(int x=Math::max(tx-1,0);x<=Math::min(tx+1,ntx-1);++x)
+					tile.active=tile.active||tiles[y*ntx+x].wet;
+			tile.timeOld=tile.timeNew=0;
+			tile.minStepSize=Math::Constants<float>::max;
+			if(tile.active)
+				++numActiveTiles;
+			}
+	
+	/* Calculate the temporal derivatives and maximum step sizes of all active tiles and their neighbors: */
+	numPassTiles=0;
+	for(int ty=0;ty<nty;++ty)
+		for(int tx=0;tx<ntx;++tx)
+			{
+			bool needed=false;
+			for(int y=Math::max(ty-1,0);y<=Math::min(ty+1,nty-1);++y)
+				for(int x=Math::max(tx-1,0);x<=Math::min(tx+1,ntx-1);++x)
+					needed=needed||tiles[y*ntx+x].active;
+			if(needed)
+				passTiles[numPassTiles++]=ty*ntx+tx;
+			}
+	runPass(TileStartPass);
+	
+	/* Calculate the base step size as the largest step size allowed by all active tiles, limited to the client-specified range: */
+	float baseStepSize=maxStepSize;
+	if(!forceStepSize)
+		{
+		for(unsigned int i=0;i<numAllTiles;++i)
+			if(tiles[i].active)
+				baseStepSize=Math::min(baseStepSize,tiles[i].minStepSize);
+		}
+	
+	/* Assign each active tile the highest level allowed by its own and its neighbors' maximum step sizes: */
+	for(int ty=0;ty<nty;++ty)
+		for(int tx=0;tx<ntx;++tx)
+			{
+			Tile& tile=tiles[ty*ntx+tx];
+			float limit=maxStepSize;
+			if(!forceStepSize)
+				{
+				for(int y=Math::max(ty-1,0);y<=Math::min(ty+1,nty-1);++y)
+					for(int x=Math::max(tx-1,0);x<=Math::min(tx+1,ntx-1);++x)
+						limit=Math::min(limit,tiles[y*ntx+x].minStepSize);
+				}
+			tile.level=0;
+			while(tile.level<maxTileLevel&&baseStepSize*float(2U<<tile.level)<=limit)
+				++tile.level;
+			}
+	
+	/* Limit the level difference between neighboring active tiles to one: */
+	bool changed=true;
+	while(changed)
+		{
+		changed=false;
+		for(int ty=0;ty<nty;++ty)
+			for(int tx=0;tx<ntx;++tx)
+				{
+				Tile& tile=tiles[ty*ntx+tx];
+				if(tile.active)
+					{
+					for(int y=Math::max(ty-1,0);y<=Math::min(ty+1,nty-1);++y)
+						for(int x=Math::max(tx-1,0);x<=Math::min(tx+1,ntx-1);++x)
+							{
+							const Tile& neighbor=tiles[y*ntx+x];
+							if(neighbor.active&&tile.level>neighbor.level+1)
+								{
+								tile.level=neighbor.level+1;
+								changed=true;
+								}
+							}
+					}
+				}
+		}
+	
+	/* Calculate the cycle length from the highest level of any active tile: */
+	unsigned int cycleLevel=0;
+	for(unsigned int i=0;i<numAllTiles;++i)
+		if(tiles[i].active)
+			cycleLevel=Math::max(cycleLevel,tiles[i].level);
+	unsigned int cycleLength=1U<<cycleLevel;
+	
+	/* Run all base steps of the cycle: */
+	double numCellSteps=0.0;
+	passStepSize=baseStepSize;
+	for(passTime=0;passTime<cycleLength;++passTime)
+		{
+		/* Collect and activate all tiles that start a new step at this base step: */
+		numPassTiles=0;
+		for(unsigned int i=0;i<numAllTiles;++i)
+			{
+			const Tile& tile=tiles[i];
+			if(tile.active&&passTime%(1U<<tile.level)==0)
+				{
+				passTiles[numPassTiles++]=i;
+				numCellSteps+=double(tile.x1-tile.x0)*double(tile.y1-tile.y0);
+				}
+			}
+		runPass(TileActivatePass);
+		
+		/* Advance all collected tiles by one step: */
+		runPass(TileStepPass);
+		}
+	
+	/* Make the cycle conservative by correcting coarser tiles along level boundaries: */
+	correctTileFluxes();
+	for(int i=0;i<3;++i)
+		fillGhostCells(quantity[i]);
+	
+	/* Update the local time stepping statistics: */
+	++localTimeSteppingStats.numCycles;
+	localTimeSteppingStats.numBaseSteps+=double(cycleLength);
+	localTimeSteppingStats.numTileCycles+=double(numAllTiles);
+	localTimeSteppingStats.numActiveTileCycles+=double(numActiveTiles);
+	localTimeSteppingStats.numCellSteps+=numCellSteps;
+	localTimeSteppingStats.numGlobalCellSteps+=double(cycleLength)*double(size[0])*double(size[1]);
+	
+	/* Return the cycle's length: */
+	return baseStepSize*float(cycleLength);
+	}
+
+void WaterTable2CPU::releaseTiles(void)
+	{
+	delete[] tiles;
+	tiles=0;
+	free(tileFluxes);
+	tileFluxes=0;
+	for(int i=0;i<3;++i)
+		{
+		free(quantityOld[i]);
+		quantityOld[i]=0;
+		}
+	delete[] passTiles;
+	passTiles=0;
+	numPassTiles=0;
+	for(unsigned int i=0;i<numBands;++i)
+		{
+		Band& band=bands[i];
+		for(int j=0;j<3;++j)
+			{
+			free(band.patchQuantity[j]);
+			free(band.patchQuantityStar[j]);
+			free(band.patchDerivative[j]);
+			band.patchQuantity[j]=band.patchQuantityStar[j]=band.patchDerivative[j]=0;
+			}
+		}
+	numTiles[0]=numTiles[1]=0;
+	}
+
+void WaterTable2CPU::processBand(unsigned int bandIndex)
+	{
+	Band& band=bands[bandIndex];
+	switch(pass)
+		{
+		case DerivativePass:
+			{
+			GridView q[3],qt[3];
+			for(int i=0;i<3;++i)
+				{
+				q[i]=getGridView(passQuantity[i]);
+				qt[i]=getGridView(derivative[i]);
+				}
+			band.minStepSize=calcDerivative(0,int(band.yBegin),int(size[0]),int(band.yEnd),q,qt,band,0);
+			break;
+			}
+		
+		case EulerStepPass:
+			eulerStep(band);
+			break;
+		
+		case RungeKuttaStepPass:
+			rungeKuttaStep(band);
+			break;
+		
+		case WaterUpdatePass:
+			updateWater(0,int(band.yBegin),int(size[0]),int(band.yEnd),passStepSize);
+			break;
+		
+		case TileScanPass:
+			for(unsigned int i=bandIndex;i<numPassTiles;i+=numBands)
+				scanTile(tiles[passTiles[i]]);
+			break;
+		
+		case TileStartPass:
+			for(unsigned int i=bandIndex;i<numPassTiles;i+=numBands)
+				startTile(tiles[passTiles[i]],band);
+			break;
+		
+		case TileActivatePass:
+			for(unsigned int i=bandIndex;i<numPassTiles;i+=numBands)
+				activateTile(tiles[passTiles[i]]);
+			break;
+		
+		case TileStepPass:
+			for(unsigned int i=bandIndex;i<numPassTiles;i+=numBands)
+				stepTile(tiles[passTiles[i]],band);
+			break;
+		
+		default:
+			;
+		}
+	}
+
+void WaterTable2CPU::runPass(WaterTable2CPU::Pass newPass)
+	{
+	pass=newPass;
+	
+	/* Wake up the worker threads: */
+	if(numBands>1)
+		passBarrier->synchronize();
+	
+	/* Process the first band: */
+	processBand(0);
+	
+	/* Wait for the worker threads to finish their bands: */
+	if(numBands>1)
+		passBarrier->synchronize();
+	}
+
+void* WaterTable2CPU::workerThreadMethod(void)
+	{
+	/* Claim a band: */
+	unsigned int bandIndex;
+	{
+	Threads::Mutex::Lock bandLock(bandMutex);
+	bandIndex=nextWorkerBandIndex;
+	++nextWorkerBandIndex;
+	}
+	
+	while(true)
+		{
+		/* Wait until the calling thread starts a new pass or shuts down: */
+		passBarrier->synchronize();
+		
+		/* Bail out if the water table is being destroyed: */
+		if(pass==ShutdownPass)
+			break;
+		
+		/* Process the band and signal completion: */
+		processBand(bandIndex);
+		passBarrier->synchronize();
+		}
+	
+	return 0;
+	}
+
+WaterTable2CPU::WaterTable2CPU(const Size& sSize,const float sCellSize[2],unsigned int sNumThreads)
+	:size(sSize),stride(sSize[0]+4),
+	 mode(Traditional),
+	 dryBoundary(true),halfPrecision(false),
+	 waterSource(0),
+	 tileSize(0),maxTileLevel(0),dryDepth(0.0f),tiles(0),tileFluxes(0),passTiles(0),numPassTiles(0),
+	 numBands(0),bands(0),nextWorkerBandIndex(1),workerThreads(0),passBarrier(0),
+	 pass(DerivativePass),passQuantity(quantity),passStepSize(0.0f),passAttenuation(1.0f),passTime(0)
+	{
+	/* Initialize the water table cell size: */
+	for(int i=0;i<2;++i)
+		cellSize[i]=sCellSize[i];
+	
+	/* Initialize simulation parameters with the same defaults as WaterTable2: */
+	theta=1.3f;
+	g=9.81f;
+	epsilon=0.01f*Math::max(Math::max(cellSize[0],cellSize[1]),1.0f);
+	maxPropagationSpeed[1]=maxPropagationSpeed[0]=1.0e10f; // Ridiculously large
+	attenuation=127.0f/128.0f;
+	maxStepSize=1.0f;
+	snowLine=1000.0f;
+	snowMelt=0.1f;
+	waterDeposit=0.0f;
+	
+	/* Allocate the bathymetry grids: */
+	size_t numCells=size_t(size[1]+4)*size_t(stride);
+	bathymetry=allocPlane<float>(size_t(size[1]-1)*size_t(size[0]-1));
+	for(int i=0;i<2;++i)
+		faceBathymetry[i]=allocPlane<float>(numCells);
+	cellBathymetry=allocPlane<float>(numCells);
+	
+	/* Allocate the cell-centered grids: */
+	for(int i=0;i<3;++i)
+		{
+		quantity[i]=allocPlane<float>(numCells);
+		quantityStar[i]=allocPlane<float>(numCells);
+		derivative[i]=allocPlane<float>(numCells);
+		quantityOld[i]=0;
+		}
+	numTiles[0]=numTiles[1]=0;
+	snow=allocPlane<float>(numCells);
+	for(int i=0;i<2;++i)
+		properties[i]=allocPlane<float>(numCells);
+	
+	/* Initialize the grids to a flat and dry surface at zero elevation, using PropertyGridCreator's default properties: */
+	size_t numBathymetryVertices=size_t(size[1]-1)*size_t(size[0]-1);
+	for(size_t i=0;i<numBathymetryVertices;++i)
+		bathymetry[i]=0.0f;
+	for(size_t i=0;i<numCells;++i)
+		{
+		faceBathymetry[0][i]=faceBathymetry[1][i]=cellBathymetry[i]=0.0f;
+		for(int j=0;j<3;++j)
+			quantity[j][i]=quantityStar[j][i]=derivative[j][i]=0.0f;
+		snow[i]=0.0f;
+		properties[0][i]=0.01f;
+		properties[1][i]=0.0f;
+		}
+	
+	/* Split the grid into one band of rows per simulation thread: */
+	numBands=sNumThreads;
+	if(numBands<1)
+		numBands=1;
+	if(numBands>size[1])
+		numBands=size[1];
+	bands=new Band[numBands];
+	for(unsigned int i=0;i<numBands;++i)
+		{
+		Band& band=bands[i];
+		band.yBegin=(size[1]*i)/numBands;
+		band.yEnd=(size[1]*(i+1))/numBands;
+		for(int j=0;j<3;++j)
+			{
+			for(int k=0;k<3;++k)
+				band.slopeY[k][j]=allocPlane<float>(size[0]);
+			for(int k=0;k<2;++k)
+				band.fluxY[k][j]=allocPlane<float>(size[0]);
+			band.slopeX[j]=allocPlane<float>(size[0]+2);
+			band.fluxX[j]=allocPlane<float>(size[0]+1);
+			}
+		band.minStepSize=0.0f;
+		for(int j=0;j<3;++j)
+			band.patchQuantity[j]=band.patchQuantityStar[j]=band.patchDerivative[j]=0;
+		}
+	
+	/* Start the worker threads: */
+	if(numBands>1)
+		{
+		passBarrier=new Threads::Barrier(numBands);
+		workerThreads=new Threads::Thread[numBands-1];
+		for(unsigned int i=0;i<numBands-1;++i)
+			workerThreads[i].start(this,&WaterTable2CPU::workerThreadMethod);
+		}
+	}
+
+WaterTable2CPU::~WaterTable2CPU(void)
+	{
+	/* Shut down the worker threads: */
+	if(numBands>1)
+		{
+		pass=ShutdownPass;
+		passBarrier->synchronize();
+		for(unsigned int i=0;i<numBands-1;++i)
+			workerThreads[i].join();
+		delete[] workerThreads;
+		delete passBarrier;
+		}
+	
+	/* Release all allocated buffers: */
+	releaseTiles();
+	for(unsigned int i=0;i<numBands;++i)
+		{
+		Band& band=bands[i];
+		for(int j=0;j<3;++j)
+			{
+			for(int k=0;k<3;++k)
+				free(band.slopeY[k][j]);
+			for(int k=0;k<2;++k)
+				free(band.fluxY[k][j]);
+			free(band.slopeX[j]);
+			free(band.fluxX[j]);
+			}
+		}
+	delete[] bands;
+	free(bathymetry);
+	for(int i=0;i<2;++i)
+		free(faceBathymetry[i]);
+	free(cellBathymetry);
+	for(int i=0;i<3;++i)
+		{
+		free(quantity[i]);
+		free(quantityStar[i]);
+		free(derivative[i]);
+		}
+	free(snow);
+	for(int i=0;i<2;++i)
+		free(properties[i]);
+	free(waterSource);
+	}
+
+void WaterTable2CPU::setMode(WaterTable2CPU::Mode newMode)
+	{
+	mode=newMode;
+	}
+
+void WaterTable2CPU::setAttenuation(float newAttenuation)
+	{
+	attenuation=newAttenuation;
+	}
+
+void WaterTable2CPU::setProperties(float newRoughness,float newAbsorption)
+	{
+	/* Reset the property grids including their ghost cells: */
+	size_t numCells=size_t(size[1]+4)*size_t(stride);
+	for(size_t i=0;i<numCells;++i)
+		{
+		properties[0][i]=newRoughness;
+		properties[1][i]=newAbsorption;
+		}
+	}
+
+void WaterTable2CPU::setPropertyGrid(const float* propertyGrid)
+	{
+	/* De-interleave the given property grid: */
+	const float* pgPtr=propertyGrid;
+	for(int y=0;y<int(size[1]);++y)
+		{
+		float* r=getCell(properties[0],0,y);
+		float* a=getCell(properties[1],0,y);
+		for(int x=0;x<int(size[0]);++x,pgPtr+=2)
+			{
+			r[x]=pgPtr[0];
+			a[x]=pgPtr[1];
+			}
+		}
+	}
+
+void WaterTable2CPU::forceMinStepSize(float newMinStepSize)
+	{
+	/* Calculate the maximum propagation speeds in x and y: */
+	for(int i=0;i<2;++i)
+		maxPropagationSpeed[i]=cellSize[i]/(2.0f*newMinStepSize);
+	}
+
+void WaterTable2CPU::setMaxStepSize(float newMaxStepSize)
+	{
+	maxStepSize=newMaxStepSize;
+	}
+
+void WaterTable2CPU::setSnowLine(float newSnowLine)
+	{
+	snowLine=newSnowLine;
+	}
+
+void WaterTable2CPU::setSnowMelt(float newSnowMelt)
+	{
+	snowMelt=newSnowMelt;
+	}
+
+void WaterTable2CPU::setWaterDeposit(float newWaterDeposit)
+	{
+	waterDeposit=newWaterDeposit;
+	}
+
+void WaterTable2CPU::setDryBoundary(bool newDryBoundary)
+	{
+	dryBoundary=newDryBoundary;
+	}
+
+void WaterTable2CPU::setHalfPrecision(bool newHalfPrecision)
+	{
+	halfPrecision=newHalfPrecision;
+	}
+
+void WaterTable2CPU::setWaterSource(const float* waterSourceGrid)
+	{
+	if(waterSourceGrid!=0)
+		{
+		/* Copy the given water source grid: */
+		if(waterSource==0)
+			waterSource=allocPlane<float>(size_t(size[1]+4)*size_t(stride));
+		const float* wsgPtr=waterSourceGrid;
+		for(int y=0;y<int(size[1]);++y,wsgPtr+=size[0])
+			{
+			float* wsPtr=getCell(waterSource,0,y);
+			memcpy(wsPtr,wsgPtr,size[0]*sizeof(float));
+			if(halfPrecision)
+				for(int x=0;x<int(size[0]);++x)
+					wsPtr[x]=roundToHalf(wsPtr[x]);
+			}
+		}
+	else
+		{
+		/* Remove the water source: */
+		free(waterSource);
+		waterSource=0;
+		}
+	}
+
+void WaterTable2CPU::updateBathymetry(const float* bathymetryGrid)
+	{
+	/* Copy the new bathymetry grid: */
+	int bw=int(size[0])-1;
+	int bh=int(size[1])-1;
+	memcpy(bathymetry,bathymetryGrid,size_t(bh)*size_t(bw)*sizeof(float));
+	
+	/* Calculate the face-centered and cell-centered bathymetry grids including ghost cells, clamping bathymetry grid indices like the shaders' texture samplers: */
+	for(int y=-2;y<bh+3;++y)
+		{
+		const float* b0=bathymetry+size_t(Math::clamp(y-1,0,bh-1))*size_t(bw);
+		const float* b1=bathymetry+size_t(Math::clamp(y,0,bh-1))*size_t(bw);
+		float* fbx=getCell(faceBathymetry[0],0,y);
+		float* fby=getCell(faceBathymetry[1],0,y);
+		float* cb=getCell(cellBathymetry,0,y);
+		for(int x=-2;x<bw+3;++x)
+			{
+			int x0=Math::clamp(x-1,0,bw-1);
+			int x1=Math::clamp(x,0,bw-1);
+			fbx[x]=(b0[x0]+b1[x0])*0.5f;
+			fby[x]=(b0[x0]+b0[x1])*0.5f;
+			
+			/* Update the water surface height to keep the water column height: */
+			float bNew=(b0[x0]+b0[x1]+b1[x0]+b1[x1])*0.25f;
+			if(x>=0&&x<=bw&&y>=0&&y<=bh)
+				{
+				float* q=getCell(quantity[0],x,y);
+				*q=Math::max(*q-cb[x],0.0f)+bNew;
+				}
+			cb[x]=bNew;
+			}
+		}
+	fillGhostCells(quantity[0]);
+	}
+
+void WaterTable2CPU::setWaterLevel(const float* waterGrid)
+	{
+	/* Adapt the given water level grid to the current bathymetry, and reset the partial discharges: */
+	const float* wgPtr=waterGrid;
+	for(int y=0;y<int(size[1]);++y,wgPtr+=size[0])
+		{
+		const float* b=getCell(cellBathymetry,0,y);
+		float* q[3];
+		for(int i=0;i<3;++i)
+			q[i]=getCell(quantity[i],0,y);
+		for(int x=0;x<int(size[0]);++x)
+			{
+			q[0][x]=Math::max(wgPtr[x],b[x]);
+			q[1][x]=q[2][x]=0.0f;
+			}
+		}
+	for(int i=0;i<3;++i)
+		fillGhostCells(quantity[i]);
+	}
+
+void WaterTable2CPU::setLocalTimeStepping(unsigned int newTileSize,unsigned int newMaxTileLevel,float newDryDepth)
+	{
+	/* Release the current tiles: */
+	releaseTiles();
+	
+	/* Set the local time stepping parameters; tiles must be at least four cells wide to keep tile patches within their direct neighbors: */
+	tileSize=newTileSize;
+	if(tileSize!=0&&tileSize<4)
+		tileSize=4;
+	maxTileLevel=Math::min(newMaxTileLevel,7U);
+	dryDepth=newDryDepth;
+	
+	if(tileSize!=0)
+		{
+		/* Split the grid into tiles: */
+		for(int i=0;i<2;++i)
+			numTiles[i]=(size[i]+tileSize-1)/tileSize;
+		unsigned int numAllTiles=numTiles[0]*numTiles[1];
+		tiles=new Tile[numAllTiles];
+		size_t numFluxes=0;
+		for(unsigned int ty=0;ty<numTiles[1];++ty)
+			for(unsigned int tx=0;tx<numTiles[0];++tx)
+				{
+				Tile& tile=tiles[ty*numTiles[0]+tx];
+				tile.x0=int(tx*tileSize);
+				tile.y0=int(ty*tileSize);
+				tile.x1=int(Math::min((tx+1)*tileSize,size[0]));
+				tile.y1=int(Math::min((ty+1)*tileSize,size[1]));
+				tile.wet=tile.active=false;
+				tile.level=0;
+				tile.timeOld=tile.timeNew=0;
+				tile.minStepSize=0.0f;
+				numFluxes+=tile.getNumFluxes()*2;
+				}
+		
+		/* Assign each tile its flux registers: */
+		tileFluxes=allocPlane<float>(numFluxes);
+		float* tfPtr=tileFluxes;
+		for(unsigned int i=0;i<numAllTiles;++i)
+			{
+			Tile& tile=tiles[i];
+			size_t tileNumFluxes=tile.getNumFluxes();
+			tile.startFluxes=tfPtr;
+			tile.fluxRegister=tfPtr+tileNumFluxes;
+			tfPtr+=tileNumFluxes*2;
+			}
+		
+		/* Allocate the saved quantity grid and the per-band tile patches: */
+		size_t numCells=size_t(size[1]+4)*size_t(stride);
+		size_t numPatchCells=size_t(tileSize+8)*size_t(tileSize+8);
+		for(int i=0;i<3;++i)
+			{
+			quantityOld[i]=allocPlane<float>(numCells);
+			memcpy(quantityOld[i],quantity[i],numCells*sizeof(float));
+			}
+		passTiles=new unsigned int[numAllTiles];
+		for(unsigned int i=0;i<numBands;++i)
+			{
+			Band& band=bands[i];
+			for(int j=0;j<3;++j)
+				{
+				band.patchQuantity[j]=allocPlane<float>(numPatchCells);
+				band.patchQuantityStar[j]=allocPlane<float>(numPatchCells);
+				band.patchDerivative[j]=allocPlane<float>(numPatchCells);
+				}
+			}
+		}
+	}
+
+void WaterTable2CPU::readTileMask(unsigned char* buffer) const
+	{
+	unsigned int numAllTiles=numTiles[0]*numTiles[1];
+	for(unsigned int i=0;i<numAllTiles;++i)
+		buffer[i]=tiles[i].active?(unsigned char)(tiles[i].level):255U;
+	}
+
+void WaterTable2CPU::resetLocalTimeSteppingStats(void)
+	{
+	localTimeSteppingStats=LocalTimeSteppingStats();
+	}
+
+float WaterTable2CPU::runSimulationStep(bool forceStepSize)
+	{
+	/* Run a full cycle if local time stepping is enabled: */
+	if(tileSize!=0)
+		return runLocalTimeSteppingCycle(forceStepSize);
+	
+	/*********************************************************************
+	Step 1: Calculate temporal derivative of most recent quantities.
+	*********************************************************************/
+	
+	passQuantity=quantity;
+	runPass(DerivativePass);
+	
+	/* Gather the maximum step size from all bands, and limit it to the client-specified range: */
+	float stepSize=maxStepSize;
+	if(!forceStepSize)
+		{
+		for(unsigned int i=0;i<numBands;++i)
+			stepSize=Math::min(stepSize,bands[i].minStepSize);
+		}
+	
+	/*********************************************************************
+	Step 2: Perform the tentative Euler integration step.
+	*********************************************************************/
+	
+	passStepSize=stepSize;
+	passAttenuation=mode==Traditional?Math::pow(attenuation,stepSize):1.0f;
+	runPass(EulerStepPass);
+	for(int i=0;i<3;++i)
+		fillGhostCells(quantityStar[i]);
+	
+	/*********************************************************************
+	Step 3: Calculate temporal derivative of intermediate quantities.
+	*********************************************************************/
+	
+	passQuantity=quantityStar;
+	runPass(DerivativePass);
+	
+	/*********************************************************************
+	Step 4: Perform the final Runge-Kutta integration step and enforce
+	dry boundaries.
+	*********************************************************************/
+	
+	runPass(RungeKuttaStepPass);
+	
+	if(waterDeposit!=0.0f||waterSource!=0)
+		{
+		/*******************************************************************
+		Step 5: Add or remove water and snow.
+		*******************************************************************/
+		
+		runPass(WaterUpdatePass);
+		}
+	
+	for(int i=0;i<3;++i)
+		fillGhostCells(quantity[i]);
+	
+	/* Return the Runge-Kutta step's step size: */
+	return stepSize;
+	}
+
+void WaterTable2CPU::readBathymetryGrid(float* buffer) const
+	{
+	memcpy(buffer,bathymetry,size_t(size[1]-1)*size_t(size[0]-1)*sizeof(float));
+	}
+
+void WaterTable2CPU::readSnowGrid(float* buffer) const
+	{
+	float* bPtr=buffer;
+	for(int y=0;y<int(size[1]);++y,bPtr+=size[0])
+		memcpy(bPtr,getCell(snow,0,y),size[0]*sizeof(float));
+	}
+
+void WaterTable2CPU::readQuantityGrid(unsigned int numComponents,float* buffer) const
+	{
+	float* bPtr=buffer;
+	for(int y=0;y<int(size[1]);++y)
+		{
+		const float* q[3];
+		for(int i=0;i<3;++i)
+			q[i]=getCell(quantity[i],0,y);
+		for(int x=0;x<int(size[0]);++x)
+			for(unsigned int i=0;i<numComponents;++i,++bPtr)
+				*bPtr=q[i][x];
+		}
+	}
+
+double WaterTable2CPU::calcWaterVolume(void) const
+	{
+	/* Accumulate the water column heights of all cells in double precision: */
+	double volume=0.0;
+	for(int y=0;y<int(size[1]);++y)
+		{
+		const float* w=getCell(quantity[0],0,y);
+		const float* b=getCell(cellBathymetry,0,y);
+		double rowVolume=0.0;
+		for(int x=0;x<int(size[0]);++x)
+			rowVolume+=double(w[x])-double(b[x]);
+		volume+=rowVolume;
+		}
+	
+	return volume*double(cellSize[0])*double(cellSize[1]);
+	}
+
+void WaterTable2CPU::calcStats(float statsDryDepth,WaterStats& stats) const
+	{
+	/* Accumulate the statistics of all cells, summing water column heights in double precision: */
+	double volume=0.0;
+	float maxSpeed=0.0f;
+	unsigned int numWetCells=0;
+	float maxDepth=0.0f;
+	for(int y=0;y<int(size[1]);++y)
+		{
+		const float* q[3];
+		for(int i=0;i<3;++i)
+			q[i]=getCell(quantity[i],0,y);
+		const float* b=getCell(cellBathymetry,0,y);
+		double rowVolume=0.0;
+		for(int x=0;x<int(size[0]);++x)
+			{
+			/* Calculate the cell's water column height and desingularized flow velocity: */
+			float h=q[0][x]-b[x];
+			rowVolume+=double(q[0][x])-double(b[x]);
+			float uvFactor=calcUvFactor(Math::max(h,0.0f),epsilon);
+			float u=q[1][x]*uvFactor;
+			float v=q[2][x]*uvFactor;
+			
+			maxSpeed=Math::max(maxSpeed,Math::sqrt(u*u+v*v));
+			if(h>statsDryDepth)
+				++numWetCells;
+			maxDepth=Math::max(maxDepth,h);
+			}
+		volume+=rowVolume;
+		}
+	
+	stats.volume=volume*double(cellSize[0])*double(cellSize[1]);
+	stats.maxSpeed=maxSpeed;
+	stats.numWetCells=numWetCells;
+	stats.maxDepth=maxDepth;
+	}
@@ -0,0 +1,332 @@
+/***********************************************************************
+WaterTable2CPU - Class to simulate water flowing over a surface on the
+CPU, using the same Kurganov-Petrova scheme for the Saint-Venant system
+of partial differential equations as the GPU-based WaterTable2 class,
+for headless validation and benchmarking.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef WATERTABLE2CPU_INCLUDED
+#define WATERTABLE2CPU_INCLUDED
+
+#include <stddef.h>
+#include <Threads/Mutex.h>
+#include <Threads/Thread.h>
+#include <Threads/Barrier.h>
+
+#include "Types.h"
+#include "WaterStats.h"
+
+class WaterTable2CPU
+	{
+	/* Embedded classes: */
+	public:
+	enum Mode // Enumerated type for water simulation modes; same as WaterTable2::Mode
+		{
+		Traditional=0, // Water simulation mode using simple attenuation
+		Engineering // Water simulation mode using per-cell roughness coefficients and absorption rates
+		};
+	
+	struct LocalTimeSteppingStats // Structure accumulating statistics of local time stepping cycles
+		{
+		/* Elements: */
+		public:
+		unsigned int numCycles; // Number of completed cycles
+		double numBaseSteps; // Total number of base steps in all cycles, i.e., the number of steps global time stepping would have taken
+		double numTileCycles; // Total number of tiles summed over all cycles
+		double numActiveTileCycles; // Total number of tiles that were not skipped, summed over all cycles
+		double numCellSteps; // Total number of cell updates performed by all tile steps
+		double numGlobalCellSteps; // Total number of cell updates global time stepping would have performed
+		
+		/* Constructors and destructors: */
+		LocalTimeSteppingStats(void)
+			:numCycles(0),numBaseSteps(0.0),
+			 numTileCycles(0.0),numActiveTileCycles(0.0),
+			 numCellSteps(0.0),numGlobalCellSteps(0.0)
+			{
+			}
+		};
+	
+	private:
+	enum Pass // Enumerated type for simulation passes run on all bands in parallel
+		{
+		DerivativePass, // Calculates the temporal derivative of the pass quantity grid and the maximum step size
+		EulerStepPass, // Performs the tentative Euler integration step
+		RungeKuttaStepPass, // Performs the final Runge-Kutta integration step and enforces dry boundaries
+		WaterUpdatePass, // Adds or removes water and snow
+		TileScanPass, // Checks the pass tiles for water, water sources, and snow
+		TileStartPass, // Calculates the temporal derivatives and maximum step sizes of the pass tiles at the beginning of a local time stepping cycle
+		TileActivatePass, // Saves the quantities of the pass tiles at the beginning of their next steps
+		TileStepPass, // Advances the pass tiles by one step of their own step sizes
+		ShutdownPass // Shuts down the worker threads
+		};
+	
+	struct Band // Structure describing a horizontal band of grid rows processed by one simulation thread
+		{
+		/* Elements: */
+		public:
+		unsigned int yBegin,yEnd; // Range of grid rows in the band
+		float* slopeY[3][3]; // Rolling buffers of y-direction reconstruction offsets for three consecutive rows, per conserved quantity component
+		float* fluxY[2][3]; // Rolling buffers of y-direction fluxes across the lower and upper faces of the current row, per component
+		float* slopeX[3]; // Buffers of x-direction reconstruction offsets for the current row and one ghost cell on either side, per component
+		float* fluxX[3]; // Buffers of x-direction fluxes across all vertical faces of the current row, per component
+		float minStepSize; // Maximum step size allowed by all faces processed by the band in the most recent derivative pass
+		float* patchQuantity[3]; // Conserved quantities around the tile currently stepped by the band, covering four cells on each side
+		float* patchQuantityStar[3]; // Intermediate conserved quantities around the tile currently stepped by the band
+		float* patchDerivative[3]; // Temporal derivatives around the tile currently stepped by the band
+		};
+	
+	struct GridView // Structure to address a cell-centered grid or a grid patch by cell indices
+		{
+		/* Elements: */
+		public:
+		float* base; // Pointer to the cell at the base index
+		int x0,y0; // Index of the base cell
+		ptrdiff_t stride; // Row stride of the grid or grid patch
+		
+		/* Constructors and destructors: */
+		GridView(void)
+			{
+			}
+		GridView(float* sBase,int sX0,int sY0,ptrdiff_t sStride)
+			:base(sBase),x0(sX0),y0(sY0),stride(sStride)
+			{
+			}
+		
+		/* Methods: */
+		float* getCell(int x,int y) const // Returns a pointer to the cell of the given index
+			{
+			return base+(ptrdiff_t(y)-ptrdiff_t(y0))*stride+(ptrdiff_t(x)-ptrdiff_t(x0));
+			}
+		};
+	
+	struct Tile // Structure describing a rectangular tile of cells that is advanced with its own step size during local time stepping
+		{
+		/* Elements: */
+		public:
+		int x0,y0,x1,y1; // Range of cells covered by the tile
+		bool wet; // Flag whether the tile contained water, or water sources or snow, at the beginning of the current cycle
+		bool active; // Flag whether the tile is advanced during the current cycle, i.e., whether it or any of its neighbors is wet
+		unsigned int level; // The tile's time stepping level; the tile advances in steps of 2^level base steps
+		unsigned int timeOld,timeNew; // Beginning and end of the tile's current step in base steps since the beginning of the current cycle
+		float minStepSize; // Maximum step size allowed by all faces of the tile at the beginning of the current cycle
+		float* startFluxes; // Fluxes across the tile's boundary faces at the beginning of the current cycle, in the same layout as fluxRegister
+		float* fluxRegister; // Fluxes across the tile's west, east, south, and north boundary faces integrated over the current cycle, with three interleaved components per face
+		
+		/* Methods: */
+		size_t getNumFluxes(void) const // Returns the number of flux values in the tile's flux registers
+			{
+			return size_t(6*((x1-x0)+(y1-y0)));
+			}
+		float* getSide(float* fluxes,int side) const // Returns the part of the given flux register corresponding to the given tile side (0: west, 1: east, 2: south, 3: north)
+			{
+			int height=y1-y0;
+			return fluxes+(side<2?side*3*height:6*height+(side-2)*3*(x1-x0));
+			}
+		};
+	
+	struct FluxRecorder // Structure to accumulate scaled fluxes across the boundary faces of a tile during a derivative calculation
+		{
+		/* Elements: */
+		public:
+		int x0,y0,x1,y1; // Range of cells covered by the tile
+		float scale; // Factor by which fluxes are scaled before being accumulated
+		float* sides[4]; // Accumulated fluxes across the tile's west, east, south, and north faces
+		
+		/* Methods: */
+		void recordFluxY(int rowX0,int y,int w,float* const flux[3]) const; // Accumulates those fluxes across the south faces of the given row segment that cross the tile's south or north faces
+		void recordFluxX(int rowX0,int y,int w,float* const flux[3]) const; // Accumulates those fluxes across the vertical faces of the given row segment that cross the tile's west or east faces
+		};
+	
+	/* Elements: */
+	Size size; // Width and height of water table in cells
+	float cellSize[2]; // Width and height of water table cells in world coordinate units
+	unsigned int stride; // Row stride of all cell-centered grids, which carry a layer of two ghost cells around their boundary
+	float theta; // Coefficient for minmod flux-limiting differential operator
+	float g; // Gravitiational acceleration constant
+	float epsilon; // Coefficient for desingularizing division operator
+	float maxPropagationSpeed[2]; // Maximum propagation speeds in x and y to guarantee minimum step size
+	Mode mode; // Current water simulation mode
+	float attenuation; // Attenuation factor for partial discharges
+	float maxStepSize; // Maximum step size for each Runge-Kutta integration step
+	float snowLine; // The elevation of the snow line relative to the base plane
+	float snowMelt; // The rate of snow melt in elevation units per second
+	float waterDeposit; // A fixed amount of water added at every iteration of the flow simulation, for evaporation etc.
+	bool dryBoundary; // Flag whether to enforce dry boundary conditions at the end of each simulation step
+	bool halfPrecision; // Flag whether temporal derivatives and water sources are rounded to half precision to emulate FP16 texture storage
+	float* bathymetry; // The vertex-centered bathymetry grid of grid size minus 1
+	float* faceBathymetry[2]; // Bathymetry elevations at the centers of the west and south faces of each cell, including ghost cells
+	float* cellBathymetry; // Bathymetry elevations at the cell centers, including ghost cells
+	float* quantity[3]; // The cell-centered conserved quantity grid (w, hu, hv), one plane per component, including ghost cells
+	float* quantityStar[3]; // The intermediate conserved quantity grid produced by the Euler step
+	float* derivative[3]; // The cell-centered temporal derivative grid
+	float* snow; // The cell-centered snow height grid
+	float* properties[2]; // The cell-centered roughness coefficient and absorption rate grids used in engineering mode
+	float* waterSource; // The cell-centered water source grid in elevation units per second, or null
+	unsigned int tileSize; // Width and height of tiles for local time stepping, or zero if local time stepping is disabled
+	unsigned int maxTileLevel; // Maximum time stepping level of any tile
+	float dryDepth; // Water column height up to which a cell is considered dry for local time stepping
+	unsigned int numTiles[2]; // Number of tiles in x and y
+	Tile* tiles; // Array of tiles in row-major order
+	float* tileFluxes; // Storage for all tiles' flux registers
+	float* quantityOld[3]; // The cell-centered conserved quantity grid at the beginning of each tile's current step
+	unsigned int* passTiles; // Indices of the tiles processed by the current tile pass
+	unsigned int numPassTiles; // Number of tiles processed by the current tile pass
+	LocalTimeSteppingStats localTimeSteppingStats; // Statistics of local time stepping cycles
+	unsigned int numBands; // Number of horizontal bands into which the grid is split, equal to the number of simulation threads
+	Band* bands; // Array of horizontal bands
+	Threads::Mutex bandMutex; // Mutex protecting the index of the next band to be claimed by a starting worker thread
+	unsigned int nextWorkerBandIndex; // Index of the band to be claimed by the next starting worker thread
+	Threads::Thread* workerThreads; // Array of worker threads processing all bands but the first, which is processed by the calling thread
+	Threads::Barrier* passBarrier; // Barrier to synchronize the calling thread and the worker threads at the beginning and end of each pass
+	Pass pass; // The currently running pass
+	float** passQuantity; // Conserved quantity grid read by the current derivative pass
+	float passStepSize; // Step size used by the current integration or water update pass
+	float passAttenuation; // Attenuation factor for partial discharges used by the current integration pass
+	unsigned int passTime; // Index of the current base step within the current local time stepping cycle
+	
+	/* Private methods: */
+	float* getCell(float* grid,int x,int y) const // Returns a pointer to the cell of the given index in the given cell-centered grid; indices can reach into the ghost cells
+		{
+		return grid+(ptrdiff_t(y)+2)*ptrdiff_t(stride)+(ptrdiff_t(x)+2);
+		}
+	void fillGhostCells(float* grid) const; // Copies the outermost layer of interior cells of the given cell-centered grid into its ghost cells
+	GridView getGridView(float* grid) const // Returns a view of the given cell-centered grid
+		{
+		return GridView(getCell(grid,0,0),0,0,ptrdiff_t(stride));
+		}
+	void calcSlopeYRow(const GridView q[3],int x0,int y,int w,float* slope[3]) const; // Calculates y-direction reconstruction offsets for the row segment of the given width starting at the given cell
+	void calcSlopeXRow(const GridView q[3],int x0,int y,int w,float* slope[3]) const; // Calculates x-direction reconstruction offsets for the row segment of the given width starting at the given cell, including one cell on either side
+	float calcFluxYRow(const GridView q[3],int x0,int y,int w,float* const lowerSlope[3],float* const upperSlope[3],float* flux[3]) const; // Calculates fluxes across the south faces of the given row segment; returns the maximum step size allowed by all faces
+	float calcFluxXRow(const GridView q[3],int x0,int y,int w,float* const slope[3],float* flux[3]) const; // Calculates fluxes across all vertical faces of the given row segment; returns the maximum step size allowed by all faces
+	void calcDerivativeRow(const GridView quantity[3],const GridView derivative[3],int x0,int y,int w,float* const fluxX[3],float* const lowerFluxY[3],float* const upperFluxY[3]) const; // Calculates the temporal derivative of the given row segment
+	float calcDerivative(int x0,int y0,int x1,int y1,const GridView q[3],const GridView qt[3],Band& band,const FluxRecorder* recorder) const; // Calculates the temporal derivative of the given rectangle of cells using the given band's buffers, and optionally records fluxes across a tile's boundary faces; returns the maximum step size allowed by all faces
+	void eulerStep(Band& band); // Runs the Euler step pass on the given band
+	void rungeKuttaStep(Band& band); // Runs the Runge-Kutta step pass on the given band
+	void updateWater(int x0,int y0,int x1,int y1,float stepSize); // Adds or removes water and snow in the given rectangle of cells for the given step size
+	void initFluxRecorder(const Tile& tile,float* fluxes,float scale,FluxRecorder& recorder) const; // Sets up a flux recorder accumulating into the given flux register of the given tile
+	void scanTile(Tile& tile) const; // Checks whether the given tile is wet
+	void startTile(Tile& tile,Band& band); // Calculates the given tile's temporal derivative, maximum step size, and boundary fluxes at the beginning of a cycle
+	void activateTile(Tile& tile); // Saves the given tile's quantities at the beginning of its next step
+	void assemblePatch(const Tile& tile,const GridView patch[3]) const; // Assembles the conserved quantities of the given tile and four cells around it at the current base step into the given patch
+	void fillPatchGhostCells(const GridView patch[3],int ix0,int iy0,int ix1,int iy1,int gx0,int gy0,int gx1,int gy1) const; // Replicates the outermost cells of the given interior rectangle of the given patch into the given larger rectangle
+	void stepTile(Tile& tile,Band& band); // Advances the given tile by one step of its own step size
+	void correctTileFluxes(void); // Corrects the quantities of coarser tiles along level boundaries with the fluxes of their finer neighbors
+	float runLocalTimeSteppingCycle(bool forceStepSize); // Advances all tiles by one local time stepping cycle; returns the length of the cycle
+	void releaseTiles(void); // Releases all tiles and buffers used for local time stepping
+	void processBand(unsigned int bandIndex); // Runs the current pass on the band of the given index
+	void runPass(Pass newPass); // Runs the given pass on all bands and waits for it to finish
+	void* workerThreadMethod(void); // Method for the worker threads
+	
+	/* Constructors and destructors: */
+	public:
+	WaterTable2CPU(const Size& sSize,const float sCellSize[2],unsigned int sNumThreads); // Creates a water table of the given size in cells and cell size, using the given number of simulation threads
+	private:
+	WaterTable2CPU(const WaterTable2CPU& source); // Prohibit copy constructor
+	WaterTable2CPU& operator=(const WaterTable2CPU& source); // Prohibit assignment operator
+	public:
+	~WaterTable2CPU(void);
+	
+	/* Methods: */
+	const Size& getSize(void) const // Returns the size of the water table
+		{
+		return size;
+		}
+	const float* getCellSize(void) const // Returns the water table's cell size
+		{
+		return cellSize;
+		}
+	unsigned int getNumThreads(void) const // Returns the number of simulation threads
+		{
+		return numBands;
+		}
+	Mode getMode(void) const // Returns the current water simulation mode
+		{
+		return mode;
+		}
+	float getAttenuation(void) const // Returns the attenuation factor for partial discharges
+		{
+		return attenuation;
+		}
+	bool getDryBoundary(void) const // Returns true if dry boundaries are enforced after every simulation step
+		{
+		return dryBoundary;
+		}
+	void setMode(Mode newMode); // Sets the water simulation mode
+	void setAttenuation(float newAttenuation); // Sets the attenuation factor for partial discharges
+	void setProperties(float newRoughness,float newAbsorption); // Globally resets the property grid to the given roughness coefficient and absorption rate
+	void setPropertyGrid(const float* propertyGrid); // Sets the property grid from a cell-centered grid of interleaved roughness coefficients and absorption rates
+	void forceMinStepSize(float newMinStepSize); // Forces the given minimum step size for all subsequent integration steps by limiting cell fluxes
+	void setMaxStepSize(float newMaxStepSize); // Sets the maximum step size for all subsequent integration steps
+	float getSnowLine(void) const // Returns the elevation of the snow line relative to the base plane
+		{
+		return snowLine;
+		}
+	void setSnowLine(float newSnowLine); // Sets the elevation of the snow line relative to the base plane
+	float getSnowMelt(void) const // Returns the snow melt rate in elevation units per second
+		{
+		return snowMelt;
+		}
+	void setSnowMelt(float newSnowMelt); // Sets the snow melt rate in elevation units per second
+	float getWaterDeposit(void) const // Returns the current amount of water deposited on every simulation step
+		{
+		return waterDeposit;
+		}
+	void setWaterDeposit(float newWaterDeposit); // Sets the amount of deposited water
+	void setDryBoundary(bool newDryBoundary); // Enables or disables enforcement of dry boundaries
+	bool getHalfPrecision(void) const // Returns true if derivatives and auxiliary grids are stored at half precision
+		{
+		return halfPrecision;
+		}
+	void setHalfPrecision(bool newHalfPrecision); // Enables or disables half precision storage of derivatives and auxiliary grids; conserved quantities remain at single precision
+	void setWaterSource(const float* waterSourceGrid); // Sets a cell-centered grid of water amounts added (or removed, if negative) per second, replacing WaterTable2's render functions; removes the water source if null
+	void updateBathymetry(const float* bathymetryGrid); // Updates the bathymetry with a vertex-centered elevation grid of grid size minus 1, keeping the water column heights
+	void setWaterLevel(const float* waterGrid); // Sets the current water level to the given grid, and resets flux components to zero
+	void setLocalTimeStepping(unsigned int newTileSize,unsigned int newMaxTileLevel,float newDryDepth); // Enables local time stepping on square tiles of the given size that advance in steps of up to 2^newMaxTileLevel base steps, skipping tiles whose neighborhoods hold no water deeper than the given depth; disables local time stepping if tile size is zero
+	unsigned int getTileSize(void) const // Returns the tile size for local time stepping, or zero if local time stepping is disabled
+		{
+		return tileSize;
+		}
+	Size getTileGridSize(void) const // Returns the number of local time stepping tiles in x and y
+		{
+		return Size(numTiles[0],numTiles[1]);
+		}
+	void readTileMask(unsigned char* buffer) const; // Reads the tile activity mask of the most recent local time stepping cycle into the given buffer; holds each tile's time stepping level, or 255 for skipped dry tiles
+	const LocalTimeSteppingStats& getLocalTimeSteppingStats(void) const // Returns statistics of local time stepping cycles since the last reset
+		{
+		return localTimeSteppingStats;
+		}
+	void resetLocalTimeSteppingStats(void); // Resets local time stepping statistics
+	float runSimulationStep(bool forceStepSize); // Runs a water flow simulation step, or a full cycle if local time stepping is enabled, always uses maxStepSize if flag is true (may lead to instability); returns simulated time advanced
+	void readBathymetryGrid(float* buffer) const; // Reads the current vertex-centered bathymetry grid into the given buffer
+	void readSnowGrid(float* buffer) const; // Reads the current snow height grid into the given buffer
+	void readQuantityGrid(unsigned int numComponents,float* buffer) const; // Reads the first one (water level) or all three components of the current conserved quantity grid into the given buffer, interleaved
+	double calcWaterVolume(void) const; // Returns the total volume of water on the water table
+	void calcStats(float statsDryDepth,WaterStats& stats) const; // Calculates health statistics of the current simulation state, counting cells with water deeper than the given depth as wet; reference for WaterTable2's GPU reduction
+	Size getBathymetrySize(void) const // Returns the width or height of the bathymetry grid
+		{
+		return Size(size[0]-1,size[1]-1);
+		}
+	unsigned int getBathymetrySize(int index) const // Ditto
+		{
+		return size[index]-1;
+		}
+	};
+
+#endif
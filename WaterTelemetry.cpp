@@ -0,0 +1,147 @@
+/***********************************************************************
+WaterTelemetry - Class to keep a rolling log of the water flow
+simulation's per-frame step counts, time deficits, and health
+statistics, and to report summaries of the log.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "WaterTelemetry.h"
+
+#include <iomanip>
+#include <IO/OpenFile.h>
+#include <IO/OStream.h>
+#include <Math/Math.h>
+
+/*******************************
+Methods of class WaterTelemetry:
+*******************************/
+
+WaterTelemetry::WaterTelemetry(void)
+	:nextRecordIndex(0),numRecords(0),
+	 unstable(false)
+	{
+	}
+
+void WaterTelemetry::simulationRun(double time,unsigned int numSteps,float timeDeficit)
+	{
+	/* Start a new record in the ring buffer, overwriting the oldest one: */
+	Record& record=records[nextRecordIndex];
+	record.time=time;
+	record.numSteps=numSteps;
+	record.timeDeficit=timeDeficit;
+	record.statsValid=false;
+	nextRecordIndex=(nextRecordIndex+1)%windowSize;
+	if(numRecords<windowSize)
+		++numRecords;
+	}
+
+void WaterTelemetry::statsRetrieved(const WaterStats& stats)
+	{
+	/* Attach the statistics to the most recent record: */
+	if(numRecords>0)
+		{
+		Record& record=records[(nextRecordIndex+windowSize-1)%windowSize];
+		record.statsValid=true;
+		record.stats=stats;
+		}
+	
+	/* Check for non-finite statistics, which indicate that the simulation blew up: */
+	if(!unstable&&!(Math::abs(stats.volume)<1.0e30&&stats.maxSpeed<1.0e30f))
+		{
+		std::cerr<<"Water simulation became unstable; total water volume "<<stats.volume<<", maximum flow speed "<<stats.maxSpeed<<std::endl;
+		unstable=true;
+		}
+	}
+
+void WaterTelemetry::printStatistics(std::ostream& os)
+	{
+	/* Summarize all records in order of arrival: */
+	unsigned int totalSteps=0;
+	unsigned int maxSteps=0;
+	unsigned int numDeficitFrames=0;
+	double totalDeficit=0.0;
+	const Record* firstStats=0;
+	const Record* lastStats=0;
+	float maxSpeed=0.0f;
+	unsigned int recordIndex=(nextRecordIndex+windowSize-numRecords)%windowSize;
+	for(unsigned int i=0;i<numRecords;++i,recordIndex=(recordIndex+1)%windowSize)
+		{
+		const Record& r=records[recordIndex];
+		totalSteps+=r.numSteps;
+		maxSteps=Math::max(maxSteps,r.numSteps);
+		if(r.timeDeficit>0.0f)
+			{
+			++numDeficitFrames;
+			totalDeficit+=double(r.timeDeficit);
+			}
+		if(r.statsValid)
+			{
+			if(firstStats==0)
+				firstStats=&r;
+			lastStats=&r;
+			maxSpeed=Math::max(maxSpeed,r.stats.maxSpeed);
+			}
+		}
+	
+	/* Print the summary: */
+	std::ios::fmtflags oldFlags=os.flags();
+	std::streamsize oldPrecision=os.precision();
+	os<<"Water simulation over last "<<numRecords<<" frames:"<<std::endl;
+	if(numRecords>0)
+		{
+		os<<std::fixed<<std::setprecision(2);
+		os<<"  Steps per frame: "<<double(totalSteps)/double(numRecords)<<" mean, "<<maxSteps<<" max"<<std::endl;
+		os<<std::setprecision(4);
+		os<<"  Frames out of time: "<<numDeficitFrames<<", "<<totalDeficit<<" s of simulation time dropped"<<std::endl;
+		}
+	if(lastStats!=0)
+		{
+		os<<std::setprecision(4);
+		os<<"  Water volume: "<<lastStats->stats.volume;
+		if(firstStats!=lastStats&&firstStats->stats.volume!=0.0)
+			os<<", "<<(lastStats->stats.volume-firstStats->stats.volume)*100.0/firstStats->stats.volume<<"% change over "<<lastStats->time-firstStats->time<<" s";
+		os<<std::endl;
+		os<<"  Maximum flow speed: "<<lastStats->stats.maxSpeed<<", "<<maxSpeed<<" max over log"<<std::endl;
+		os<<"  Wet cells: "<<lastStats->stats.numWetCells<<std::endl;
+		os<<"  Maximum water depth: "<<lastStats->stats.maxDepth<<std::endl;
+		}
+	else
+		os<<"  No health statistics; enable them via the waterStatsInterval setting"<<std::endl;
+	os.flags(oldFlags);
+	os.precision(oldPrecision);
+	}
+
+void WaterTelemetry::writeCSVFile(const char* fileName)
+	{
+	/* Write one line per frame, leaving the statistics of frames without statistics empty: */
+	IO::OStream csvFile(IO::openFile(fileName,IO::File::WriteOnly));
+	csvFile<<"Time,NumSteps,TimeDeficit,Volume,MaxSpeed,NumWetCells,MaxDepth"<<std::endl;
+	csvFile<<std::setprecision(9);
+	unsigned int recordIndex=(nextRecordIndex+windowSize-numRecords)%windowSize;
+	for(unsigned int i=0;i<numRecords;++i,recordIndex=(recordIndex+1)%windowSize)
+		{
+		const Record& r=records[recordIndex];
+		csvFile<<r.time<<','<<r.numSteps<<','<<r.timeDeficit;
+		if(r.statsValid)
+			csvFile<<','<<r.stats.volume<<','<<r.stats.maxSpeed<<','<<r.stats.numWetCells<<','<<r.stats.maxDepth;
+		else
+			csvFile<<",,,,";
+		csvFile<<std::endl;
+		}
+	}
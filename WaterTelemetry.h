@@ -0,0 +1,68 @@
+/***********************************************************************
+WaterTelemetry - Class to keep a rolling log of the water flow
+simulation's per-frame step counts, time deficits, and health
+statistics, and to report summaries of the log.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef WATERTELEMETRY_INCLUDED
+#define WATERTELEMETRY_INCLUDED
+
+#include <iostream>
+
+#include "WaterStats.h"
+
+class WaterTelemetry
+	{
+	/* Embedded classes: */
+	private:
+	struct Record // Structure holding the telemetry of a single frame or simulation tick
+		{
+		/* Elements: */
+		public:
+		double time; // Application time at which the simulation was run
+		unsigned int numSteps; // Number of simulation steps run
+		float timeDeficit; // Amount of simulation time that could not be covered within the maximum number of steps
+		bool statsValid; // Flag whether health statistics arrived during this frame
+		WaterStats stats; // Health statistics that arrived during this frame
+		};
+	
+	/* Elements: */
+	static const unsigned int windowSize=1024; // Number of most recent frames kept in the rolling log
+	Record records[windowSize]; // Ring buffer of the most recent frames
+	unsigned int nextRecordIndex; // Index of the ring buffer slot to be used by the next frame
+	unsigned int numRecords; // Number of valid records in the ring buffer
+	bool unstable; // Flag whether the simulation has been reported as unstable
+	
+	/* Constructors and destructors: */
+	public:
+	WaterTelemetry(void); // Creates an empty telemetry log
+	private:
+	WaterTelemetry(const WaterTelemetry& source); // Prohibit copy constructor
+	WaterTelemetry& operator=(const WaterTelemetry& source); // Prohibit assignment operator
+	public:
+	
+	/* Methods: */
+	void simulationRun(double time,unsigned int numSteps,float timeDeficit); // Logs a frame or tick that ran the given number of simulation steps at the given application time, falling short of its simulation time by the given deficit
+	void statsRetrieved(const WaterStats& stats); // Attaches the given health statistics to the most recent frame; warns once if they indicate an unstable simulation
+	void printStatistics(std::ostream& os); // Prints a summary of step counts, time deficits, and health statistics in the rolling log to the given stream
+	void writeCSVFile(const char* fileName); // Writes all frames in the rolling log to a CSV file of the given name
+	};
+
+#endif
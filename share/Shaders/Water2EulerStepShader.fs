@@ -1,6 +1,6 @@
 /***********************************************************************
 Water2EulerStepShader - Shader to perform an Euler integration step.
-Copyright (c) 2012 Oliver Kreylos
+Copyright (c) 2012-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -21,17 +21,20 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #extension GL_ARB_texture_rectangle : enable
 
-uniform float stepSize;
+uniform sampler2DRect stepSizeSampler;
 uniform float attenuation;
 uniform sampler2DRect quantitySampler;
 uniform sampler2DRect derivativeSampler;
 
 void main()
 	{
+	/* Retrieve the step size calculated on the GPU: */
+	float stepSize=texture2DRect(stepSizeSampler,vec2(0.5,0.5)).r;
+	
 	/* Calculate the Euler step: */
 	vec3 q=texture2DRect(quantitySampler,gl_FragCoord.xy).rgb;
 	vec3 qt=texture2DRect(derivativeSampler,gl_FragCoord.xy).rgb;
 	vec3 newQ=q+qt*stepSize;
-	newQ.yz*=attenuation;
+	newQ.yz*=pow(attenuation,stepSize);
 	gl_FragColor=vec4(newQ,0.0);
 	}
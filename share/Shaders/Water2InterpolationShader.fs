@@ -0,0 +1,38 @@
+/***********************************************************************
+Water2InterpolationShader - Shader to blend the conserved quantity grids
+of two consecutive simulation ticks for rendering.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform float weight;
+uniform sampler2DRect previousQuantitySampler;
+uniform sampler2DRect quantitySampler;
+
+void main()
+	{
+	/* Get the previous and current conserved quantities at the cell center: */
+	vec3 q0=texture2DRect(previousQuantitySampler,gl_FragCoord.xy).rgb;
+	vec3 q1=texture2DRect(quantitySampler,gl_FragCoord.xy).rgb;
+	
+	/* Blend the conserved quantities: */
+	gl_FragColor=vec4(mix(q0,q1,weight),0.0);
+	}
@@ -2,7 +2,7 @@
 Water2MaxStepSizeShader - Shader to compute the maximum step size for a
 subsequent Runge-Kutta integration step by reducing the maximum step
 size texture.
-Copyright (c) 2012 Oliver Kreylos
+Copyright (c) 2012-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #extension GL_ARB_texture_rectangle : enable
 
 uniform vec2 fullTextureSize;
+uniform float maxStepSize;
 uniform sampler2DRect maxStepSizeSampler;
 
 void main()
@@ -32,14 +33,14 @@ void main()
 	vec2 frag=gl_FragCoord.xy*2.0-vec2(0.5,0.5);
 	
 	/* Accumulate the minimum value of the 2x2 tile: */
-	float maxStepSize=texture2DRect(maxStepSizeSampler,frag).r;
+	float stepSize=texture2DRect(maxStepSizeSampler,frag).r;
 	if(frag.x<fullTextureSize.x)
-		maxStepSize=min(maxStepSize,texture2DRect(maxStepSizeSampler,vec2(frag.x+1.0,frag.y)).r);
+		stepSize=min(stepSize,texture2DRect(maxStepSizeSampler,vec2(frag.x+1.0,frag.y)).r);
 	if(frag.y<fullTextureSize.y)
-		maxStepSize=min(maxStepSize,texture2DRect(maxStepSizeSampler,vec2(frag.x,frag.y+1.0)).r);
+		stepSize=min(stepSize,texture2DRect(maxStepSizeSampler,vec2(frag.x,frag.y+1.0)).r);
 	if(frag.x<fullTextureSize.x&&frag.y<fullTextureSize.y)
-		maxStepSize=min(maxStepSize,texture2DRect(maxStepSizeSampler,vec2(frag.x+1.0,frag.y+1.0)).r);
+		stepSize=min(stepSize,texture2DRect(maxStepSizeSampler,vec2(frag.x+1.0,frag.y+1.0)).r);
 	
-	/* Assign the maximum of the 2x2 tile to the result frame buffer: */
-	gl_FragData[0]=vec4(maxStepSize,0.0,0.0,0.0);
+	/* Limit the step size to the client-specified maximum and assign it to the result frame buffer: */
+	gl_FragData[0]=vec4(min(stepSize,maxStepSize),0.0,0.0,0.0);
 	}
@@ -0,0 +1,66 @@
+/***********************************************************************
+Water2StatsShader - Shader to reduce blocks of the conserved quantity
+grid to partial health statistics: summed water column height, maximum
+flow speed, number of wet cells, and maximum water column height.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform float blockSize;
+uniform vec2 gridSize;
+uniform float dryDepth;
+uniform float epsilon;
+uniform sampler2DRect bathymetrySampler;
+uniform sampler2DRect quantitySampler;
+
+void main()
+	{
+	/* Calculate the range of cell centers covered by this fragment's block: */
+	vec2 blockMin=floor(gl_FragCoord.xy)*blockSize+vec2(0.5,0.5);
+	vec2 blockMax=min(blockMin+vec2(blockSize,blockSize),gridSize);
+	
+	/* Accumulate the statistics of all cells in the block: */
+	vec4 stats=vec4(0.0,0.0,0.0,0.0);
+	for(float y=blockMin.y;y<blockMax.y;y+=1.0)
+		for(float x=blockMin.x;x<blockMax.x;x+=1.0)
+			{
+			/* Calculate the bathymetry elevation at the center of this cell: */
+			float b=(texture2DRect(bathymetrySampler,vec2(x-1.0,y-1.0)).r+
+			         texture2DRect(bathymetrySampler,vec2(x,y-1.0)).r+
+			         texture2DRect(bathymetrySampler,vec2(x-1.0,y)).r+
+			         texture2DRect(bathymetrySampler,vec2(x,y)).r)*0.25;
+			
+			/* Calculate the cell's water column height and desingularized flow velocity: */
+			vec3 q=texture2DRect(quantitySampler,vec2(x,y)).rgb;
+			float h=q.x-b;
+			float hp=max(h,0.0);
+			float h4=hp*hp*hp*hp;
+			vec2 uv=q.yz*(1.41421356237309*hp/sqrt(h4+max(h4,epsilon)));
+			
+			stats.r+=h;
+			stats.g=max(stats.g,length(uv));
+			if(h>dryDepth)
+				stats.b+=1.0;
+			stats.a=max(stats.a,h);
+			}
+	
+	/* Write the block's partial statistics: */
+	gl_FragColor=stats;
+	}
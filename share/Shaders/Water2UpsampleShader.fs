@@ -0,0 +1,55 @@
+/***********************************************************************
+Water2UpsampleShader - Shader to reconstruct conserved quantities and
+snow heights on a fine rendering grid from a coarse simulation grid and
+the fine bathymetry grid.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform float renderFactor;
+uniform float dryDepth;
+uniform sampler2DRect bathymetrySampler;
+uniform sampler2DRect snowSampler;
+uniform sampler2DRect quantitySampler;
+uniform sampler2DRect renderBathymetrySampler;
+
+void main()
+	{
+	/* Calculate the position of the fine cell center in coarse grid space: */
+	vec2 coarse=gl_FragCoord.xy/renderFactor;
+	
+	/* Interpolate the coarse conserved quantities and the coarse bathymetry elevation at the fine cell center: */
+	vec3 q=texture2DRect(quantitySampler,coarse).rgb;
+	float b=texture2DRect(bathymetrySampler,coarse-vec2(0.5,0.5)).r;
+	float h=q.r-b;
+	
+	/* Calculate the fine bathymetry elevation at the fine cell center: */
+	float fb=texture2DRect(renderBathymetrySampler,gl_FragCoord.xy-vec2(0.5,0.5)).r;
+	
+	/* Keep the coarse water surface elevation above the fine bathymetry, and keep dry coarse cells dry: */
+	float fh=h>dryDepth?max(q.r-fb,0.0):0.0;
+	
+	/* Scale the coarse discharges to preserve flow velocities at the fine water column height: */
+	vec2 fhuv=h>dryDepth?q.gb*(fh/h):vec2(0.0,0.0);
+	
+	/* Write the reconstructed conserved quantities and the interpolated snow height: */
+	gl_FragData[0]=vec4(fb+fh,fhuv,0.0);
+	gl_FragData[1]=vec4(texture2DRect(snowSampler,coarse).r,0.0,0.0,0.0);
+	}
@@ -1,6 +1,6 @@
 /***********************************************************************
 Water2WaterAddShader - Shader to render water-adding objects.
-Copyright (c) 2012-2023 Oliver Kreylos
+Copyright (c) 2012-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -19,10 +19,10 @@ with the Augmented Reality Sandbox; if not, write to the Free Software
 Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 ***********************************************************************/
 
-varying float scaledWaterAmount;
+varying float waterRate;
 
 void main()
 	{
 	/* Update the water texture: */
-	gl_FragColor=vec4(scaledWaterAmount);
+	gl_FragColor=vec4(waterRate);
 	}
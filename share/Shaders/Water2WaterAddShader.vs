@@ -1,6 +1,6 @@
 /***********************************************************************
 Water2WaterAddShader - Shader to render water-adding objects.
-Copyright (c) 2012-2014 Oliver Kreylos
+Copyright (c) 2012-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -20,16 +20,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 ***********************************************************************/
 
 uniform mat4 pmv; // Combined transformation from camera space to clip space
-uniform float stepSize;
 
 attribute float waterAmount;
 
-varying float scaledWaterAmount;
+varying float waterRate;
 
 void main()
 	{
-	/* Use the vertex attribute and the step size uniform to calculate the amount of water to add/remove: */
-	scaledWaterAmount=waterAmount*stepSize;
+	/* Pass the vertex attribute through as a rate; the water update shader scales it by the GPU-side step size: */
+	waterRate=waterAmount;
 	
 	/* Use the standard vertex transform: */
 	gl_Position=pmv*gl_Vertex;
@@ -0,0 +1,46 @@
+/***********************************************************************
+Water2WaterDiskShader - Shader to render batches of water-adding disks
+as instances of a single disk template.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+uniform mat4 pmv; // Combined transformation from camera space to clip space
+uniform vec3 diskX; // Camera-space direction of the water table's x axis
+uniform vec3 diskY; // Camera-space direction of the water table's y axis
+uniform float edgeWidth; // Width of the band around each disk's edge across which its rate decays to zero
+
+attribute vec3 diskVertex; // Template vertex as (cosine, sine) of its angle around the disk and 0.0 for the inner or 1.0 for the outer edge of the decay band
+attribute vec4 disk; // Per-instance disk center in camera space and disk radius
+attribute float diskRate; // Per-instance water rate
+
+varying float waterRate;
+
+void main()
+	{
+	/* Calculate the radius of the template vertex' edge of the decay band: */
+	float inner=max(disk.w-edgeWidth*0.5,0.0);
+	float radius=mix(inner,disk.w+edgeWidth*0.5,diskVertex.z);
+	
+	/* Pass the disk's rate through on the inner edge, and fade it out towards the outer edge: */
+	waterRate=diskRate*(1.0-diskVertex.z);
+	
+	/* Place the template vertex around the disk center and transform it to clip space: */
+	vec3 position=disk.xyz+(diskX*diskVertex.x+diskY*diskVertex.y)*radius;
+	gl_Position=pmv*vec4(position,1.0);
+	}
@@ -1,7 +1,7 @@
 /***********************************************************************
 Water2WaterUpdateShader - Shader to adjust the water surface height
 based on the additive water texture.
-Copyright (c) 2012-2025 Oliver Kreylos
+Copyright (c) 2012-2026 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
 
@@ -27,6 +27,7 @@ uniform sampler2DRect bathymetrySampler;
 uniform sampler2DRect snowSampler;
 uniform sampler2DRect quantitySampler;
 uniform sampler2DRect waterSampler;
+uniform sampler2DRect stepSizeSampler;
 uniform float snowLine;
 uniform float snowMelt;
 
@@ -47,8 +48,11 @@ void main()
 	/* Calculate the old water column height: */
 	float hOld=q.x-b;
 	
-	/* Calculate the effective changes in water and snow level: */
-	float precip=texture2DRect(waterSampler,gl_FragCoord.xy).r;
+	/* Retrieve the step size calculated on the GPU: */
+	float stepSize=texture2DRect(stepSizeSampler,vec2(0.5,0.5)).r;
+	
+	/* Calculate the effective changes in water and snow level from the water rate texture: */
+	float precip=texture2DRect(waterSampler,gl_FragCoord.xy).r*stepSize;
 	float dWater=precip;
 	float dSnow=precip*4.0; // Snow is four times fluffier than water
 	
@@ -61,9 +65,9 @@ void main()
 		}
 	
 	/* Melt snow into water: */
-	snowMelt=min(snowMelt,s);
-	dSnow=dSnow-snowMelt;
-	dWater=dWater+snowMelt/4.0; // Snow is four times fluffier than water
+	float melt=min(snowMelt*stepSize,s);
+	dSnow=dSnow-melt;
+	dWater=dWater+melt/4.0; // Snow is four times fluffier than water
 	
 	/* Update the snow height: */
 	s=max(s+dSnow,0.0);
@@ -0,0 +1,54 @@
+/***********************************************************************
+Water2WetTileShader - Shader to reduce the conserved quantity grid to a
+coarse grid of flags marking tiles that contain at least one wet cell.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform float tileSize;
+uniform vec2 gridSize;
+uniform float dryDepth;
+uniform sampler2DRect bathymetrySampler;
+uniform sampler2DRect quantitySampler;
+
+void main()
+	{
+	/* Calculate the range of cell centers covered by this fragment's tile: */
+	vec2 tileMin=floor(gl_FragCoord.xy)*tileSize+vec2(0.5,0.5);
+	vec2 tileMax=min(tileMin+vec2(tileSize,tileSize),gridSize);
+	
+	/* Check the tile's cells until the first wet one: */
+	bool wet=false;
+	for(float y=tileMin.y;!wet&&y<tileMax.y;y+=1.0)
+		for(float x=tileMin.x;!wet&&x<tileMax.x;x+=1.0)
+			{
+			/* Calculate the bathymetry elevation at the center of this cell: */
+			float b=(texture2DRect(bathymetrySampler,vec2(x-1.0,y-1.0)).r+
+			         texture2DRect(bathymetrySampler,vec2(x,y-1.0)).r+
+			         texture2DRect(bathymetrySampler,vec2(x-1.0,y)).r+
+			         texture2DRect(bathymetrySampler,vec2(x,y)).r)*0.25;
+			
+			/* Check the cell's water column height: */
+			wet=texture2DRect(quantitySampler,vec2(x,y)).r-b>dryDepth;
+			}
+	
+	/* Write the tile's wet flag: */
+	gl_FragColor=vec4(wet?1.0:0.0,0.0,0.0,0.0);
+	}